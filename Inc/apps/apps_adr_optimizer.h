@@ -0,0 +1,192 @@
+/**
+ * @file      apps_adr_optimizer.h
+ *
+ * @brief     On-device ADR optimizer: custom data rate distribution built from the link quality
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_ADR_OPTIMIZER_H
+#define APPS_ADR_OPTIMIZER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_helper.h"
+#include "lr1121_modem_lorawan_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of entries of the custom ADR list, one being drawn at random for each transmission
+ */
+#define APPS_ADR_OPTIMIZER_LIST_SIZE 16
+
+/**
+ * @brief Number of data rates the acknowledgements are counted for
+ */
+#define APPS_ADR_OPTIMIZER_NB_DATA_RATES 16
+
+/**
+ * @brief Confirmed uplinks at a data rate from which its success rate is taken into account
+ */
+#define APPS_ADR_OPTIMIZER_MIN_SAMPLES 4
+
+/**
+ * @brief Confirmed uplinks at a data rate from which its counts are halved, the recent ones weighting more
+ */
+#define APPS_ADR_OPTIMIZER_MAX_SAMPLES 32
+
+/**
+ * @brief Margin above the goal from which all the entries go to the chosen data rate, a quarter going to the next
+ * slower one below it
+ */
+#define APPS_ADR_OPTIMIZER_HEADROOM_DB 3
+
+/**
+ * @brief Entries given to the next slower data rate when the margin is short of the headroom
+ */
+#define APPS_ADR_OPTIMIZER_SAFE_ENTRIES 4
+
+/**
+ * @brief Entries given to the next faster data rate to measure it, when its margin is positive
+ */
+#define APPS_ADR_OPTIMIZER_EXPLORE_ENTRIES 1
+
+/**
+ * @brief Shortest time between two changes of the custom ADR list
+ */
+#define APPS_ADR_OPTIMIZER_MIN_INTERVAL_MS ( 600UL * 1000 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Application goals the data rates are chosen for
+ */
+typedef struct apps_adr_optimizer_goals_s
+{
+    uint8_t  payload_size;    //!< Typical payload size, the time on air of which is minimized to save energy
+    uint8_t  min_margin_db;   //!< Demodulation margin kept at the chosen data rate
+    uint16_t min_success;     //!< Lowest acknowledgement rate of a data rate, in per mille
+    uint32_t max_latency_ms;  //!< Highest time on air plus duty-cycle off time of an uplink, 0 if none
+} apps_adr_optimizer_goals_t;
+
+/**
+ * @brief ADR optimizer statistics
+ */
+typedef struct apps_adr_optimizer_stats_s
+{
+    bool     applied;                                     //!< The custom ADR list is used by the modem
+    uint8_t  list[APPS_ADR_OPTIMIZER_LIST_SIZE];          //!< Last custom ADR list applied
+    uint32_t nb_updates;                                  //!< Custom ADR lists applied
+    uint8_t  nb_sent[APPS_ADR_OPTIMIZER_NB_DATA_RATES];   //!< Recent confirmed uplinks per data rate
+    uint8_t  nb_acked[APPS_ADR_OPTIMIZER_NB_DATA_RATES];  //!< Acknowledged ones among them
+} apps_adr_optimizer_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Start the optimizer with the application goals, once the device joined the network
+ *
+ * The modem keeps its ADR profile until a custom ADR list is applied by @ref apps_adr_optimizer_process.
+ *
+ * @param [in] goals Application goals, copied, NULL to stop the optimizer
+ */
+void apps_adr_optimizer_init( const apps_adr_optimizer_goals_t* goals );
+
+/**
+ * @brief Count the acknowledgement of a confirmed uplink at its data rate
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_TX_DONE event handler.
+ *
+ * @param [in] data_rate Data rate of the uplink, APPS_AIRTIME_UNKNOWN_DATA_RATE if unknown
+ * @param [in] uplink_type Unconfirmed or confirmed uplink, only the confirmed ones being counted
+ * @param [in] tx_done_status Status of the TX_DONE event
+ */
+void apps_adr_optimizer_on_tx_done( uint8_t data_rate, lr1121_modem_uplink_type_t uplink_type,
+                                    lr1121_modem_tx_done_event_t tx_done_status );
+
+/**
+ * @brief Build the custom ADR list from the link quality, and apply it if it changed
+ *
+ * The margin of @ref apps_link_quality_get_health is moved to each data rate of the region by the difference of their
+ * sensitivities. The data rate of the shortest time on air is chosen among the ones keeping the margin goal, the
+ * success goal once APPS_ADR_OPTIMIZER_MIN_SAMPLES uplinks were acknowledged or not, and the latency goal, or the
+ * slowest one within the latency goal if none does. The list holds APPS_ADR_OPTIMIZER_EXPLORE_ENTRIES at the next
+ * faster data rate, APPS_ADR_OPTIMIZER_SAFE_ENTRIES at the next slower one if the margin is short of
+ * APPS_ADR_OPTIMIZER_HEADROOM_DB, and the chosen data rate in the rest.
+ *
+ * @remark To be called from the application main loop. The modem event interrupts are masked while the modem is
+ * requested.
+ *
+ * @param [in] context Chip implementation context
+ *
+ * @returns true if a new custom ADR list was applied
+ */
+bool apps_adr_optimizer_process( const void* context );
+
+/**
+ * @brief Get the optimizer statistics
+ *
+ * @param [out] stats Statistics
+ */
+void apps_adr_optimizer_get_stats( apps_adr_optimizer_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_ADR_OPTIMIZER_H
+
+/* --- EOF ------------------------------------------------------------------ */
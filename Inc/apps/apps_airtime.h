@@ -0,0 +1,204 @@
+/**
+ * @file      apps_airtime.h
+ *
+ * @brief     LoRa time-on-air model of the LoRaWAN uplinks and airtime-aware uplink planning
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_AIRTIME_H
+#define APPS_AIRTIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_lorawan_types.h"
+#include "lr1121_modem_radio_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Bytes added by the MAC layer to the application payload: MHDR, FHDR without FOpts, FPort and MIC
+ */
+#define APPS_AIRTIME_MAC_OVERHEAD 13
+
+/**
+ * @brief Preamble length of the LoRaWAN uplinks, in symbols
+ */
+#define APPS_AIRTIME_PREAMBLE_LEN 8
+
+/**
+ * @brief Value of an unknown data rate
+ */
+#define APPS_AIRTIME_UNKNOWN_DATA_RATE 0xFF
+
+/**
+ * @brief Largest number of items split by @ref apps_airtime_plan
+ */
+#define APPS_AIRTIME_PLAN_MAX_ITEMS 64
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Select the region whose data rates are used, the data rate being unknown until it is set or updated
+ *
+ * @param [in] region LoRaWAN region
+ *
+ * @returns true if the LoRa data rates of @p region are known
+ */
+bool apps_airtime_init( lr1121_modem_regions_t region );
+
+/**
+ * @brief Set the data rate of the next uplinks
+ *
+ * @param [in] data_rate LoRaWAN data rate, APPS_AIRTIME_UNKNOWN_DATA_RATE to forget it
+ *
+ * @returns true if @p data_rate is a LoRa data rate of the region
+ */
+bool apps_airtime_set_data_rate( uint8_t data_rate );
+
+/**
+ * @brief Infer the data rate of the next uplinks from their maximal payload size
+ *
+ * The modem does not report the data rate it uses, but the maximal payload size of the next transmission follows it.
+ * The slowest data rate allowing this size is selected, so that the time on air is never underestimated.
+ *
+ * @param [in] max_payload Maximal payload size reported by lr1121_modem_get_next_tx_max_payload
+ *
+ * @returns true if a data rate matches @p max_payload
+ */
+bool apps_airtime_update_data_rate( uint8_t max_payload );
+
+/**
+ * @brief Get the data rate of the next uplinks
+ *
+ * @returns LoRaWAN data rate, APPS_AIRTIME_UNKNOWN_DATA_RATE if not known
+ */
+uint8_t apps_airtime_get_data_rate( void );
+
+/**
+ * @brief Get the LoRa modulation parameters of a data rate of the region
+ *
+ * The coding rate is 4/5 and the low data rate optimization is set for the symbols of 16 ms or more, as the LoRaWAN
+ * uplinks use.
+ *
+ * @param [in] data_rate LoRaWAN data rate
+ * @param [out] mod_params LoRa modulation parameters
+ *
+ * @returns true if @p data_rate is a LoRa data rate of the region
+ */
+bool apps_airtime_get_lora_params( uint8_t data_rate, lr1121_modem_radio_mod_params_lora_t* mod_params );
+
+/**
+ * @brief Get the time on air of an uplink
+ *
+ * The time on air is read in constant time from the tables generated by tools/smtc_airtime_table.py.
+ *
+ * @param [in] data_rate LoRaWAN data rate
+ * @param [in] payload_size Application payload size, APPS_AIRTIME_MAC_OVERHEAD bytes being added by the MAC layer
+ *
+ * @returns Time on air in ms, 0 if @p data_rate is not a LoRa data rate of the region
+ */
+uint32_t apps_airtime_get_time_on_air_ms( uint8_t data_rate, uint8_t payload_size );
+
+/**
+ * @brief Get the time on air of a LoRa packet
+ *
+ * The time on air of the packets sent as the LoRaWAN uplinks, with an explicit header, a CRC and
+ * APPS_AIRTIME_PREAMBLE_LEN preamble symbols, is read from the tables for the modulations of the supported regions.
+ * It is computed by lr1121_modem_radio_get_lora_time_on_air_in_ms for any other packet, with the same result.
+ *
+ * @param [in] pkt_params LoRa packet parameters
+ * @param [in] mod_params LoRa modulation parameters
+ *
+ * @returns Time on air in ms
+ */
+uint32_t apps_airtime_get_lora_time_on_air_ms( const lr1121_modem_radio_pkt_params_lora_t* pkt_params,
+                                               const lr1121_modem_radio_mod_params_lora_t* mod_params );
+
+/**
+ * @brief Get the time the sub-band stays unavailable after a transmission, as the duty cycle of the region requires
+ *
+ * @param [in] time_on_air_ms Time on air of the transmission
+ *
+ * @returns Off time in ms, 0 if the region has no duty-cycle limit
+ */
+uint32_t apps_airtime_get_off_time_ms( uint32_t time_on_air_ms );
+
+/**
+ * @brief Split consecutive items in uplinks so that their total time on air is the shortest
+ *
+ * The items are packed in order, each uplink holding at least one item and up to @p max_payload bytes. Every split
+ * is weighed by the time on air at the current data rate, so that the padding of the last LoRa symbols is spent on
+ * items instead of on another uplink. The items are packed greedily if the data rate is not known, or if there are
+ * more than APPS_AIRTIME_PLAN_MAX_ITEMS of them.
+ *
+ * @param [in] sizes Item sizes
+ * @param [in] nb_items Number of items
+ * @param [in] max_payload Maximal payload size
+ * @param [out] time_on_air_ms Total time on air of the uplinks, 0 if the data rate is not known, can be NULL
+ *
+ * @returns Number of items of the first uplink, 0 if @p nb_items is 0
+ */
+uint8_t apps_airtime_plan( const uint8_t* sizes, uint8_t nb_items, uint8_t max_payload, uint32_t* time_on_air_ms );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_AIRTIME_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,160 @@
+/**
+ * @file      apps_downlink_rx.h
+ *
+ * @brief     Retrieval of the downlinks queued in the modem into a pool of buffers
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_DOWNLINK_RX_H
+#define APPS_DOWNLINK_RX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_lorawan_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of downlink buffers of the pool
+ */
+#define APPS_DOWNLINK_RX_POOL_SIZE 4
+
+/**
+ * @brief Largest payload of a downlink, the largest LoRaWAN application payload
+ */
+#define APPS_DOWNLINK_RX_MAX_PAYLOAD_SIZE 242
+
+/**
+ * @brief Largest number of downlinks retrieved by a call of @ref apps_downlink_rx_drain
+ */
+#define APPS_DOWNLINK_RX_MAX_DRAIN 16
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Downlink held in a buffer of the pool
+ */
+typedef struct apps_downlink_rx_frame_s
+{
+    lr1121_modem_downlink_metadata_t metadata;      //!< Metadata, read with the payload
+    uint32_t                         timestamp_ms;  //!< RTC time of the retrieval from the modem
+    uint8_t                          size;          //!< Payload size
+    uint8_t                          payload[APPS_DOWNLINK_RX_MAX_PAYLOAD_SIZE];  //!< Payload
+} apps_downlink_rx_frame_t;
+
+/**
+ * @brief Downlink pool statistics since reset
+ */
+typedef struct apps_downlink_rx_stats_s
+{
+    uint32_t nb_received;  //!< Downlinks retrieved from the modem
+    uint32_t nb_queued;    //!< Downlinks retrieved after the first one of a drain, waiting in the modem before
+    uint32_t nb_dropped;   //!< Unclaimed downlinks evicted by newer ones, the pool being full
+    uint32_t nb_deferred;  //!< Drains stopped with downlinks left in the modem, all the buffers being held
+    uint32_t nb_errors;    //!< Modem read failures
+    uint8_t  nb_ready;     //!< Downlinks waiting to be taken
+    uint8_t  nb_held;      //!< Downlinks taken and not released yet
+    uint8_t  max_used;     //!< Highest number of buffers in use
+} apps_downlink_rx_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Retrieve all the downlinks waiting in the modem
+ *
+ * Each downlink is read with its metadata straight in a free buffer of the pool, until the modem reports no remaining
+ * downlink. When no buffer is free, the oldest downlink not taken yet is dropped for the new one; when all the buffers
+ * are held, the remaining downlinks are left in the modem for the next call.
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_DOWN_DATA event handler. The modem also raises one event
+ * per downlink: once drained, the next events find no downlink.
+ *
+ * @param [in] context Chip implementation context
+ *
+ * @returns Number of downlinks retrieved
+ */
+uint8_t apps_downlink_rx_drain( const void* context );
+
+/**
+ * @brief Take the oldest downlink retrieved from the modem
+ *
+ * The downlink is handed by reference and its buffer stays held until it is released.
+ *
+ * @returns Downlink, NULL if none waits
+ */
+const apps_downlink_rx_frame_t* apps_downlink_rx_take( void );
+
+/**
+ * @brief Release the buffer of a downlink taken with @ref apps_downlink_rx_take
+ *
+ * @param [in] frame Downlink
+ */
+void apps_downlink_rx_release( const apps_downlink_rx_frame_t* frame );
+
+/**
+ * @brief Get the pool statistics
+ *
+ * @param [out] stats Statistics
+ */
+void apps_downlink_rx_get_stats( apps_downlink_rx_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_DOWNLINK_RX_H
+
+/* --- EOF ------------------------------------------------------------------ */
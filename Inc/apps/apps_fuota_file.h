@@ -0,0 +1,229 @@
+/**
+ * @file      apps_fuota_file.h
+ *
+ * @brief     Streaming extraction of the FUOTA file into the MCU flash
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_FUOTA_FILE_H
+#define APPS_FUOTA_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Maximal size of a FUOTA file stored by the modem
+ */
+#define APPS_FUOTA_FILE_MAX_SIZE 32768
+
+/**
+ * @brief Size of the fragments read from the modem: one flash row, below the 350 bytes SPI read limit
+ */
+#define APPS_FUOTA_FILE_FRAGMENT_SIZE 256
+
+/**
+ * @brief Magic word starting the header of an image file, "SFU1" little endian. Files without it are raw files.
+ */
+#define APPS_FUOTA_FILE_HEADER_MAGIC 0x31554653
+
+/**
+ * @brief Size of the header of an image file
+ */
+#define APPS_FUOTA_FILE_HEADER_SIZE 28
+
+/**
+ * @brief Image file flag: the payload is a delta patch against the running image (see tools/smtc_fuota_file.py)
+ */
+#define APPS_FUOTA_FILE_FLAG_DELTA 0x01
+
+/**
+ * @brief Image file flag: the payload is LZSS compressed, the decompressed stream being the image or the delta patch
+ */
+#define APPS_FUOTA_FILE_FLAG_COMPRESSED 0x02
+
+/**
+ * @brief Image file flag: the image is an encrypted Modem-E firmware to be written in the modem, not a MCU firmware
+ * (see apps_modem_update.h). A modem image cannot be a delta patch.
+ */
+#define APPS_FUOTA_FILE_FLAG_MODEM 0x04
+
+/**
+ * @brief Largest LZSS window accepted, in bits: the window is a RAM buffer of 2^APPS_FUOTA_FILE_WINDOW_BITS_MAX bytes
+ */
+#define APPS_FUOTA_FILE_WINDOW_BITS_MAX 11
+
+/**
+ * @brief Number of file bytes between two checkpoints of the extraction in the journal
+ */
+#define APPS_FUOTA_FILE_CHECKPOINT_PERIOD 4096
+
+/**
+ * @brief Minimal number of pages of the journal: two checkpoint slots of two pages, written alternately
+ */
+#define APPS_FUOTA_FILE_JOURNAL_MIN_NB_PAGES 4
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Status of a FUOTA file extraction
+ */
+typedef enum apps_fuota_file_status_e
+{
+    APPS_FUOTA_FILE_STATUS_OK,               //!< File extracted in its staging area and CRC verified
+    APPS_FUOTA_FILE_STATUS_INVALID_PARAM,    //!< Empty file, or file or image larger than its staging area
+    APPS_FUOTA_FILE_STATUS_MODEM_ERROR,      //!< File size, CRC or fragment read from the modem failed
+    APPS_FUOTA_FILE_STATUS_FLASH_ERROR,      //!< Staging area erase or programming failed
+    APPS_FUOTA_FILE_STATUS_CRC_ERROR,        //!< CRC of the file or of the staged image is not the expected one
+    APPS_FUOTA_FILE_STATUS_FORMAT_ERROR,     //!< Invalid image header or delta patch
+    APPS_FUOTA_FILE_STATUS_SOURCE_MISMATCH,  //!< The delta patch was not generated against the running image
+} apps_fuota_file_status_t;
+
+/**
+ * @brief Flash areas of the FUOTA file extraction
+ */
+typedef struct apps_fuota_file_config_s
+{
+    uint32_t file_first_page;     //!< First flash page of the raw file staging area
+    uint16_t file_nb_pages;       //!< Number of flash pages of the raw file staging area
+    uint32_t image_first_page;    //!< First flash page of the image staging area, above the running image
+    uint16_t image_nb_pages;      //!< Number of flash pages of the image staging area
+    uint32_t journal_first_page;  //!< First flash page of the extraction journal
+    uint16_t journal_nb_pages;    //!< Number of flash pages of the extraction journal, 0 to disable the checkpoints
+} apps_fuota_file_config_t;
+
+/**
+ * @brief Header of an image file, little endian
+ */
+typedef struct apps_fuota_file_header_s
+{
+    uint32_t magic;        //!< APPS_FUOTA_FILE_HEADER_MAGIC
+    uint8_t  flags;        //!< APPS_FUOTA_FILE_FLAG_xxx
+    uint8_t  window_bits;  //!< Compressed payload: LZSS window size in bits, 0 otherwise
+    uint8_t  length_bits;  //!< Compressed payload: LZSS match length size in bits, 0 otherwise
+    uint32_t image_size;   //!< Size of the image written in the image staging area
+    uint32_t image_crc;    //!< CRC32 of the image
+    uint32_t source_size;  //!< Delta patch: size of the image the patch was generated against, 0 otherwise
+    uint32_t source_crc;   //!< Delta patch: CRC32 of the image the patch was generated against, 0 otherwise
+    uint32_t version;      //!< Version of the image, application defined
+} apps_fuota_file_header_t;
+
+/**
+ * @brief Information on an extracted FUOTA file
+ */
+typedef struct apps_fuota_file_info_s
+{
+    uint32_t                 size;           //!< File size in bytes, as reported by the modem
+    uint32_t                 expected_crc;   //!< CRC32 reported by the modem
+    uint32_t                 crc;            //!< CRC32 computed on the received file
+    uint32_t                 duration_ms;    //!< Extraction duration, erase included
+    uint32_t                 resume_offset;  //!< File offset the extraction resumed from, 0 if started from scratch
+    bool                     is_image;       //!< true if the file starts with an image header
+    apps_fuota_file_header_t header;         //!< Image header, valid if is_image is true
+} apps_fuota_file_info_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Set the flash areas of the FUOTA file extraction and look for an interrupted extraction in the journal
+ *
+ * @param [in] config Flash areas
+ */
+void apps_fuota_file_init( const apps_fuota_file_config_t* config );
+
+/**
+ * @brief Tell if an extraction was interrupted by a reset after its last checkpoint
+ *
+ * @remark Calling @ref apps_fuota_file_extract again resumes it, provided the modem still holds the same file.
+ *
+ * @returns true if the journal holds a checkpoint
+ */
+bool apps_fuota_file_is_pending( void );
+
+/**
+ * @brief Extract the FUOTA file received by the modem in the MCU flash
+ *
+ * The file is streamed fragment by fragment and never buffered in RAM, while its CRC is accumulated and checked
+ * against the one reported by the modem:
+ * - a file starting with an image header is an image, written in the image staging area. Its payload is either the
+ *   image itself or, with APPS_FUOTA_FILE_FLAG_DELTA, a delta patch applied on the fly against the running image,
+ *   possibly LZSS compressed (APPS_FUOTA_FILE_FLAG_COMPRESSED) and decompressed on the fly as well. The CRC of the
+ *   staged image is then checked against the one of the header.
+ * - any other file is copied as is in the raw file staging area.
+ *
+ * Every APPS_FUOTA_FILE_CHECKPOINT_PERIOD bytes, the extraction state (file identity, CRC so far, staging area
+ * position and decoder state) is saved in the journal. If the MCU is reset before the end, the next call resumes from
+ * the last checkpoint instead of the beginning of the file. The journal is cleared when the extraction terminates,
+ * unless it failed on a modem error.
+ *
+ * @remark To be called from the application main loop after a successful LR1121_MODEM_LORAWAN_EVENT_FUOTA_DONE event,
+ * never from an interrupt: the staging area erase and programming take up to a few seconds.
+ *
+ * @param [in] context Chip implementation context
+ * @param [out] info Information on the extracted file, can be NULL
+ *
+ * @returns Extraction status
+ */
+apps_fuota_file_status_t apps_fuota_file_extract( const void* context, apps_fuota_file_info_t* info );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_FUOTA_FILE_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,196 @@
+/**
+ * @file      apps_fuota_image.h
+ *
+ * @brief     A/B image update: bank swap activation with boot counting and rollback
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_FUOTA_IMAGE_H
+#define APPS_FUOTA_IMAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Default number of boots a new image is given to call @ref apps_fuota_image_confirm before the rollback
+ */
+#define APPS_FUOTA_IMAGE_MAX_BOOT_ATTEMPTS 3
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Status of the image operations
+ */
+typedef enum apps_fuota_image_status_e
+{
+    APPS_FUOTA_IMAGE_STATUS_OK,             //!< Operation done
+    APPS_FUOTA_IMAGE_STATUS_INVALID_PARAM,  //!< Image larger than the staging area
+    APPS_FUOTA_IMAGE_STATUS_INVALID_STATE,  //!< Operation not allowed in the current state
+    APPS_FUOTA_IMAGE_STATUS_CRC_ERROR,      //!< CRC of the staging area is not the one of the image header
+    APPS_FUOTA_IMAGE_STATUS_FLASH_ERROR,    //!< Key-value store write, persistent data copy or bank swap failed
+} apps_fuota_image_status_t;
+
+/**
+ * @brief Update state, kept in the key-value store
+ */
+typedef enum apps_fuota_image_state_e
+{
+    APPS_FUOTA_IMAGE_STATE_IDLE,         //!< The running image is confirmed
+    APPS_FUOTA_IMAGE_STATE_STAGED,       //!< A verified image waits in the staging bank
+    APPS_FUOTA_IMAGE_STATE_TRIAL,        //!< The new image runs, the previous one waits in the staging bank
+    APPS_FUOTA_IMAGE_STATE_ROLLED_BACK,  //!< The new image was not confirmed in time, the previous one runs again
+} apps_fuota_image_state_t;
+
+/**
+ * @brief Header of an image
+ */
+typedef struct apps_fuota_image_header_s
+{
+    uint32_t version;  //!< Version of the image, application defined, 0 if unknown
+    uint32_t size;     //!< Size of the image in bytes, 0 if unknown
+    uint32_t crc;      //!< CRC32 of the image
+} apps_fuota_image_header_t;
+
+/**
+ * @brief Flash areas and policy of the image updates
+ */
+typedef struct apps_fuota_image_config_s
+{
+    uint32_t image_first_page;       //!< First flash page of the image staging area, the start of the second bank
+    uint16_t image_nb_pages;         //!< Number of flash pages of the image staging area
+    uint32_t persistent_first_page;  //!< First flash page of the persistent data, in the second bank
+    uint16_t persistent_nb_pages;    //!< Number of flash pages of the persistent data
+    uint8_t  kv_key;                 //!< Key of the update state in the key-value store
+    uint8_t  max_boot_attempts;      //!< Number of boots a new image is given to be confirmed
+} apps_fuota_image_config_t;
+
+/**
+ * @brief Update information
+ */
+typedef struct apps_fuota_image_info_s
+{
+    apps_fuota_image_state_t  state;       //!< Update state
+    uint8_t                   boot_count;  //!< Number of boots of the new image, in APPS_FUOTA_IMAGE_STATE_TRIAL
+    bool                      swapped;     //!< true if the firmware runs from the second physical bank
+    apps_fuota_image_header_t running;     //!< Header of the running image
+    apps_fuota_image_header_t staged;      //!< Header of the image in the staging bank, the previous one after a swap
+} apps_fuota_image_info_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Load the update state and count the boots of a new image
+ *
+ * An image is activated by swapping the flash banks (BFB2 option bit): the staging bank is mapped at 0x08000000 and
+ * runs without being copied, while the previous image stays in the other bank. A new image has max_boot_attempts
+ * boots to call @ref apps_fuota_image_confirm: otherwise, the banks are swapped back and the previous image runs again.
+ *
+ * @remark To be called at the very beginning of the application, after the key-value store is mounted: the MCU is
+ * reset here if the new image has to be rolled back.
+ *
+ * @param [in] config Flash areas and policy
+ *
+ * @returns Update state
+ */
+apps_fuota_image_state_t apps_fuota_image_init( const apps_fuota_image_config_t* config );
+
+/**
+ * @brief Get the update information
+ *
+ * @param [out] info Update information
+ */
+void apps_fuota_image_get_info( apps_fuota_image_info_t* info );
+
+/**
+ * @brief Record the image written in the staging area, once its CRC is checked
+ *
+ * @remark Not allowed in APPS_FUOTA_IMAGE_STATE_TRIAL, when the staging bank holds the image to roll back to.
+ *
+ * @param [in] header Header of the image
+ *
+ * @returns Operation status
+ */
+apps_fuota_image_status_t apps_fuota_image_stage( const apps_fuota_image_header_t* header );
+
+/**
+ * @brief Run the staged image: copy the persistent data to the running bank and swap the banks
+ *
+ * The persistent data (key-value store, telemetry log) are copied at the same offset of the running bank, which becomes
+ * the second bank after the swap, so that they are found at the same address by the new image.
+ *
+ * @remark To be called from the application main loop in APPS_FUOTA_IMAGE_STATE_STAGED: copying the persistent data
+ * takes up to a few seconds.
+ *
+ * @returns Operation status, does not return if the banks are swapped
+ */
+apps_fuota_image_status_t apps_fuota_image_activate( void );
+
+/**
+ * @brief Confirm that the new image is healthy, which cancels the rollback
+ *
+ * @returns Operation status, APPS_FUOTA_IMAGE_STATUS_OK if there is nothing to confirm
+ */
+apps_fuota_image_status_t apps_fuota_image_confirm( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_FUOTA_IMAGE_H
+
+/* --- EOF ------------------------------------------------------------------ */
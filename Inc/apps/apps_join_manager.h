@@ -0,0 +1,179 @@
+/**
+ * @file      apps_join_manager.h
+ *
+ * @brief     Join procedure with a randomized backoff and a spread join data rate distribution
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_JOIN_MANAGER_H
+#define APPS_JOIN_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_lorawan_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Backoff window after the first join failure, doubled at each following one
+ */
+#define APPS_JOIN_MANAGER_BACKOFF_BASE_MS ( 10UL * 1000 )
+
+/**
+ * @brief Largest backoff window
+ */
+#define APPS_JOIN_MANAGER_BACKOFF_MAX_MS ( 600UL * 1000 )
+
+/**
+ * @brief Join failures after which the fastest data rate left is dropped from the join data rate distribution
+ */
+#define APPS_JOIN_MANAGER_FAILURES_PER_STEP 2
+
+/**
+ * @brief Value returned by @ref apps_join_manager_process when no join request is scheduled
+ */
+#define APPS_JOIN_MANAGER_IDLE UINT32_MAX
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Join manager statistics
+ *
+ * The time to join runs from @ref apps_join_manager_start to the JOINED event, the start jitter and the backoffs
+ * included.
+ */
+typedef struct apps_join_manager_stats_s
+{
+    bool     joining;                                                  //!< A join procedure runs
+    uint16_t nb_failures;                                              //!< Join failures of the running procedure
+    uint32_t next_join_ms;                                             //!< Time before the next join request
+    uint8_t  distribution[LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH];  //!< Last join data rate distribution
+    uint32_t nb_joins;                                                 //!< Join procedures that succeeded
+    uint16_t last_attempts;                                            //!< Join requests of the last success
+    uint32_t last_time_ms;                                             //!< Time to join of the last success
+    uint32_t min_time_ms;                                              //!< Shortest time to join
+    uint32_t max_time_ms;                                              //!< Longest time to join
+    uint32_t avg_time_ms;                                              //!< Average time to join
+} apps_join_manager_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Start a join procedure
+ *
+ * The pseudo-random generator is seeded from the random number generator of the chip, then the first join request is
+ * scheduled after a random delay, so that devices powered up together do not join together.
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_RESET event handler, in place of @ref lr1121_modem_join,
+ * once the region is set and given to @ref apps_airtime_init.
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] start_jitter_ms Largest delay before the first join request
+ */
+void apps_join_manager_start( const void* context, uint32_t start_jitter_ms );
+
+/**
+ * @brief Report a join failure
+ *
+ * The automatic retry of the modem is cancelled, and the next join request is scheduled after a random delay within
+ * the backoff window, which doubles at each failure from APPS_JOIN_MANAGER_BACKOFF_BASE_MS up to
+ * APPS_JOIN_MANAGER_BACKOFF_MAX_MS.
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_JOIN_FAIL event handler.
+ *
+ * @param [in] context Chip implementation context
+ */
+void apps_join_manager_on_join_fail( const void* context );
+
+/**
+ * @brief Report the end of the join procedure and record its time to join
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_JOINED event handler.
+ */
+void apps_join_manager_on_joined( void );
+
+/**
+ * @brief Send the scheduled join request when its time has come
+ *
+ * The join data rate distribution is set first. Each LoRa data rate of the region at 125 kHz is drawn with a weight
+ * inversely proportional to the time on air of a join request, so that each spreading factor carries the same share
+ * of the airtime. Every APPS_JOIN_MANAGER_FAILURES_PER_STEP failures the fastest data rate left is dropped, until the
+ * slowest one only is left and the distribution starts over.
+ *
+ * @remark To be called from the application main loop. The modem event interrupts are masked while the modem is
+ * requested.
+ *
+ * @param [in] context Chip implementation context
+ *
+ * @returns Time in ms before the function has to be called again if no event occurs, APPS_JOIN_MANAGER_IDLE if no join
+ * request is scheduled
+ */
+uint32_t apps_join_manager_process( const void* context );
+
+/**
+ * @brief Get the join manager statistics
+ *
+ * @param [out] stats Statistics
+ */
+void apps_join_manager_get_stats( apps_join_manager_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_JOIN_MANAGER_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,161 @@
+/**
+ * @file      apps_kv_store.h
+ *
+ * @brief     Wear-leveled key-value store in the user flash area
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_KV_STORE_H
+#define APPS_KV_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of keys, valid keys are 0 to APPS_KV_STORE_MAX_KEYS - 1
+ */
+#define APPS_KV_STORE_MAX_KEYS 32
+
+/**
+ * @brief Maximal size of a value
+ */
+#define APPS_KV_STORE_MAX_VALUE_SIZE 64
+
+/**
+ * @brief Minimal number of pages of the store: one page in use, one page being filled and one spare page
+ */
+#define APPS_KV_STORE_MIN_NB_PAGES 3
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Mount the key-value store and build its RAM index
+ *
+ * The store is an append-only log of CRC protected records over a range of user flash pages used as a ring: updating
+ * a value appends a new record, a 4-byte value costing a single double-word program. When the ring is full, the
+ * oldest page is compacted: its live records are copied to the head and the page is erased.
+ *
+ * @remark The store is not reentrant: all the functions must be called from the application main loop, never from an
+ * interrupt.
+ *
+ * @param [in] first_page First flash page of the store, in the user flash area
+ * @param [in] nb_pages Number of flash pages of the store, at least APPS_KV_STORE_MIN_NB_PAGES
+ *
+ * @returns true if the store is mounted, false if the page range is invalid or a flash operation failed
+ */
+bool apps_kv_store_init( uint32_t first_page, uint8_t nb_pages );
+
+/**
+ * @brief Read a value
+ *
+ * @param [in] key Key of the value
+ * @param [out] value Buffer receiving the value
+ * @param [in] size Size of @p value
+ * @param [out] length Length of the value, can be NULL
+ *
+ * @returns true if the value is found and fits in @p value
+ */
+bool apps_kv_store_read( uint8_t key, void* value, uint8_t size, uint8_t* length );
+
+/**
+ * @brief Write a value
+ *
+ * @remark Nothing is written if the stored value is identical. The oldest page is compacted first if the store is
+ * full, which takes a page erase.
+ *
+ * @param [in] key Key of the value
+ * @param [in] value Value to be written
+ * @param [in] length Length of @p value, from 1 to APPS_KV_STORE_MAX_VALUE_SIZE
+ *
+ * @returns true if the value is written
+ */
+bool apps_kv_store_write( uint8_t key, const void* value, uint8_t length );
+
+/**
+ * @brief Delete a value
+ *
+ * @param [in] key Key of the value
+ *
+ * @returns true if the value is deleted or was not present
+ */
+bool apps_kv_store_delete( uint8_t key );
+
+/**
+ * @brief Compact the oldest page in advance if the store is almost full
+ *
+ * @remark To be called from the application main loop: it keeps a free page ahead so that writes do not have to
+ * erase a page. At most one page is compacted per call.
+ */
+void apps_kv_store_process( void );
+
+/**
+ * @brief Get the number of erased pages of the store
+ *
+ * @returns Number of erased pages
+ */
+uint8_t apps_kv_store_get_nb_free_pages( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_KV_STORE_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,263 @@
+/**
+ * @file      apps_link_quality.h
+ *
+ * @brief     Link quality monitor: downlink RSSI/SNR statistics, link checks and link health score
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_LINK_QUALITY_H
+#define APPS_LINK_QUALITY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_lorawan_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of the last downlinks the windowed statistics are computed on
+ */
+#define APPS_LINK_QUALITY_WINDOW_SIZE 16
+
+/**
+ * @brief Weight of a new downlink in the exponentially weighted statistics, as a power of 2: 1/8
+ */
+#define APPS_LINK_QUALITY_EWMA_SHIFT 3
+
+/**
+ * @brief Number of downlink windows and of data rates the statistics are kept for
+ */
+#define APPS_LINK_QUALITY_NB_WINDOWS 16
+#define APPS_LINK_QUALITY_NB_DATA_RATES 16
+
+/**
+ * @brief Demodulation margin giving the highest link score
+ */
+#define APPS_LINK_QUALITY_GOOD_MARGIN_DB 15
+
+/**
+ * @brief Uplinks without downlink from which the link score is halved
+ */
+#define APPS_LINK_QUALITY_MAX_LOST 32
+
+/**
+ * @brief Lowest link scores of the good and fair levels
+ */
+#define APPS_LINK_QUALITY_GOOD_SCORE 70
+#define APPS_LINK_QUALITY_FAIR_SCORE 40
+
+/**
+ * @brief Link score when no margin is known yet
+ */
+#define APPS_LINK_QUALITY_UNKNOWN_SCORE 0xFF
+
+/**
+ * @brief Time after which a link check answer is too old to give the margin, and a new link check is due
+ */
+#define APPS_LINK_QUALITY_LINK_CHECK_PERIOD_MS ( 24UL * 3600 * 1000 )
+
+/**
+ * @brief Shortest time between two link checks requested because the link degrades
+ */
+#define APPS_LINK_QUALITY_LINK_CHECK_MIN_INTERVAL_MS ( 3600UL * 1000 )
+
+/**
+ * @brief Uplinks without downlink from which a link check is requested
+ */
+#define APPS_LINK_QUALITY_LINK_CHECK_LOST 8
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Link health level
+ */
+typedef enum apps_link_quality_level_e
+{
+    APPS_LINK_QUALITY_LEVEL_UNKNOWN,  //!< No downlink nor link check answer yet
+    APPS_LINK_QUALITY_LEVEL_POOR,     //!< Score below APPS_LINK_QUALITY_FAIR_SCORE
+    APPS_LINK_QUALITY_LEVEL_FAIR,     //!< Score below APPS_LINK_QUALITY_GOOD_SCORE
+    APPS_LINK_QUALITY_LEVEL_GOOD,
+} apps_link_quality_level_t;
+
+/**
+ * @brief Statistics of the downlinks of a window, of a data rate, or of all of them
+ *
+ * The SNR is given in 0.25 dB, as snr_integer * 4 + snr_quarter in the downlink metadata.
+ */
+typedef struct apps_link_quality_stats_s
+{
+    uint32_t nb_downlinks;      //!< Downlinks received since reset
+    int16_t  rssi_dbm;          //!< Exponentially weighted RSSI
+    int16_t  snr_qdb;           //!< Exponentially weighted SNR
+    uint8_t  nb_window;         //!< Downlinks among the last APPS_LINK_QUALITY_WINDOW_SIZE ones, the following
+                                //!< fields being meaningless if 0
+    int16_t  rssi_avg_dbm;      //!< Average RSSI of the downlinks of the window
+    int16_t  rssi_min_dbm;      //!< Lowest RSSI of the downlinks of the window
+    int16_t  snr_avg_qdb;       //!< Average SNR of the downlinks of the window
+    int16_t  snr_min_qdb;       //!< Lowest SNR of the downlinks of the window
+} apps_link_quality_stats_t;
+
+/**
+ * @brief Link health, summing up the downlinks, the link checks and the uplinks without downlink
+ */
+typedef struct apps_link_quality_health_s
+{
+    uint8_t                   score;             //!< From 0 to 100, APPS_LINK_QUALITY_UNKNOWN_SCORE if unknown
+    apps_link_quality_level_t level;             //!< Level of the score
+    int8_t                    margin_db;         //!< Demodulation margin the score is based on
+    uint8_t                   margin_data_rate;  //!< Data rate of the margin, APPS_AIRTIME_UNKNOWN_DATA_RATE if unknown
+    uint8_t                   gateway_count;     //!< Gateways of the last link check answer, 0 if none
+    uint16_t                  nb_lost;           //!< Uplinks sent since the last downlink
+    uint32_t                  lost_since_s;      //!< Time since the last downlink
+} apps_link_quality_health_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Add the metadata of a received downlink to the statistics
+ *
+ * The demodulation margin of the downlink is its SNR above the demodulation floor of its spreading factor, known from
+ * the data rates of the region set with @ref apps_airtime_init.
+ *
+ * @remark This function can be called from the modem event handler.
+ *
+ * @param [in] metadata Downlink metadata
+ */
+void apps_link_quality_add_downlink( const lr1121_modem_downlink_metadata_t* metadata );
+
+/**
+ * @brief Read the link check answer from the modem after a LR1121_MODEM_LORAWAN_EVENT_LINK_CHECK event
+ *
+ * @remark To be called from the modem event handler.
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] status Event data, LR1121_MODEM_LINK_CHECK_RECEIVED if the network answered
+ */
+void apps_link_quality_on_link_check( const void* context, uint8_t status );
+
+/**
+ * @brief Read the number of uplinks sent and the time elapsed since the last downlink
+ *
+ * @remark To be called from the modem event handler, once an uplink is sent.
+ *
+ * @param [in] context Chip implementation context
+ */
+void apps_link_quality_read_lost_connection( const void* context );
+
+/**
+ * @brief Get the link health
+ *
+ * The score follows the margin of the last link check answer, the uplink margin seen by the best gateway, or the
+ * exponentially weighted margin of the downlinks without any recent answer: 100 from APPS_LINK_QUALITY_GOOD_MARGIN_DB
+ * and more, down to 0 for no margin. An answer from several gateways adds 10, and the uplinks without downlink
+ * take up to half of the score off, APPS_LINK_QUALITY_MAX_LOST of them halving it.
+ *
+ * @param [out] health Link health
+ */
+void apps_link_quality_get_health( apps_link_quality_health_t* health );
+
+/**
+ * @brief Tell if a link check should be requested
+ *
+ * A link check is due when no answer was received for APPS_LINK_QUALITY_LINK_CHECK_PERIOD_MS, or when the link is
+ * poor or APPS_LINK_QUALITY_LINK_CHECK_LOST uplinks were sent without downlink, at most once per
+ * APPS_LINK_QUALITY_LINK_CHECK_MIN_INTERVAL_MS.
+ *
+ * @returns true if a link check should be requested
+ */
+bool apps_link_quality_is_link_check_due( void );
+
+/**
+ * @brief Record that a link check was requested
+ */
+void apps_link_quality_on_link_check_requested( void );
+
+/**
+ * @brief Get the statistics of the downlinks received in a window
+ *
+ * @param [in] window Downlink window
+ * @param [out] stats Statistics
+ *
+ * @returns true if a downlink was received in @p window
+ */
+bool apps_link_quality_get_window_stats( lr1121_modem_downlink_window_t window, apps_link_quality_stats_t* stats );
+
+/**
+ * @brief Get the statistics of the downlinks received at a data rate
+ *
+ * @param [in] data_rate LoRaWAN data rate
+ * @param [out] stats Statistics
+ *
+ * @returns true if a downlink was received at @p data_rate
+ */
+bool apps_link_quality_get_data_rate_stats( uint8_t data_rate, apps_link_quality_stats_t* stats );
+
+/**
+ * @brief Get the statistics of all the downlinks
+ *
+ * @param [out] stats Statistics
+ *
+ * @returns true if a downlink was received
+ */
+bool apps_link_quality_get_stats( apps_link_quality_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_LINK_QUALITY_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,184 @@
+/**
+ * @file      apps_modem_update.h
+ *
+ * @brief     LR1121 Modem-E firmware update from an image staged in the MCU flash
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_MODEM_UPDATE_H
+#define APPS_MODEM_UPDATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_bootloader_types.h"
+#include "lr1121_modem_modem_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/**
+ * @brief Pack a Modem-E version in the version field of an image
+ */
+#define APPS_MODEM_UPDATE_VERSION( major, minor, patch ) \
+    ( ( ( uint32_t ) ( major ) << 16 ) | ( ( uint32_t ) ( minor ) << 8 ) | ( uint32_t ) ( patch ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of attempts of an update, MCU resets included, before it is given up
+ */
+#define APPS_MODEM_UPDATE_MAX_ATTEMPTS 3
+
+/**
+ * @brief Version type reported by the LR1121 bootloader, the running firmware reporting another one
+ */
+#define APPS_MODEM_UPDATE_BOOTLOADER_TYPE 0xDF
+
+/**
+ * @brief Maximal time for the new firmware to answer after the reboot
+ */
+#define APPS_MODEM_UPDATE_BOOT_TIMEOUT_MS 3000
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Status of a modem firmware update
+ */
+typedef enum apps_modem_update_status_e
+{
+    APPS_MODEM_UPDATE_STATUS_OK,                //!< New firmware written and running with the expected version
+    APPS_MODEM_UPDATE_STATUS_INVALID_PARAM,     //!< Empty image, or size not a multiple of 4 bytes
+    APPS_MODEM_UPDATE_STATUS_CRC_ERROR,         //!< CRC of the staged image is not the expected one
+    APPS_MODEM_UPDATE_STATUS_FLASH_ERROR,       //!< Update record write in the key-value store failed
+    APPS_MODEM_UPDATE_STATUS_BOOTLOADER_ERROR,  //!< The chip did not enter its bootloader
+    APPS_MODEM_UPDATE_STATUS_ERASE_ERROR,       //!< Modem flash erase failed
+    APPS_MODEM_UPDATE_STATUS_WRITE_ERROR,       //!< Modem flash write failed
+    APPS_MODEM_UPDATE_STATUS_VERSION_ERROR,     //!< The new firmware does not answer, or with another version
+} apps_modem_update_status_t;
+
+/**
+ * @brief Encrypted modem firmware image staged in the MCU flash
+ *
+ * The image is the array of 32-bit words of the encrypted firmware, stored little endian as it is in RAM: the words
+ * are sent to the bootloader without being copied.
+ */
+typedef struct apps_modem_update_image_s
+{
+    uint32_t address;  //!< Address of the image in the MCU flash, 4-byte aligned
+    uint32_t size;     //!< Size of the image in bytes, multiple of 4
+    uint32_t crc;      //!< CRC32 of the image
+    uint32_t version;  //!< Expected Modem-E version, see APPS_MODEM_UPDATE_VERSION, 0 to skip the check
+} apps_modem_update_image_t;
+
+/**
+ * @brief Information on a modem firmware update
+ */
+typedef struct apps_modem_update_info_s
+{
+    lr1121_bootloader_version_t bootloader;      //!< Version reported by the bootloader
+    lr1121_modem_version_t      modem;           //!< Version reported by the new firmware
+    uint8_t                     attempt;         //!< Number of the last attempt, from 1
+    uint32_t                    erase_ms;        //!< Modem flash erase duration
+    uint32_t                    write_ms;        //!< Image write duration
+    uint32_t                    throughput_bps;  //!< Image write throughput in bytes per second
+    uint32_t                    duration_ms;     //!< Total duration of the last attempt, reboot included
+} apps_modem_update_info_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Set the key of the update record in the key-value store
+ *
+ * @remark The key-value store has to be mounted first.
+ *
+ * @param [in] kv_key Key of the update record
+ */
+void apps_modem_update_init( uint8_t kv_key );
+
+/**
+ * @brief Tell if an update was interrupted by a MCU reset, the modem being left without a valid firmware
+ *
+ * @param [out] image Image of the interrupted update
+ *
+ * @returns true if an update has to be run again with @p image
+ */
+bool apps_modem_update_is_pending( apps_modem_update_image_t* image );
+
+/**
+ * @brief Write a new firmware in the modem
+ *
+ * The chip is switched in its bootloader, which is identified by its version, then its flash is erased and the image
+ * is streamed in 256-byte chunks, straight from the MCU flash. The chip is rebooted on the new firmware, whose
+ * version is read back. Since the bootloader only accepts the chunks in order after an erase, a failed attempt is
+ * started over, up to APPS_MODEM_UPDATE_MAX_ATTEMPTS times. The update is recorded in the key-value store while it
+ * runs, so that it is resumed by @ref apps_modem_update_is_pending after a MCU reset.
+ *
+ * @remark To be called from the application main loop: the update takes several seconds, during which the GPIO
+ * interrupts are disabled so that the modem events are only processed once it is done.
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] image Image staged in the MCU flash
+ * @param [out] info Information on the update, can be NULL
+ *
+ * @returns Update status
+ */
+apps_modem_update_status_t apps_modem_update_run( const void* context, const apps_modem_update_image_t* image,
+                                                  apps_modem_update_info_t* info );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_MODEM_UPDATE_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,288 @@
+/**
+ * @file      apps_multicast_session.h
+ *
+ * @brief     Multicast groups provisioned over the air, saved in flash, and their scheduled sessions
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_MULTICAST_SESSION_H
+#define APPS_MULTICAST_SESSION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_lorawan_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of multicast groups the modem runs at once, the sessions being given one of its groups when they start
+ */
+#define APPS_MULTICAST_SESSION_NB_MODEM_GROUPS 4
+
+/**
+ * @brief Number of multicast groups provisioned, each one saved under its own key of the key-value store
+ */
+#define APPS_MULTICAST_SESSION_MAX_GROUPS 8
+
+/**
+ * @brief Start time of a session starting as soon as the device joined, and running until it is set up again or
+ * deleted
+ */
+#define APPS_MULTICAST_SESSION_START_NOW 0
+
+/**
+ * @brief Duration of a session without end
+ */
+#define APPS_MULTICAST_SESSION_NO_END 0
+
+/**
+ * @brief Provisioning commands, each one followed by its parameters, little endian
+ *
+ * - GROUP_SETUP: group (1 byte), address (4), network session key (16), application session key (16)
+ * - GROUP_DELETE: group (1 byte)
+ * - SESSION_SETUP: group (1 byte), class (1), frequency in Hz (4), data rate (1), ping slot periodicity (1), start in
+ *   GPS seconds (4), duration in seconds (4)
+ */
+#define APPS_MULTICAST_SESSION_CMD_GROUP_SETUP 0x01
+#define APPS_MULTICAST_SESSION_CMD_GROUP_DELETE 0x02
+#define APPS_MULTICAST_SESSION_CMD_SESSION_SETUP 0x03
+
+/**
+ * @brief Size of the answer to a provisioning command: command, group and status
+ */
+#define APPS_MULTICAST_SESSION_ANSWER_SIZE 3
+
+/**
+ * @brief Largest number of provisioning commands of a downlink
+ */
+#define APPS_MULTICAST_SESSION_MAX_COMMANDS 16
+
+/**
+ * @brief Shortest time between two network time requests, while a session waits for the time
+ */
+#define APPS_MULTICAST_SESSION_TIME_REQUEST_INTERVAL_MS ( 600UL * 1000 )
+
+/**
+ * @brief Time after which the network time is requested again, the RTC drifting
+ */
+#define APPS_MULTICAST_SESSION_TIME_SYNC_PERIOD_MS ( 24UL * 3600 * 1000 )
+
+/**
+ * @brief Value returned by @ref apps_multicast_session_process when no session is scheduled
+ */
+#define APPS_MULTICAST_SESSION_IDLE UINT32_MAX
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Status of a provisioning command
+ */
+typedef enum apps_multicast_session_status_e
+{
+    APPS_MULTICAST_SESSION_STATUS_OK,               //!< Command applied and saved
+    APPS_MULTICAST_SESSION_STATUS_INVALID_PARAM,    //!< Group out of range, wrong class or ping slot periodicity
+    APPS_MULTICAST_SESSION_STATUS_UNKNOWN_GROUP,    //!< Session setup of a group not provisioned
+    APPS_MULTICAST_SESSION_STATUS_CLASS_CONFLICT,   //!< Window overlapping one of the other class, or of another
+                                                    //!< class C frequency or data rate
+    APPS_MULTICAST_SESSION_STATUS_NO_MODEM_GROUP,   //!< More overlapping windows than groups of the modem
+    APPS_MULTICAST_SESSION_STATUS_FLASH_ERROR,      //!< Group write in the key-value store failed
+    APPS_MULTICAST_SESSION_STATUS_UNKNOWN_COMMAND,  //!< Unknown or truncated command, the following ones being ignored
+} apps_multicast_session_status_t;
+
+/**
+ * @brief Multicast group configuration and session, as saved in the key-value store
+ */
+typedef struct apps_multicast_session_group_s
+{
+    uint32_t                         address;        //!< Multicast group address
+    uint8_t                          nwk_skey[16];   //!< Multicast network session key
+    uint8_t                          app_skey[16];   //!< Multicast application session key
+    bool                             has_session;    //!< A session is set up, the following fields being meaningful
+    uint8_t                          data_rate;      //!< Downlink data rate
+    lr1121_modem_classes_t           session_class;  //!< LR1121_LORAWAN_CLASS_B or LR1121_LORAWAN_CLASS_C
+    lr1121_modem_class_b_ping_slot_t ping_slot;      //!< Ping slot periodicity of a class B session
+    uint32_t                         frequency;      //!< Downlink frequency in Hz, 0 for the beacon frequency hopping
+    uint32_t                         start_s;        //!< Start time in GPS seconds, APPS_MULTICAST_SESSION_START_NOW
+    uint32_t                         duration_s;     //!< Duration, APPS_MULTICAST_SESSION_NO_END
+} apps_multicast_session_group_t;
+
+/**
+ * @brief State of a multicast group
+ */
+typedef enum apps_multicast_session_state_e
+{
+    APPS_MULTICAST_SESSION_STATE_NONE,       //!< Group not provisioned
+    APPS_MULTICAST_SESSION_STATE_IDLE,       //!< Group without session
+    APPS_MULTICAST_SESSION_STATE_SCHEDULED,  //!< Session waiting for its start time, or for the network time
+    APPS_MULTICAST_SESSION_STATE_RUNNING,    //!< Session running in a group of the modem
+    APPS_MULTICAST_SESSION_STATE_ENDED,      //!< Session ended
+} apps_multicast_session_state_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Load the provisioned multicast groups from the key-value store
+ *
+ * @remark The key-value store has to be mounted first.
+ *
+ * @param [in] first_kv_key Key of the first group, the groups using APPS_MULTICAST_SESSION_MAX_GROUPS keys from it
+ *
+ * @returns Number of groups loaded
+ */
+uint8_t apps_multicast_session_init( uint8_t first_kv_key );
+
+/**
+ * @brief Provision a multicast group and its session from the application, as a GROUP_SETUP then a SESSION_SETUP
+ * command would
+ *
+ * @remark To be called from the application main loop.
+ *
+ * @param [in] group_id Group, lower than APPS_MULTICAST_SESSION_MAX_GROUPS
+ * @param [in] group Group configuration and session, has_session false for a group without session
+ *
+ * @returns Provisioning status
+ */
+apps_multicast_session_status_t apps_multicast_session_provision( uint8_t                               group_id,
+                                                                  const apps_multicast_session_group_t* group );
+
+/**
+ * @brief Apply the provisioning commands of a downlink
+ *
+ * A session is accepted if its window does not overlap the window of a session of the other class, nor of a class C
+ * session on another frequency or data rate, the modem running its class C sessions on the same channel, and if
+ * APPS_MULTICAST_SESSION_NB_MODEM_GROUPS sessions at most run at any time. The running session of a group set up again
+ * or deleted is stopped first.
+ *
+ * @remark To be called from the application main loop, the groups being written in the key-value store.
+ *
+ * @param [in] payload Downlink payload, a sequence of commands
+ * @param [in] size Payload size
+ * @param [out] answer Answer to each command, APPS_MULTICAST_SESSION_ANSWER_SIZE *
+ * APPS_MULTICAST_SESSION_MAX_COMMANDS bytes long
+ *
+ * @returns Size of the answer
+ */
+uint8_t apps_multicast_session_on_downlink( const uint8_t* payload, uint8_t size, uint8_t* answer );
+
+/**
+ * @brief Record that the device joined the network, the sessions being started from then
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_JOINED event handler.
+ */
+void apps_multicast_session_on_joined( void );
+
+/**
+ * @brief Record that the modem reset, its running sessions and the network time being lost
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_RESET event handler.
+ */
+void apps_multicast_session_on_modem_reset( void );
+
+/**
+ * @brief Read the network time after a LR1121_MODEM_LORAWAN_EVENT_LORAWAN_MAC_TIME event
+ *
+ * @remark To be called from the modem event handler.
+ *
+ * @param [in] context Chip implementation context
+ */
+void apps_multicast_session_on_mac_time( const void* context );
+
+/**
+ * @brief Start and stop the sessions as their windows open and close
+ *
+ * A session starting is given a free group of the modem, and the device class is switched to the class of the
+ * session; once no session runs, the device class is switched back to class A. The network time is requested, at
+ * most every APPS_MULTICAST_SESSION_TIME_REQUEST_INTERVAL_MS, while a session with a start time waits for it.
+ *
+ * @remark To be called from the application main loop. The modem event interrupts are masked while the modem is
+ * requested.
+ *
+ * @param [in] context Chip implementation context
+ *
+ * @returns Time in ms before the function has to be called again if no event occurs, APPS_MULTICAST_SESSION_IDLE if no
+ * session is scheduled
+ */
+uint32_t apps_multicast_session_process( const void* context );
+
+/**
+ * @brief Get a multicast group
+ *
+ * @param [in] group_id Group
+ * @param [out] group Group configuration and session, can be NULL
+ * @param [out] modem_group Group of the modem running its session, can be NULL
+ *
+ * @returns State of the group
+ */
+apps_multicast_session_state_t apps_multicast_session_get_group( uint8_t                         group_id,
+                                                                 apps_multicast_session_group_t* group,
+                                                                 uint8_t*                        modem_group );
+
+/**
+ * @brief Get the group whose session runs in a group of the modem
+ *
+ * @param [in] modem_group Group of the modem, from the window of a multicast downlink
+ *
+ * @returns Group, APPS_MULTICAST_SESSION_MAX_GROUPS if no session runs in @p modem_group
+ */
+uint8_t apps_multicast_session_get_group_id( uint8_t modem_group );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_MULTICAST_SESSION_H
+
+/* --- EOF ------------------------------------------------------------------ */
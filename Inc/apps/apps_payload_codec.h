@@ -0,0 +1,200 @@
+/**
+ * @file      apps_payload_codec.h
+ *
+ * @brief     Schema-driven compact payload codec: bit packing, zigzag varints, delta encoding
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_PAYLOAD_CODEC_H
+#define APPS_PAYLOAD_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Largest number of fields of a schema
+ */
+#define APPS_PAYLOAD_CODEC_MAX_FIELDS 8
+
+/**
+ * @brief Number of encoded frames kept to be acknowledged
+ */
+#define APPS_PAYLOAD_CODEC_HISTORY_SIZE 4
+
+/**
+ * @brief Number of frame sequence numbers, the sequence being sent on 4 bits
+ */
+#define APPS_PAYLOAD_CODEC_NB_SEQUENCES 16
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Field encoding
+ */
+typedef enum apps_payload_codec_type_e
+{
+    APPS_PAYLOAD_CODEC_UNSIGNED,  //!< Unsigned value on a fixed number of bits
+    APPS_PAYLOAD_CODEC_SIGNED,    //!< Two's complement value on a fixed number of bits
+    APPS_PAYLOAD_CODEC_VARINT,    //!< Zigzag varint, made of groups of data bits each followed by a continuation bit
+} apps_payload_codec_type_t;
+
+/**
+ * @brief Field of a schema
+ */
+typedef struct apps_payload_codec_field_s
+{
+    uint8_t type;        //!< apps_payload_codec_type_t
+    uint8_t bits;        //!< Bits of a fixed-width field, in [1,32], or data bits per group of a varint, in [1,8]
+    uint8_t delta_bits;  //!< Data bits per group of the zigzag varint difference with the reference frame, in
+                         //!< [1,8], 0 if the field is not delta encoded
+} apps_payload_codec_field_t;
+
+/**
+ * @brief Codec of the frames of a schema
+ *
+ * A frame is a bit stream, most significant bit first, padded with zeros to a byte boundary:
+ * - delta flag (1 bit), set if the frame is encoded against a reference frame
+ * - frame sequence number (4 bits)
+ * - reference frame sequence number (4 bits), if the delta flag is set
+ * - fields in the schema order, the delta encoded ones as their zigzag varint difference with the reference frame if
+ *   the delta flag is set
+ *
+ * The reference frame is the last acknowledged one, so that the decoder received it. A frame is sent without delta
+ * until the first acknowledgment, or when the reference frame is older than APPS_PAYLOAD_CODEC_NB_SEQUENCES - 1
+ * frames, its sequence number being reused.
+ */
+typedef struct apps_payload_codec_s
+{
+    const apps_payload_codec_field_t* fields;           //!< Schema
+    uint8_t                           nb_fields;        //!< Number of fields, up to APPS_PAYLOAD_CODEC_MAX_FIELDS
+    bool                              has_reference;    //!< A frame has been acknowledged
+    uint32_t                          index;            //!< Index of the next frame, its sequence number modulo 16
+    uint32_t                          reference_index;  //!< Index of the reference frame
+    int32_t reference[APPS_PAYLOAD_CODEC_MAX_FIELDS];   //!< Values of the reference frame
+    uint32_t history_index[APPS_PAYLOAD_CODEC_HISTORY_SIZE];  //!< Index of the last encoded frames
+    int32_t  history[APPS_PAYLOAD_CODEC_HISTORY_SIZE][APPS_PAYLOAD_CODEC_MAX_FIELDS];  //!< Values of the last frames
+} apps_payload_codec_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Initialize a codec
+ *
+ * @param [out] codec Codec
+ * @param [in] fields Schema, kept by the codec
+ * @param [in] nb_fields Number of fields, up to APPS_PAYLOAD_CODEC_MAX_FIELDS
+ *
+ * @returns true if the schema is valid
+ */
+bool apps_payload_codec_init( apps_payload_codec_t* codec, const apps_payload_codec_field_t* fields,
+                              uint8_t nb_fields );
+
+/**
+ * @brief Encode a frame
+ *
+ * @param [in,out] codec Codec
+ * @param [in] values Values of the fields, in the schema order; the unsigned ones are cast to int32_t
+ * @param [out] buffer Encoded frame
+ * @param [in] max_size Size of @p buffer
+ *
+ * @returns Size of the encoded frame, 0 if a value does not fit in its field or the frame in @p buffer
+ */
+uint8_t apps_payload_codec_encode( apps_payload_codec_t* codec, const int32_t* values, uint8_t* buffer,
+                                   uint8_t max_size );
+
+/**
+ * @brief Decode a frame without delta, or against a reference frame
+ *
+ * @param [in] codec Codec, for its schema
+ * @param [in] buffer Encoded frame
+ * @param [in] size Frame size
+ * @param [in] reference Values of the reference frame of a delta frame, can be NULL for a frame without delta
+ * @param [out] values Values of the fields
+ *
+ * @returns true if the frame is decoded
+ */
+bool apps_payload_codec_decode( const apps_payload_codec_t* codec, const uint8_t* buffer, uint8_t size,
+                                const int32_t* reference, int32_t* values );
+
+/**
+ * @brief Get the sequence number of an encoded frame
+ *
+ * @param [in] buffer Encoded frame, at least one byte
+ *
+ * @returns Sequence number, in [0,15]
+ */
+uint8_t apps_payload_codec_get_sequence( const uint8_t* buffer );
+
+/**
+ * @brief Acknowledge an encoded frame, which becomes the reference of the next ones
+ *
+ * The frame is ignored if it is not one of the last APPS_PAYLOAD_CODEC_HISTORY_SIZE encoded frames, or older than the
+ * current reference.
+ *
+ * @param [in,out] codec Codec
+ * @param [in] sequence Sequence number of the frame
+ */
+void apps_payload_codec_acknowledge( apps_payload_codec_t* codec, uint8_t sequence );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_PAYLOAD_CODEC_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,143 @@
+/**
+ * @file      apps_shell.h
+ *
+ * @brief     UART command shell
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_SHELL_H
+#define APPS_SHELL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smtc_hal_options.h"
+#include "smtc_hal_dbg_log.h"
+#include "smtc_hal_mcu.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/**
+ * @brief Print a shell answer, whatever the runtime trace levels
+ */
+#if( HAL_DBG_TRACE_BINARY == HAL_FEATURE_ON )
+#define APPS_SHELL_PRINTF( ... ) HAL_DBG_LOG( __VA_ARGS__ )
+#else
+#define APPS_SHELL_PRINTF( ... ) hal_mcu_trace_print( __VA_ARGS__ )
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Size of the circular DMA reception buffer
+ */
+#define APPS_SHELL_RX_BUFFER_SIZE 128
+
+/**
+ * @brief Maximal length of a command line
+ */
+#define APPS_SHELL_LINE_MAX_SIZE 64
+
+/**
+ * @brief Maximal number of words in a command line, command name included
+ */
+#define APPS_SHELL_MAX_ARGS 6
+
+/**
+ * @brief Time without received byte after which the MCU is allowed again to enter stop mode
+ */
+#define APPS_SHELL_SESSION_TIMEOUT_MS 60000
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Shell command
+ */
+typedef struct apps_shell_command_s
+{
+    const char* name;  //!< Command name
+    const char* help;  //!< One line help, printed by the help command
+    void ( *handler )( uint8_t argc, char* argv[] );  //!< Command handler, argv[0] is the command name
+} apps_shell_command_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Start the UART reception of the shell
+ *
+ * Built-in commands: help, status (modem status) and log (runtime trace levels). The application adds its own
+ * commands with @p commands.
+ *
+ * @remark In stop mode, the first byte received only wakes up the MCU and is lost: press Enter first. The MCU does not
+ * enter stop mode anymore until no byte is received for APPS_SHELL_SESSION_TIMEOUT_MS.
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] commands Application commands, can be NULL
+ * @param [in] nb_commands Number of application commands
+ */
+void apps_shell_init( const void* context, const apps_shell_command_t* commands, uint8_t nb_commands );
+
+/**
+ * @brief Read the received bytes and run the complete command lines
+ *
+ * @remark To be called from the application main loop, before going to sleep. It never blocks waiting for bytes.
+ */
+void apps_shell_process( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_SHELL_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,160 @@
+/**
+ * @file      apps_telemetry_log.h
+ *
+ * @brief     Persistent telemetry log in flash
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_TELEMETRY_LOG_H
+#define APPS_TELEMETRY_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of records waiting in RAM to be written in flash by @ref apps_telemetry_log_process
+ */
+#define APPS_TELEMETRY_LOG_QUEUE_SIZE 8
+
+/**
+ * @brief Minimal number of pages of the log: when the head page is full, the oldest page is erased
+ */
+#define APPS_TELEMETRY_LOG_MIN_NB_PAGES 2
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Telemetry record
+ */
+typedef struct apps_telemetry_log_record_s
+{
+    uint32_t sequence;     //!< Record sequence number, set by the log
+    uint32_t timestamp_s;  //!< RTC time in seconds when the record was appended, set by the log
+    uint32_t charge;       //!< Charge counter, application defined unit
+    int16_t  rssi_dbm;     //!< RSSI in dBm
+    int8_t   snr_db;       //!< SNR in dB
+    uint8_t  event_type;   //!< Event type, application defined (0xFF is reserved)
+    uint8_t  modem_rc;     //!< Modem response code
+    uint16_t info;         //!< Event specific information
+} apps_telemetry_log_record_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Mount the telemetry log
+ *
+ * The log is a ring of flash pages holding fixed-size CRC protected records. Each page starts with a sequence number:
+ * at mount, only the page headers and a few records of the head page (binary search of the first free slot) are read.
+ *
+ * @param [in] first_page First flash page of the log
+ * @param [in] nb_pages Number of flash pages of the log, at least APPS_TELEMETRY_LOG_MIN_NB_PAGES
+ *
+ * @returns true if the log is mounted, false if the page range is invalid
+ */
+bool apps_telemetry_log_init( uint32_t first_page, uint8_t nb_pages );
+
+/**
+ * @brief Queue a record to be written in flash
+ *
+ * @remark This function can be called from an interrupt: the record is only copied in RAM, and dropped if the queue
+ * is full. The sequence and timestamp_s fields of @p record are ignored.
+ *
+ * @param [in] record Record to be appended
+ *
+ * @returns true if the record is queued
+ */
+bool apps_telemetry_log_append( const apps_telemetry_log_record_t* record );
+
+/**
+ * @brief Write the queued records in flash
+ *
+ * @remark To be called from the application main loop. Opening a new page costs a page erase.
+ */
+void apps_telemetry_log_process( void );
+
+/**
+ * @brief Get the number of records retained in flash
+ *
+ * @returns Number of records, including the ones lost by a reset while they were written
+ */
+uint32_t apps_telemetry_log_get_nb_records( void );
+
+/**
+ * @brief Read a record
+ *
+ * @param [in] index Index of the record, 0 being the most recent one
+ * @param [out] record Record
+ *
+ * @returns true if the record exists and is valid
+ */
+bool apps_telemetry_log_read( uint32_t index, apps_telemetry_log_record_t* record );
+
+/**
+ * @brief Get the number of records dropped because the RAM queue was full or a flash operation failed
+ *
+ * @returns Number of dropped records since reset
+ */
+uint32_t apps_telemetry_log_get_nb_dropped( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_TELEMETRY_LOG_H
+
+/* --- EOF ------------------------------------------------------------------ */
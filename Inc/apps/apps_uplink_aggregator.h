@@ -0,0 +1,176 @@
+/**
+ * @file      apps_uplink_aggregator.h
+ *
+ * @brief     Aggregation of application records in LoRaWAN uplinks
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_UPLINK_AGGREGATOR_H
+#define APPS_UPLINK_AGGREGATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "apps_uplink_queue.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/**
+ * @brief Header byte of a record in an aggregated uplink: type in bits 7-5, size minus one in bits 4-0
+ */
+#define APPS_UPLINK_AGGREGATOR_RECORD_HEADER( type, size ) ( ( uint8_t )( ( ( type ) << 5 ) | ( ( size ) - 1 ) ) )
+
+/**
+ * @brief Type of a record from its header byte
+ */
+#define APPS_UPLINK_AGGREGATOR_RECORD_TYPE( header ) ( ( uint8_t )( ( header ) >> 5 ) )
+
+/**
+ * @brief Size of a record from its header byte
+ */
+#define APPS_UPLINK_AGGREGATOR_RECORD_SIZE( header ) ( ( uint8_t )( ( ( header ) & 0x1F ) + 1 ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Size of the buffer of the records waiting to be sent, record headers and timestamps included
+ */
+#define APPS_UPLINK_AGGREGATOR_BUFFER_SIZE 512
+
+/**
+ * @brief Largest record
+ */
+#define APPS_UPLINK_AGGREGATOR_MAX_RECORD_SIZE 32
+
+/**
+ * @brief Largest record type
+ */
+#define APPS_UPLINK_AGGREGATOR_MAX_RECORD_TYPE 7
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Uplink aggregator statistics since reset
+ */
+typedef struct apps_uplink_aggregator_stats_s
+{
+    uint32_t nb_records;   //!< Records added
+    uint32_t nb_uplinks;   //!< Aggregated uplinks queued
+    uint32_t nb_resplits;  //!< Aggregated uplinks taken back from the queue to be split after a data rate change
+    uint32_t nb_dropped;   //!< Records refused, the buffer being full
+    uint16_t nb_pending;   //!< Records waiting to be queued
+} apps_uplink_aggregator_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Configure the aggregator
+ *
+ * @param [in] port LoRaWAN port of the aggregated uplinks
+ * @param [in] uplink_type Unconfirmed or confirmed aggregated uplinks
+ * @param [in] max_age_ms Time after which a record is sent, even if the uplink is not full
+ */
+void apps_uplink_aggregator_init( uint8_t port, lr1121_modem_uplink_type_t uplink_type, uint32_t max_age_ms );
+
+/**
+ * @brief Add a record to the next aggregated uplink
+ *
+ * An aggregated uplink is the sequence of its records, each one made of a header byte, see
+ * APPS_UPLINK_AGGREGATOR_RECORD_HEADER, followed by the record itself.
+ *
+ * @remark This function can be called from an interrupt: the record is only copied in RAM.
+ *
+ * @param [in] type Record type, up to APPS_UPLINK_AGGREGATOR_MAX_RECORD_TYPE
+ * @param [in] priority Record priority: a record of high priority is sent without waiting for other ones
+ * @param [in] record Record
+ * @param [in] size Record size, in [1,APPS_UPLINK_AGGREGATOR_MAX_RECORD_SIZE]
+ *
+ * @returns true if the record is added
+ */
+bool apps_uplink_aggregator_add( uint8_t type, apps_uplink_queue_priority_t priority, const uint8_t* record,
+                                 uint8_t size );
+
+/**
+ * @brief Pack the records in an uplink when it is due, and queue it
+ *
+ * The records are packed in order up to the maximal payload size of the next transmission, when they fill it, when the
+ * oldest one reaches its maximal age or when one has a high priority. The uplink is only built once the duty cycle
+ * allows a transmission, one at a time, so that it holds as many records as possible. If the maximal payload size
+ * shrinks while the uplink waits in the queue, after a data rate change, it is taken back and its records are packed
+ * again. When the waiting records need several uplinks, their split is planned by @ref apps_airtime_plan at the data
+ * rate inferred from the maximal payload size, so that they take the least time on air.
+ *
+ * @remark To be called from the application main loop, before @ref apps_uplink_queue_process. The modem event
+ * interrupts are masked while the modem is requested.
+ *
+ * @param [in] context Chip implementation context
+ *
+ * @returns Time in ms before the function has to be called again if no event occurs, APPS_UPLINK_QUEUE_IDLE if no
+ * record waits
+ */
+uint32_t apps_uplink_aggregator_process( const void* context );
+
+/**
+ * @brief Get the aggregator statistics
+ *
+ * @param [out] stats Statistics
+ */
+void apps_uplink_aggregator_get_stats( apps_uplink_aggregator_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_UPLINK_AGGREGATOR_H
+
+/* --- EOF ------------------------------------------------------------------ */
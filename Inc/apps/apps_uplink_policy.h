@@ -0,0 +1,188 @@
+/**
+ * @file      apps_uplink_policy.h
+ *
+ * @brief     Uplink policy: confirmation and number of transmissions meeting a delivery target
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_UPLINK_POLICY_H
+#define APPS_UPLINK_POLICY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_helper.h"
+#include "lr1121_modem_lorawan_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Delivery target disabling the policy, the uplinks being sent as queued
+ */
+#define APPS_UPLINK_POLICY_DISABLED 0
+
+/**
+ * @brief Highest number of transmissions of an uplink
+ */
+#define APPS_UPLINK_POLICY_MAX_NB_TRANS 4
+
+/**
+ * @brief Number of the last probes the acknowledgement rate is measured on
+ */
+#define APPS_UPLINK_POLICY_WINDOW_SIZE 16
+
+/**
+ * @brief Probes the acknowledgement rate needs before the confirmed uplinks are sent unconfirmed
+ */
+#define APPS_UPLINK_POLICY_MIN_PROBES 4
+
+/**
+ * @brief Uplinks to be confirmed between two probes, once the acknowledgement rate is measured
+ */
+#define APPS_UPLINK_POLICY_PROBE_PERIOD 8
+
+/**
+ * @brief Weight, in probes, of the success rate predicted from the link health
+ */
+#define APPS_UPLINK_POLICY_PRIOR_WEIGHT 4
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief How an uplink is sent
+ */
+typedef struct apps_uplink_policy_decision_s
+{
+    lr1121_modem_uplink_type_t uplink_type;  //!< Unconfirmed or confirmed uplink
+    uint8_t                    nb_trans;     //!< Transmissions of the uplink, 0 to keep the setting of the modem
+    bool                       probe;        //!< Confirmed uplink sent once to measure the acknowledgement rate
+} apps_uplink_policy_decision_t;
+
+/**
+ * @brief Uplink policy statistics
+ *
+ * The probabilities are given in per mille.
+ */
+typedef struct apps_uplink_policy_stats_s
+{
+    uint16_t target;            //!< Delivery target, APPS_UPLINK_POLICY_DISABLED if disabled
+    uint16_t success;           //!< Estimated success rate of a single transmission
+    uint16_t delivery;          //!< Expected delivery of an uplink sent nb_trans times
+    uint8_t  nb_trans;          //!< Transmissions of the next unconfirmed uplink
+    uint8_t  nb_window;         //!< Probes among the last APPS_UPLINK_POLICY_WINDOW_SIZE ones
+    uint8_t  nb_window_acked;   //!< Probes acknowledged among them
+    uint32_t nb_probes;         //!< Probes sent
+    uint32_t nb_confirmed;      //!< Confirmed uplinks sent, probes included
+    uint32_t nb_unconfirmed;    //!< Unconfirmed uplinks sent
+    uint32_t nb_transmissions;  //!< Transmissions requested for the uplinks sent
+} apps_uplink_policy_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Set the delivery target of the uplinks
+ *
+ * @param [in] target Probability in per mille that an uplink reaches the network, APPS_UPLINK_POLICY_DISABLED to send
+ * the uplinks as queued
+ */
+void apps_uplink_policy_init( uint16_t target );
+
+/**
+ * @brief Decide how to send an uplink
+ *
+ * The success rate of a single transmission is estimated from the acknowledgements of the last probes, confirmed
+ * uplinks sent once, blended with a rate predicted from the link health of @ref apps_link_quality_get_health. The
+ * uplinks are sent the fewest times meeting the delivery target with this rate, up to APPS_UPLINK_POLICY_MAX_NB_TRANS.
+ *
+ * An uplink queued confirmed is sent:
+ * - as a probe until APPS_UPLINK_POLICY_MIN_PROBES probes are in the window, then once every
+ *   APPS_UPLINK_POLICY_PROBE_PERIOD uplinks,
+ * - confirmed APPS_UPLINK_POLICY_MAX_NB_TRANS times if the target cannot be met, the retransmissions stopping at the
+ *   acknowledgement,
+ * - unconfirmed otherwise, repeated to meet the target without a downlink.
+ *
+ * An uplink queued unconfirmed stays unconfirmed.
+ *
+ * @param [in] uplink_type Type the uplink was queued with
+ *
+ * @returns How to send the uplink
+ */
+apps_uplink_policy_decision_t apps_uplink_policy_decide( lr1121_modem_uplink_type_t uplink_type );
+
+/**
+ * @brief Report the end of the transmission of an uplink sent as decided by @ref apps_uplink_policy_decide
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_TX_DONE event handler.
+ *
+ * @param [in] decision Decision the uplink was sent with
+ * @param [in] tx_done_status Status of the TX_DONE event
+ */
+void apps_uplink_policy_on_tx_done( const apps_uplink_policy_decision_t* decision,
+                                    lr1121_modem_tx_done_event_t         tx_done_status );
+
+/**
+ * @brief Get the policy statistics
+ *
+ * @param [out] stats Statistics
+ */
+void apps_uplink_policy_get_stats( apps_uplink_policy_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_UPLINK_POLICY_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,236 @@
+/**
+ * @file      apps_uplink_queue.h
+ *
+ * @brief     Duty-cycle aware queue of the application uplinks
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+#ifndef APPS_UPLINK_QUEUE_H
+#define APPS_UPLINK_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1121_modem_helper.h"
+#include "lr1121_modem_lorawan_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Number of uplinks the queue holds
+ */
+#define APPS_UPLINK_QUEUE_SIZE 8
+
+/**
+ * @brief Largest payload of a queued uplink, the largest LoRaWAN application payload
+ */
+#define APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE 242
+
+/**
+ * @brief Lifetime of an uplink that never expires
+ */
+#define APPS_UPLINK_QUEUE_NO_EXPIRY 0
+
+/**
+ * @brief Maximal time between a transmission request and its TX_DONE event, the request being dropped after
+ */
+#define APPS_UPLINK_QUEUE_TX_TIMEOUT_MS 60000
+
+/**
+ * @brief Delay before a transmission request refused by the modem is retried
+ */
+#define APPS_UPLINK_QUEUE_RETRY_DELAY_MS 5000
+
+/**
+ * @brief Value returned by @ref apps_uplink_queue_process when the queue is empty
+ */
+#define APPS_UPLINK_QUEUE_IDLE UINT32_MAX
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Uplink priority: the uplinks of highest priority are sent first, in the order they were queued
+ */
+typedef enum apps_uplink_queue_priority_e
+{
+    APPS_UPLINK_QUEUE_PRIORITY_LOW,
+    APPS_UPLINK_QUEUE_PRIORITY_NORMAL,
+    APPS_UPLINK_QUEUE_PRIORITY_HIGH,
+} apps_uplink_queue_priority_t;
+
+/**
+ * @brief Uplink queue statistics since reset
+ */
+typedef struct apps_uplink_queue_stats_s
+{
+    uint32_t nb_queued;    //!< Uplinks queued
+    uint32_t nb_sent;      //!< Uplinks sent
+    uint32_t nb_not_sent;  //!< Transmissions reported not sent by the modem, the uplink being kept for a new one
+    uint32_t nb_flushes;   //!< Empty uplinks sent because the next uplink exceeded the maximal payload size
+    uint32_t nb_expired;   //!< Uplinks dropped when their lifetime elapsed
+    uint32_t nb_dropped;   //!< Uplinks refused or evicted by an uplink of higher priority, the queue being full
+    uint8_t  nb_entries;   //!< Uplinks in the queue
+    bool     tx_pending;   //!< A transmission waits for its TX_DONE event
+} apps_uplink_queue_stats_t;
+
+/**
+ * @brief Callback of a sent uplink
+ *
+ * @param [in] port LoRaWAN port
+ * @param [in] payload Payload
+ * @param [in] size Payload size
+ * @param [in] tx_done_status Status of the TX_DONE event, LR1121_MODEM_CONFIRMED_TX if the uplink is acknowledged
+ */
+typedef void ( *apps_uplink_queue_sent_callback_t )( uint8_t port, const uint8_t* payload, uint8_t size,
+                                                     lr1121_modem_tx_done_event_t tx_done_status );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Set the callback called when an uplink is sent, before it is removed from the queue
+ *
+ * @remark The callback is called from @ref apps_uplink_queue_on_tx_done, in the context of the modem events.
+ *
+ * @param [in] callback Callback, NULL to remove it
+ */
+void apps_uplink_queue_set_sent_callback( apps_uplink_queue_sent_callback_t callback );
+
+/**
+ * @brief Queue an uplink
+ *
+ * When the queue is full, the oldest uplink of the lowest priority is evicted if its priority is lower than the one of
+ * the new uplink, which is refused otherwise.
+ *
+ * @remark This function can be called from an interrupt: the payload is only copied in RAM.
+ *
+ * @param [in] port LoRaWAN port, in [1,223]
+ * @param [in] uplink_type Unconfirmed or confirmed uplink, the uplink policy telling if it is sent confirmed
+ * @param [in] priority Uplink priority
+ * @param [in] lifetime_ms Time after which the uplink is dropped if not sent yet, APPS_UPLINK_QUEUE_NO_EXPIRY
+ * @param [in] payload Payload
+ * @param [in] size Payload size, up to APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE
+ *
+ * @returns true if the uplink is queued
+ */
+bool apps_uplink_queue_push( uint8_t port, lr1121_modem_uplink_type_t uplink_type,
+                             apps_uplink_queue_priority_t priority, uint32_t lifetime_ms, const uint8_t* payload,
+                             uint8_t size );
+
+/**
+ * @brief Report the end of a transmission
+ *
+ * The uplink is removed from the queue once sent. If the modem reports it not sent, it is kept for a new transmission.
+ *
+ * @remark To be called from the LR1121_MODEM_LORAWAN_EVENT_TX_DONE event handler.
+ *
+ * @param [in] tx_done_status Status of the TX_DONE event
+ */
+void apps_uplink_queue_on_tx_done( lr1121_modem_tx_done_event_t tx_done_status );
+
+/**
+ * @brief Request the transmission of the next uplink when the modem allows it
+ *
+ * A single transmission is requested at a time. The duty-cycle status of the modem gives the time before the next
+ * one is allowed; an uplink larger than the maximal payload size of the next transmission stays in the queue while an
+ * empty uplink is sent to flush the MAC commands and let the data rate settle. The confirmation and the number of
+ * transmissions of each uplink are decided by @ref apps_uplink_policy_decide.
+ *
+ * @remark To be called from the application main loop, once the device joined the network. The modem event interrupts
+ * are masked while the modem is requested.
+ *
+ * @param [in] context Chip implementation context
+ *
+ * @returns Time in ms before the function has to be called again if no event occurs, APPS_UPLINK_QUEUE_IDLE if the
+ * queue is empty
+ */
+uint32_t apps_uplink_queue_process( const void* context );
+
+/**
+ * @brief Get the number of queued uplinks on a port
+ *
+ * @param [in] port LoRaWAN port
+ *
+ * @returns Number of uplinks on @p port, the one being transmitted included
+ */
+uint8_t apps_uplink_queue_get_nb_entries( uint8_t port );
+
+/**
+ * @brief Take back a queued uplink that no longer fits in the maximal payload size of the next transmission
+ *
+ * The oldest uplink on @p port larger than @p max_size is removed from the queue, unless it is being transmitted, so
+ * that its content is split in smaller uplinks after a data rate change.
+ *
+ * @param [in] port LoRaWAN port
+ * @param [in] max_size Maximal payload size
+ * @param [out] payload Payload of the uplink, APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE bytes long
+ *
+ * @returns Size of the payload taken back, 0 if no uplink was taken back
+ */
+uint8_t apps_uplink_queue_take_oversized( uint8_t port, uint8_t max_size, uint8_t* payload );
+
+/**
+ * @brief Get the queue statistics
+ *
+ * @param [out] stats Statistics
+ */
+void apps_uplink_queue_get_stats( apps_uplink_queue_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // APPS_UPLINK_QUEUE_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -49,6 +49,7 @@ extern "C" {
 #include "lr1121_modem_lorawan.h"
 #include "lr1121_modem_modem.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 /*
  * -----------------------------------------------------------------------------
@@ -60,6 +61,14 @@ extern "C" {
  * --- PUBLIC CONSTANTS --------------------------------------------------------
  */
 
+/**
+ * @brief LoRaWAN port of the downlinks setting the runtime trace levels
+ *
+ * The payload is a list of (module, level) byte pairs, see @ref hal_dbg_trace_module_t and HAL_DBG_TRACE_LEVEL_xxx.
+ * Module HAL_DBG_TRACE_MODULE_NB sets the level of all modules.
+ */
+#define TRACE_LEVEL_DOWNLINK_PORT 199
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
@@ -78,6 +87,17 @@ extern "C" {
  */
 void print_hex_buffer( const uint8_t* buffer, uint8_t size );
 
+/**
+ * @brief Update the runtime trace levels if the downlink was received on TRACE_LEVEL_DOWNLINK_PORT
+ *
+ * @param [in] port LoRaWAN port of the downlink
+ * @param [in] payload Downlink payload
+ * @param [in] size Downlink payload size
+ *
+ * @returns true if the downlink was a trace level command, false otherwise
+ */
+bool set_trace_levels_from_downlink( uint8_t port, const uint8_t* payload, uint8_t size );
+
 /**
  * @brief Prints the LoRaWAN keys
  *
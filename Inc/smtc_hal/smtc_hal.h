@@ -43,6 +43,7 @@ extern "C" {
 
 #include "smtc_hal_options.h"
 #include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_dbg_log.h"
 #include "smtc_hal_gpio.h"
 #include "smtc_hal_gpio_pin_names.h"
 #include "smtc_hal_mcu.h"
@@ -51,6 +52,7 @@ extern "C" {
 #include "smtc_hal_tmr_list.h"
 #include "smtc_hal_watchdog.h"
 #include "smtc_hal_rng.h"
+#include "smtc_hal_crc.h"
 #include "smtc_hal_gpio.h"
 #include "smtc_hal_spi.h"
 #include "smtc_hal_uart.h"
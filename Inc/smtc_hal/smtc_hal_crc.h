@@ -0,0 +1,99 @@
+/**
+ * @file      smtc_hal_crc.h
+ *
+ * @brief     Board specific package CRC API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SMTC_HAL_CRC_H
+#define SMTC_HAL_CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief Value of the CRC32 before the first call to @ref hal_crc32_update
+ */
+#define HAL_CRC32_INIT_VALUE ( ( uint32_t ) 0 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Update a CRC32 with a buffer.
+ *
+ * CRC-32 of IEEE 802.3 (reflected polynomial 0xEDB88320, initial value and final xor 0xFFFFFFFF), as used by the
+ * LoRaWAN FUOTA file CRC. The CRC of data split in several buffers is obtained by chaining the calls, starting from
+ * HAL_CRC32_INIT_VALUE.
+ *
+ * The computation uses the CRC peripheral if HAL_USE_CRC32_HW is HAL_FEATURE_ON (see smtc_hal_options.h), a
+ * slice-by-8 table otherwise.
+ *
+ * @remark With the CRC peripheral, this function is not reentrant: it must not be called from an interrupt while it
+ * runs in the main loop.
+ *
+ * @param [in] crc CRC32 of the previous data, HAL_CRC32_INIT_VALUE for the first buffer
+ * @param [in] buffer Pointer to the data, no alignment constraint
+ * @param [in] size Size of the data in bytes
+ *
+ * @returns CRC32 of the previous data followed by @p buffer
+ */
+uint32_t hal_crc32_update( uint32_t crc, const uint8_t* buffer, uint32_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SMTC_HAL_CRC_H
+
+/* --- EOF ------------------------------------------------------------------ */
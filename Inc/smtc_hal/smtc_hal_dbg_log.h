@@ -0,0 +1,230 @@
+/**
+ * @file      smtc_hal_dbg_log.h
+ *
+ * @brief     Binary (tokenized) debug log API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SMTC_HAL_DBG_LOG_H
+#define SMTC_HAL_DBG_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_hal_options.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/**
+ * @brief Name of the ELF section holding the format strings of the binary log sites
+ *
+ * @remark This section is declared as INFO in the linker script: it is kept in the .elf file for the host decoder
+ * (tools/smtc_dbg_log_decoder.py) but it is neither loaded in the MCU flash nor present in the .bin/.hex files.
+ */
+#define HAL_DBG_LOG_FMT_SECTION ".smtc_log_fmt"
+
+/**
+ * @brief Log a message in binary form
+ *
+ * The format string is only stored in the @ref HAL_DBG_LOG_FMT_SECTION section, and its offset in this section is
+ * used as log identifier. Only the identifier and the raw 32-bit argument words are pushed in the RAM log buffer.
+ *
+ * @remark Supported arguments are integers, characters and pointers up to 32 bits. A "%s" argument is only decoded if
+ * it points to a constant string located in the MCU flash. 64-bit and floating point arguments are not supported.
+ *
+ * @param [in] ... Format string literal followed by up to @ref HAL_DBG_LOG_MAX_ARGS arguments
+ */
+#define HAL_DBG_LOG( ... )                                                                                 \
+    do                                                                                                     \
+    {                                                                                                      \
+        static const char hal_dbg_log_fmt[] __attribute__( ( section( HAL_DBG_LOG_FMT_SECTION ), used ) ) = \
+            HAL_DBG_LOG_FIRST( __VA_ARGS__ );                                                              \
+        hal_dbg_log_write( HAL_DBG_LOG_ID( hal_dbg_log_fmt ),                                              \
+                           HAL_DBG_LOG_NB_ARGS( __VA_ARGS__ ) HAL_DBG_LOG_REST( __VA_ARGS__ ) );           \
+    } while( 0 )
+
+/**
+ * @brief Log a byte array in binary form
+ *
+ * @param [in] msg Message string literal
+ * @param [in] array Byte array to be logged
+ * @param [in] len Number of bytes to be logged
+ */
+#define HAL_DBG_LOG_ARRAY( msg, array, len )                                                               \
+    do                                                                                                     \
+    {                                                                                                      \
+        static const char hal_dbg_log_fmt[] __attribute__( ( section( HAL_DBG_LOG_FMT_SECTION ), used ) ) = \
+            msg;                                                                                           \
+        hal_dbg_log_write_array( HAL_DBG_LOG_ID( hal_dbg_log_fmt ), HAL_DBG_LOG_FRAME_ARRAY_FLAG,          \
+                                 ( const uint8_t* ) ( array ), ( uint32_t ) ( len ) );                     \
+    } while( 0 )
+
+/**
+ * @brief Log a byte array in binary form, decoded on host side as a single hexadecimal string
+ *
+ * @param [in] msg Message string literal
+ * @param [in] array Byte array to be logged
+ * @param [in] len Number of bytes to be logged
+ */
+#define HAL_DBG_LOG_PACKARRAY( msg, array, len )                                                           \
+    do                                                                                                     \
+    {                                                                                                      \
+        static const char hal_dbg_log_fmt[] __attribute__( ( section( HAL_DBG_LOG_FMT_SECTION ), used ) ) = \
+            msg;                                                                                           \
+        hal_dbg_log_write_array( HAL_DBG_LOG_ID( hal_dbg_log_fmt ),                                        \
+                                 HAL_DBG_LOG_FRAME_ARRAY_FLAG | HAL_DBG_LOG_FRAME_PACKED_FLAG,             \
+                                 ( const uint8_t* ) ( array ), ( uint32_t ) ( len ) );                     \
+    } while( 0 )
+
+/**
+ * @brief Maximal number of arguments of a binary log site
+ */
+#define HAL_DBG_LOG_MAX_ARGS 8
+
+/**
+ * @brief Log identifier of a format string stored in @ref HAL_DBG_LOG_FMT_SECTION
+ */
+#define HAL_DBG_LOG_ID( fmt ) ( ( uint16_t ) ( uintptr_t ) ( fmt ) )
+
+/*
+ * Helpers splitting a variadic list in its first element (the format string) and the remaining elements (the
+ * arguments), and counting the arguments. They avoid the empty __VA_ARGS__ extension which is not valid C99.
+ * A log site with more than HAL_DBG_LOG_MAX_ARGS (and up to 16) arguments fails to build on the undeclared
+ * hal_dbg_log_error_more_than_8_arguments identifier, the helpers being written for HAL_DBG_LOG_MAX_ARGS = 8.
+ */
+#define HAL_DBG_LOG_FIRST( ... ) HAL_DBG_LOG_FIRST_( __VA_ARGS__, ~ )
+#define HAL_DBG_LOG_FIRST_( first, ... ) first
+#define HAL_DBG_LOG_REST( ... ) HAL_DBG_LOG_REST_( HAL_DBG_LOG_ONE_OR_MORE( __VA_ARGS__ ), __VA_ARGS__ )
+#define HAL_DBG_LOG_REST_( qty, ... ) HAL_DBG_LOG_REST__( qty, __VA_ARGS__ )
+#define HAL_DBG_LOG_REST__( qty, ... ) HAL_DBG_LOG_REST_##qty( __VA_ARGS__ )
+#define HAL_DBG_LOG_REST_ONE( first )
+#define HAL_DBG_LOG_REST_MORE( first, ... ) , __VA_ARGS__
+#define HAL_DBG_LOG_REST_TOO_MANY( first, ... ) , hal_dbg_log_error_more_than_8_arguments
+#define HAL_DBG_LOG_ONE_OR_MORE( ... )                                                                                \
+    HAL_DBG_LOG_18TH( __VA_ARGS__, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, \
+                      MORE, MORE, MORE, MORE, MORE, MORE, MORE, MORE, ONE, ~ )
+#define HAL_DBG_LOG_NB_ARGS( ... ) \
+    HAL_DBG_LOG_18TH( __VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, ~ )
+#define HAL_DBG_LOG_18TH( a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, ... ) a18
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/**
+ * @brief First byte of every binary log frame
+ */
+#define HAL_DBG_LOG_FRAME_SYNC 0xA5
+
+/**
+ * @brief Flag set in the frame info byte when the frame payload is a byte array
+ */
+#define HAL_DBG_LOG_FRAME_ARRAY_FLAG 0x80
+
+/**
+ * @brief Flag set with @ref HAL_DBG_LOG_FRAME_ARRAY_FLAG when the byte array is printed without separators
+ */
+#define HAL_DBG_LOG_FRAME_PACKED_FLAG 0x40
+
+/**
+ * @brief Reserved log identifier used to report frames dropped because the log buffer was full
+ */
+#define HAL_DBG_LOG_ID_DROPPED 0xFFFF
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Push a binary log frame in the RAM log buffer
+ *
+ * Frame layout: sync (0xA5) | id (2 bytes, little endian) | nb_args | nb_args x 32-bit words (little endian)
+ *
+ * @remark Use @ref HAL_DBG_LOG instead of calling this function directly
+ *
+ * @param [in] id Log identifier
+ * @param [in] nb_args Number of 32-bit arguments following
+ */
+void hal_dbg_log_write( uint16_t id, uint8_t nb_args, ... );
+
+/**
+ * @brief Push a binary log frame holding a byte array in the RAM log buffer
+ *
+ * Frame layout: sync (0xA5) | id (2 bytes, little endian) | info (0x80 or 0xC0) | len | len bytes
+ *
+ * @remark Use @ref HAL_DBG_LOG_ARRAY or @ref HAL_DBG_LOG_PACKARRAY instead of calling this function directly.
+ * Arrays longer than 255 bytes are split in several frames.
+ *
+ * @param [in] id Log identifier
+ * @param [in] info Frame info byte, @ref HAL_DBG_LOG_FRAME_ARRAY_FLAG optionally combined with
+ *                  @ref HAL_DBG_LOG_FRAME_PACKED_FLAG
+ * @param [in] array Byte array to be logged
+ * @param [in] len Number of bytes to be logged
+ */
+void hal_dbg_log_write_array( uint16_t id, uint8_t info, const uint8_t* array, uint32_t len );
+
+/**
+ * @brief Send the content of the RAM log buffer on the trace UART
+ *
+ * @remark This function is called by the HAL before entering low power mode. It can also be called by the
+ * application main loop.
+ */
+void hal_dbg_log_flush( void );
+
+/**
+ * @brief Get the number of frames dropped because the RAM log buffer was full
+ *
+ * @returns Number of dropped frames since reset
+ */
+uint32_t hal_dbg_log_get_nb_dropped( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SMTC_HAL_DBG_LOG_H
+
+/* --- EOF ------------------------------------------------------------------ */
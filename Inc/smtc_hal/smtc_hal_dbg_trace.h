@@ -47,6 +47,7 @@ extern "C" {
 
 #include "smtc_hal_options.h"
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_dbg_log.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -75,90 +76,187 @@ extern "C" {
 #define HAL_DBG_TRACE_COLOR_DEFAULT ""
 #endif
 
+/*
+ * Trace levels: a trace is emitted if its level is lower than or equal to both the level compiled for the module
+ * (HAL_DBG_TRACE_MODULE_xxx_LEVEL in smtc_hal_options.h) and the runtime level of the module
+ * (@ref hal_dbg_trace_set_level). Traces above the compiled level generate no code.
+ */
+#define HAL_DBG_TRACE_LEVEL_NONE 0
+#define HAL_DBG_TRACE_LEVEL_ERROR 1
+#define HAL_DBG_TRACE_LEVEL_WARNING 2
+#define HAL_DBG_TRACE_LEVEL_INFO 3
+#define HAL_DBG_TRACE_LEVEL_DEBUG 4
+
+/*
+ * Module of the traces of the current file, one of @ref hal_dbg_trace_module_t. To be defined before the first
+ * #include of the file, for example:
+ * #define HAL_DBG_TRACE_MODULE HAL_DBG_TRACE_MODULE_HAL
+ */
+#ifndef HAL_DBG_TRACE_MODULE
+#define HAL_DBG_TRACE_MODULE HAL_DBG_TRACE_MODULE_APP
+#endif
+
+#define HAL_DBG_TRACE_CAT( a, b ) HAL_DBG_TRACE_CAT_( a, b )
+#define HAL_DBG_TRACE_CAT_( a, b ) a##b
+
 #if( HAL_DBG_TRACE ) && !defined( PERF_TEST_ENABLED )
+#define HAL_DBG_TRACE_COMPILED_LEVEL HAL_DBG_TRACE_CAT( HAL_DBG_TRACE_MODULE, _LEVEL )
+#else
+#define HAL_DBG_TRACE_COMPILED_LEVEL HAL_DBG_TRACE_LEVEL_NONE
+#endif
+
+/**
+ * @brief Check if the traces of a given level are emitted by the current module
+ *
+ * @remark Can be used to skip the preparation of a trace, like a loop printing a buffer
+ */
+#define HAL_DBG_TRACE_IS_ENABLED( level ) \
+    ( ( HAL_DBG_TRACE_COMPILED_LEVEL >= ( level ) ) && ( hal_dbg_trace_levels[HAL_DBG_TRACE_MODULE] >= ( level ) ) )
+
+#define HAL_DBG_TRACE_FILTER( level, trace )                          \
+    do                                                                \
+    {                                                                 \
+        if( hal_dbg_trace_levels[HAL_DBG_TRACE_MODULE] >= ( level ) ) \
+        {                                                             \
+            trace;                                                    \
+        }                                                             \
+    } while( 0 )
+
+#if( HAL_DBG_TRACE ) && ( HAL_DBG_TRACE_BINARY ) && !defined( PERF_TEST_ENABLED ) && !( UNIT_TEST_DBG )
+
+/*
+ * Binary mode: each trace is a log identifier plus raw arguments, the strings are not stored in the MCU flash.
+ * Colors are not sent, the host decoder colors the traces from their "INFO : ", "WARN : " or "ERROR: " prefix.
+ */
+#define HAL_DBG_TRACE_EMIT_PRINTF( ... ) HAL_DBG_LOG( __VA_ARGS__ )
+
+#define HAL_DBG_TRACE_EMIT_MSG( msg ) HAL_DBG_LOG( msg )
+
+#define HAL_DBG_TRACE_EMIT_MSG_COLOR( msg, color ) HAL_DBG_LOG( msg )
+
+#define HAL_DBG_TRACE_EMIT_INFO( ... ) HAL_DBG_LOG( "INFO : " __VA_ARGS__ )
+
+#define HAL_DBG_TRACE_EMIT_WARNING( ... ) HAL_DBG_LOG( "WARN : " __VA_ARGS__ )
+
+#define HAL_DBG_TRACE_EMIT_ERROR( ... ) HAL_DBG_LOG( "ERROR: " __VA_ARGS__ )
+
+#define HAL_DBG_TRACE_EMIT_ARRAY( msg, array, len ) HAL_DBG_LOG_ARRAY( msg, array, len )
+
+#define HAL_DBG_TRACE_EMIT_PACKARRAY( msg, array, len ) HAL_DBG_LOG_PACKARRAY( msg, array, len )
+
+#elif( HAL_DBG_TRACE ) && !defined( PERF_TEST_ENABLED )
 
 #if( UNIT_TEST_DBG )
-#define HAL_DBG_TRACE_PRINTF( ... ) printf( __VA_ARGS__ )
+#define HAL_DBG_TRACE_EMIT_PRINTF( ... ) printf( __VA_ARGS__ )
+#else
+#define HAL_DBG_TRACE_EMIT_PRINTF( ... ) hal_mcu_trace_print( __VA_ARGS__ )
+#endif
+
+#define HAL_DBG_TRACE_EMIT_MSG( msg )                             \
+    do                                                            \
+    {                                                             \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
+        HAL_DBG_TRACE_EMIT_PRINTF( msg );                         \
+    } while( 0 )
+
+#define HAL_DBG_TRACE_EMIT_MSG_COLOR( msg, color )                \
+    do                                                            \
+    {                                                             \
+        HAL_DBG_TRACE_EMIT_PRINTF( color );                       \
+        HAL_DBG_TRACE_EMIT_PRINTF( msg );                         \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
+    } while( 0 )
+
+#define HAL_DBG_TRACE_EMIT_INFO( ... )                            \
+    do                                                            \
+    {                                                             \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_GREEN );   \
+        HAL_DBG_TRACE_EMIT_PRINTF( "INFO : " );                   \
+        HAL_DBG_TRACE_EMIT_PRINTF( __VA_ARGS__ );                 \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
+    } while( 0 )
+
+#define HAL_DBG_TRACE_EMIT_WARNING( ... )                         \
+    do                                                            \
+    {                                                             \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_YELLOW );  \
+        HAL_DBG_TRACE_EMIT_PRINTF( "WARN : " );                   \
+        HAL_DBG_TRACE_EMIT_PRINTF( __VA_ARGS__ );                 \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
+    } while( 0 )
+
+#define HAL_DBG_TRACE_EMIT_ERROR( ... )                           \
+    do                                                            \
+    {                                                             \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_RED );     \
+        HAL_DBG_TRACE_EMIT_PRINTF( "ERROR: " );                   \
+        HAL_DBG_TRACE_EMIT_PRINTF( __VA_ARGS__ );                 \
+        HAL_DBG_TRACE_EMIT_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
+    } while( 0 )
+
+#define HAL_DBG_TRACE_EMIT_ARRAY( msg, array, len )                                \
+    do                                                                             \
+    {                                                                              \
+        HAL_DBG_TRACE_EMIT_PRINTF( "%s - (%lu bytes):\n", msg, ( uint32_t ) len ); \
+        for( uint32_t i = 0; i < ( uint32_t ) len; i++ )                           \
+        {                                                                          \
+            if( ( ( i % 16 ) == 0 ) && ( i > 0 ) )                                 \
+            {                                                                      \
+                HAL_DBG_TRACE_EMIT_PRINTF( "\n" );                                 \
+            }                                                                      \
+            HAL_DBG_TRACE_EMIT_PRINTF( " %02X", array[i] );                        \
+        }                                                                          \
+        HAL_DBG_TRACE_EMIT_PRINTF( "\n" );                                         \
+    } while( 0 )
+
+#define HAL_DBG_TRACE_EMIT_PACKARRAY( msg, array, len )    \
+    do                                                     \
+    {                                                      \
+        for( uint32_t i = 0; i < ( uint32_t ) len; i++ )   \
+        {                                                  \
+            HAL_DBG_TRACE_EMIT_PRINTF( "%02X", array[i] ); \
+        }                                                  \
+    } while( 0 )
+
+#endif
+
+#if( HAL_DBG_TRACE_COMPILED_LEVEL >= HAL_DBG_TRACE_LEVEL_ERROR )
+#define HAL_DBG_TRACE_ERROR( ... ) \
+    HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_ERROR, HAL_DBG_TRACE_EMIT_ERROR( __VA_ARGS__ ) );
 #else
-#define HAL_DBG_TRACE_PRINTF( ... ) hal_mcu_trace_print( __VA_ARGS__ )
+#define HAL_DBG_TRACE_ERROR( ... )
 #endif
 
-#define HAL_DBG_TRACE_MSG( msg )                             \
-    do                                                       \
-    {                                                        \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
-        HAL_DBG_TRACE_PRINTF( msg );                         \
-    } while( 0 );
-
-#define HAL_DBG_TRACE_MSG_COLOR( msg, color )                \
-    do                                                       \
-    {                                                        \
-        HAL_DBG_TRACE_PRINTF( color );                       \
-        HAL_DBG_TRACE_PRINTF( msg );                         \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
-    } while( 0 );
-
-#define HAL_DBG_TRACE_INFO( ... )                            \
-    do                                                       \
-    {                                                        \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_GREEN );   \
-        HAL_DBG_TRACE_PRINTF( "INFO : " );                   \
-        HAL_DBG_TRACE_PRINTF( __VA_ARGS__ );                 \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
-    } while( 0 );
-
-#define HAL_DBG_TRACE_WARNING( ... )                         \
-    do                                                       \
-    {                                                        \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_YELLOW );  \
-        HAL_DBG_TRACE_PRINTF( "WARN : " );                   \
-        HAL_DBG_TRACE_PRINTF( __VA_ARGS__ );                 \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
-    } while( 0 );
-
-#define HAL_DBG_TRACE_ERROR( ... )                           \
-    do                                                       \
-    {                                                        \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_RED );     \
-        HAL_DBG_TRACE_PRINTF( "ERROR: " );                   \
-        HAL_DBG_TRACE_PRINTF( __VA_ARGS__ );                 \
-        HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT ); \
-    } while( 0 );
-
-#define HAL_DBG_TRACE_ARRAY( msg, array, len )                                \
-    do                                                                        \
-    {                                                                         \
-        HAL_DBG_TRACE_PRINTF( "%s - (%lu bytes):\n", msg, ( uint32_t ) len ); \
-        for( uint32_t i = 0; i < ( uint32_t ) len; i++ )                      \
-        {                                                                     \
-            if( ( ( i % 16 ) == 0 ) && ( i > 0 ) )                            \
-            {                                                                 \
-                HAL_DBG_TRACE_PRINTF( "\n" );                                 \
-            }                                                                 \
-            HAL_DBG_TRACE_PRINTF( " %02X", array[i] );                        \
-        }                                                                     \
-        HAL_DBG_TRACE_PRINTF( "\n" );                                         \
-    } while( 0 );
-
-#define HAL_DBG_TRACE_PACKARRAY( msg, array, len )       \
-    do                                                   \
-    {                                                    \
-        for( uint32_t i = 0; i < ( uint32_t ) len; i++ ) \
-        {                                                \
-            HAL_DBG_TRACE_PRINTF( "%02X", array[i] );    \
-        }                                                \
-    } while( 0 );
+#if( HAL_DBG_TRACE_COMPILED_LEVEL >= HAL_DBG_TRACE_LEVEL_WARNING )
+#define HAL_DBG_TRACE_WARNING( ... ) \
+    HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_WARNING, HAL_DBG_TRACE_EMIT_WARNING( __VA_ARGS__ ) );
+#else
+#define HAL_DBG_TRACE_WARNING( ... )
+#endif
 
+#if( HAL_DBG_TRACE_COMPILED_LEVEL >= HAL_DBG_TRACE_LEVEL_INFO )
+#define HAL_DBG_TRACE_PRINTF( ... ) \
+    HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_INFO, HAL_DBG_TRACE_EMIT_PRINTF( __VA_ARGS__ ) )
+#define HAL_DBG_TRACE_MSG( msg ) HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_INFO, HAL_DBG_TRACE_EMIT_MSG( msg ) );
+#define HAL_DBG_TRACE_MSG_COLOR( msg, color ) \
+    HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_INFO, HAL_DBG_TRACE_EMIT_MSG_COLOR( msg, color ) );
+#define HAL_DBG_TRACE_INFO( ... ) \
+    HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_INFO, HAL_DBG_TRACE_EMIT_INFO( __VA_ARGS__ ) );
 #else
 #define HAL_DBG_TRACE_PRINTF( ... )
 #define HAL_DBG_TRACE_MSG( msg )
 #define HAL_DBG_TRACE_MSG_COLOR( msg, color )
 #define HAL_DBG_TRACE_INFO( ... )
-#define HAL_DBG_TRACE_WARNING( ... )
-#define HAL_DBG_TRACE_ERROR( ... )
+#endif
+
+#if( HAL_DBG_TRACE_COMPILED_LEVEL >= HAL_DBG_TRACE_LEVEL_DEBUG )
+#define HAL_DBG_TRACE_ARRAY( msg, array, len ) \
+    HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_DEBUG, HAL_DBG_TRACE_EMIT_ARRAY( msg, array, len ) );
+#define HAL_DBG_TRACE_PACKARRAY( msg, array, len ) \
+    HAL_DBG_TRACE_FILTER( HAL_DBG_TRACE_LEVEL_DEBUG, HAL_DBG_TRACE_EMIT_PACKARRAY( msg, array, len ) );
+#else
 #define HAL_DBG_TRACE_ARRAY( msg, array, len )
 #define HAL_DBG_TRACE_PACKARRAY( ... )
-
 #endif
 
 #if defined( PERF_TEST_ENABLED )
@@ -177,11 +275,52 @@ extern "C" {
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/**
+ * @brief Modules with their own trace level
+ *
+ * @remark The level compiled for each module is set by HAL_DBG_TRACE_MODULE_xxx_LEVEL in smtc_hal_options.h
+ */
+typedef enum hal_dbg_trace_module_e
+{
+    HAL_DBG_TRACE_MODULE_APP = 0,  //!< Applications and application helpers (default module)
+    HAL_DBG_TRACE_MODULE_HAL,      //!< MCU hardware abstraction layer
+    HAL_DBG_TRACE_MODULE_BOARD,    //!< Board and LR1121 modem board helpers
+    HAL_DBG_TRACE_MODULE_NB,       //!< Number of modules
+} hal_dbg_trace_module_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
  */
 
+/**
+ * @brief Runtime trace level of each module, read by the trace macros
+ *
+ * @remark Use @ref hal_dbg_trace_set_level to update it
+ */
+extern volatile uint8_t hal_dbg_trace_levels[HAL_DBG_TRACE_MODULE_NB];
+
+/**
+ * @brief Set the runtime trace level of a module
+ *
+ * @remark The traces above the level compiled for the module stay disabled, they are not in the firmware
+ *
+ * @param [in] module Module, or HAL_DBG_TRACE_MODULE_NB to set the level of all modules
+ * @param [in] level Trace level, from HAL_DBG_TRACE_LEVEL_NONE to HAL_DBG_TRACE_LEVEL_DEBUG
+ *
+ * @returns true if the level was set, false if the module or the level is invalid
+ */
+bool hal_dbg_trace_set_level( hal_dbg_trace_module_t module, uint8_t level );
+
+/**
+ * @brief Get the runtime trace level of a module
+ *
+ * @param [in] module Module
+ *
+ * @returns Trace level of the module, HAL_DBG_TRACE_LEVEL_NONE if the module is invalid
+ */
+uint8_t hal_dbg_trace_get_level( hal_dbg_trace_module_t module );
+
 #ifdef __cplusplus
 }
 #endif
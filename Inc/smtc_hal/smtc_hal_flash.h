@@ -60,6 +60,8 @@ extern "C" {
 
 #define FLASH_USER_START_PAGE ( 1 ) /* Start nb page of user Flash area */
 
+#define FLASH_NB_PAGES_PER_BANK ( 256 ) /* Number of pages of each of the two Flash banks */
+
 #define FLASH_USER_END_ADDR \
     ( ADDR_FLASH_PAGE( FLASH_USER_END_PAGE ) + ADDR_FLASH_PAGE_SIZE - 1 ) /* End @ of user Flash area */
 #define FLASH_USER_END_PAGE ( 509 )                                       /* End nb page of user Flash area */
@@ -78,17 +80,59 @@ extern "C" {
     ( ADDR_FLASH_PAGE( FLASH_USER_TRACKER_CTX_START_PAGE ) + ADDR_FLASH_PAGE_SIZE - \
       1 ) /* End @ of user tracker ctx Flash area */
 
+/* Telemetry log: ends with the user Flash area, below the internal log and tracker ctx pages, and extends downwards */
+#define FLASH_USER_TELEMETRY_LOG_NB_PAGES ( 32 )
+#define FLASH_USER_TELEMETRY_LOG_START_PAGE ( FLASH_USER_END_PAGE + 1 - FLASH_USER_TELEMETRY_LOG_NB_PAGES )
+
+/* Key-value store: just below the telemetry log */
+#define FLASH_USER_KV_STORE_NB_PAGES ( 8 )
+#define FLASH_USER_KV_STORE_START_PAGE ( FLASH_USER_TELEMETRY_LOG_START_PAGE - FLASH_USER_KV_STORE_NB_PAGES )
+
+/* FUOTA file staging area: just below the key-value store, sized for the largest file the modem can receive (32 KB) */
+#define FLASH_USER_FUOTA_FILE_NB_PAGES ( 16 )
+#define FLASH_USER_FUOTA_FILE_START_PAGE ( FLASH_USER_KV_STORE_START_PAGE - FLASH_USER_FUOTA_FILE_NB_PAGES )
+
+/* FUOTA extraction journal: just below the FUOTA file staging area, two checkpoint slots of two pages */
+#define FLASH_USER_FUOTA_JOURNAL_NB_PAGES ( 4 )
+#define FLASH_USER_FUOTA_JOURNAL_START_PAGE ( FLASH_USER_FUOTA_FILE_START_PAGE - FLASH_USER_FUOTA_JOURNAL_NB_PAGES )
+
+/* FUOTA image staging area: from the start of the second bank up to the FUOTA extraction journal */
+#define FLASH_USER_FUOTA_IMAGE_START_PAGE FLASH_NB_PAGES_PER_BANK
+#define FLASH_USER_FUOTA_IMAGE_NB_PAGES ( FLASH_USER_FUOTA_JOURNAL_START_PAGE - FLASH_USER_FUOTA_IMAGE_START_PAGE )
+
+/* Persistent data (key-value store and telemetry log): copied at the same offset of the first bank before the banks
+   are swapped to run the staged image, see apps_fuota_image.h */
+#define FLASH_USER_PERSISTENT_START_PAGE FLASH_USER_KV_STORE_START_PAGE
+#define FLASH_USER_PERSISTENT_NB_PAGES ( FLASH_USER_END_PAGE + 1 - FLASH_USER_PERSISTENT_START_PAGE )
+
+/* First page of the areas above, which are not filled sequentially. In the first bank, the firmware image and the user
+   Flash area end at the size of the image staging area, the rest receiving the persistent data before a bank swap */
+#define FLASH_USER_RESERVED_START_PAGE FLASH_USER_FUOTA_IMAGE_NB_PAGES
+
 /* Base address of the Flash s */
 #define ADDR_FLASH_PAGE_0 ( ( uint32_t ) 0x08000000 ) /* Base @ of Page 0, 2 KBytes */
 #define ADDR_FLASH_PAGE( page ) ( ADDR_FLASH_PAGE_0 + ( page ) *ADDR_FLASH_PAGE_SIZE )
 
 #define FLASH_OPERATION_MAX_RETRY 4
 
+#define FLASH_ROW_SIZE ( 256 ) /* Size of the rows buffered by the staging areas before a write = 32 double words */
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/**
+ * @brief Status of the flash erase and write operations
+ */
+typedef enum flash_status_e
+{
+    FLASH_STATUS_OK,             //!< Operation done
+    FLASH_STATUS_INVALID_PARAM,  //!< Address not aligned or out of the user Flash area
+    FLASH_STATUS_ERASE_ERROR,    //!< Erase failed FLASH_OPERATION_MAX_RETRY times
+    FLASH_STATUS_PROGRAM_ERROR,  //!< Programming failed FLASH_OPERATION_MAX_RETRY times
+} flash_status_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -119,16 +163,44 @@ uint8_t flash_erase_page( uint32_t addr, uint8_t nb_page );
  */
 uint8_t flash_force_erase_page( uint32_t addr, uint8_t nb_page );
 
+/**
+ * @brief Erase pages of the user Flash area with a single erase request per bank.
+ *
+ * @param [in] addr FLASH address to start the erase, aligned on a page
+ * @param [in] nb_pages the number of page to erase.
+ * @returns status [FLASH_STATUS_OK, FLASH_STATUS_INVALID_PARAM, FLASH_STATUS_ERASE_ERROR]
+ */
+flash_status_t flash_bulk_erase( uint32_t addr, uint16_t nb_pages );
+
 /**
  * @brief Writes the given buffer to the FLASH at the specified address.
  *
- * @param [in] addr FLASH address to write to
+ * @remark Since the status codes, an address not aligned on a double word or out of the user Flash area is refused
+ * (SMTC_FAIL) instead of spinning forever on the programming error, and the last double word is padded with 0xFF
+ * instead of the bytes following the buffer. A size of 0 still writes nothing and returns 0.
+ *
+ * @param [in] addr FLASH address to write to, aligned on a double word
  * @param [in] buffer Pointer to the buffer to be written.
  * @param [in] size Size of the buffer to be written.
  * @returns status [Real_size_written, FAIL]
  */
 uint32_t flash_write_buffer( uint32_t addr, uint8_t* buffer, uint32_t size );
 
+/**
+ * @brief Writes the given buffer to the FLASH at the specified address by double words, with a single unlock.
+ *
+ * The buffer is copied from any alignment, the last double word being padded with 0xFF.
+ *
+ * @remark The destination must be erased. Row fast programming is not used: the STM32L4 only accepts it on a mass
+ * erased bank, and both banks hold data which must survive (running image, key-value store and telemetry log).
+ *
+ * @param [in] addr FLASH address to write to, aligned on a double word
+ * @param [in] buffer Pointer to the buffer to be written, no alignment constraint.
+ * @param [in] size Size of the buffer to be written.
+ * @returns status [FLASH_STATUS_OK, FLASH_STATUS_INVALID_PARAM, FLASH_STATUS_PROGRAM_ERROR]
+ */
+flash_status_t flash_write_double_words( uint32_t addr, const uint8_t* buffer, uint32_t size );
+
 /**
  * @brief Reads the FLASH at the specified address to the given buffer.
  *
@@ -153,6 +225,26 @@ uint32_t flash_get_user_start_addr( void );
  */
 void flash_set_user_start_addr( uint32_t addr );
 
+/**
+ * @brief Tell if the Flash banks are swapped: the second physical bank is mapped at ADDR_FLASH_PAGE_0.
+ *
+ * @remark The addresses are the ones of the memory map: whatever the mapping, the running firmware is in the first
+ * bank.
+ *
+ * @returns true if the MCU booted from the second physical bank
+ */
+bool flash_is_bank_swapped( void );
+
+/**
+ * @brief Boot from the other bank: toggle the BFB2 option bit and reload the option bytes, which resets the MCU.
+ *
+ * @remark With BFB2 set, the system bootloader maps the second physical bank at ADDR_FLASH_PAGE_0 if its vector table
+ * is valid, and falls back to the first one otherwise.
+ *
+ * @returns FLASH_STATUS_PROGRAM_ERROR if the option bytes could not be programmed, does not return otherwise
+ */
+flash_status_t flash_swap_banks( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -184,6 +184,14 @@ void hal_mcu_disable_once_low_power_wait( void );
  */
 void hal_mcu_partial_sleep_enable( bool enable );
 
+/**
+ * @brief Enable/Disable stop mode
+ *
+ * @remark When stop mode is disabled, the low power handler enters sleep mode: the peripherals (UART reception for
+ * instance) keep running
+ */
+void hal_mcu_stop_mode_enable( bool enable );
+
 /**
  * @brief Enter in low power state
  */
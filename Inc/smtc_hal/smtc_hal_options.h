@@ -59,6 +59,21 @@ extern "C" {
 #define HAL_DBG_TRACE HAL_FEATURE_ON
 #define HAL_DBG_TRACE_COLOR HAL_FEATURE_ON
 
+/* HAL_FEATURE_ON to send the debug traces as binary frames decoded on host side by tools/smtc_dbg_log_decoder.py */
+#define HAL_DBG_TRACE_BINARY HAL_FEATURE_OFF
+
+/* Size in bytes of the RAM buffer holding the binary frames until they are sent (power of 2) */
+#define HAL_DBG_LOG_BUFFER_SIZE 2048
+
+/*
+ * Highest trace level compiled for each module (see smtc_hal_dbg_trace.h), the traces above it generate no code:
+ * HAL_DBG_TRACE_LEVEL_NONE, HAL_DBG_TRACE_LEVEL_ERROR, HAL_DBG_TRACE_LEVEL_WARNING, HAL_DBG_TRACE_LEVEL_INFO or
+ * HAL_DBG_TRACE_LEVEL_DEBUG (arrays and hexadecimal dumps)
+ */
+#define HAL_DBG_TRACE_MODULE_APP_LEVEL HAL_DBG_TRACE_LEVEL_DEBUG
+#define HAL_DBG_TRACE_MODULE_HAL_LEVEL HAL_DBG_TRACE_LEVEL_DEBUG
+#define HAL_DBG_TRACE_MODULE_BOARD_LEVEL HAL_DBG_TRACE_LEVEL_DEBUG
+
 /* HAL_FEATURE_ON to activate sleep mode */
 
 /* HAL_FEATURE_OFF to deactivate sleep mode */
@@ -75,6 +90,9 @@ extern "C" {
 
 #define HAL_I2C_ID 1
 
+/* HAL_FEATURE_ON to compute the CRC32 with the CRC peripheral, HAL_FEATURE_OFF to use a slice-by-8 table (8 KB) */
+#define HAL_USE_CRC32_HW HAL_FEATURE_ON
+
 /* HAL_FEATURE_OFF to not use watchdog */
 #define HAL_USE_WATCHDOG HAL_FEATURE_ON
 
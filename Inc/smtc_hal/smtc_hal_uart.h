@@ -98,6 +98,36 @@ void hal_uart_tx( const uint32_t id, uint8_t* buff, uint16_t len );
  */
 void hal_uart_rx( const uint32_t id, uint8_t* rx_buffer, uint8_t len );
 
+/**
+ * @brief Start the reception in a circular buffer filled by DMA, with idle line detection
+ *
+ * The reception keeps running until reset, including across the UART deinit/init done by the low power handler. In
+ * stop mode, the RX pin is configured as a wake-up interrupt: the byte waking up the MCU is lost.
+ *
+ * @remark @p callback is called under interrupt when the line becomes idle after some bytes were received, when half
+ * of the buffer or the full buffer is filled, and when the MCU is woken up by the RX pin. The received bytes are then
+ * read with @ref hal_uart_rx_read.
+ *
+ * @param [in] id UART interface id [1:N]
+ * @param [in] buffer Circular reception buffer, must remain valid
+ * @param [in] size Size of the circular reception buffer
+ * @param [in] callback Reception callback, can be NULL
+ */
+void hal_uart_rx_dma_start( const uint32_t id, uint8_t* buffer, uint16_t size, void ( *callback )( void ) );
+
+/**
+ * @brief Read the bytes received since the last call, without blocking
+ *
+ * @remark Bytes are lost if more than the circular buffer size are received between two calls
+ *
+ * @param [in] id UART interface id [1:N]
+ * @param [out] buffer Buffer receiving the bytes
+ * @param [in] max_len Size of @p buffer
+ *
+ * @returns Number of bytes copied in @p buffer, 0 if none or if the DMA reception is not started
+ */
+uint16_t hal_uart_rx_read( const uint32_t id, uint8_t* buffer, uint16_t max_len );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,65 @@
+/**
+ * @file      counters_codec.h
+ *
+ * @brief     Payload codec schema "counters"
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+// Generated by tools/smtc_payload_codec.py from counters_codec.json, do not edit
+
+#ifndef COUNTERS_CODEC_H
+#define COUNTERS_CODEC_H
+
+#include "apps_payload_codec.h"
+
+/**
+ * @brief Fields of the "counters" frames
+ */
+enum
+{
+    COUNTERS_FIELD_UPLINKS,
+    COUNTERS_FIELD_CONFIRMED,
+    COUNTERS_NB_FIELDS,
+};
+
+/**
+ * @brief Schema of the "counters" frames
+ */
+static const apps_payload_codec_field_t counters_fields[COUNTERS_NB_FIELDS] = {
+    [COUNTERS_FIELD_UPLINKS] = { APPS_PAYLOAD_CODEC_VARINT, 7, 3 },
+    [COUNTERS_FIELD_CONFIRMED] = { APPS_PAYLOAD_CODEC_VARINT, 7, 3 },
+};
+
+#endif  // COUNTERS_CODEC_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,125 @@
+##
+## @file  counters_decoder.py
+##
+## @brief Decoder of the "counters" payloads
+##
+## The Clear BSD License
+## Copyright Semtech Corporation 2024. All rights reserved.
+##
+## Redistribution and use in source and binary forms, with or without
+## modification, are permitted (subject to the limitations in the disclaimer
+## below) provided that the following conditions are met:
+##     * Redistributions of source code must retain the above copyright
+##       notice, this list of conditions and the following disclaimer.
+##     * Redistributions in binary form must reproduce the above copyright
+##       notice, this list of conditions and the following disclaimer in the
+##       documentation and/or other materials provided with the distribution.
+##     * Neither the name of the Semtech corporation nor the
+##       names of its contributors may be used to endorse or promote products
+##       derived from this software without specific prior written permission.
+##
+## NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+## THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+## CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+## NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+## PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+## LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+## CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+## SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+## INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+## CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+## ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+## POSSIBILITY OF SUCH DAMAGE.
+##
+
+##
+## Generated by tools/smtc_payload_codec.py from counters_codec.json, do not edit
+##
+## Usage:
+##   python counters_decoder.py <frame>...
+##
+
+import sys
+
+SEQUENCE_BITS = 4
+
+SCHEMA = {
+    "name": "counters",
+    "fields": [
+        {
+            "name": "uplinks",
+            "type": "varint",
+            "bits": 7,
+            "delta_bits": 3
+        },
+        {
+            "name": "confirmed",
+            "type": "varint",
+            "bits": 7,
+            "delta_bits": 3
+        }
+    ]
+}
+
+
+class Decoder:
+    """Stateful decoder of the frames of a schema"""
+
+    def __init__(self, schema):
+        self.fields = schema["fields"]
+        self.frames = {}
+
+    @staticmethod
+    def _read(frame, position, nb_bits):
+        if position + nb_bits > 8 * len(frame):
+            raise ValueError("frame too short")
+        value = 0
+        for i in range(position, position + nb_bits):
+            value = (value << 1) | ((frame[i // 8] >> (7 - i % 8)) & 1)
+        return value, position + nb_bits
+
+    @classmethod
+    def _read_varint(cls, frame, position, group_bits):
+        value, shift, more = 0, 0, 1
+        while more:
+            if shift >= 32:
+                raise ValueError("varint too long")
+            data, position = cls._read(frame, position, group_bits)
+            more, position = cls._read(frame, position, 1)
+            value |= data << shift
+            shift += group_bits
+        return (value >> 1) ^ -(value & 1), position
+
+    def decode(self, frame):
+        """Decode a frame, returns (sequence number, {field name: value})"""
+        delta, position = self._read(frame, 0, 1)
+        sequence, position = self._read(frame, position, SEQUENCE_BITS)
+        reference = None
+        if delta:
+            reference_sequence, position = self._read(frame, position, SEQUENCE_BITS)
+            if reference_sequence not in self.frames:
+                raise ValueError("reference frame %u not received" % reference_sequence)
+            reference = self.frames[reference_sequence]
+        values = {}
+        for field in self.fields:
+            name, bits = field["name"], field["bits"]
+            if reference is not None and field.get("delta_bits", 0):
+                difference, position = self._read_varint(frame, position, field["delta_bits"])
+                value = (reference[name] + difference) & 0xFFFFFFFF
+                if field["type"] != "unsigned":
+                    value = value - (1 << 32) if value & 0x80000000 else value
+            elif field["type"] == "varint":
+                value, position = self._read_varint(frame, position, bits)
+            else:
+                value, position = self._read(frame, position, bits)
+                if field["type"] == "signed" and value & (1 << (bits - 1)):
+                    value -= 1 << bits
+            values[name] = value
+        self.frames[sequence] = values
+        return sequence, values
+
+
+if __name__ == "__main__":
+    decoder = Decoder(SCHEMA)
+    for frame in sys.argv[1:]:
+        print("#%u %s" % decoder.decode(bytes.fromhex(frame)))
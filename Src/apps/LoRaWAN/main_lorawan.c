@@ -49,11 +49,26 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "lorawan_commissioning.h"
 #include "lr1121_modem_board.h"
 #include "apps_utilities.h"
+#include "apps_shell.h"
+#include "apps_adr_optimizer.h"
+#include "apps_airtime.h"
+#include "apps_downlink_rx.h"
+#include "apps_join_manager.h"
+#include "apps_kv_store.h"
+#include "apps_link_quality.h"
+#include "apps_telemetry_log.h"
+#include "apps_payload_codec.h"
+#include "apps_uplink_aggregator.h"
+#include "apps_uplink_policy.h"
+#include "apps_uplink_queue.h"
 #include "lr1121_modem_helper.h"
+#include "lr1121_modem_radio.h"
 #include "lr1121_modem_system_types.h"
+#include "counters_codec.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -120,12 +135,48 @@
  */
 #define PERIODICAL_UPLINK_DELAY_S 30
 
-#define EXTI_BUTTON PC_13
+/**
+ * @brief Maximal age in seconds of a periodical record, the records being aggregated in a single uplink until then
+ */
+#define PERIODICAL_RECORD_MAX_AGE_S 300
 
-/*!
- * @brief User application data buffer size
+/**
+ * @brief LoRaWAN port of the aggregated periodical records
+ */
+#define PERIODICAL_RECORD_PORT 101
+
+/**
+ * @brief Type of the counters record in the aggregated uplinks
+ */
+#define COUNTERS_RECORD_TYPE 0
+
+/**
+ * @brief Probability in per mille that an uplink reaches the network, APPS_UPLINK_POLICY_DISABLED to send all the
+ * confirmed uplinks confirmed
+ */
+#define UPLINK_DELIVERY_TARGET 990
+
+/**
+ * @brief Use the ADR optimizer instead of the network server ADR once the link is measured
+ */
+#define USE_ADR_OPTIMIZER true
+
+/**
+ * @brief Goals of the ADR optimizer: typical payload size, demodulation margin, acknowledgement rate in per mille and
+ * latency in ms, 0 for none
  */
-#define LORAWAN_APP_DATA_MAX_SIZE 242
+#define ADR_OPTIMIZER_PAYLOAD_SIZE 16
+#define ADR_OPTIMIZER_MIN_MARGIN_DB 10
+#define ADR_OPTIMIZER_MIN_SUCCESS 900
+#define ADR_OPTIMIZER_MAX_LATENCY_MS 0
+
+/**
+ * @brief Largest random delay before the first join request after reset, spreading the joins of the devices powered up
+ * together
+ */
+#define JOIN_START_JITTER_MS 30000
+
+#define EXTI_BUTTON PC_13
 
 /*!
  * @brief LoRaWAN regulatory region.
@@ -144,6 +195,23 @@
  */
 #define LORAWAN_REGION_USED LR1121_LORAWAN_REGION_EU868
 
+/**
+ * @brief Downlink RSSI histogram: number of 10 dB wide bins, the first one starting at -130 dBm
+ */
+#define DOWNLINK_RSSI_HISTOGRAM_NB_BINS 8
+#define DOWNLINK_RSSI_HISTOGRAM_MIN_DBM -130
+
+/**
+ * @brief Telemetry event types added to the modem event types
+ */
+#define TELEMETRY_EVENT_BOOT 0x80            // Application start
+#define TELEMETRY_EVENT_GET_EVENT_FAIL 0x81  // Modem event read failure, modem_rc holds the response code
+
+/**
+ * @brief Default number of telemetry records printed by the events shell command
+ */
+#define TELEMETRY_EVENTS_DEFAULT_NB 10
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
@@ -159,11 +227,32 @@ static const uint8_t user_nwk_key[16] = LORAWAN_NWK_KEY;
 static const uint8_t user_app_key[16] = LORAWAN_APP_KEY;
 #endif
 
+#if( USE_ADR_OPTIMIZER )
+/**
+ * @brief ADR optimizer goals
+ */
+static const apps_adr_optimizer_goals_t adr_optimizer_goals = {
+    .payload_size   = ADR_OPTIMIZER_PAYLOAD_SIZE,
+    .min_margin_db  = ADR_OPTIMIZER_MIN_MARGIN_DB,
+    .min_success    = ADR_OPTIMIZER_MIN_SUCCESS,
+    .max_latency_ms = ADR_OPTIMIZER_MAX_LATENCY_MS,
+};
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/**
+ * @brief Keys of the values saved in the key-value store
+ */
+typedef enum
+{
+    KV_STORE_KEY_UPLINK_COUNTER    = 0,
+    KV_STORE_KEY_CONFIRMED_COUNTER = 1,
+} kv_store_key_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -182,7 +271,14 @@ extern lr1121_t lr1121;
 static volatile bool user_button_is_press = false;  // Flag indicating if the button is pressed
 static uint32_t      uplink_counter       = 0;      // Counter for uplinks sent
 static uint32_t      confirmed_counter    = 0;      // Counter for confirmed uplinks
-static bool          uplink_sending       = false;  // Flag indicating an uplink is requested but not yet sent
+static uint32_t      downlink_counter     = 0;      // Counter for downlinks received
+
+static uint32_t downlink_rssi_histogram[DOWNLINK_RSSI_HISTOGRAM_NB_BINS] = { 0 };
+
+static lr1121_modem_charge_t modem_charge_details;  // Modem charge counters, read at each transmission
+static uint32_t              modem_charge = 0;      // LoRaWAN stack charge in uA.s, recorded in the telemetry log
+
+static apps_payload_codec_t counters_codec;  // Codec of the counters records
 
 /*
  * -----------------------------------------------------------------------------
@@ -197,22 +293,123 @@ static bool          uplink_sending       = false;  // Flag indicating an uplink
 static void user_button_callback( void* context );
 
 /**
- * @brief Send the 32bits uplink counter and 32bits confirmed counter on chosen port
+ * @brief Encode the 32bits uplink counter and 32bits confirmed counter
+ *
+ * @param [out] buffer Counters, 8 bytes
+ */
+static void counters_encode( uint8_t* buffer );
+
+/**
+ * @brief Add the counters record to the next aggregated periodical uplink, encoded with counters_codec
+ */
+static void add_counters_record( void );
+
+/**
+ * @brief Acknowledge the last counters record of a confirmed periodical uplink, the reference of the next ones
+ *
+ * @param [in] port LoRaWAN port
+ * @param [in] payload Payload
+ * @param [in] size Payload size
+ * @param [in] tx_done_status Status of the TX_DONE event
  */
-static void send_uplinks_counter_on_port( uint8_t port );
+static void uplink_sent( uint8_t port, const uint8_t* payload, uint8_t size,
+                         lr1121_modem_tx_done_event_t tx_done_status );
 
 /**
- * @brief Send tx_frame_buffer on choosen port
+ * @brief Queue the 32bits uplink counter and 32bits confirmed counter on chosen port
  *
+ * @param [in] port LoRaWAN port
+ * @param [in] priority Uplink priority in the queue
+ * @param [in] lifetime_ms Time after which the uplink is dropped if not sent yet, APPS_UPLINK_QUEUE_NO_EXPIRY
  */
-static lr1121_modem_response_code_t send_frame( const uint8_t* tx_frame_buffer, const uint8_t tx_frame_buffer_size,
-                                                uint8_t port, const lr1121_modem_uplink_type_t tx_confirmed );
+static void send_uplinks_counter_on_port( uint8_t port, apps_uplink_queue_priority_t priority, uint32_t lifetime_ms );
 
 /**
  * @brief Process received events
  *
  */
 static void event_process( void* context );
+
+/**
+ * @brief Count a downlink in the RSSI histogram
+ *
+ * @param [in] rssi Downlink RSSI in dBm
+ */
+static void downlink_rssi_histogram_add( int16_t rssi );
+
+/**
+ * @brief Mount the key-value store and restore the uplink counters saved before the last reset
+ */
+static void counters_restore( void );
+
+/**
+ * @brief Save the uplink counters in the key-value store if they have changed
+ */
+static void counters_save( void );
+
+/**
+ * @brief Request a link check from the network, if the device joined
+ *
+ * @param [in] context Chip implementation context
+ */
+static void link_check_request( const void* context );
+
+/**
+ * @brief Shell command printing the uplink and downlink counters
+ */
+static void shell_cmd_counters( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command printing the last telemetry records
+ */
+static void shell_cmd_events( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command printing the downlink RSSI histogram
+ */
+static void shell_cmd_histo( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command sending the uplink counters, on port 102 or on the given port
+ */
+static void shell_cmd_uplink( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command printing the time on air and the duty-cycle off time of an uplink at each data rate
+ */
+static void shell_cmd_airtime( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command printing the link health and the downlink statistics per window and per data rate
+ */
+static void shell_cmd_link( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command printing the uplink policy statistics, or setting its delivery target
+ */
+static void shell_cmd_policy( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command printing the custom ADR list and the acknowledgements per data rate
+ */
+static void shell_cmd_adr( uint8_t argc, char* argv[] );
+
+/**
+ * @brief Shell command printing the join procedure state and the time-to-join statistics
+ */
+static void shell_cmd_join( uint8_t argc, char* argv[] );
+
+static const apps_shell_command_t shell_commands[] = {
+    { "counters", "print the uplink and downlink counters", shell_cmd_counters },
+    { "histo", "print the downlink RSSI histogram", shell_cmd_histo },
+    { "events", "events [n]: print the last telemetry records", shell_cmd_events },
+    { "uplink", "uplink [port]: send the uplink counters", shell_cmd_uplink },
+    { "airtime", "airtime [size]: print the time on air of an uplink", shell_cmd_airtime },
+    { "link", "print the link health and the downlink statistics", shell_cmd_link },
+    { "policy", "policy [target]: print the uplink policy, or set its delivery target in per mille", shell_cmd_policy },
+    { "adr", "print the custom ADR list and the acknowledgements per data rate", shell_cmd_adr },
+    { "join", "print the join procedure and the time-to-join statistics", shell_cmd_join },
+};
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -230,6 +427,21 @@ int main( void )
     HAL_DBG_TRACE_INFO( "###### ===== Periodical uplink (%d sec) example is starting ==== ######\n\n\n",
                         PERIODICAL_UPLINK_DELAY_S );
 
+    counters_restore( );
+    apps_uplink_aggregator_init( PERIODICAL_RECORD_PORT, LR1121_MODEM_UPLINK_CONFIRMED,
+                                 PERIODICAL_RECORD_MAX_AGE_S * 1000 );
+    apps_payload_codec_init( &counters_codec, counters_fields, COUNTERS_NB_FIELDS );
+    apps_uplink_queue_set_sent_callback( uplink_sent );
+    apps_uplink_policy_init( UPLINK_DELIVERY_TARGET );
+
+    // Keep the modem events across resets for post-mortem analysis
+    if( apps_telemetry_log_init( FLASH_USER_TELEMETRY_LOG_START_PAGE, FLASH_USER_TELEMETRY_LOG_NB_PAGES ) == true )
+    {
+        const apps_telemetry_log_record_t boot_record = { .event_type = TELEMETRY_EVENT_BOOT };
+
+        apps_telemetry_log_append( &boot_record );
+    }
+
     // Disable IRQ to avoid unwanted behavior during init
     hal_mcu_disable_irq( );
 
@@ -258,10 +470,42 @@ int main( void )
     /* Board is initialized */
     leds_blink( LED_TX_MASK, 100, 20, true );
     HAL_DBG_TRACE_MSG( "Initialization done\n\n" );
+    apps_shell_init( &lr1121, shell_commands, sizeof( shell_commands ) / sizeof( shell_commands[0] ) );
     lr1121_modem_system_reboot( &lr1121, false );
 
     while( 1 )
     {
+        apps_shell_process( );
+
+        // Save the counters updated by the last events, then compact the store in advance if needed
+        counters_save( );
+        apps_kv_store_process( );
+        apps_telemetry_log_process( );
+
+        // Pack the periodical records, then request the next queued uplink as soon as the duty cycle allows it
+        uint32_t       sleep_ms       = apps_uplink_aggregator_process( &lr1121 );
+        const uint32_t queue_sleep_ms = apps_uplink_queue_process( &lr1121 );
+        if( queue_sleep_ms < sleep_ms )
+        {
+            sleep_ms = queue_sleep_ms;
+        }
+        // Measure the link when its quality asks for it, once the queued uplinks are sent
+        if( ( queue_sleep_ms == APPS_UPLINK_QUEUE_IDLE ) && ( apps_link_quality_is_link_check_due( ) == true ) )
+        {
+            link_check_request( &lr1121 );
+        }
+        apps_adr_optimizer_process( &lr1121 );
+        // Send the join request scheduled after reset or after a join failure
+        const uint32_t join_sleep_ms = apps_join_manager_process( &lr1121 );
+        if( join_sleep_ms < sleep_ms )
+        {
+            sleep_ms = join_sleep_ms;
+        }
+        if( sleep_ms > WATCHDOG_RELOAD_PERIOD_MS )
+        {
+            sleep_ms = WATCHDOG_RELOAD_PERIOD_MS;
+        }
+
         // Check button
         if( user_button_is_press == true )
         {
@@ -272,17 +516,9 @@ int main( void )
             // Check if the device has already joined a network
             if( ( modem_status & LR1121_LORAWAN_JOINED ) == LR1121_LORAWAN_JOINED )
             {
-                if( uplink_sending == false )
-                {
-                    // Send the uplink counter on port 102
-                    send_uplinks_counter_on_port( 102 );
-                }
-                else
-                {
-                    HAL_DBG_TRACE_PRINTF(
-                        "An uplink has already been requested, please wait for this uplink to be sent before "
-                        "requesting another one\n" );
-                }
+                // Send the uplink counter on port 102, ahead of the periodical uplinks
+                send_uplinks_counter_on_port( 102, APPS_UPLINK_QUEUE_PRIORITY_HIGH, APPS_UPLINK_QUEUE_NO_EXPIRY );
+                sleep_ms = 0;
             }
             else
             {
@@ -294,7 +530,7 @@ int main( void )
         if( ( user_button_is_press == false ) )
         {
             hal_watchdog_reload( );
-            hal_mcu_set_sleep_for_ms( WATCHDOG_RELOAD_PERIOD_MS );
+            hal_mcu_set_sleep_for_ms( ( int32_t ) sleep_ms );
         }
         hal_watchdog_reload( );
         hal_mcu_enable_irq( );
@@ -317,6 +553,13 @@ static void event_process( void* context )
         rc_event = lr1121_modem_get_event( context, &current_event );
         if( rc_event == LR1121_MODEM_RESPONSE_CODE_OK )
         {
+            // Telemetry record of the event, completed by the event handlers
+            apps_telemetry_log_record_t telemetry_record = {
+                .event_type = current_event.event_type,
+                .modem_rc   = rc_event,
+            };
+            bool telemetry_appended = false;  // The event handler appended its own records
+
             switch( current_event.event_type )
             {
             case LR1121_MODEM_LORAWAN_EVENT_RESET:
@@ -347,15 +590,19 @@ static void event_process( void* context )
                 // Set user region
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_region( context, LORAWAN_REGION_USED ) );
                 print_lorawan_region( LORAWAN_REGION_USED );
-                // Schedule a LoRaWAN network JoinRequest.
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_join( context ) );
-                HAL_DBG_TRACE_INFO( "###### ===== JOINING ==== ######\n\n\n" );
+                // Time-on-air model of the uplinks, whose data rate is inferred by the uplink aggregator
+                if( apps_airtime_init( LORAWAN_REGION_USED ) == false )
+                {
+                    HAL_DBG_TRACE_WARNING( "No time-on-air model for this region, uplinks packed greedily\n" );
+                }
+                // Schedule a LoRaWAN network JoinRequest after a random delay, sent from the main loop
+                apps_join_manager_start( context, JOIN_START_JITTER_MS );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_ALARM:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: ALARM\n\n", HAL_DBG_TRACE_COLOR_BLUE );
-                // Send periodical uplink on port 101
-                send_uplinks_counter_on_port( 101 );
+                // Add a periodical record, sent on port 101 with the following ones
+                add_counters_record( );
                 // Restart periodical uplink alarm
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_alarm_timer( context, PERIODICAL_UPLINK_DELAY_S ) );
                 break;
@@ -363,13 +610,18 @@ static void event_process( void* context )
             case LR1121_MODEM_LORAWAN_EVENT_JOINED:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINED\n", HAL_DBG_TRACE_COLOR_BLUE );
                 HAL_DBG_TRACE_INFO( "Modem is now joined \n\n" );
+                apps_join_manager_on_joined( );
 
                 uint8_t adr_custom_list[16] = { 0 };
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_adr_profile(
                     context, LR1121_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED, adr_custom_list ) );
+#if( USE_ADR_OPTIMIZER )
+                // The network server ADR runs until the link is measured
+                apps_adr_optimizer_init( &adr_optimizer_goals );
+#endif
 
-                // Send first periodical uplink on port 101
-                send_uplinks_counter_on_port( 101 );
+                // Add the first periodical record, sent on port 101 with the following ones
+                add_counters_record( );
                 // start periodical uplink alarm
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_alarm_timer( context, PERIODICAL_UPLINK_DELAY_S ) );
                 break;
@@ -379,6 +631,13 @@ static void event_process( void* context )
                 const lr1121_modem_tx_done_event_t tx_done_event_data =
                     ( lr1121_modem_tx_done_event_t )( current_event.data >> 8 );
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: TXDONE\n\n", HAL_DBG_TRACE_COLOR_BLUE );
+                telemetry_record.info = tx_done_event_data;
+                if( lr1121_modem_get_charge( context, &modem_charge_details ) == LR1121_MODEM_RESPONSE_CODE_OK )
+                {
+                    modem_charge = modem_charge_details.lr1mac_stack.tx_consumption_ma +
+                                   modem_charge_details.lr1mac_stack.rx_consumption_ma +
+                                   modem_charge_details.lr1mac_stack.none_consumption_ma;
+                }
 
                 HAL_DBG_TRACE_MSG( "TX DATA     : " );
 
@@ -387,7 +646,6 @@ static void event_process( void* context )
                 case LR1121_MODEM_TX_NOT_SENT:
                 {
                     HAL_DBG_TRACE_PRINTF( " NOT SENT" );
-                    uplink_counter--;
                     break;
                 }
                 case LR1121_MODEM_CONFIRMED_TX:
@@ -409,30 +667,49 @@ static void event_process( void* context )
                 HAL_DBG_TRACE_MSG( "\n\n" );
 
                 HAL_DBG_TRACE_INFO( "Transmission done \n" );
-                uplink_sending = false;  // Reset flag indicating an uplink request has been processed
+                // Release the sent uplink, or keep it for a new transmission if not sent
+                apps_uplink_queue_on_tx_done( tx_done_event_data );
+                apps_link_quality_read_lost_connection( context );
                 break;
             }
 
             case LR1121_MODEM_LORAWAN_EVENT_DOWN_DATA:
+            {
+                const apps_downlink_rx_frame_t* downlink;
+
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: DOWNDATA\n\n", HAL_DBG_TRACE_COLOR_BLUE );
-                uint8_t rx_payload[LORAWAN_APP_DATA_MAX_SIZE] = { 0 };  // Buffer for rx payload
-                uint8_t rx_payload_size                       = 0;      // Size of the payload in the rx_payload buffer
-                lr1121_modem_downlink_metadata_t rx_metadata  = { 0 };  // Metadata of downlink
-                uint8_t                          rx_remaining = 0;      // Remaining downlink payload in modem
-                // Get downlink data
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data_size( context, &rx_payload_size, &rx_remaining ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data( context, rx_payload, rx_payload_size ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_metadata( context, &rx_metadata ) );
-                HAL_DBG_TRACE_PRINTF( "Data received on port %u\n", rx_metadata.fport );
-                HAL_DBG_TRACE_ARRAY( "Received payload", rx_payload, rx_payload_size );
+                // Get all the downlinks waiting in the modem, then handle them in order
+                apps_downlink_rx_drain( context );
+                while( ( downlink = apps_downlink_rx_take( ) ) != NULL )
+                {
+                    HAL_DBG_TRACE_PRINTF( "Data received on port %u\n", downlink->metadata.fport );
+                    downlink_counter++;
+                    downlink_rssi_histogram_add( downlink->metadata.rssi );
+                    apps_link_quality_add_downlink( &downlink->metadata );
+                    // One telemetry record per downlink, each one with its own RSSI and SNR
+                    telemetry_record.rssi_dbm = downlink->metadata.rssi;
+                    telemetry_record.snr_db   = downlink->metadata.snr_integer;
+                    telemetry_record.info     = downlink->metadata.fport;
+                    telemetry_record.charge   = modem_charge;
+                    apps_telemetry_log_append( &telemetry_record );
+                    telemetry_appended = true;
+                    HAL_DBG_TRACE_ARRAY( "Received payload", downlink->payload, downlink->size );
+                    set_trace_levels_from_downlink( downlink->metadata.fport, downlink->payload, downlink->size );
+                    apps_downlink_rx_release( downlink );
+                }
                 break;
+            }
 
             case LR1121_MODEM_LORAWAN_EVENT_JOIN_FAIL:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINFAIL\n\n", HAL_DBG_TRACE_COLOR_BLUE );
+                // Retry after a random backoff instead of the automatic retry of the modem
+                apps_join_manager_on_join_fail( context );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_LINK_CHECK:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: LINK_CHECK\n\n", HAL_DBG_TRACE_COLOR_BLUE );
+                telemetry_record.info = ( uint8_t ) ( current_event.data >> 8 );
+                apps_link_quality_on_link_check( context, ( uint8_t ) ( current_event.data >> 8 ) );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_CLASS_B_PING_SLOT_INFO:
@@ -466,6 +743,22 @@ static void event_process( void* context )
                 HAL_DBG_TRACE_INFO( "Event not handled 0x%02x\n", current_event.event_type );
                 break;
             }
+
+            if( telemetry_appended == false )
+            {
+                telemetry_record.charge = modem_charge;
+                apps_telemetry_log_append( &telemetry_record );
+            }
+        }
+        else if( rc_event != LR1121_MODEM_RESPONSE_CODE_NO_EVENT )
+        {
+            const apps_telemetry_log_record_t telemetry_record = {
+                .event_type = TELEMETRY_EVENT_GET_EVENT_FAIL,
+                .modem_rc   = rc_event,
+                .charge     = modem_charge,
+            };
+
+            apps_telemetry_log_append( &telemetry_record );
         }
     } while( rc_event != LR1121_MODEM_RESPONSE_CODE_NO_EVENT );
 }
@@ -484,69 +777,355 @@ static void user_button_callback( void* context )
     }
 }
 
-static void send_uplinks_counter_on_port( uint8_t port )
+static void counters_encode( uint8_t* buffer )
+{
+    buffer[0] = ( uplink_counter >> 24 ) & 0xFF;
+    buffer[1] = ( uplink_counter >> 16 ) & 0xFF;
+    buffer[2] = ( uplink_counter >> 8 ) & 0xFF;
+    buffer[3] = ( uplink_counter & 0xFF );
+    buffer[4] = ( confirmed_counter >> 24 ) & 0xFF;
+    buffer[5] = ( confirmed_counter >> 16 ) & 0xFF;
+    buffer[6] = ( confirmed_counter >> 8 ) & 0xFF;
+    buffer[7] = ( confirmed_counter & 0xFF );
+}
+
+static void add_counters_record( void )
+{
+    const int32_t values[COUNTERS_NB_FIELDS] = {
+        [COUNTERS_FIELD_UPLINKS]   = ( int32_t ) uplink_counter,
+        [COUNTERS_FIELD_CONFIRMED] = ( int32_t ) confirmed_counter,
+    };
+    uint8_t       buff[APPS_UPLINK_AGGREGATOR_MAX_RECORD_SIZE];
+    const uint8_t size = apps_payload_codec_encode( &counters_codec, values, buff, sizeof( buff ) );
+
+    if( ( size != 0 ) &&
+        ( apps_uplink_aggregator_add( COUNTERS_RECORD_TYPE, APPS_UPLINK_QUEUE_PRIORITY_NORMAL, buff, size ) == true ) )
+    {
+        uplink_counter++;  // Increment uplink counter
+    }
+    else
+    {
+        HAL_DBG_TRACE_WARNING( "Uplink aggregator full, record dropped\n" );
+    }
+}
+
+static void uplink_sent( uint8_t port, const uint8_t* payload, uint8_t size,
+                         lr1121_modem_tx_done_event_t tx_done_status )
+{
+    const uint8_t* last_record = NULL;
+
+    if( ( port != PERIODICAL_RECORD_PORT ) || ( tx_done_status != LR1121_MODEM_CONFIRMED_TX ) )
+    {
+        return;
+    }
+
+    // Only the last record is acknowledged: an older one may share its sequence number with a record not sent yet
+    for( uint8_t i = 0; i < size; i += 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( payload[i] ) )
+    {
+        if( APPS_UPLINK_AGGREGATOR_RECORD_TYPE( payload[i] ) == COUNTERS_RECORD_TYPE )
+        {
+            last_record = &payload[i + 1];
+        }
+    }
+    if( last_record != NULL )
+    {
+        apps_payload_codec_acknowledge( &counters_codec, apps_payload_codec_get_sequence( last_record ) );
+    }
+}
+
+static void send_uplinks_counter_on_port( uint8_t port, apps_uplink_queue_priority_t priority, uint32_t lifetime_ms )
 {
     // Send uplink and confirmed counter
     uint8_t buff[8] = { 0 };
-    buff[0]         = ( uplink_counter >> 24 ) & 0xFF;
-    buff[1]         = ( uplink_counter >> 16 ) & 0xFF;
-    buff[2]         = ( uplink_counter >> 8 ) & 0xFF;
-    buff[3]         = ( uplink_counter & 0xFF );
-    buff[4]         = ( confirmed_counter >> 24 ) & 0xFF;
-    buff[5]         = ( confirmed_counter >> 16 ) & 0xFF;
-    buff[6]         = ( confirmed_counter >> 8 ) & 0xFF;
-    buff[7]         = ( confirmed_counter & 0xFF );
-    ASSERT_SMTC_MODEM_RC( send_frame( buff, 8, port, true ) );
-    uplink_counter++;  // Increment uplink counter
-    uplink_sending = true;
+
+    counters_encode( buff );
+    if( apps_uplink_queue_push( port, LR1121_MODEM_UPLINK_CONFIRMED, priority, lifetime_ms, buff, 8 ) == true )
+    {
+        uplink_counter++;  // Increment uplink counter
+    }
+    else
+    {
+        HAL_DBG_TRACE_WARNING( "Uplink queue full, uplink on port %u dropped\n", port );
+    }
 }
 
-static lr1121_modem_response_code_t send_frame( const uint8_t* tx_frame_buffer, const uint8_t tx_frame_buffer_size,
-                                                uint8_t port, const lr1121_modem_uplink_type_t tx_confirmed )
+static void downlink_rssi_histogram_add( int16_t rssi )
 {
-    lr1121_modem_response_code_t modem_response_code = LR1121_MODEM_RESPONSE_CODE_OK;
-    uint8_t                      tx_max_payload;
-    int32_t                      duty_cycle;
+    int32_t bin = ( ( int32_t ) rssi - DOWNLINK_RSSI_HISTOGRAM_MIN_DBM ) / 10;
 
-    lr1121_modem_get_duty_cycle_status( &lr1121, &duty_cycle );
+    if( bin < 0 )
+    {
+        bin = 0;
+    }
+    else if( bin >= DOWNLINK_RSSI_HISTOGRAM_NB_BINS )
+    {
+        bin = DOWNLINK_RSSI_HISTOGRAM_NB_BINS - 1;
+    }
+    downlink_rssi_histogram[bin]++;
+}
+
+static void counters_restore( void )
+{
+    if( apps_kv_store_init( FLASH_USER_KV_STORE_START_PAGE, FLASH_USER_KV_STORE_NB_PAGES ) == false )
+    {
+        return;
+    }
+    apps_kv_store_read( KV_STORE_KEY_UPLINK_COUNTER, &uplink_counter, sizeof( uplink_counter ), NULL );
+    apps_kv_store_read( KV_STORE_KEY_CONFIRMED_COUNTER, &confirmed_counter, sizeof( confirmed_counter ), NULL );
+    HAL_DBG_TRACE_INFO( "Restored counters: uplinks %lu, confirmed %lu\n", uplink_counter, confirmed_counter );
+}
+
+static void counters_save( void )
+{
+    // Copies of the counters updated by the event interrupt, a 4-byte value costs one flash double word
+    const uint32_t uplinks   = uplink_counter;
+    const uint32_t confirmed = confirmed_counter;
+
+    apps_kv_store_write( KV_STORE_KEY_UPLINK_COUNTER, &uplinks, sizeof( uplinks ) );
+    apps_kv_store_write( KV_STORE_KEY_CONFIRMED_COUNTER, &confirmed, sizeof( confirmed ) );
+}
+
+static void link_check_request( const void* context )
+{
+    lr1121_modem_lorawan_status_bitmask_t modem_status = 0;
+    lr1121_modem_response_code_t          rc           = LR1121_MODEM_RESPONSE_CODE_FAIL;
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    if( ( lr1121_modem_get_status( context, &modem_status ) == LR1121_MODEM_RESPONSE_CODE_OK ) &&
+        ( ( modem_status & LR1121_LORAWAN_JOINED ) == LR1121_LORAWAN_JOINED ) )
+    {
+        rc = lr1121_modem_mac_request_tx( context, LR1121_MODEM_MAC_REQUEST_LINK_CHECK );
+        // A refused request is not retried before the next link check is due
+        apps_link_quality_on_link_check_requested( );
+    }
+    hal_gpio_irq_enable( );
 
-    if( duty_cycle < 0 )
+    if( rc == LR1121_MODEM_RESPONSE_CODE_OK )
     {
-        HAL_DBG_TRACE_INFO( "DUTY CYCLE, NEXT UPLINK AVAILABLE in %d milliseconds \n\n\n", -duty_cycle );
-        return modem_response_code;
+        HAL_DBG_TRACE_INFO( "Link check requested\n" );
     }
+}
+
+static void shell_cmd_counters( uint8_t argc, char* argv[] )
+{
+    apps_uplink_queue_stats_t      stats;
+    apps_uplink_aggregator_stats_t aggregator_stats;
+    apps_downlink_rx_stats_t       downlink_stats;
+
+    apps_uplink_queue_get_stats( &stats );
+    APPS_SHELL_PRINTF( "Uplinks: %lu, confirmed: %lu, downlinks: %lu%s\n", uplink_counter, confirmed_counter,
+                       downlink_counter, ( stats.tx_pending == true ) ? ", uplink on-going" : "" );
+    APPS_SHELL_PRINTF( "Queue: %u queued, %lu sent, %lu not sent, %lu flushes, %lu expired, %lu dropped\n",
+                       stats.nb_entries, stats.nb_sent, stats.nb_not_sent, stats.nb_flushes, stats.nb_expired,
+                       stats.nb_dropped );
+    apps_uplink_aggregator_get_stats( &aggregator_stats );
+    APPS_SHELL_PRINTF( "Aggregator: %u pending, %lu records in %lu uplinks, %lu resplits, %lu dropped\n",
+                       aggregator_stats.nb_pending, aggregator_stats.nb_records, aggregator_stats.nb_uplinks,
+                       aggregator_stats.nb_resplits, aggregator_stats.nb_dropped );
+    apps_downlink_rx_get_stats( &downlink_stats );
+    APPS_SHELL_PRINTF( "Downlink pool: %u ready, %u held, %u max used, %lu received, %lu queued, %lu dropped, "
+                       "%lu deferred, %lu errors\n",
+                       downlink_stats.nb_ready, downlink_stats.nb_held, downlink_stats.max_used,
+                       downlink_stats.nb_received, downlink_stats.nb_queued, downlink_stats.nb_dropped,
+                       downlink_stats.nb_deferred, downlink_stats.nb_errors );
+}
+
+static void shell_cmd_events( uint8_t argc, char* argv[] )
+{
+    uint32_t nb_events = ( argc > 1 ) ? strtoul( argv[1], NULL, 0 ) : TELEMETRY_EVENTS_DEFAULT_NB;
 
-    modem_response_code = lr1121_modem_get_next_tx_max_payload( &lr1121, &tx_max_payload );
-    if( modem_response_code != LR1121_MODEM_RESPONSE_CODE_OK )
+    APPS_SHELL_PRINTF( "%lu records retained, %lu dropped\n", apps_telemetry_log_get_nb_records( ),
+                       apps_telemetry_log_get_nb_dropped( ) );
+    for( uint32_t i = 0; ( i < nb_events ) && ( i < apps_telemetry_log_get_nb_records( ) ); i++ )
     {
-        HAL_DBG_TRACE_ERROR( "\n\n lr1121_modem_get_next_tx_max_payload RC : %d \n\n", modem_response_code );
+        apps_telemetry_log_record_t record;
+
+        if( apps_telemetry_log_read( i, &record ) == true )
+        {
+            APPS_SHELL_PRINTF( "#%lu t=%lus event=0x%02x rc=%u rssi=%d snr=%d info=%u charge=%lu\n", record.sequence,
+                               record.timestamp_s, record.event_type, record.modem_rc, record.rssi_dbm, record.snr_db,
+                               record.info, record.charge );
+        }
+        else
+        {
+            APPS_SHELL_PRINTF( "-%lu: invalid record\n", i );
+        }
     }
+}
 
-    if( tx_frame_buffer_size > tx_max_payload )
+static void shell_cmd_histo( uint8_t argc, char* argv[] )
+{
+    for( uint8_t i = 0; i < DOWNLINK_RSSI_HISTOGRAM_NB_BINS; i++ )
     {
-        /* Send empty frame in order to flush MAC commands */
-        HAL_DBG_TRACE_PRINTF( "\n\n APP DATA > MAX PAYLOAD AVAILABLE (%d bytes) \n\n", tx_max_payload );
-        modem_response_code = lr1121_modem_request_tx( &lr1121, port, tx_confirmed, NULL, 0 );
+        const int32_t min_dbm = DOWNLINK_RSSI_HISTOGRAM_MIN_DBM + ( 10 * i );
+
+        APPS_SHELL_PRINTF( "%s%4ld dBm: %lu\n", ( i == ( DOWNLINK_RSSI_HISTOGRAM_NB_BINS - 1 ) ) ? ">=" : "  ", min_dbm,
+                           downlink_rssi_histogram[i] );
+    }
+}
+
+static void shell_cmd_uplink( uint8_t argc, char* argv[] )
+{
+    lr1121_modem_lorawan_status_bitmask_t modem_status;
+    unsigned long                         port = 102;
+
+    if( argc > 1 )
+    {
+        port = strtoul( argv[1], NULL, 0 );
+        if( ( port == 0 ) || ( port > 223 ) )
+        {
+            APPS_SHELL_PRINTF( "Invalid port\n" );
+            return;
+        }
+    }
+
+    lr1121_modem_get_status( &lr1121, &modem_status );
+    if( ( modem_status & LR1121_LORAWAN_JOINED ) != LR1121_LORAWAN_JOINED )
+    {
+        APPS_SHELL_PRINTF( "The device has not yet joined the network\n" );
     }
     else
     {
-        modem_response_code =
-            lr1121_modem_request_tx( &lr1121, port, tx_confirmed, tx_frame_buffer, tx_frame_buffer_size );
+        send_uplinks_counter_on_port( ( uint8_t ) port, APPS_UPLINK_QUEUE_PRIORITY_HIGH, APPS_UPLINK_QUEUE_NO_EXPIRY );
+    }
+}
+
+static void shell_cmd_airtime( uint8_t argc, char* argv[] )
+{
+    lr1121_modem_radio_mod_params_lora_t mod_params;
+    unsigned long                        size = ( argc > 1 ) ? strtoul( argv[1], NULL, 0 ) : 0;
+
+    if( size > APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE )
+    {
+        APPS_SHELL_PRINTF( "Invalid size\n" );
+        return;
+    }
+
+    for( uint8_t data_rate = 0; apps_airtime_get_lora_params( data_rate, &mod_params ) == true; data_rate++ )
+    {
+        const uint32_t time_on_air_ms = apps_airtime_get_time_on_air_ms( data_rate, ( uint8_t ) size );
+
+        APPS_SHELL_PRINTF( "%sDR%u SF%u/%lukHz: %lu ms on air, %lu ms off\n",
+                           ( data_rate == apps_airtime_get_data_rate( ) ) ? "*" : " ", data_rate, mod_params.sf,
+                           lr1121_modem_radio_get_lora_bw_in_hz( mod_params.bw ) / 1000, time_on_air_ms,
+                           apps_airtime_get_off_time_ms( time_on_air_ms ) );
+    }
+}
+
+static void shell_cmd_link( uint8_t argc, char* argv[] )
+{
+    static const char* const   level_names[] = { "unknown", "poor", "fair", "good" };
+    apps_link_quality_health_t health;
+    apps_link_quality_stats_t  stats;
+
+    apps_link_quality_get_health( &health );
+    APPS_SHELL_PRINTF( "Health: %s, score %u, margin %d dB, %u gateways, %u uplinks without downlink for %lus\n",
+                       level_names[health.level], health.score, health.margin_db, health.gateway_count,
+                       health.nb_lost, health.lost_since_s );
+    for( uint8_t window = 0; window < APPS_LINK_QUALITY_NB_WINDOWS; window++ )
+    {
+        if( apps_link_quality_get_window_stats( ( lr1121_modem_downlink_window_t ) window, &stats ) == true )
+        {
+            APPS_SHELL_PRINTF( "Window 0x%02x: %lu downlinks, rssi %d dBm, snr %d/4 dB, ", window, stats.nb_downlinks,
+                               stats.rssi_dbm, stats.snr_qdb );
+            APPS_SHELL_PRINTF( "last %u: rssi %d/%d dBm, snr %d/%d /4 dB (avg/min)\n", stats.nb_window,
+                               stats.rssi_avg_dbm, stats.rssi_min_dbm, stats.snr_avg_qdb, stats.snr_min_qdb );
+        }
+    }
+    for( uint8_t data_rate = 0; data_rate < APPS_LINK_QUALITY_NB_DATA_RATES; data_rate++ )
+    {
+        if( apps_link_quality_get_data_rate_stats( data_rate, &stats ) == true )
+        {
+            APPS_SHELL_PRINTF( "DR%u: %lu downlinks, rssi %d dBm, snr %d/4 dB, ", data_rate, stats.nb_downlinks,
+                               stats.rssi_dbm, stats.snr_qdb );
+            APPS_SHELL_PRINTF( "last %u: rssi %d/%d dBm, snr %d/%d /4 dB (avg/min)\n", stats.nb_window,
+                               stats.rssi_avg_dbm, stats.rssi_min_dbm, stats.snr_avg_qdb, stats.snr_min_qdb );
+        }
+    }
+}
+
+static void shell_cmd_policy( uint8_t argc, char* argv[] )
+{
+    apps_uplink_policy_stats_t stats;
+
+    if( argc > 1 )
+    {
+        const unsigned long target = strtoul( argv[1], NULL, 0 );
+
+        if( target > 1000 )
+        {
+            APPS_SHELL_PRINTF( "Invalid target\n" );
+            return;
+        }
+        apps_uplink_policy_init( ( uint16_t ) target );
+    }
+
+    apps_uplink_policy_get_stats( &stats );
+    if( stats.target == APPS_UPLINK_POLICY_DISABLED )
+    {
+        APPS_SHELL_PRINTF( "Policy disabled\n" );
+        return;
     }
+    APPS_SHELL_PRINTF( "Target %u/1000: success %u/1000 (%u/%u probes acked), x%u for %u/1000\n", stats.target,
+                       stats.success, stats.nb_window_acked, stats.nb_window, stats.nb_trans, stats.delivery );
+    APPS_SHELL_PRINTF( "Sent: %lu confirmed (%lu probes), %lu unconfirmed, %lu transmissions\n", stats.nb_confirmed,
+                       stats.nb_probes, stats.nb_unconfirmed, stats.nb_transmissions );
+}
 
-    if( modem_response_code == LR1121_MODEM_RESPONSE_CODE_OK )
+static void shell_cmd_adr( uint8_t argc, char* argv[] )
+{
+    apps_adr_optimizer_stats_t stats;
+
+    apps_adr_optimizer_get_stats( &stats );
+    if( stats.applied == true )
     {
-        HAL_DBG_TRACE_INFO( "lr1121 MODEM-E REQUEST TX \n\n" );
-        HAL_DBG_TRACE_MSG( "TX DATA     : " );
-        print_hex_buffer( tx_frame_buffer, tx_frame_buffer_size );
-        HAL_DBG_TRACE_MSG( "\n\n\n" )
+        APPS_SHELL_PRINTF( "Custom ADR list (%lu updates):", stats.nb_updates );
+        for( uint8_t i = 0; i < APPS_ADR_OPTIMIZER_LIST_SIZE; i++ )
+        {
+            APPS_SHELL_PRINTF( " DR%u", stats.list[i] );
+        }
+        APPS_SHELL_PRINTF( "\n" );
     }
     else
     {
-        HAL_DBG_TRACE_ERROR( "lr1121 MODEM-E REQUEST TX ERROR CMD, modem_response_code : %d \n\n\n",
-                             modem_response_code );
+        APPS_SHELL_PRINTF( "Network server ADR\n" );
+    }
+    for( uint8_t data_rate = 0; data_rate < APPS_ADR_OPTIMIZER_NB_DATA_RATES; data_rate++ )
+    {
+        if( stats.nb_sent[data_rate] > 0 )
+        {
+            APPS_SHELL_PRINTF( "DR%u: %u/%u confirmed uplinks acked\n", data_rate, stats.nb_acked[data_rate],
+                               stats.nb_sent[data_rate] );
+        }
+    }
+}
+
+static void shell_cmd_join( uint8_t argc, char* argv[] )
+{
+    apps_join_manager_stats_t stats;
+
+    apps_join_manager_get_stats( &stats );
+    if( stats.joining == true )
+    {
+        APPS_SHELL_PRINTF( "Joining: %u failures, next join request in %lu ms\n", stats.nb_failures,
+                           stats.next_join_ms );
+    }
+    APPS_SHELL_PRINTF( "Join data rate distribution:" );
+    for( uint8_t data_rate = 0; data_rate < LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH; data_rate++ )
+    {
+        if( stats.distribution[data_rate] > 0 )
+        {
+            APPS_SHELL_PRINTF( " DR%u x%u", data_rate, stats.distribution[data_rate] );
+        }
+    }
+    APPS_SHELL_PRINTF( "\n" );
+    if( stats.nb_joins > 0 )
+    {
+        APPS_SHELL_PRINTF( "%lu joins, last in %lu ms with %u join requests, %lu/%lu/%lu ms (min/avg/max)\n",
+                           stats.nb_joins, stats.last_time_ms, stats.last_attempts, stats.min_time_ms,
+                           stats.avg_time_ms, stats.max_time_ms );
     }
-    return modem_response_code;
 }
 
 /* --- EOF ------------------------------------------------------------------ */
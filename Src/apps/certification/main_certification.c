@@ -53,6 +53,7 @@
 #include "lr1121_modem_board.h"
 #include "smtc_utilities.h"
 #include "apps_utilities.h"
+#include "apps_downlink_rx.h"
 #include "lr1121_modem_system_types.h"
 #include "lr1121_modem_helper.h"
 
@@ -123,11 +124,6 @@
 
 #define EXTI_BUTTON PC_13
 
-/**
- * @brief User application data buffer size
- */
-#define LORAWAN_APP_DATA_MAX_SIZE 242
-
 /*!
  * @brief LoRaWAN regulatory region.
  * One of:
@@ -180,11 +176,6 @@ static uint8_t chip_pin[4] = { 0 };
 
 extern lr1121_t lr1121;
 
-static uint8_t                          rx_payload[LORAWAN_APP_DATA_MAX_SIZE] = { 0 };  // Buffer for rx payload
-static uint8_t                          rx_payload_size = 0;      // Size of the payload in the rx_payload buffer
-static lr1121_modem_downlink_metadata_t rx_metadata     = { 0 };  // Metadata of downlink
-static uint8_t                          rx_remaining    = 0;      // Remaining downlink payload in modem
-
 static volatile bool                              user_button_is_press = false;  // Flag for button status
 static volatile lr1121_modem_certification_mode_t certif_running       = false;  // Certification mode enabled
 static uint32_t                                   uplink_counter       = 0;      // uplink sent counter
@@ -455,14 +446,20 @@ static void event_process( void* context )
             }
 
             case LR1121_MODEM_LORAWAN_EVENT_DOWN_DATA:
+            {
+                const apps_downlink_rx_frame_t* downlink;
+
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: DOWNDATA\n\n", HAL_DBG_TRACE_COLOR_BLUE );
-                // Get downlink data
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data_size( context, &rx_payload_size, &rx_remaining ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data( context, rx_payload, rx_payload_size ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_metadata( context, &rx_metadata ) );
-                HAL_DBG_TRACE_PRINTF( "Data received on port %u\n", rx_metadata.fport );
-                HAL_DBG_TRACE_ARRAY( "Received payload", rx_payload, rx_payload_size );
+                // Get all the downlinks waiting in the modem, then handle them in order
+                apps_downlink_rx_drain( context );
+                while( ( downlink = apps_downlink_rx_take( ) ) != NULL )
+                {
+                    HAL_DBG_TRACE_PRINTF( "Data received on port %u\n", downlink->metadata.fport );
+                    HAL_DBG_TRACE_ARRAY( "Received payload", downlink->payload, downlink->size );
+                    apps_downlink_rx_release( downlink );
+                }
                 break;
+            }
 
             case LR1121_MODEM_LORAWAN_EVENT_JOIN_FAIL:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINFAIL\n\n", HAL_DBG_TRACE_COLOR_BLUE );
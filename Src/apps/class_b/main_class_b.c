@@ -53,6 +53,9 @@
 #include "lr1121_modem_board.h"
 #include "smtc_utilities.h"
 #include "apps_utilities.h"
+#include "apps_airtime.h"
+#include "apps_downlink_rx.h"
+#include "apps_join_manager.h"
 #include "lr1121_modem_system_types.h"
 #include "lr1121_modem_helper.h"
 
@@ -117,14 +120,15 @@
 #define WATCHDOG_RELOAD_PERIOD_MS 20000
 
 /**
- * @brief Pin of the nucleo button
+ * @brief Largest random delay before the first join request after reset, spreading the joins of the devices powered up
+ * together
  */
-#define EXTI_BUTTON PC_13
+#define JOIN_START_JITTER_MS 30000
 
-/*!
- * @brief User application data buffer size
+/**
+ * @brief Pin of the nucleo button
  */
-#define LORAWAN_APP_DATA_MAX_SIZE 242
+#define EXTI_BUTTON PC_13
 
 /*!
  * @brief LoRaWAN regulatory region.
@@ -287,11 +291,18 @@ int main( void )
             main_handle_button_pushed( &lr1121 );
         }
 
+        // Send the join request scheduled after reset or after a join failure
+        uint32_t sleep_ms = apps_join_manager_process( &lr1121 );
+        if( sleep_ms > WATCHDOG_RELOAD_PERIOD_MS )
+        {
+            sleep_ms = WATCHDOG_RELOAD_PERIOD_MS;
+        }
+
         hal_mcu_disable_irq( );
         if( ( user_button_is_press == false ) )
         {
             hal_watchdog_reload( );
-            hal_mcu_set_sleep_for_ms( WATCHDOG_RELOAD_PERIOD_MS );
+            hal_mcu_set_sleep_for_ms( ( int32_t ) sleep_ms );
         }
         hal_watchdog_reload( );
         hal_mcu_enable_irq( );
@@ -345,9 +356,13 @@ static void event_process( void* context )
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_region( context, LORAWAN_REGION_USED ) );
                 print_lorawan_region( LORAWAN_REGION_USED );
 
-                // Schedule a LoRaWAN network JoinRequest.
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_join( context ) );
-                HAL_DBG_TRACE_INFO( "###### ===== JOINING ==== ######\n\n\n" );
+                // Data rates of the region, the join data rate distribution is built from
+                if( apps_airtime_init( LORAWAN_REGION_USED ) == false )
+                {
+                    HAL_DBG_TRACE_WARNING( "No data rate table for this region, default join distribution\n" );
+                }
+                // Schedule a LoRaWAN network JoinRequest after a random delay, sent from the main loop
+                apps_join_manager_start( context, JOIN_START_JITTER_MS );
 
                 break;
 
@@ -358,6 +373,7 @@ static void event_process( void* context )
             case LR1121_MODEM_LORAWAN_EVENT_JOINED:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINED\n", HAL_DBG_TRACE_COLOR_BLUE );
                 HAL_DBG_TRACE_INFO( "Modem is now joined \n" );
+                apps_join_manager_on_joined( );
                 HAL_DBG_TRACE_INFO( "You can push the blue button to switch to Class B \n\n" )
 
                 uint8_t adr_custom_list[16] = { 0 };
@@ -407,21 +423,27 @@ static void event_process( void* context )
             }
 
             case LR1121_MODEM_LORAWAN_EVENT_DOWN_DATA:
+            {
+                const apps_downlink_rx_frame_t* downlink;
+
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: DOWNDATA\n\n", HAL_DBG_TRACE_COLOR_BLUE );
-                // Get downlink data
-                uint8_t rx_payload[LORAWAN_APP_DATA_MAX_SIZE] = { 0 };  // Buffer for rx payload
-                uint8_t rx_payload_size                       = 0;      // Size of the payload in the rx_payload buffer
-                lr1121_modem_downlink_metadata_t rx_metadata  = { 0 };  // Metadata of downlink
-                uint8_t                          rx_remaining = 0;      // Remaining downlink payload in modem
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data_size( context, &rx_payload_size, &rx_remaining ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data( context, rx_payload, rx_payload_size ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_metadata( context, &rx_metadata ) );
-                HAL_DBG_TRACE_PRINTF( "Data received on %s window\n", get_downlink_window_name( rx_metadata.window ) );
-                HAL_DBG_TRACE_ARRAY( "Received payload", rx_payload, rx_payload_size );
+                // Get all the downlinks waiting in the modem, then handle them in order
+                apps_downlink_rx_drain( context );
+                while( ( downlink = apps_downlink_rx_take( ) ) != NULL )
+                {
+                    HAL_DBG_TRACE_PRINTF( "Data received on %s window\n",
+                                          get_downlink_window_name( downlink->metadata.window ) );
+                    HAL_DBG_TRACE_ARRAY( "Received payload", downlink->payload, downlink->size );
+                    set_trace_levels_from_downlink( downlink->metadata.fport, downlink->payload, downlink->size );
+                    apps_downlink_rx_release( downlink );
+                }
                 break;
+            }
 
             case LR1121_MODEM_LORAWAN_EVENT_JOIN_FAIL:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINFAIL\n\n", HAL_DBG_TRACE_COLOR_BLUE );
+                // Retry after a random backoff instead of the automatic retry of the modem
+                apps_join_manager_on_join_fail( context );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_LINK_CHECK:
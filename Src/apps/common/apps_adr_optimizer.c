@@ -0,0 +1,350 @@
+/*!
+ * @file      apps_adr_optimizer.c
+ *
+ * @brief     On-device ADR optimizer: custom data rate distribution built from the link quality
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "apps_adr_optimizer.h"
+#include "apps_airtime.h"
+#include "apps_link_quality.h"
+#include "lr1121_modem_lorawan.h"
+#include "lr1121_modem_radio.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Demodulation floor of SF7 in 0.25 dB, the floor being 2.5 dB lower at each higher SF
+ */
+#define ADR_OPTIMIZER_SF7_FLOOR_QDB ( -30 )
+#define ADR_OPTIMIZER_SF_STEP_QDB ( -10 )
+
+/**
+ * @brief Noise increase in 0.25 dB each time the bandwidth doubles from 125 kHz
+ */
+#define ADR_OPTIMIZER_BW_STEP_QDB 12
+
+/**
+ * @brief Data rate not found
+ */
+#define ADR_OPTIMIZER_NO_DATA_RATE 0xFF
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief ADR optimizer context
+ */
+typedef struct adr_optimizer_s
+{
+    bool                       enabled;                                     //!< Goals set
+    apps_adr_optimizer_goals_t goals;                                       //!< Application goals
+    bool                       applied;                                     //!< A custom ADR list was applied
+    uint8_t                    list[APPS_ADR_OPTIMIZER_LIST_SIZE];          //!< Custom ADR list applied
+    uint8_t                    data_rate;                                   //!< Data rate chosen for the list
+    uint32_t                   update_ms;                                   //!< Time the list was applied
+    uint32_t                   nb_updates;                                  //!< Custom ADR lists applied
+    uint8_t                    nb_sent[APPS_ADR_OPTIMIZER_NB_DATA_RATES];   //!< Recent confirmed uplinks
+    uint8_t                    nb_acked[APPS_ADR_OPTIMIZER_NB_DATA_RATES];  //!< Acknowledged ones among them
+} adr_optimizer_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static adr_optimizer_t adr_optimizer;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Get the sensitivity of a LoRa modulation relative to SF7 at 125 kHz
+ *
+ * @param [in] mod_params LoRa modulation parameters
+ *
+ * @returns Sensitivity in 0.25 dB, lower for the more robust modulations
+ */
+static int16_t adr_optimizer_get_sensitivity_qdb( const lr1121_modem_radio_mod_params_lora_t* mod_params );
+
+/**
+ * @brief Build the custom ADR list from the link health
+ *
+ * @param [in] health Link health, whose margin data rate is known
+ * @param [out] list Custom ADR list
+ *
+ * @returns Data rate chosen, ADR_OPTIMIZER_NO_DATA_RATE if no data rate meets the latency goal
+ */
+static uint8_t adr_optimizer_build( const apps_link_quality_health_t* health,
+                                    uint8_t                           list[APPS_ADR_OPTIMIZER_LIST_SIZE] );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_adr_optimizer_init( const apps_adr_optimizer_goals_t* goals )
+{
+    CRITICAL_SECTION_BEGIN( );
+    adr_optimizer.enabled = ( goals != NULL );
+    adr_optimizer.applied = false;
+    if( goals != NULL )
+    {
+        adr_optimizer.goals = *goals;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void apps_adr_optimizer_on_tx_done( uint8_t data_rate, lr1121_modem_uplink_type_t uplink_type,
+                                    lr1121_modem_tx_done_event_t tx_done_status )
+{
+    if( ( uplink_type != LR1121_MODEM_UPLINK_CONFIRMED ) || ( tx_done_status == LR1121_MODEM_TX_NOT_SENT ) ||
+        ( data_rate >= APPS_ADR_OPTIMIZER_NB_DATA_RATES ) )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    adr_optimizer.nb_sent[data_rate]++;
+    if( tx_done_status == LR1121_MODEM_CONFIRMED_TX )
+    {
+        adr_optimizer.nb_acked[data_rate]++;
+    }
+    if( adr_optimizer.nb_sent[data_rate] >= APPS_ADR_OPTIMIZER_MAX_SAMPLES )
+    {
+        adr_optimizer.nb_sent[data_rate] /= 2;
+        adr_optimizer.nb_acked[data_rate] /= 2;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+bool apps_adr_optimizer_process( const void* context )
+{
+    const uint32_t               now_ms = hal_rtc_get_time_ms( );
+    apps_link_quality_health_t   health;
+    uint8_t                      list[APPS_ADR_OPTIMIZER_LIST_SIZE];
+    uint8_t                      data_rate;
+    lr1121_modem_response_code_t rc;
+
+    if( adr_optimizer.enabled == false )
+    {
+        return false;
+    }
+    apps_link_quality_get_health( &health );
+    if( ( health.level == APPS_LINK_QUALITY_LEVEL_UNKNOWN ) ||
+        ( health.margin_data_rate == APPS_AIRTIME_UNKNOWN_DATA_RATE ) )
+    {
+        return false;
+    }
+
+    data_rate = adr_optimizer_build( &health, list );
+    if( ( data_rate == ADR_OPTIMIZER_NO_DATA_RATE ) ||
+        ( ( adr_optimizer.applied == true ) && ( memcmp( list, adr_optimizer.list, sizeof( list ) ) == 0 ) ) )
+    {
+        return false;
+    }
+    // A degrading link is followed at once, an improving one at most once per interval
+    if( ( adr_optimizer.applied == true ) && ( data_rate >= adr_optimizer.data_rate ) &&
+        ( ( now_ms - adr_optimizer.update_ms ) < APPS_ADR_OPTIMIZER_MIN_INTERVAL_MS ) )
+    {
+        return false;
+    }
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    rc = lr1121_modem_set_adr_profile( context, LR1121_MODEM_ADR_PROFILE_CUSTOM, list );
+    hal_gpio_irq_enable( );
+
+    if( rc != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "ADR optimizer: custom ADR list refused, rc %d\n", rc );
+        return false;
+    }
+
+    HAL_DBG_TRACE_INFO( "ADR optimizer: DR%u chosen, margin %d dB at DR%u\n", data_rate, health.margin_db,
+                        health.margin_data_rate );
+    HAL_DBG_TRACE_ARRAY( "ADR optimizer: custom ADR list", list, sizeof( list ) );
+    memcpy( adr_optimizer.list, list, sizeof( list ) );
+    adr_optimizer.applied   = true;
+    adr_optimizer.data_rate = data_rate;
+    adr_optimizer.update_ms = now_ms;
+    adr_optimizer.nb_updates++;
+    return true;
+}
+
+void apps_adr_optimizer_get_stats( apps_adr_optimizer_stats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    stats->applied    = adr_optimizer.applied;
+    stats->nb_updates = adr_optimizer.nb_updates;
+    memcpy( stats->list, adr_optimizer.list, sizeof( stats->list ) );
+    memcpy( stats->nb_sent, adr_optimizer.nb_sent, sizeof( stats->nb_sent ) );
+    memcpy( stats->nb_acked, adr_optimizer.nb_acked, sizeof( stats->nb_acked ) );
+    CRITICAL_SECTION_END( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static int16_t adr_optimizer_get_sensitivity_qdb( const lr1121_modem_radio_mod_params_lora_t* mod_params )
+{
+    const int16_t sf_steps        = ( int16_t ) mod_params->sf - LR1121_MODEM_RADIO_LORA_SF7;
+    int16_t       sensitivity_qdb = ADR_OPTIMIZER_SF7_FLOOR_QDB + sf_steps * ADR_OPTIMIZER_SF_STEP_QDB;
+    uint32_t      bw_hz           = lr1121_modem_radio_get_lora_bw_in_hz( mod_params->bw );
+
+    while( bw_hz > 125000 )
+    {
+        sensitivity_qdb += ADR_OPTIMIZER_BW_STEP_QDB;
+        bw_hz /= 2;
+    }
+    return sensitivity_qdb;
+}
+
+static uint8_t adr_optimizer_build( const apps_link_quality_health_t* health,
+                                    uint8_t                           list[APPS_ADR_OPTIMIZER_LIST_SIZE] )
+{
+    const apps_adr_optimizer_goals_t*    goals = &adr_optimizer.goals;
+    lr1121_modem_radio_mod_params_lora_t mod_params;
+    int16_t                              margin_qdb[APPS_ADR_OPTIMIZER_NB_DATA_RATES];
+    bool                                 in_time[APPS_ADR_OPTIMIZER_NB_DATA_RATES];
+    int16_t                              reference_qdb;
+    uint8_t                              chosen     = ADR_OPTIMIZER_NO_DATA_RATE;
+    uint8_t                              slowest    = ADR_OPTIMIZER_NO_DATA_RATE;
+    uint32_t                             chosen_ms  = UINT32_MAX;
+    uint8_t                              nb_rates   = 0;
+    uint8_t                              nb_safe    = 0;
+    uint8_t                              nb_explore = 0;
+    uint8_t                              index      = 0;
+
+    if( apps_airtime_get_lora_params( health->margin_data_rate, &mod_params ) == false )
+    {
+        return ADR_OPTIMIZER_NO_DATA_RATE;
+    }
+    // Signal level above the sensitivity of SF7 at 125 kHz, the same whatever the data rate
+    reference_qdb = health->margin_db * 4 + adr_optimizer_get_sensitivity_qdb( &mod_params );
+
+    while( ( nb_rates < APPS_ADR_OPTIMIZER_NB_DATA_RATES ) &&
+           ( apps_airtime_get_lora_params( nb_rates, &mod_params ) == true ) )
+    {
+        const uint8_t  data_rate      = nb_rates++;
+        const uint32_t time_on_air_ms = apps_airtime_get_time_on_air_ms( data_rate, goals->payload_size );
+        const uint32_t latency_ms     = time_on_air_ms + apps_airtime_get_off_time_ms( time_on_air_ms );
+        uint8_t        nb_sent;
+        uint8_t        nb_acked;
+
+        margin_qdb[data_rate] = reference_qdb - adr_optimizer_get_sensitivity_qdb( &mod_params );
+        in_time[data_rate]    = ( goals->max_latency_ms == 0 ) || ( latency_ms <= goals->max_latency_ms );
+        if( in_time[data_rate] == false )
+        {
+            continue;
+        }
+        if( slowest == ADR_OPTIMIZER_NO_DATA_RATE )
+        {
+            slowest = data_rate;
+        }
+
+        CRITICAL_SECTION_BEGIN( );
+        nb_sent  = adr_optimizer.nb_sent[data_rate];
+        nb_acked = adr_optimizer.nb_acked[data_rate];
+        CRITICAL_SECTION_END( );
+
+        if( ( margin_qdb[data_rate] >= goals->min_margin_db * 4 ) &&
+            ( ( nb_sent < APPS_ADR_OPTIMIZER_MIN_SAMPLES ) ||
+              ( ( uint32_t ) nb_acked * 1000 >= ( uint32_t ) goals->min_success * nb_sent ) ) &&
+            ( time_on_air_ms < chosen_ms ) )
+        {
+            chosen    = data_rate;
+            chosen_ms = time_on_air_ms;
+        }
+    }
+
+    if( chosen == ADR_OPTIMIZER_NO_DATA_RATE )
+    {
+        // No data rate meets the goals: the most robust one left gives the best chance
+        chosen = slowest;
+        if( chosen == ADR_OPTIMIZER_NO_DATA_RATE )
+        {
+            return ADR_OPTIMIZER_NO_DATA_RATE;
+        }
+    }
+    else if( ( chosen > 0 ) && ( in_time[chosen - 1] == true ) &&
+             ( margin_qdb[chosen] < ( goals->min_margin_db + APPS_ADR_OPTIMIZER_HEADROOM_DB ) * 4 ) )
+    {
+        nb_safe = APPS_ADR_OPTIMIZER_SAFE_ENTRIES;
+    }
+    if( ( ( chosen + 1 ) < nb_rates ) && ( in_time[chosen + 1] == true ) && ( margin_qdb[chosen + 1] >= 0 ) )
+    {
+        nb_explore = APPS_ADR_OPTIMIZER_EXPLORE_ENTRIES;
+    }
+
+    while( index < nb_safe )
+    {
+        list[index++] = chosen - 1;
+    }
+    while( index < ( nb_safe + nb_explore ) )
+    {
+        list[index++] = chosen + 1;
+    }
+    while( index < APPS_ADR_OPTIMIZER_LIST_SIZE )
+    {
+        list[index++] = chosen;
+    }
+    return chosen;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,337 @@
+/*!
+ * @file      apps_airtime.c
+ *
+ * @brief     LoRa time-on-air model of the LoRaWAN uplinks and airtime-aware uplink planning
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include "apps_airtime.h"
+#include "apps_airtime_table.h"
+#include "lr1121_modem_radio.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief LoRa data rate of a region
+ */
+typedef struct airtime_data_rate_s
+{
+    uint8_t row;          //!< Row of the time-on-air tables holding the LoRa modulation
+    uint8_t max_payload;  //!< Maximal application payload size, without dwell time limit
+} airtime_data_rate_t;
+
+/**
+ * @brief LoRa data rates and duty cycle of a region
+ */
+typedef struct airtime_region_s
+{
+    uint8_t                    region;         //!< lr1121_modem_regions_t
+    uint8_t                    nb_data_rates;  //!< Number of LoRa data rates, from DR0
+    uint16_t                   off_ratio;      //!< Off time per ms on air, 0 without duty-cycle limit
+    const airtime_data_rate_t* data_rates;     //!< LoRa data rates, from DR0
+} airtime_region_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/**
+ * @brief DR0 to DR6 of EU868, AS923 and RU864, DR0 to DR5 of CN470, IN865 and KR920
+ */
+static const airtime_data_rate_t airtime_data_rates_eu868[] = {
+    { APPS_AIRTIME_TABLE_SF12_BW125, 51 },
+    { APPS_AIRTIME_TABLE_SF11_BW125, 51 },
+    { APPS_AIRTIME_TABLE_SF10_BW125, 51 },
+    { APPS_AIRTIME_TABLE_SF9_BW125, 115 },
+    { APPS_AIRTIME_TABLE_SF8_BW125, 242 },
+    { APPS_AIRTIME_TABLE_SF7_BW125, 242 },
+    { APPS_AIRTIME_TABLE_SF7_BW250, 242 },
+};
+
+/**
+ * @brief DR0 to DR4 of US915
+ */
+static const airtime_data_rate_t airtime_data_rates_us915[] = {
+    { APPS_AIRTIME_TABLE_SF10_BW125, 11 },
+    { APPS_AIRTIME_TABLE_SF9_BW125, 53 },
+    { APPS_AIRTIME_TABLE_SF8_BW125, 125 },
+    { APPS_AIRTIME_TABLE_SF7_BW125, 242 },
+    { APPS_AIRTIME_TABLE_SF8_BW500, 242 },
+};
+
+/**
+ * @brief DR0 to DR6 of AU915
+ */
+static const airtime_data_rate_t airtime_data_rates_au915[] = {
+    { APPS_AIRTIME_TABLE_SF12_BW125, 51 },
+    { APPS_AIRTIME_TABLE_SF11_BW125, 51 },
+    { APPS_AIRTIME_TABLE_SF10_BW125, 51 },
+    { APPS_AIRTIME_TABLE_SF9_BW125, 115 },
+    { APPS_AIRTIME_TABLE_SF8_BW125, 242 },
+    { APPS_AIRTIME_TABLE_SF7_BW125, 242 },
+    { APPS_AIRTIME_TABLE_SF8_BW500, 242 },
+};
+
+/**
+ * @brief Regions of the sub-GHz LoRaWAN regional parameters, the 1% duty cycle of the ETSI sub-bands being applied to
+ * EU868 and RU864
+ */
+static const airtime_region_t airtime_regions[] = {
+    { LR1121_LORAWAN_REGION_EU868, 7, 99, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_AS923_GRP1, 7, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_AS923_GRP2, 7, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_AS923_GRP3, 7, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_AS923_GRP4, 7, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_US915, 5, 0, airtime_data_rates_us915 },
+    { LR1121_LORAWAN_REGION_AU915, 7, 0, airtime_data_rates_au915 },
+    { LR1121_LORAWAN_REGION_CN470, 6, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_CN470_RP_1_0, 6, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_IN865, 6, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_KR920, 6, 0, airtime_data_rates_eu868 },
+    { LR1121_LORAWAN_REGION_RU864, 7, 99, airtime_data_rates_eu868 },
+};
+
+static const airtime_region_t* airtime_region    = NULL;
+static uint8_t                 airtime_data_rate = APPS_AIRTIME_UNKNOWN_DATA_RATE;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Pack the items greedily, as many as fit in each uplink
+ *
+ * @param [in] sizes Item sizes
+ * @param [in] nb_items Number of items
+ * @param [in] max_payload Maximal payload size
+ *
+ * @returns Number of items of the first uplink
+ */
+static uint8_t airtime_plan_greedy( const uint8_t* sizes, uint8_t nb_items, uint8_t max_payload );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool apps_airtime_init( lr1121_modem_regions_t region )
+{
+    airtime_region    = NULL;
+    airtime_data_rate = APPS_AIRTIME_UNKNOWN_DATA_RATE;
+
+    for( uint8_t i = 0; i < ( sizeof( airtime_regions ) / sizeof( airtime_regions[0] ) ); i++ )
+    {
+        if( airtime_regions[i].region == ( uint8_t ) region )
+        {
+            airtime_region = &airtime_regions[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool apps_airtime_set_data_rate( uint8_t data_rate )
+{
+    if( ( airtime_region == NULL ) || ( data_rate >= airtime_region->nb_data_rates ) )
+    {
+        airtime_data_rate = APPS_AIRTIME_UNKNOWN_DATA_RATE;
+        return false;
+    }
+    airtime_data_rate = data_rate;
+    return true;
+}
+
+bool apps_airtime_update_data_rate( uint8_t max_payload )
+{
+    if( airtime_region != NULL )
+    {
+        for( uint8_t data_rate = 0; data_rate < airtime_region->nb_data_rates; data_rate++ )
+        {
+            if( airtime_region->data_rates[data_rate].max_payload >= max_payload )
+            {
+                airtime_data_rate = data_rate;
+                return true;
+            }
+        }
+    }
+    airtime_data_rate = APPS_AIRTIME_UNKNOWN_DATA_RATE;
+    return false;
+}
+
+uint8_t apps_airtime_get_data_rate( void ) { return airtime_data_rate; }
+
+bool apps_airtime_get_lora_params( uint8_t data_rate, lr1121_modem_radio_mod_params_lora_t* mod_params )
+{
+    if( ( airtime_region == NULL ) || ( data_rate >= airtime_region->nb_data_rates ) )
+    {
+        return false;
+    }
+
+    *mod_params = apps_airtime_table_mod_params[airtime_region->data_rates[data_rate].row];
+    return true;
+}
+
+uint32_t apps_airtime_get_time_on_air_ms( uint8_t data_rate, uint8_t payload_size )
+{
+    uint16_t length = payload_size + APPS_AIRTIME_MAC_OVERHEAD;
+
+    if( ( airtime_region == NULL ) || ( data_rate >= airtime_region->nb_data_rates ) )
+    {
+        return 0;
+    }
+    if( length >= APPS_AIRTIME_TABLE_NB_LENGTHS )
+    {
+        length = APPS_AIRTIME_TABLE_NB_LENGTHS - 1;
+    }
+    return apps_airtime_table_ms[airtime_region->data_rates[data_rate].row][length];
+}
+
+uint32_t apps_airtime_get_lora_time_on_air_ms( const lr1121_modem_radio_pkt_params_lora_t* pkt_params,
+                                               const lr1121_modem_radio_mod_params_lora_t* mod_params )
+{
+    if( ( pkt_params->preamble_len_in_symb == APPS_AIRTIME_TABLE_PREAMBLE_LEN ) &&
+        ( pkt_params->header_type == LR1121_MODEM_RADIO_LORA_PKT_EXPLICIT ) &&
+        ( pkt_params->crc == LR1121_MODEM_RADIO_LORA_CRC_ON ) )
+    {
+        for( uint8_t row = 0; row < APPS_AIRTIME_TABLE_NB_ROWS; row++ )
+        {
+            const lr1121_modem_radio_mod_params_lora_t* table_params = &apps_airtime_table_mod_params[row];
+
+            if( ( mod_params->sf == table_params->sf ) && ( mod_params->bw == table_params->bw ) &&
+                ( mod_params->cr == table_params->cr ) && ( mod_params->ldro == table_params->ldro ) )
+            {
+                return apps_airtime_table_ms[row][pkt_params->pld_len_in_bytes];
+            }
+        }
+    }
+    return lr1121_modem_radio_get_lora_time_on_air_in_ms( pkt_params, mod_params );
+}
+
+uint32_t apps_airtime_get_off_time_ms( uint32_t time_on_air_ms )
+{
+    return ( airtime_region != NULL ) ? time_on_air_ms * airtime_region->off_ratio : 0;
+}
+
+uint8_t apps_airtime_plan( const uint8_t* sizes, uint8_t nb_items, uint8_t max_payload, uint32_t* time_on_air_ms )
+{
+    // Shortest time on air of the items from i to the last one, and number of items of its first uplink
+    uint32_t best_ms[APPS_AIRTIME_PLAN_MAX_ITEMS + 1];
+    uint8_t  first[APPS_AIRTIME_PLAN_MAX_ITEMS];
+
+    if( time_on_air_ms != NULL )
+    {
+        *time_on_air_ms = 0;
+    }
+    if( nb_items == 0 )
+    {
+        return 0;
+    }
+    if( ( airtime_data_rate == APPS_AIRTIME_UNKNOWN_DATA_RATE ) || ( nb_items > APPS_AIRTIME_PLAN_MAX_ITEMS ) )
+    {
+        return airtime_plan_greedy( sizes, nb_items, max_payload );
+    }
+
+    best_ms[nb_items] = 0;
+    for( int16_t i = nb_items - 1; i >= 0; i-- )
+    {
+        uint16_t size = 0;
+
+        best_ms[i] = UINT32_MAX;
+        for( uint8_t j = i; j < nb_items; j++ )
+        {
+            size += sizes[j];
+            if( ( j > i ) && ( size > max_payload ) )
+            {
+                break;
+            }
+
+            const uint32_t cost_ms =
+                apps_airtime_get_time_on_air_ms( airtime_data_rate, ( size > UINT8_MAX ) ? UINT8_MAX : size ) +
+                best_ms[j + 1];
+
+            // On a tie, the split sending more items at once is kept
+            if( cost_ms <= best_ms[i] )
+            {
+                best_ms[i] = cost_ms;
+                first[i]   = j + 1 - i;
+            }
+        }
+    }
+
+    if( time_on_air_ms != NULL )
+    {
+        *time_on_air_ms = best_ms[0];
+    }
+    return first[0];
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint8_t airtime_plan_greedy( const uint8_t* sizes, uint8_t nb_items, uint8_t max_payload )
+{
+    uint16_t size     = sizes[0];
+    uint8_t  nb_first = 1;
+
+    while( ( nb_first < nb_items ) && ( ( size + sizes[nb_first] ) <= max_payload ) )
+    {
+        size += sizes[nb_first];
+        nb_first++;
+    }
+    return nb_first;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
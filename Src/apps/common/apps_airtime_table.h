@@ -0,0 +1,246 @@
+/**
+ * @file      apps_airtime_table.h
+ *
+ * @brief     LoRa time-on-air tables of the LoRaWAN uplinks
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+// Generated by tools/smtc_airtime_table.py, do not edit
+
+#ifndef APPS_AIRTIME_TABLE_H
+#define APPS_AIRTIME_TABLE_H
+
+#include <stdint.h>
+#include "lr1121_modem_radio_types.h"
+
+/**
+ * @brief Preamble length of the packets of the tables, in symbols
+ */
+#define APPS_AIRTIME_TABLE_PREAMBLE_LEN 8
+
+/**
+ * @brief Number of PHY payload lengths of a table row, from 0 byte
+ */
+#define APPS_AIRTIME_TABLE_NB_LENGTHS 256
+
+/**
+ * @brief Rows of the time-on-air tables
+ */
+enum
+{
+    APPS_AIRTIME_TABLE_SF12_BW125,
+    APPS_AIRTIME_TABLE_SF11_BW125,
+    APPS_AIRTIME_TABLE_SF10_BW125,
+    APPS_AIRTIME_TABLE_SF9_BW125,
+    APPS_AIRTIME_TABLE_SF8_BW125,
+    APPS_AIRTIME_TABLE_SF7_BW125,
+    APPS_AIRTIME_TABLE_SF7_BW250,
+    APPS_AIRTIME_TABLE_SF8_BW500,
+    APPS_AIRTIME_TABLE_NB_ROWS,
+};
+
+/**
+ * @brief LoRa modulation of the rows, with coding rate 4/5
+ */
+static const lr1121_modem_radio_mod_params_lora_t apps_airtime_table_mod_params[APPS_AIRTIME_TABLE_NB_ROWS] = {
+    [APPS_AIRTIME_TABLE_SF12_BW125] = { LR1121_MODEM_RADIO_LORA_SF12, LR1121_MODEM_RADIO_LORA_BW_125,
+                                        LR1121_MODEM_RADIO_LORA_CR_4_5, 1 },
+    [APPS_AIRTIME_TABLE_SF11_BW125] = { LR1121_MODEM_RADIO_LORA_SF11, LR1121_MODEM_RADIO_LORA_BW_125,
+                                        LR1121_MODEM_RADIO_LORA_CR_4_5, 1 },
+    [APPS_AIRTIME_TABLE_SF10_BW125] = { LR1121_MODEM_RADIO_LORA_SF10, LR1121_MODEM_RADIO_LORA_BW_125,
+                                        LR1121_MODEM_RADIO_LORA_CR_4_5, 0 },
+    [APPS_AIRTIME_TABLE_SF9_BW125] = { LR1121_MODEM_RADIO_LORA_SF9, LR1121_MODEM_RADIO_LORA_BW_125,
+                                       LR1121_MODEM_RADIO_LORA_CR_4_5, 0 },
+    [APPS_AIRTIME_TABLE_SF8_BW125] = { LR1121_MODEM_RADIO_LORA_SF8, LR1121_MODEM_RADIO_LORA_BW_125,
+                                       LR1121_MODEM_RADIO_LORA_CR_4_5, 0 },
+    [APPS_AIRTIME_TABLE_SF7_BW125] = { LR1121_MODEM_RADIO_LORA_SF7, LR1121_MODEM_RADIO_LORA_BW_125,
+                                       LR1121_MODEM_RADIO_LORA_CR_4_5, 0 },
+    [APPS_AIRTIME_TABLE_SF7_BW250] = { LR1121_MODEM_RADIO_LORA_SF7, LR1121_MODEM_RADIO_LORA_BW_250,
+                                       LR1121_MODEM_RADIO_LORA_CR_4_5, 0 },
+    [APPS_AIRTIME_TABLE_SF8_BW500] = { LR1121_MODEM_RADIO_LORA_SF8, LR1121_MODEM_RADIO_LORA_BW_500,
+                                       LR1121_MODEM_RADIO_LORA_CR_4_5, 0 },
+};
+
+/**
+ * @brief Time on air in ms of the LoRaWAN uplinks, per row and PHY payload length
+ */
+static const uint16_t apps_airtime_table_ms[APPS_AIRTIME_TABLE_NB_ROWS][APPS_AIRTIME_TABLE_NB_LENGTHS] = {
+    [APPS_AIRTIME_TABLE_SF12_BW125] = {
+        664, 828, 828, 828, 828, 828, 992, 992, 992, 992, 992, 1156, 1156, 1156, 1156, 1156,
+        1319, 1319, 1319, 1319, 1319, 1483, 1483, 1483, 1483, 1483, 1647, 1647, 1647, 1647, 1647, 1811,
+        1811, 1811, 1811, 1811, 1975, 1975, 1975, 1975, 1975, 2139, 2139, 2139, 2139, 2139, 2302, 2302,
+        2302, 2302, 2302, 2466, 2466, 2466, 2466, 2466, 2630, 2630, 2630, 2630, 2630, 2794, 2794, 2794,
+        2794, 2794, 2958, 2958, 2958, 2958, 2958, 3122, 3122, 3122, 3122, 3122, 3285, 3285, 3285, 3285,
+        3285, 3449, 3449, 3449, 3449, 3449, 3613, 3613, 3613, 3613, 3613, 3777, 3777, 3777, 3777, 3777,
+        3941, 3941, 3941, 3941, 3941, 4105, 4105, 4105, 4105, 4105, 4269, 4269, 4269, 4269, 4269, 4432,
+        4432, 4432, 4432, 4432, 4596, 4596, 4596, 4596, 4596, 4760, 4760, 4760, 4760, 4760, 4924, 4924,
+        4924, 4924, 4924, 5088, 5088, 5088, 5088, 5088, 5252, 5252, 5252, 5252, 5252, 5415, 5415, 5415,
+        5415, 5415, 5579, 5579, 5579, 5579, 5579, 5743, 5743, 5743, 5743, 5743, 5907, 5907, 5907, 5907,
+        5907, 6071, 6071, 6071, 6071, 6071, 6235, 6235, 6235, 6235, 6235, 6398, 6398, 6398, 6398, 6398,
+        6562, 6562, 6562, 6562, 6562, 6726, 6726, 6726, 6726, 6726, 6890, 6890, 6890, 6890, 6890, 7054,
+        7054, 7054, 7054, 7054, 7218, 7218, 7218, 7218, 7218, 7381, 7381, 7381, 7381, 7381, 7545, 7545,
+        7545, 7545, 7545, 7709, 7709, 7709, 7709, 7709, 7873, 7873, 7873, 7873, 7873, 8037, 8037, 8037,
+        8037, 8037, 8201, 8201, 8201, 8201, 8201, 8365, 8365, 8365, 8365, 8365, 8528, 8528, 8528, 8528,
+        8528, 8692, 8692, 8692, 8692, 8692, 8856, 8856, 8856, 8856, 8856, 9020, 9020, 9020, 9020, 9020,
+    },
+    [APPS_AIRTIME_TABLE_SF11_BW125] = {
+        332, 414, 414, 414, 414, 496, 496, 496, 496, 496, 578, 578, 578, 578, 660, 660,
+        660, 660, 660, 742, 742, 742, 742, 824, 824, 824, 824, 824, 906, 906, 906, 906,
+        988, 988, 988, 988, 988, 1070, 1070, 1070, 1070, 1151, 1151, 1151, 1151, 1151, 1233, 1233,
+        1233, 1233, 1315, 1315, 1315, 1315, 1315, 1397, 1397, 1397, 1397, 1479, 1479, 1479, 1479, 1479,
+        1561, 1561, 1561, 1561, 1643, 1643, 1643, 1643, 1643, 1725, 1725, 1725, 1725, 1807, 1807, 1807,
+        1807, 1807, 1889, 1889, 1889, 1889, 1971, 1971, 1971, 1971, 1971, 2053, 2053, 2053, 2053, 2135,
+        2135, 2135, 2135, 2135, 2216, 2216, 2216, 2216, 2298, 2298, 2298, 2298, 2298, 2380, 2380, 2380,
+        2380, 2462, 2462, 2462, 2462, 2462, 2544, 2544, 2544, 2544, 2626, 2626, 2626, 2626, 2626, 2708,
+        2708, 2708, 2708, 2790, 2790, 2790, 2790, 2790, 2872, 2872, 2872, 2872, 2954, 2954, 2954, 2954,
+        2954, 3036, 3036, 3036, 3036, 3118, 3118, 3118, 3118, 3118, 3199, 3199, 3199, 3199, 3281, 3281,
+        3281, 3281, 3281, 3363, 3363, 3363, 3363, 3445, 3445, 3445, 3445, 3445, 3527, 3527, 3527, 3527,
+        3609, 3609, 3609, 3609, 3609, 3691, 3691, 3691, 3691, 3773, 3773, 3773, 3773, 3773, 3855, 3855,
+        3855, 3855, 3937, 3937, 3937, 3937, 3937, 4019, 4019, 4019, 4019, 4101, 4101, 4101, 4101, 4101,
+        4183, 4183, 4183, 4183, 4264, 4264, 4264, 4264, 4264, 4346, 4346, 4346, 4346, 4428, 4428, 4428,
+        4428, 4428, 4510, 4510, 4510, 4510, 4592, 4592, 4592, 4592, 4592, 4674, 4674, 4674, 4674, 4756,
+        4756, 4756, 4756, 4756, 4838, 4838, 4838, 4838, 4920, 4920, 4920, 4920, 4920, 5002, 5002, 5002,
+    },
+    [APPS_AIRTIME_TABLE_SF10_BW125] = {
+        207, 207, 207, 207, 207, 248, 248, 248, 248, 248, 289, 289, 289, 289, 289, 330,
+        330, 330, 330, 330, 371, 371, 371, 371, 371, 412, 412, 412, 412, 412, 453, 453,
+        453, 453, 453, 494, 494, 494, 494, 494, 535, 535, 535, 535, 535, 576, 576, 576,
+        576, 576, 617, 617, 617, 617, 617, 658, 658, 658, 658, 658, 699, 699, 699, 699,
+        699, 740, 740, 740, 740, 740, 781, 781, 781, 781, 781, 822, 822, 822, 822, 822,
+        863, 863, 863, 863, 863, 904, 904, 904, 904, 904, 945, 945, 945, 945, 945, 986,
+        986, 986, 986, 986, 1027, 1027, 1027, 1027, 1027, 1067, 1067, 1067, 1067, 1067, 1108, 1108,
+        1108, 1108, 1108, 1149, 1149, 1149, 1149, 1149, 1190, 1190, 1190, 1190, 1190, 1231, 1231, 1231,
+        1231, 1231, 1272, 1272, 1272, 1272, 1272, 1313, 1313, 1313, 1313, 1313, 1354, 1354, 1354, 1354,
+        1354, 1395, 1395, 1395, 1395, 1395, 1436, 1436, 1436, 1436, 1436, 1477, 1477, 1477, 1477, 1477,
+        1518, 1518, 1518, 1518, 1518, 1559, 1559, 1559, 1559, 1559, 1600, 1600, 1600, 1600, 1600, 1641,
+        1641, 1641, 1641, 1641, 1682, 1682, 1682, 1682, 1682, 1723, 1723, 1723, 1723, 1723, 1764, 1764,
+        1764, 1764, 1764, 1805, 1805, 1805, 1805, 1805, 1846, 1846, 1846, 1846, 1846, 1887, 1887, 1887,
+        1887, 1887, 1928, 1928, 1928, 1928, 1928, 1969, 1969, 1969, 1969, 1969, 2010, 2010, 2010, 2010,
+        2010, 2051, 2051, 2051, 2051, 2051, 2091, 2091, 2091, 2091, 2091, 2132, 2132, 2132, 2132, 2132,
+        2173, 2173, 2173, 2173, 2173, 2214, 2214, 2214, 2214, 2214, 2255, 2255, 2255, 2255, 2255, 2296,
+    },
+    [APPS_AIRTIME_TABLE_SF9_BW125] = {
+        104, 104, 104, 104, 124, 124, 124, 124, 124, 145, 145, 145, 145, 165, 165, 165,
+        165, 165, 186, 186, 186, 186, 206, 206, 206, 206, 206, 227, 227, 227, 227, 247,
+        247, 247, 247, 247, 268, 268, 268, 268, 288, 288, 288, 288, 288, 309, 309, 309,
+        309, 329, 329, 329, 329, 329, 350, 350, 350, 350, 370, 370, 370, 370, 370, 391,
+        391, 391, 391, 411, 411, 411, 411, 411, 432, 432, 432, 432, 452, 452, 452, 452,
+        452, 473, 473, 473, 473, 493, 493, 493, 493, 493, 514, 514, 514, 514, 534, 534,
+        534, 534, 534, 554, 554, 554, 554, 575, 575, 575, 575, 575, 595, 595, 595, 595,
+        616, 616, 616, 616, 616, 636, 636, 636, 636, 657, 657, 657, 657, 657, 677, 677,
+        677, 677, 698, 698, 698, 698, 698, 718, 718, 718, 718, 739, 739, 739, 739, 739,
+        759, 759, 759, 759, 780, 780, 780, 780, 780, 800, 800, 800, 800, 821, 821, 821,
+        821, 821, 841, 841, 841, 841, 862, 862, 862, 862, 862, 882, 882, 882, 882, 903,
+        903, 903, 903, 903, 923, 923, 923, 923, 944, 944, 944, 944, 944, 964, 964, 964,
+        964, 985, 985, 985, 985, 985, 1005, 1005, 1005, 1005, 1026, 1026, 1026, 1026, 1026, 1046,
+        1046, 1046, 1046, 1066, 1066, 1066, 1066, 1066, 1087, 1087, 1087, 1087, 1107, 1107, 1107, 1107,
+        1107, 1128, 1128, 1128, 1128, 1148, 1148, 1148, 1148, 1148, 1169, 1169, 1169, 1169, 1189, 1189,
+        1189, 1189, 1189, 1210, 1210, 1210, 1210, 1230, 1230, 1230, 1230, 1230, 1251, 1251, 1251, 1251,
+    },
+    [APPS_AIRTIME_TABLE_SF8_BW125] = {
+        52, 52, 52, 62, 62, 62, 62, 73, 73, 73, 73, 83, 83, 83, 83, 93,
+        93, 93, 93, 103, 103, 103, 103, 114, 114, 114, 114, 124, 124, 124, 124, 134,
+        134, 134, 134, 144, 144, 144, 144, 155, 155, 155, 155, 165, 165, 165, 165, 175,
+        175, 175, 175, 185, 185, 185, 185, 196, 196, 196, 196, 206, 206, 206, 206, 216,
+        216, 216, 216, 226, 226, 226, 226, 237, 237, 237, 237, 247, 247, 247, 247, 257,
+        257, 257, 257, 267, 267, 267, 267, 277, 277, 277, 277, 288, 288, 288, 288, 298,
+        298, 298, 298, 308, 308, 308, 308, 318, 318, 318, 318, 329, 329, 329, 329, 339,
+        339, 339, 339, 349, 349, 349, 349, 359, 359, 359, 359, 370, 370, 370, 370, 380,
+        380, 380, 380, 390, 390, 390, 390, 400, 400, 400, 400, 411, 411, 411, 411, 421,
+        421, 421, 421, 431, 431, 431, 431, 441, 441, 441, 441, 452, 452, 452, 452, 462,
+        462, 462, 462, 472, 472, 472, 472, 482, 482, 482, 482, 493, 493, 493, 493, 503,
+        503, 503, 503, 513, 513, 513, 513, 523, 523, 523, 523, 533, 533, 533, 533, 544,
+        544, 544, 544, 554, 554, 554, 554, 564, 564, 564, 564, 574, 574, 574, 574, 585,
+        585, 585, 585, 595, 595, 595, 595, 605, 605, 605, 605, 615, 615, 615, 615, 626,
+        626, 626, 626, 636, 636, 636, 636, 646, 646, 646, 646, 656, 656, 656, 656, 667,
+        667, 667, 667, 677, 677, 677, 677, 687, 687, 687, 687, 697, 697, 697, 697, 708,
+    },
+    [APPS_AIRTIME_TABLE_SF7_BW125] = {
+        26, 26, 31, 31, 31, 31, 37, 37, 37, 42, 42, 42, 42, 47, 47, 47,
+        52, 52, 52, 52, 57, 57, 57, 62, 62, 62, 62, 67, 67, 67, 72, 72,
+        72, 72, 78, 78, 78, 83, 83, 83, 83, 88, 88, 88, 93, 93, 93, 93,
+        98, 98, 98, 103, 103, 103, 103, 108, 108, 108, 113, 113, 113, 113, 119, 119,
+        119, 124, 124, 124, 124, 129, 129, 129, 134, 134, 134, 134, 139, 139, 139, 144,
+        144, 144, 144, 149, 149, 149, 154, 154, 154, 154, 159, 159, 159, 165, 165, 165,
+        165, 170, 170, 170, 175, 175, 175, 175, 180, 180, 180, 185, 185, 185, 185, 190,
+        190, 190, 195, 195, 195, 195, 200, 200, 200, 206, 206, 206, 206, 211, 211, 211,
+        216, 216, 216, 216, 221, 221, 221, 226, 226, 226, 226, 231, 231, 231, 236, 236,
+        236, 236, 241, 241, 241, 247, 247, 247, 247, 252, 252, 252, 257, 257, 257, 257,
+        262, 262, 262, 267, 267, 267, 267, 272, 272, 272, 277, 277, 277, 277, 282, 282,
+        282, 287, 287, 287, 287, 293, 293, 293, 298, 298, 298, 298, 303, 303, 303, 308,
+        308, 308, 308, 313, 313, 313, 318, 318, 318, 318, 323, 323, 323, 328, 328, 328,
+        328, 334, 334, 334, 339, 339, 339, 339, 344, 344, 344, 349, 349, 349, 349, 354,
+        354, 354, 359, 359, 359, 359, 364, 364, 364, 369, 369, 369, 369, 375, 375, 375,
+        380, 380, 380, 380, 385, 385, 385, 390, 390, 390, 390, 395, 395, 395, 400, 400,
+    },
+    [APPS_AIRTIME_TABLE_SF7_BW250] = {
+        13, 13, 16, 16, 16, 16, 19, 19, 19, 21, 21, 21, 21, 24, 24, 24,
+        26, 26, 26, 26, 29, 29, 29, 31, 31, 31, 31, 34, 34, 34, 36, 36,
+        36, 36, 39, 39, 39, 42, 42, 42, 42, 44, 44, 44, 47, 47, 47, 47,
+        49, 49, 49, 52, 52, 52, 52, 54, 54, 54, 57, 57, 57, 57, 60, 60,
+        60, 62, 62, 62, 62, 65, 65, 65, 67, 67, 67, 67, 70, 70, 70, 72,
+        72, 72, 72, 75, 75, 75, 77, 77, 77, 77, 80, 80, 80, 83, 83, 83,
+        83, 85, 85, 85, 88, 88, 88, 88, 90, 90, 90, 93, 93, 93, 93, 95,
+        95, 95, 98, 98, 98, 98, 100, 100, 100, 103, 103, 103, 103, 106, 106, 106,
+        108, 108, 108, 108, 111, 111, 111, 113, 113, 113, 113, 116, 116, 116, 118, 118,
+        118, 118, 121, 121, 121, 124, 124, 124, 124, 126, 126, 126, 129, 129, 129, 129,
+        131, 131, 131, 134, 134, 134, 134, 136, 136, 136, 139, 139, 139, 139, 141, 141,
+        141, 144, 144, 144, 144, 147, 147, 147, 149, 149, 149, 149, 152, 152, 152, 154,
+        154, 154, 154, 157, 157, 157, 159, 159, 159, 159, 162, 162, 162, 164, 164, 164,
+        164, 167, 167, 167, 170, 170, 170, 170, 172, 172, 172, 175, 175, 175, 175, 177,
+        177, 177, 180, 180, 180, 180, 182, 182, 182, 185, 185, 185, 185, 188, 188, 188,
+        190, 190, 190, 190, 193, 193, 193, 195, 195, 195, 195, 198, 198, 198, 200, 200,
+    },
+    [APPS_AIRTIME_TABLE_SF8_BW500] = {
+        13, 13, 13, 16, 16, 16, 16, 19, 19, 19, 19, 21, 21, 21, 21, 24,
+        24, 24, 24, 26, 26, 26, 26, 29, 29, 29, 29, 31, 31, 31, 31, 34,
+        34, 34, 34, 36, 36, 36, 36, 39, 39, 39, 39, 42, 42, 42, 42, 44,
+        44, 44, 44, 47, 47, 47, 47, 49, 49, 49, 49, 52, 52, 52, 52, 54,
+        54, 54, 54, 57, 57, 57, 57, 60, 60, 60, 60, 62, 62, 62, 62, 65,
+        65, 65, 65, 67, 67, 67, 67, 70, 70, 70, 70, 72, 72, 72, 72, 75,
+        75, 75, 75, 77, 77, 77, 77, 80, 80, 80, 80, 83, 83, 83, 83, 85,
+        85, 85, 85, 88, 88, 88, 88, 90, 90, 90, 90, 93, 93, 93, 93, 95,
+        95, 95, 95, 98, 98, 98, 98, 100, 100, 100, 100, 103, 103, 103, 103, 106,
+        106, 106, 106, 108, 108, 108, 108, 111, 111, 111, 111, 113, 113, 113, 113, 116,
+        116, 116, 116, 118, 118, 118, 118, 121, 121, 121, 121, 124, 124, 124, 124, 126,
+        126, 126, 126, 129, 129, 129, 129, 131, 131, 131, 131, 134, 134, 134, 134, 136,
+        136, 136, 136, 139, 139, 139, 139, 141, 141, 141, 141, 144, 144, 144, 144, 147,
+        147, 147, 147, 149, 149, 149, 149, 152, 152, 152, 152, 154, 154, 154, 154, 157,
+        157, 157, 157, 159, 159, 159, 159, 162, 162, 162, 162, 164, 164, 164, 164, 167,
+        167, 167, 167, 170, 170, 170, 170, 172, 172, 172, 172, 175, 175, 175, 175, 177,
+    },
+};
+
+#endif  // APPS_AIRTIME_TABLE_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,328 @@
+/*!
+ * @file      apps_downlink_rx.c
+ *
+ * @brief     Retrieval of the downlinks queued in the modem into a pool of buffers
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include "apps_downlink_rx.h"
+#include "lr1121_modem_lorawan.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief State of a buffer of the pool
+ */
+typedef enum downlink_rx_state_e
+{
+    DOWNLINK_RX_FREE,     //!< Available
+    DOWNLINK_RX_FILLING,  //!< Being read from the modem
+    DOWNLINK_RX_READY,    //!< Waiting to be taken
+    DOWNLINK_RX_HELD,     //!< Taken and not released yet
+} downlink_rx_state_t;
+
+/**
+ * @brief Buffer of the pool
+ */
+typedef struct downlink_rx_slot_s
+{
+    apps_downlink_rx_frame_t frame;     //!< Downlink, first member so that a frame points to its slot
+    uint32_t                 sequence;  //!< Retrieval order
+    uint8_t                  state;     //!< downlink_rx_state_t
+} downlink_rx_slot_t;
+
+/**
+ * @brief Downlink pool context
+ */
+typedef struct downlink_rx_s
+{
+    downlink_rx_slot_t       slots[APPS_DOWNLINK_RX_POOL_SIZE];
+    uint32_t                 sequence;  //!< Retrieval order of the next downlink
+    apps_downlink_rx_stats_t stats;     //!< Statistics, except nb_ready and nb_held
+} downlink_rx_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static downlink_rx_t downlink_rx;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Tell if all the buffers are held by consumers
+ *
+ * @returns true if no buffer can be used for a new downlink
+ */
+static bool downlink_rx_is_full( void );
+
+/**
+ * @brief Get a buffer for a new downlink, the oldest downlink not taken yet being dropped if none is free
+ *
+ * @returns Buffer, in the filling state, NULL if all the buffers are held
+ */
+static downlink_rx_slot_t* downlink_rx_alloc( void );
+
+/**
+ * @brief Hand a filled buffer to the consumers
+ *
+ * @param [in] slot Buffer
+ */
+static void downlink_rx_commit( downlink_rx_slot_t* slot );
+
+/**
+ * @brief Set a buffer free
+ *
+ * @param [in] slot Buffer
+ */
+static void downlink_rx_free( downlink_rx_slot_t* slot );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+uint8_t apps_downlink_rx_drain( const void* context )
+{
+    uint8_t nb_retrieved = 0;
+    uint8_t nb_read      = 0;
+    uint8_t remaining    = 0;
+    uint8_t size         = 0;
+
+    do
+    {
+        if( downlink_rx_is_full( ) == true )
+        {
+            HAL_DBG_TRACE_WARNING( "Downlink pool: all buffers held, downlinks left in the modem\n" );
+            downlink_rx.stats.nb_deferred++;
+            break;
+        }
+
+        // The size, payload and metadata have to be read in sequence, without any other command in between
+        if( lr1121_modem_get_downlink_data_size( context, &size, &remaining ) != LR1121_MODEM_RESPONSE_CODE_OK )
+        {
+            downlink_rx.stats.nb_errors++;
+            break;
+        }
+        nb_read++;
+
+        if( size == 0 )
+        {
+            // No application payload, or no downlink left once a previous drain emptied the modem
+            lr1121_modem_downlink_metadata_t metadata;
+
+            lr1121_modem_get_downlink_metadata( context, &metadata );
+            continue;
+        }
+
+        downlink_rx_slot_t* slot = downlink_rx_alloc( );
+        if( ( slot == NULL ) || ( size > APPS_DOWNLINK_RX_MAX_PAYLOAD_SIZE ) )
+        {
+            if( slot != NULL )
+            {
+                downlink_rx_free( slot );
+            }
+            downlink_rx.stats.nb_errors++;
+            break;
+        }
+        if( ( lr1121_modem_get_downlink_data( context, slot->frame.payload, size ) != LR1121_MODEM_RESPONSE_CODE_OK ) ||
+            ( lr1121_modem_get_downlink_metadata( context, &slot->frame.metadata ) != LR1121_MODEM_RESPONSE_CODE_OK ) )
+        {
+            downlink_rx_free( slot );
+            downlink_rx.stats.nb_errors++;
+            break;
+        }
+        slot->frame.size         = size;
+        slot->frame.timestamp_ms = hal_rtc_get_time_ms( );
+        downlink_rx_commit( slot );
+        nb_retrieved++;
+    } while( ( remaining > 0 ) && ( nb_read < APPS_DOWNLINK_RX_MAX_DRAIN ) );
+
+    if( nb_retrieved > 1 )
+    {
+        downlink_rx.stats.nb_queued += nb_retrieved - 1;
+    }
+    return nb_retrieved;
+}
+
+const apps_downlink_rx_frame_t* apps_downlink_rx_take( void )
+{
+    downlink_rx_slot_t* oldest = NULL;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < APPS_DOWNLINK_RX_POOL_SIZE; i++ )
+    {
+        downlink_rx_slot_t* slot = &downlink_rx.slots[i];
+
+        if( ( slot->state == DOWNLINK_RX_READY ) &&
+            ( ( oldest == NULL ) || ( ( int32_t )( slot->sequence - oldest->sequence ) < 0 ) ) )
+        {
+            oldest = slot;
+        }
+    }
+    if( oldest != NULL )
+    {
+        oldest->state = DOWNLINK_RX_HELD;
+    }
+    CRITICAL_SECTION_END( );
+
+    return ( oldest != NULL ) ? &oldest->frame : NULL;
+}
+
+void apps_downlink_rx_release( const apps_downlink_rx_frame_t* frame )
+{
+    if( frame != NULL )
+    {
+        downlink_rx_free( ( downlink_rx_slot_t* ) frame );
+    }
+}
+
+void apps_downlink_rx_get_stats( apps_downlink_rx_stats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    *stats          = downlink_rx.stats;
+    stats->nb_ready = 0;
+    stats->nb_held  = 0;
+    for( uint8_t i = 0; i < APPS_DOWNLINK_RX_POOL_SIZE; i++ )
+    {
+        stats->nb_ready += ( downlink_rx.slots[i].state == DOWNLINK_RX_READY ) ? 1 : 0;
+        stats->nb_held += ( downlink_rx.slots[i].state == DOWNLINK_RX_HELD ) ? 1 : 0;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool downlink_rx_is_full( void )
+{
+    bool full = true;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < APPS_DOWNLINK_RX_POOL_SIZE; i++ )
+    {
+        full &= ( downlink_rx.slots[i].state == DOWNLINK_RX_HELD );
+    }
+    CRITICAL_SECTION_END( );
+
+    return full;
+}
+
+static downlink_rx_slot_t* downlink_rx_alloc( void )
+{
+    downlink_rx_slot_t* victim = NULL;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < APPS_DOWNLINK_RX_POOL_SIZE; i++ )
+    {
+        downlink_rx_slot_t* slot = &downlink_rx.slots[i];
+
+        if( slot->state == DOWNLINK_RX_FREE )
+        {
+            victim = slot;
+            break;
+        }
+        if( ( slot->state == DOWNLINK_RX_READY ) &&
+            ( ( victim == NULL ) || ( ( int32_t )( slot->sequence - victim->sequence ) < 0 ) ) )
+        {
+            victim = slot;
+        }
+    }
+    if( victim != NULL )
+    {
+        if( victim->state == DOWNLINK_RX_READY )
+        {
+            downlink_rx.stats.nb_dropped++;
+        }
+        victim->state = DOWNLINK_RX_FILLING;
+    }
+    CRITICAL_SECTION_END( );
+
+    return victim;
+}
+
+static void downlink_rx_commit( downlink_rx_slot_t* slot )
+{
+    uint8_t nb_used = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    slot->sequence = downlink_rx.sequence++;
+    slot->state    = DOWNLINK_RX_READY;
+    downlink_rx.stats.nb_received++;
+    for( uint8_t i = 0; i < APPS_DOWNLINK_RX_POOL_SIZE; i++ )
+    {
+        nb_used += ( downlink_rx.slots[i].state != DOWNLINK_RX_FREE ) ? 1 : 0;
+    }
+    if( nb_used > downlink_rx.stats.max_used )
+    {
+        downlink_rx.stats.max_used = nb_used;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+static void downlink_rx_free( downlink_rx_slot_t* slot )
+{
+    CRITICAL_SECTION_BEGIN( );
+    slot->state = DOWNLINK_RX_FREE;
+    CRITICAL_SECTION_END( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
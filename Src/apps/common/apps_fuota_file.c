@@ -0,0 +1,870 @@
+/*!
+ * @file      apps_fuota_file.c
+ *
+ * @brief     Streaming extraction of the FUOTA file into the MCU flash
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "apps_fuota_file.h"
+#include "lr1121_modem_lorawan.h"
+#include "smtc_hal_crc.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_flash.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_watchdog.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+#define FUOTA_FILE_MIN( a, b ) ( ( ( a ) < ( b ) ) ? ( a ) : ( b ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Delta patch operation types, in the least significant bit of the operation header
+ *
+ * An operation header is a varint holding ( length << 1 ) | type. An insert is followed by length literal bytes, a copy
+ * by a zigzag varint: the offset of the copied bytes in the running image relative to the end of the previous copy.
+ */
+#define FUOTA_FILE_DELTA_OP_INSERT 0
+#define FUOTA_FILE_DELTA_OP_COPY 1
+
+/**
+ * @brief Shift of the last byte of a 32-bit varint (LEB128, at most 5 bytes)
+ */
+#define FUOTA_FILE_VARINT_MAX_SHIFT 28
+
+/**
+ * @brief LZSS compressed payload, a stream of tokens (most significant bit first):
+ * - literal: 1, then the byte (8 bits)
+ * - match: 0, then distance - 1 (window_bits) and length - FUOTA_FILE_LZSS_MIN_LENGTH (length_bits)
+ * The last byte is padded with less than 8 bits.
+ */
+#define FUOTA_FILE_LZSS_MIN_LENGTH 3
+#define FUOTA_FILE_LZSS_WINDOW_BITS_MIN 4
+#define FUOTA_FILE_LZSS_LENGTH_BITS_MIN 2
+#define FUOTA_FILE_LZSS_LENGTH_BITS_MAX 8
+
+/**
+ * @brief Number of decompressed bytes passed at once to the next stage
+ */
+#define FUOTA_FILE_LZSS_CHUNK_SIZE 64
+
+/**
+ * @brief Magic word of a checkpoint, "SFUJ" little endian
+ */
+#define FUOTA_FILE_CHECKPOINT_MAGIC 0x4A554653
+
+/**
+ * @brief Number of checkpoint slots of the journal, written alternately so that the last checkpoint survives a reset
+ * while the next one is written
+ */
+#define FUOTA_FILE_JOURNAL_NB_SLOTS 2
+
+/**
+ * @brief Extraction state saved in a checkpoint: the fuota_file_t fields from output_addr on
+ */
+#define FUOTA_FILE_STATE_OFFSET offsetof( fuota_file_t, output_addr )
+#define FUOTA_FILE_STATE_SIZE ( sizeof( fuota_file_t ) - FUOTA_FILE_STATE_OFFSET )
+
+/**
+ * @brief Offset of the checkpoint in a journal slot, after the extraction state
+ */
+#define FUOTA_FILE_CHECKPOINT_OFFSET ( ( FUOTA_FILE_STATE_SIZE + 7 ) & ~( ( uint32_t ) 7 ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Delta patch decoder states
+ */
+typedef enum fuota_file_delta_state_e
+{
+    FUOTA_FILE_DELTA_STATE_OP,      //!< Reading an operation header
+    FUOTA_FILE_DELTA_STATE_OFFSET,  //!< Reading the offset of a copy
+    FUOTA_FILE_DELTA_STATE_INSERT,  //!< Writing the literal bytes of an insert
+} fuota_file_delta_state_t;
+
+/**
+ * @brief FUOTA file extraction state
+ */
+typedef struct fuota_file_s
+{
+    apps_fuota_file_config_t config;
+
+    // Journal: slot holding the last checkpoint (-1 if none) and its sequence number
+    uint32_t journal_slot_size;
+    int8_t   journal_slot;
+    uint32_t journal_sequence;
+
+    // Staging area being written: the bytes beyond the last complete row wait in row
+    uint32_t output_addr;
+    uint32_t output_size;
+    uint32_t output_pos;
+    uint32_t row[FLASH_ROW_SIZE / sizeof( uint32_t )];
+
+    // Delta patch decoder
+    bool                     delta;
+    fuota_file_delta_state_t delta_state;
+    uint32_t                 varint;
+    uint8_t                  varint_shift;
+    uint32_t                 op_length;
+    uint32_t                 source_pos;
+    uint32_t                 source_size;
+
+    // LZSS decompressor: bits not decoded yet, and window of the last decompressed bytes
+    bool     compressed;
+    uint8_t  window_bits;
+    uint8_t  length_bits;
+    uint8_t  bit_count;
+    uint32_t bit_buffer;
+    uint32_t decompressed_size;
+    uint8_t  window[1 << APPS_FUOTA_FILE_WINDOW_BITS_MAX];
+} fuota_file_t;
+
+/**
+ * @brief Checkpoint of the extraction, programmed in a journal slot after the extraction state it protects
+ */
+typedef struct fuota_file_checkpoint_s
+{
+    uint32_t               magic;     //!< FUOTA_FILE_CHECKPOINT_MAGIC
+    uint32_t               sequence;  //!< Incremented at each checkpoint
+    uint32_t               offset;    //!< Offset of the next fragment to read from the modem
+    apps_fuota_file_info_t info;      //!< File identity (size and expected_crc), CRC of the bytes read and header
+    uint32_t               crc;       //!< CRC32 of the extraction state and of the fields above
+} fuota_file_checkpoint_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static fuota_file_t fuota_file = { 0 };
+
+/**
+ * @brief Fragment read from the modem
+ */
+static uint32_t fuota_file_fragment[APPS_FUOTA_FILE_FRAGMENT_SIZE / sizeof( uint32_t )];
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Read a little endian 32-bit value
+ */
+static uint32_t fuota_file_get_uint32( const uint8_t* buffer );
+
+/**
+ * @brief Read the file from the modem and extract it in the staging area, the staging area being programmed up to the
+ * last row
+ *
+ * @param [in] context Chip implementation context
+ * @param [in,out] info File information, size is an input
+ * @param [in] offset Offset of the first fragment to read: 0 to start from scratch, or the one of the checkpoint the
+ * extraction state was restored from
+ *
+ * @returns Extraction status
+ */
+static apps_fuota_file_status_t fuota_file_stream( const void* context, apps_fuota_file_info_t* info,
+                                                   uint32_t offset );
+
+/**
+ * @brief Parse the header of the file if any, select and erase the staging area
+ *
+ * @param [in] fragment First fragment of the file
+ * @param [in] fragment_size Size of the first fragment
+ * @param [in,out] info File information, size is an input
+ *
+ * @returns Extraction status
+ */
+static apps_fuota_file_status_t fuota_file_start( const uint8_t* fragment, uint16_t fragment_size,
+                                                  apps_fuota_file_info_t* info );
+
+/**
+ * @brief Program a row of the staging area, unless it was already programmed with the same data before a reset
+ */
+static apps_fuota_file_status_t fuota_file_program( uint32_t addr, const uint8_t* data, uint32_t size );
+
+/**
+ * @brief Append data to the staging area, programmed row by row
+ */
+static apps_fuota_file_status_t fuota_file_output( const uint8_t* data, uint32_t size );
+
+/**
+ * @brief Program the last incomplete row of the staging area
+ */
+static apps_fuota_file_status_t fuota_file_output_flush( void );
+
+/**
+ * @brief Decode a chunk of delta patch, the resulting image being appended to the staging area
+ */
+static apps_fuota_file_status_t fuota_file_delta_decode( const uint8_t* data, uint32_t size );
+
+/**
+ * @brief Pass a chunk of (decompressed) payload to the delta patch decoder or to the staging area
+ */
+static apps_fuota_file_status_t fuota_file_decode( const uint8_t* data, uint32_t size );
+
+/**
+ * @brief Decompress a chunk of LZSS compressed payload, the result being passed to @ref fuota_file_decode
+ */
+static apps_fuota_file_status_t fuota_file_decompress( const uint8_t* data, uint32_t size );
+
+/**
+ * @brief Get the address of a journal slot
+ */
+static uint32_t fuota_file_journal_slot_addr( uint8_t slot );
+
+/**
+ * @brief Erase the journal if it holds a checkpoint
+ */
+static void fuota_file_journal_clear( void );
+
+/**
+ * @brief Read and check the checkpoint of a journal slot
+ *
+ * @param [in] slot Journal slot
+ * @param [out] checkpoint Checkpoint
+ *
+ * @returns true if the slot holds a valid checkpoint
+ */
+static bool fuota_file_checkpoint_read( uint8_t slot, fuota_file_checkpoint_t* checkpoint );
+
+/**
+ * @brief Save the extraction state in the journal slot not holding the last checkpoint
+ *
+ * @param [in] offset Offset of the next fragment to read
+ * @param [in] info File information
+ */
+static void fuota_file_checkpoint_write( uint32_t offset, const apps_fuota_file_info_t* info );
+
+/**
+ * @brief Restore the extraction state from the last checkpoint, if it was taken on the same file
+ *
+ * @param [in,out] info File information, size and expected_crc are inputs
+ *
+ * @returns Offset of the next fragment to read, 0 if the extraction starts from scratch
+ */
+static uint32_t fuota_file_resume( apps_fuota_file_info_t* info );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_fuota_file_init( const apps_fuota_file_config_t* config )
+{
+    fuota_file_checkpoint_t checkpoint;
+
+    fuota_file.config            = *config;
+    fuota_file.journal_slot      = -1;
+    fuota_file.journal_slot_size = ( config->journal_nb_pages / FUOTA_FILE_JOURNAL_NB_SLOTS ) * ADDR_FLASH_PAGE_SIZE;
+    if( fuota_file.journal_slot_size < ( FUOTA_FILE_CHECKPOINT_OFFSET + sizeof( fuota_file_checkpoint_t ) ) )
+    {
+        fuota_file.journal_slot_size = 0;
+        return;
+    }
+
+    for( uint8_t slot = 0; slot < FUOTA_FILE_JOURNAL_NB_SLOTS; slot++ )
+    {
+        if( ( fuota_file_checkpoint_read( slot, &checkpoint ) == true ) &&
+            ( ( fuota_file.journal_slot < 0 ) ||
+              ( ( int32_t )( checkpoint.sequence - fuota_file.journal_sequence ) > 0 ) ) )
+        {
+            fuota_file.journal_slot     = ( int8_t ) slot;
+            fuota_file.journal_sequence = checkpoint.sequence;
+        }
+    }
+}
+
+bool apps_fuota_file_is_pending( void ) { return fuota_file.journal_slot >= 0; }
+
+apps_fuota_file_status_t apps_fuota_file_extract( const void* context, apps_fuota_file_info_t* info )
+{
+    const uint32_t           start_ms  = hal_rtc_get_time_ms( );
+    apps_fuota_file_info_t   file_info = { .crc = HAL_CRC32_INIT_VALUE };
+    apps_fuota_file_status_t status    = APPS_FUOTA_FILE_STATUS_OK;
+
+    if( lr1121_modem_fuota_get_file_size_crc( context, &file_info.size, &file_info.expected_crc ) !=
+        LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        status = APPS_FUOTA_FILE_STATUS_MODEM_ERROR;
+    }
+    else if( ( file_info.size == 0 ) || ( file_info.size > APPS_FUOTA_FILE_MAX_SIZE ) )
+    {
+        status = APPS_FUOTA_FILE_STATUS_INVALID_PARAM;
+    }
+
+    if( status == APPS_FUOTA_FILE_STATUS_OK )
+    {
+        file_info.resume_offset = fuota_file_resume( &file_info );
+        status                  = fuota_file_stream( context, &file_info, file_info.resume_offset );
+
+        if( ( status == APPS_FUOTA_FILE_STATUS_FLASH_ERROR ) && ( file_info.resume_offset != 0 ) )
+        {
+            // Most likely a row whose programming was interrupted by the reset: the staging area has to be erased
+            HAL_DBG_TRACE_WARNING( "FUOTA file: resume failed, restarting from scratch\n" );
+            fuota_file_journal_clear( );
+            file_info.crc           = HAL_CRC32_INIT_VALUE;
+            file_info.resume_offset = 0;
+            status                  = fuota_file_stream( context, &file_info, 0 );
+        }
+    }
+
+    if( ( status == APPS_FUOTA_FILE_STATUS_OK ) && ( file_info.crc != file_info.expected_crc ) )
+    {
+        status = APPS_FUOTA_FILE_STATUS_CRC_ERROR;
+    }
+
+    if( ( status == APPS_FUOTA_FILE_STATUS_OK ) &&
+        ( ( fuota_file.output_pos != fuota_file.output_size ) ||
+          ( fuota_file.delta_state != FUOTA_FILE_DELTA_STATE_OP ) || ( fuota_file.varint_shift != 0 ) ||
+          ( fuota_file.bit_count >= 8 ) ) )
+    {
+        status = APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+    }
+
+    // Read back the staging area: catches the programming errors, and the delta patch errors for an image
+    if( ( status == APPS_FUOTA_FILE_STATUS_OK ) &&
+        ( hal_crc32_update( HAL_CRC32_INIT_VALUE, ( const uint8_t* ) fuota_file.output_addr, fuota_file.output_size ) !=
+          ( ( file_info.is_image == true ) ? file_info.header.image_crc : file_info.expected_crc ) ) )
+    {
+        status = APPS_FUOTA_FILE_STATUS_CRC_ERROR;
+    }
+
+    // Keep the checkpoint for a retry only if the modem could not be read
+    if( status != APPS_FUOTA_FILE_STATUS_MODEM_ERROR )
+    {
+        fuota_file_journal_clear( );
+    }
+
+    file_info.duration_ms = hal_rtc_get_time_ms( ) - start_ms;
+    HAL_DBG_TRACE_INFO( "FUOTA file: %lu bytes in %lu ms (resumed at %lu), crc 0x%08lX (expected 0x%08lX), status %u\n",
+                        file_info.size, file_info.duration_ms, file_info.resume_offset, file_info.crc,
+                        file_info.expected_crc, status );
+    if( file_info.is_image == true )
+    {
+        HAL_DBG_TRACE_INFO( "FUOTA image: version %lu, %lu bytes, crc 0x%08lX%s%s%s\n", file_info.header.version,
+                            file_info.header.image_size, file_info.header.image_crc,
+                            ( ( file_info.header.flags & APPS_FUOTA_FILE_FLAG_DELTA ) != 0 ) ? ", delta" : "",
+                            ( ( file_info.header.flags & APPS_FUOTA_FILE_FLAG_COMPRESSED ) != 0 ) ? ", compressed" : "",
+                            ( ( file_info.header.flags & APPS_FUOTA_FILE_FLAG_MODEM ) != 0 ) ? ", modem" : "" );
+    }
+
+    if( info != NULL )
+    {
+        *info = file_info;
+    }
+    return status;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint32_t fuota_file_get_uint32( const uint8_t* buffer )
+{
+    return ( uint32_t ) buffer[0] | ( ( uint32_t ) buffer[1] << 8 ) | ( ( uint32_t ) buffer[2] << 16 ) |
+           ( ( uint32_t ) buffer[3] << 24 );
+}
+
+static apps_fuota_file_status_t fuota_file_stream( const void* context, apps_fuota_file_info_t* info,
+                                                   uint32_t offset )
+{
+    uint8_t*                 fragment = ( uint8_t* ) fuota_file_fragment;
+    apps_fuota_file_status_t status   = APPS_FUOTA_FILE_STATUS_OK;
+
+    for( ; ( status == APPS_FUOTA_FILE_STATUS_OK ) && ( offset < info->size ); offset += APPS_FUOTA_FILE_FRAGMENT_SIZE )
+    {
+        const uint16_t fragment_size =
+            ( uint16_t ) FUOTA_FILE_MIN( info->size - offset, APPS_FUOTA_FILE_FRAGMENT_SIZE );
+        uint16_t payload_offset = 0;
+
+        if( lr1121_modem_fuota_read_file_fragment( context, offset, fragment_size, fragment ) !=
+            LR1121_MODEM_RESPONSE_CODE_OK )
+        {
+            return APPS_FUOTA_FILE_STATUS_MODEM_ERROR;
+        }
+        info->crc = hal_crc32_update( info->crc, fragment, fragment_size );
+
+        if( offset == 0 )
+        {
+            status         = fuota_file_start( fragment, fragment_size, info );
+            payload_offset = ( info->is_image == true ) ? APPS_FUOTA_FILE_HEADER_SIZE : 0;
+        }
+
+        if( status == APPS_FUOTA_FILE_STATUS_OK )
+        {
+            status = ( fuota_file.compressed == true )
+                         ? fuota_file_decompress( fragment + payload_offset, fragment_size - payload_offset )
+                         : fuota_file_decode( fragment + payload_offset, fragment_size - payload_offset );
+        }
+
+        // Applying a delta patch can program the whole image staging area
+        hal_watchdog_reload( );
+
+        if( ( status == APPS_FUOTA_FILE_STATUS_OK ) &&
+            ( ( ( offset + fragment_size ) % APPS_FUOTA_FILE_CHECKPOINT_PERIOD ) == 0 ) &&
+            ( ( offset + fragment_size ) < info->size ) )
+        {
+            fuota_file_checkpoint_write( offset + fragment_size, info );
+        }
+    }
+
+    if( status == APPS_FUOTA_FILE_STATUS_OK )
+    {
+        status = fuota_file_output_flush( );
+    }
+    return status;
+}
+
+static apps_fuota_file_status_t fuota_file_start( const uint8_t* fragment, uint16_t fragment_size,
+                                                  apps_fuota_file_info_t* info )
+{
+    uint32_t output_max_size;
+
+    memset( &fuota_file.output_addr, 0, FUOTA_FILE_STATE_SIZE );
+    fuota_file.delta_state = FUOTA_FILE_DELTA_STATE_OP;
+
+    info->is_image = ( fragment_size >= APPS_FUOTA_FILE_HEADER_SIZE ) &&
+                     ( fuota_file_get_uint32( fragment ) == APPS_FUOTA_FILE_HEADER_MAGIC );
+    if( info->is_image == true )
+    {
+        info->header.magic       = APPS_FUOTA_FILE_HEADER_MAGIC;
+        info->header.flags       = fragment[4];
+        info->header.window_bits = fragment[5];
+        info->header.length_bits = fragment[6];
+        info->header.image_size  = fuota_file_get_uint32( fragment + 8 );
+        info->header.image_crc   = fuota_file_get_uint32( fragment + 12 );
+        info->header.source_size = fuota_file_get_uint32( fragment + 16 );
+        info->header.source_crc  = fuota_file_get_uint32( fragment + 20 );
+        info->header.version     = fuota_file_get_uint32( fragment + 24 );
+
+        fuota_file.output_addr = ADDR_FLASH_PAGE( fuota_file.config.image_first_page );
+        fuota_file.output_size = info->header.image_size;
+        output_max_size        = ( uint32_t ) fuota_file.config.image_nb_pages * ADDR_FLASH_PAGE_SIZE;
+
+        if( ( ( info->header.flags &
+                ~( APPS_FUOTA_FILE_FLAG_DELTA | APPS_FUOTA_FILE_FLAG_COMPRESSED | APPS_FUOTA_FILE_FLAG_MODEM ) ) != 0 ) ||
+            ( ( info->header.flags & ( APPS_FUOTA_FILE_FLAG_DELTA | APPS_FUOTA_FILE_FLAG_MODEM ) ) ==
+              ( APPS_FUOTA_FILE_FLAG_DELTA | APPS_FUOTA_FILE_FLAG_MODEM ) ) )
+        {
+            return APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+        }
+
+        if( ( info->header.flags & APPS_FUOTA_FILE_FLAG_COMPRESSED ) != 0 )
+        {
+            if( ( info->header.window_bits < FUOTA_FILE_LZSS_WINDOW_BITS_MIN ) ||
+                ( info->header.window_bits > APPS_FUOTA_FILE_WINDOW_BITS_MAX ) ||
+                ( info->header.length_bits < FUOTA_FILE_LZSS_LENGTH_BITS_MIN ) ||
+                ( info->header.length_bits > FUOTA_FILE_LZSS_LENGTH_BITS_MAX ) )
+            {
+                return APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+            }
+            fuota_file.compressed  = true;
+            fuota_file.window_bits = info->header.window_bits;
+            fuota_file.length_bits = info->header.length_bits;
+        }
+
+        if( ( info->header.flags & APPS_FUOTA_FILE_FLAG_DELTA ) != 0 )
+        {
+            // The source image is the running one, below the image staging area
+            if( ( info->header.source_size == 0 ) ||
+                ( info->header.source_size > ( fuota_file.output_addr - ADDR_FLASH_PAGE_0 ) ) )
+            {
+                return APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+            }
+            if( hal_crc32_update( HAL_CRC32_INIT_VALUE, ( const uint8_t* ) ADDR_FLASH_PAGE_0,
+                                  info->header.source_size ) != info->header.source_crc )
+            {
+                return APPS_FUOTA_FILE_STATUS_SOURCE_MISMATCH;
+            }
+            fuota_file.delta       = true;
+            fuota_file.source_size = info->header.source_size;
+        }
+    }
+    else
+    {
+        fuota_file.output_addr = ADDR_FLASH_PAGE( fuota_file.config.file_first_page );
+        fuota_file.output_size = info->size;
+        output_max_size        = ( uint32_t ) fuota_file.config.file_nb_pages * ADDR_FLASH_PAGE_SIZE;
+    }
+
+    if( ( fuota_file.output_size == 0 ) || ( fuota_file.output_size > output_max_size ) )
+    {
+        return APPS_FUOTA_FILE_STATUS_INVALID_PARAM;
+    }
+
+    if( flash_bulk_erase( fuota_file.output_addr,
+                          ( fuota_file.output_size + ADDR_FLASH_PAGE_SIZE - 1 ) / ADDR_FLASH_PAGE_SIZE ) !=
+        FLASH_STATUS_OK )
+    {
+        return APPS_FUOTA_FILE_STATUS_FLASH_ERROR;
+    }
+    return APPS_FUOTA_FILE_STATUS_OK;
+}
+
+static apps_fuota_file_status_t fuota_file_program( uint32_t addr, const uint8_t* data, uint32_t size )
+{
+    // After a resume, the rows programmed between the checkpoint and the reset are found with the same data
+    if( memcmp( ( const void* ) addr, data, size ) == 0 )
+    {
+        return APPS_FUOTA_FILE_STATUS_OK;
+    }
+    return ( flash_write_double_words( addr, data, size ) == FLASH_STATUS_OK ) ? APPS_FUOTA_FILE_STATUS_OK
+                                                                                : APPS_FUOTA_FILE_STATUS_FLASH_ERROR;
+}
+
+static apps_fuota_file_status_t fuota_file_output( const uint8_t* data, uint32_t size )
+{
+    if( size > ( fuota_file.output_size - fuota_file.output_pos ) )
+    {
+        return APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+    }
+
+    while( size > 0 )
+    {
+        const uint32_t row_pos = fuota_file.output_pos % FLASH_ROW_SIZE;
+        const uint32_t chunk   = FUOTA_FILE_MIN( size, FLASH_ROW_SIZE - row_pos );
+
+        memcpy( ( uint8_t* ) fuota_file.row + row_pos, data, chunk );
+        fuota_file.output_pos += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if( ( fuota_file.output_pos % FLASH_ROW_SIZE ) == 0 )
+        {
+            const apps_fuota_file_status_t status =
+                fuota_file_program( fuota_file.output_addr + fuota_file.output_pos - FLASH_ROW_SIZE,
+                                    ( const uint8_t* ) fuota_file.row, FLASH_ROW_SIZE );
+
+            if( status != APPS_FUOTA_FILE_STATUS_OK )
+            {
+                return status;
+            }
+        }
+    }
+    return APPS_FUOTA_FILE_STATUS_OK;
+}
+
+static apps_fuota_file_status_t fuota_file_output_flush( void )
+{
+    const uint32_t row_pos = fuota_file.output_pos % FLASH_ROW_SIZE;
+
+    if( row_pos == 0 )
+    {
+        return APPS_FUOTA_FILE_STATUS_OK;
+    }
+    return fuota_file_program( fuota_file.output_addr + fuota_file.output_pos - row_pos,
+                               ( const uint8_t* ) fuota_file.row, row_pos );
+}
+
+static apps_fuota_file_status_t fuota_file_delta_decode( const uint8_t* data, uint32_t size )
+{
+    apps_fuota_file_status_t status = APPS_FUOTA_FILE_STATUS_OK;
+
+    while( ( status == APPS_FUOTA_FILE_STATUS_OK ) && ( size > 0 ) )
+    {
+        if( fuota_file.delta_state == FUOTA_FILE_DELTA_STATE_INSERT )
+        {
+            const uint32_t chunk = FUOTA_FILE_MIN( size, fuota_file.op_length );
+
+            status = fuota_file_output( data, chunk );
+            data += chunk;
+            size -= chunk;
+            fuota_file.op_length -= chunk;
+            if( fuota_file.op_length == 0 )
+            {
+                fuota_file.delta_state = FUOTA_FILE_DELTA_STATE_OP;
+            }
+            continue;
+        }
+
+        // Operation header or copy offset: accumulate the varint
+        if( fuota_file.varint_shift > FUOTA_FILE_VARINT_MAX_SHIFT )
+        {
+            return APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+        }
+        fuota_file.varint |= ( uint32_t )( *data & 0x7F ) << fuota_file.varint_shift;
+        fuota_file.varint_shift += 7;
+        size--;
+        if( ( *data++ & 0x80 ) != 0 )
+        {
+            continue;
+        }
+
+        const uint32_t value    = fuota_file.varint;
+        fuota_file.varint       = 0;
+        fuota_file.varint_shift = 0;
+
+        if( fuota_file.delta_state == FUOTA_FILE_DELTA_STATE_OP )
+        {
+            fuota_file.op_length   = value >> 1;
+            fuota_file.delta_state = ( ( value & 1 ) == FUOTA_FILE_DELTA_OP_COPY ) ? FUOTA_FILE_DELTA_STATE_OFFSET
+                                                                                  : FUOTA_FILE_DELTA_STATE_INSERT;
+            if( fuota_file.op_length == 0 )
+            {
+                status = APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+            }
+        }
+        else
+        {
+            // Zigzag decoding, a negative offset wraps around and is caught by the range check
+            fuota_file.source_pos += ( value >> 1 ) ^ ( uint32_t )( -( int32_t )( value & 1 ) );
+            if( ( fuota_file.source_pos > fuota_file.source_size ) ||
+                ( fuota_file.op_length > ( fuota_file.source_size - fuota_file.source_pos ) ) )
+            {
+                status = APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+            }
+            else
+            {
+                status = fuota_file_output( ( const uint8_t* ) ( ADDR_FLASH_PAGE_0 + fuota_file.source_pos ),
+                                            fuota_file.op_length );
+                fuota_file.source_pos += fuota_file.op_length;
+                fuota_file.delta_state = FUOTA_FILE_DELTA_STATE_OP;
+            }
+        }
+    }
+    return status;
+}
+
+static apps_fuota_file_status_t fuota_file_decode( const uint8_t* data, uint32_t size )
+{
+    return ( fuota_file.delta == true ) ? fuota_file_delta_decode( data, size ) : fuota_file_output( data, size );
+}
+
+static apps_fuota_file_status_t fuota_file_decompress( const uint8_t* data, uint32_t size )
+{
+    const uint32_t           window_mask = ( 1UL << fuota_file.window_bits ) - 1;
+    const uint8_t            match_bits  = 1 + fuota_file.window_bits + fuota_file.length_bits;
+    uint8_t                  chunk[FUOTA_FILE_LZSS_CHUNK_SIZE];
+    uint32_t                 chunk_size = 0;
+    apps_fuota_file_status_t status     = APPS_FUOTA_FILE_STATUS_OK;
+
+    for( ; ( status == APPS_FUOTA_FILE_STATUS_OK ) && ( size > 0 ); size--, data++ )
+    {
+        fuota_file.bit_buffer = ( fuota_file.bit_buffer << 8 ) | *data;
+        fuota_file.bit_count += 8;
+
+        // Decode the complete tokens
+        while( ( status == APPS_FUOTA_FILE_STATUS_OK ) && ( fuota_file.bit_count > 0 ) )
+        {
+            const bool    is_literal = ( ( fuota_file.bit_buffer >> ( fuota_file.bit_count - 1 ) ) & 1 ) != 0;
+            const uint8_t token_bits = ( is_literal == true ) ? 9 : match_bits;
+
+            if( fuota_file.bit_count < token_bits )
+            {
+                break;
+            }
+            fuota_file.bit_count -= token_bits;
+
+            const uint32_t token = ( fuota_file.bit_buffer >> fuota_file.bit_count ) & ( ( 1UL << token_bits ) - 1 );
+            uint32_t       distance;
+            uint32_t       length;
+
+            if( is_literal == true )
+            {
+                // Seen as a match of the byte itself
+                fuota_file.window[fuota_file.decompressed_size & window_mask] = ( uint8_t ) token;
+                distance                                                      = 0;
+                length                                                        = 1;
+            }
+            else
+            {
+                distance = ( ( token >> fuota_file.length_bits ) & window_mask ) + 1;
+                length   = ( token & ( ( 1UL << fuota_file.length_bits ) - 1 ) ) + FUOTA_FILE_LZSS_MIN_LENGTH;
+                if( distance > fuota_file.decompressed_size )
+                {
+                    status = APPS_FUOTA_FILE_STATUS_FORMAT_ERROR;
+                    break;
+                }
+            }
+
+            for( ; ( status == APPS_FUOTA_FILE_STATUS_OK ) && ( length > 0 ); length-- )
+            {
+                const uint8_t byte = fuota_file.window[( fuota_file.decompressed_size - distance ) & window_mask];
+
+                fuota_file.window[fuota_file.decompressed_size & window_mask] = byte;
+                fuota_file.decompressed_size++;
+                chunk[chunk_size++] = byte;
+                if( chunk_size == sizeof( chunk ) )
+                {
+                    status     = fuota_file_decode( chunk, chunk_size );
+                    chunk_size = 0;
+                }
+            }
+        }
+    }
+
+    if( ( status == APPS_FUOTA_FILE_STATUS_OK ) && ( chunk_size > 0 ) )
+    {
+        status = fuota_file_decode( chunk, chunk_size );
+    }
+    return status;
+}
+
+static uint32_t fuota_file_journal_slot_addr( uint8_t slot )
+{
+    return ADDR_FLASH_PAGE( fuota_file.config.journal_first_page ) + ( slot * fuota_file.journal_slot_size );
+}
+
+static void fuota_file_journal_clear( void )
+{
+    if( fuota_file.journal_slot < 0 )
+    {
+        return;
+    }
+    fuota_file.journal_slot = -1;
+
+    if( flash_bulk_erase( ADDR_FLASH_PAGE( fuota_file.config.journal_first_page ),
+                          ( FUOTA_FILE_JOURNAL_NB_SLOTS * fuota_file.journal_slot_size ) / ADDR_FLASH_PAGE_SIZE ) !=
+        FLASH_STATUS_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "FUOTA file: journal erase failed\n" );
+    }
+}
+
+static bool fuota_file_checkpoint_read( uint8_t slot, fuota_file_checkpoint_t* checkpoint )
+{
+    const uint32_t addr = fuota_file_journal_slot_addr( slot );
+
+    memcpy( checkpoint, ( const void* ) ( addr + FUOTA_FILE_CHECKPOINT_OFFSET ), sizeof( fuota_file_checkpoint_t ) );
+    if( checkpoint->magic != FUOTA_FILE_CHECKPOINT_MAGIC )
+    {
+        return false;
+    }
+    return checkpoint->crc == hal_crc32_update( hal_crc32_update( HAL_CRC32_INIT_VALUE, ( const uint8_t* ) addr,
+                                                                  FUOTA_FILE_STATE_SIZE ),
+                                                ( const uint8_t* ) checkpoint, offsetof( fuota_file_checkpoint_t, crc ) );
+}
+
+static void fuota_file_checkpoint_write( uint32_t offset, const apps_fuota_file_info_t* info )
+{
+    const uint8_t           slot  = ( fuota_file.journal_slot == 0 ) ? 1 : 0;
+    const uint32_t          addr  = fuota_file_journal_slot_addr( slot );
+    const uint8_t*          state = ( const uint8_t* ) &fuota_file + FUOTA_FILE_STATE_OFFSET;
+    fuota_file_checkpoint_t checkpoint;
+
+    if( fuota_file.journal_slot_size == 0 )
+    {
+        return;
+    }
+
+    memset( &checkpoint, 0, sizeof( checkpoint ) );
+    checkpoint.magic    = FUOTA_FILE_CHECKPOINT_MAGIC;
+    checkpoint.sequence = fuota_file.journal_sequence + 1;
+    checkpoint.offset   = offset;
+    checkpoint.info     = *info;
+    checkpoint.crc      = hal_crc32_update( hal_crc32_update( HAL_CRC32_INIT_VALUE, state, FUOTA_FILE_STATE_SIZE ),
+                                            ( const uint8_t* ) &checkpoint, offsetof( fuota_file_checkpoint_t, crc ) );
+
+    // The checkpoint is programmed last: a slot whose writing was interrupted is not valid
+    if( ( flash_bulk_erase( addr, fuota_file.journal_slot_size / ADDR_FLASH_PAGE_SIZE ) != FLASH_STATUS_OK ) ||
+        ( flash_write_double_words( addr, state, FUOTA_FILE_STATE_SIZE ) != FLASH_STATUS_OK ) ||
+        ( flash_write_double_words( addr + FUOTA_FILE_CHECKPOINT_OFFSET, ( const uint8_t* ) &checkpoint,
+                                    sizeof( checkpoint ) ) != FLASH_STATUS_OK ) )
+    {
+        // The previous checkpoint, in the other slot, remains valid
+        HAL_DBG_TRACE_WARNING( "FUOTA file: checkpoint at offset %lu failed\n", offset );
+        return;
+    }
+    fuota_file.journal_slot     = ( int8_t ) slot;
+    fuota_file.journal_sequence = checkpoint.sequence;
+}
+
+static uint32_t fuota_file_resume( apps_fuota_file_info_t* info )
+{
+    fuota_file_checkpoint_t checkpoint;
+    uint32_t                area_addr;
+    uint32_t                area_size;
+
+    if( ( fuota_file.journal_slot < 0 ) ||
+        ( fuota_file_checkpoint_read( ( uint8_t ) fuota_file.journal_slot, &checkpoint ) == false ) ||
+        ( checkpoint.info.size != info->size ) || ( checkpoint.info.expected_crc != info->expected_crc ) ||
+        ( checkpoint.offset == 0 ) || ( checkpoint.offset >= info->size ) ||
+        ( ( checkpoint.offset % APPS_FUOTA_FILE_FRAGMENT_SIZE ) != 0 ) )
+    {
+        // Not the same file: it is extracted from scratch
+        fuota_file_journal_clear( );
+        return 0;
+    }
+
+    memcpy( ( uint8_t* ) &fuota_file + FUOTA_FILE_STATE_OFFSET,
+            ( const void* ) fuota_file_journal_slot_addr( ( uint8_t ) fuota_file.journal_slot ), FUOTA_FILE_STATE_SIZE );
+
+    // The staging area must be the one of the current configuration, and the running image the patch source
+    if( checkpoint.info.is_image == true )
+    {
+        area_addr = ADDR_FLASH_PAGE( fuota_file.config.image_first_page );
+        area_size = ( uint32_t ) fuota_file.config.image_nb_pages * ADDR_FLASH_PAGE_SIZE;
+    }
+    else
+    {
+        area_addr = ADDR_FLASH_PAGE( fuota_file.config.file_first_page );
+        area_size = ( uint32_t ) fuota_file.config.file_nb_pages * ADDR_FLASH_PAGE_SIZE;
+    }
+    if( ( fuota_file.output_addr != area_addr ) || ( fuota_file.output_size > area_size ) ||
+        ( fuota_file.output_pos > fuota_file.output_size ) ||
+        ( ( fuota_file.delta == true ) &&
+          ( hal_crc32_update( HAL_CRC32_INIT_VALUE, ( const uint8_t* ) ADDR_FLASH_PAGE_0, fuota_file.source_size ) !=
+            checkpoint.info.header.source_crc ) ) )
+    {
+        fuota_file_journal_clear( );
+        return 0;
+    }
+
+    info->crc      = checkpoint.info.crc;
+    info->is_image = checkpoint.info.is_image;
+    info->header   = checkpoint.info.header;
+    HAL_DBG_TRACE_INFO( "FUOTA file: resuming at offset %lu\n", checkpoint.offset );
+    return checkpoint.offset;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
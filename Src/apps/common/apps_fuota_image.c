@@ -0,0 +1,337 @@
+/*!
+ * @file      apps_fuota_image.c
+ *
+ * @brief     A/B image update: bank swap activation with boot counting and rollback
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "apps_fuota_image.h"
+#include "apps_kv_store.h"
+#include "smtc_hal_crc.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_flash.h"
+#include "smtc_hal_watchdog.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Distance between a page of the second bank and the page at the same offset in the first bank
+ */
+#define FUOTA_IMAGE_BANK_SIZE ( FLASH_NB_PAGES_PER_BANK * ADDR_FLASH_PAGE_SIZE )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Update state, as stored in the key-value store
+ */
+typedef struct fuota_image_record_s
+{
+    uint8_t                   state;       //!< apps_fuota_image_state_t
+    uint8_t                   boot_count;  //!< Number of boots of the new image
+    uint8_t                   swapped;     //!< Bank mapping the MCU is expected to boot with
+    uint8_t                   reserved;    //!< Reserved, 0
+    apps_fuota_image_header_t running;     //!< Header of the image expected to run
+    apps_fuota_image_header_t staged;      //!< Header of the image in the staging bank
+} fuota_image_record_t;
+
+/**
+ * @brief Image update context
+ */
+typedef struct fuota_image_s
+{
+    apps_fuota_image_config_t config;
+    fuota_image_record_t      record;
+} fuota_image_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static fuota_image_t fuota_image = { 0 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Write the update state in the key-value store
+ *
+ * @returns true if the state is written
+ */
+static bool fuota_image_save( void );
+
+/**
+ * @brief Check the CRC of an image in the staging area
+ *
+ * @param [in] header Header of the image
+ *
+ * @returns Operation status
+ */
+static apps_fuota_image_status_t fuota_image_check( const apps_fuota_image_header_t* header );
+
+/**
+ * @brief Copy the persistent data at the same offset of the running bank, skipping the erased rows
+ *
+ * @returns true if the persistent data are copied
+ */
+static bool fuota_image_copy_persistent( void );
+
+/**
+ * @brief Exchange the running and staged images: save the new state, copy the persistent data and swap the banks
+ *
+ * @param [in] state State after the swap
+ *
+ * @returns APPS_FUOTA_IMAGE_STATUS_FLASH_ERROR, the state being restored, does not return if the banks are swapped
+ */
+static apps_fuota_image_status_t fuota_image_swap( apps_fuota_image_state_t state );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+apps_fuota_image_state_t apps_fuota_image_init( const apps_fuota_image_config_t* config )
+{
+    const bool swapped = flash_is_bank_swapped( );
+    uint8_t    length  = 0;
+
+    fuota_image.config = *config;
+    if( ( apps_kv_store_read( config->kv_key, &fuota_image.record, sizeof( fuota_image.record ), &length ) == false ) ||
+        ( length != sizeof( fuota_image.record ) ) )
+    {
+        memset( &fuota_image.record, 0, sizeof( fuota_image.record ) );
+        fuota_image.record.state   = APPS_FUOTA_IMAGE_STATE_IDLE;
+        fuota_image.record.swapped = swapped;
+    }
+
+    if( fuota_image.record.state == APPS_FUOTA_IMAGE_STATE_TRIAL )
+    {
+        if( fuota_image.record.swapped != swapped )
+        {
+            // The bootloader found no valid vector table in the new image and started the previous one
+            const apps_fuota_image_header_t header = fuota_image.record.running;
+
+            HAL_DBG_TRACE_ERROR( "FUOTA image: version %lu did not boot\n", header.version );
+            fuota_image.record.running = fuota_image.record.staged;
+            fuota_image.record.staged  = header;
+            fuota_image.record.state   = APPS_FUOTA_IMAGE_STATE_ROLLED_BACK;
+            fuota_image.record.swapped = swapped;
+            fuota_image_save( );
+        }
+        else if( fuota_image.record.boot_count >= config->max_boot_attempts )
+        {
+            HAL_DBG_TRACE_ERROR( "FUOTA image: version %lu not confirmed after %u boots, rolling back\n",
+                                 fuota_image.record.running.version, fuota_image.record.boot_count );
+            fuota_image_swap( APPS_FUOTA_IMAGE_STATE_ROLLED_BACK );
+        }
+        else
+        {
+            fuota_image.record.boot_count++;
+            fuota_image_save( );
+            HAL_DBG_TRACE_WARNING( "FUOTA image: version %lu on trial, boot %u of %u\n",
+                                   fuota_image.record.running.version, fuota_image.record.boot_count,
+                                   config->max_boot_attempts );
+        }
+    }
+
+    HAL_DBG_TRACE_INFO( "FUOTA image: version %lu running from bank %u, state %u\n", fuota_image.record.running.version,
+                        ( swapped == true ) ? 2 : 1, fuota_image.record.state );
+    return ( apps_fuota_image_state_t ) fuota_image.record.state;
+}
+
+void apps_fuota_image_get_info( apps_fuota_image_info_t* info )
+{
+    info->state      = ( apps_fuota_image_state_t ) fuota_image.record.state;
+    info->boot_count = fuota_image.record.boot_count;
+    info->swapped    = flash_is_bank_swapped( );
+    info->running    = fuota_image.record.running;
+    info->staged     = fuota_image.record.staged;
+}
+
+apps_fuota_image_status_t apps_fuota_image_stage( const apps_fuota_image_header_t* header )
+{
+    apps_fuota_image_status_t status;
+
+    if( fuota_image.record.state == APPS_FUOTA_IMAGE_STATE_TRIAL )
+    {
+        return APPS_FUOTA_IMAGE_STATUS_INVALID_STATE;
+    }
+
+    status = fuota_image_check( header );
+    if( status != APPS_FUOTA_IMAGE_STATUS_OK )
+    {
+        return status;
+    }
+
+    fuota_image.record.state      = APPS_FUOTA_IMAGE_STATE_STAGED;
+    fuota_image.record.boot_count = 0;
+    fuota_image.record.staged     = *header;
+    return ( fuota_image_save( ) == true ) ? APPS_FUOTA_IMAGE_STATUS_OK : APPS_FUOTA_IMAGE_STATUS_FLASH_ERROR;
+}
+
+apps_fuota_image_status_t apps_fuota_image_activate( void )
+{
+    if( fuota_image.record.state != APPS_FUOTA_IMAGE_STATE_STAGED )
+    {
+        return APPS_FUOTA_IMAGE_STATUS_INVALID_STATE;
+    }
+
+    // The staging area may have been erased by another extraction since the image was staged
+    if( fuota_image_check( &fuota_image.record.staged ) != APPS_FUOTA_IMAGE_STATUS_OK )
+    {
+        fuota_image.record.state = APPS_FUOTA_IMAGE_STATE_IDLE;
+        fuota_image_save( );
+        return APPS_FUOTA_IMAGE_STATUS_CRC_ERROR;
+    }
+
+    HAL_DBG_TRACE_INFO( "FUOTA image: activating version %lu\n", fuota_image.record.staged.version );
+    return fuota_image_swap( APPS_FUOTA_IMAGE_STATE_TRIAL );
+}
+
+apps_fuota_image_status_t apps_fuota_image_confirm( void )
+{
+    if( fuota_image.record.state != APPS_FUOTA_IMAGE_STATE_TRIAL )
+    {
+        return APPS_FUOTA_IMAGE_STATUS_OK;
+    }
+
+    fuota_image.record.state      = APPS_FUOTA_IMAGE_STATE_IDLE;
+    fuota_image.record.boot_count = 0;
+    if( fuota_image_save( ) == false )
+    {
+        fuota_image.record.state = APPS_FUOTA_IMAGE_STATE_TRIAL;
+        return APPS_FUOTA_IMAGE_STATUS_FLASH_ERROR;
+    }
+    HAL_DBG_TRACE_INFO( "FUOTA image: version %lu confirmed\n", fuota_image.record.running.version );
+    return APPS_FUOTA_IMAGE_STATUS_OK;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool fuota_image_save( void )
+{
+    return apps_kv_store_write( fuota_image.config.kv_key, &fuota_image.record, sizeof( fuota_image.record ) );
+}
+
+static apps_fuota_image_status_t fuota_image_check( const apps_fuota_image_header_t* header )
+{
+    if( ( header->size == 0 ) ||
+        ( header->size > ( ( uint32_t ) fuota_image.config.image_nb_pages * ADDR_FLASH_PAGE_SIZE ) ) )
+    {
+        return APPS_FUOTA_IMAGE_STATUS_INVALID_PARAM;
+    }
+    if( hal_crc32_update( HAL_CRC32_INIT_VALUE, ( const uint8_t* ) ADDR_FLASH_PAGE( fuota_image.config.image_first_page ),
+                          header->size ) != header->crc )
+    {
+        return APPS_FUOTA_IMAGE_STATUS_CRC_ERROR;
+    }
+    return APPS_FUOTA_IMAGE_STATUS_OK;
+}
+
+static bool fuota_image_copy_persistent( void )
+{
+    const uint32_t src  = ADDR_FLASH_PAGE( fuota_image.config.persistent_first_page );
+    const uint32_t size = ( uint32_t ) fuota_image.config.persistent_nb_pages * ADDR_FLASH_PAGE_SIZE;
+
+    if( ( fuota_image.config.persistent_first_page < FLASH_NB_PAGES_PER_BANK ) ||
+        ( flash_bulk_erase( src - FUOTA_IMAGE_BANK_SIZE, fuota_image.config.persistent_nb_pages ) != FLASH_STATUS_OK ) )
+    {
+        return false;
+    }
+
+    for( uint32_t offset = 0; offset < size; offset += FLASH_ROW_SIZE )
+    {
+        const uint32_t* row = ( const uint32_t* ) ( src + offset );
+        uint16_t        i   = 0;
+
+        // Most of the telemetry log and key-value store pages are erased
+        while( ( i < ( FLASH_ROW_SIZE / sizeof( uint32_t ) ) ) && ( row[i] == 0xFFFFFFFF ) )
+        {
+            i++;
+        }
+        if( ( i < ( FLASH_ROW_SIZE / sizeof( uint32_t ) ) ) &&
+            ( flash_write_double_words( src - FUOTA_IMAGE_BANK_SIZE + offset, ( const uint8_t* ) row,
+                                        FLASH_ROW_SIZE ) != FLASH_STATUS_OK ) )
+        {
+            return false;
+        }
+        hal_watchdog_reload( );
+    }
+    return true;
+}
+
+static apps_fuota_image_status_t fuota_image_swap( apps_fuota_image_state_t state )
+{
+    const fuota_image_record_t previous = fuota_image.record;
+
+    // Saved first, so that the state is part of the persistent data found by the other image
+    fuota_image.record.state      = state;
+    fuota_image.record.boot_count = 0;
+    fuota_image.record.swapped    = ( flash_is_bank_swapped( ) == true ) ? 0 : 1;
+    fuota_image.record.running    = previous.staged;
+    fuota_image.record.staged     = previous.running;
+
+    if( ( fuota_image_save( ) == true ) && ( fuota_image_copy_persistent( ) == true ) )
+    {
+        flash_swap_banks( );
+    }
+
+    HAL_DBG_TRACE_ERROR( "FUOTA image: bank swap failed\n" );
+    fuota_image.record = previous;
+    fuota_image_save( );
+    return APPS_FUOTA_IMAGE_STATUS_FLASH_ERROR;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,420 @@
+/*!
+ * @file      apps_join_manager.c
+ *
+ * @brief     Join procedure with a randomized backoff and a spread join data rate distribution
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "apps_join_manager.h"
+#include "apps_airtime.h"
+#include "lr1121_modem_lorawan.h"
+#include "lr1121_modem_system.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_utilities.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Size of a JoinRequest frame: MHDR, JoinEUI, DevEUI, DevNonce and MIC
+ */
+#define JOIN_MANAGER_JOIN_REQUEST_SIZE 23
+
+/**
+ * @brief Scale of the inverse of the time on air the data rate weights are computed from
+ */
+#define JOIN_MANAGER_WEIGHT_SCALE ( 1UL << 20 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Join manager context
+ */
+typedef struct join_manager_s
+{
+    bool     joining;                                                  //!< A join procedure runs
+    bool     scheduled;                                                //!< A join request waits for its time
+    uint32_t start_ms;                                                 //!< Start time of the join procedure
+    uint32_t due_ms;                                                   //!< Time of the next join request
+    uint16_t nb_failures;                                              //!< Join failures of the join procedure
+    uint8_t  distribution[LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH];  //!< Last join data rate distribution
+    uint32_t nb_joins;                                                 //!< Join procedures that succeeded
+    uint16_t last_attempts;                                            //!< Join requests of the last success
+    uint32_t last_time_ms;                                             //!< Time to join of the last success
+    uint32_t min_time_ms;                                              //!< Shortest time to join
+    uint32_t max_time_ms;                                              //!< Longest time to join
+    uint64_t total_time_ms;                                            //!< Sum of the times to join
+} join_manager_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static join_manager_t join_manager;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Schedule the next join request
+ *
+ * @param [in] delay_ms Delay before the join request
+ */
+static void join_manager_schedule( uint32_t delay_ms );
+
+/**
+ * @brief Get the backoff window after a number of join failures
+ *
+ * @param [in] nb_failures Join failures, from 1
+ *
+ * @returns Backoff window in ms
+ */
+static uint32_t join_manager_get_backoff_window_ms( uint16_t nb_failures );
+
+/**
+ * @brief Build the join data rate distribution after a number of join failures
+ *
+ * @param [in] nb_failures Join failures of the join procedure
+ * @param [out] distribution Join data rate distribution, the weight of each data rate
+ *
+ * @returns true if the region has a LoRa data rate at 125 kHz, the distribution being built
+ */
+static bool join_manager_build_distribution( uint16_t nb_failures,
+                                             uint8_t  distribution[LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH] );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_join_manager_start( const void* context, uint32_t start_jitter_ms )
+{
+    uint32_t seed;
+
+    // A true random seed, the devices powered up together drawing different delays
+    if( lr1121_modem_system_get_random_number( context, &seed ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_WARNING( "Join manager: no random number from the chip, seeded from the time\n" );
+        seed = hal_rtc_get_time_ms( );
+    }
+    srand1( seed );
+
+    const uint32_t delay_ms = ( start_jitter_ms == 0 ) ? 0 : ( uint32_t ) randr( 0, ( int32_t ) start_jitter_ms );
+
+    CRITICAL_SECTION_BEGIN( );
+    join_manager.joining     = true;
+    join_manager.start_ms    = hal_rtc_get_time_ms( );
+    join_manager.nb_failures = 0;
+    CRITICAL_SECTION_END( );
+
+    join_manager_schedule( delay_ms );
+    HAL_DBG_TRACE_INFO( "Join manager: first join request in %lu ms\n", delay_ms );
+}
+
+void apps_join_manager_on_join_fail( const void* context )
+{
+    uint16_t nb_failures;
+
+    // Cancel the automatic retry of the modem, the next join request being scheduled here
+    if( lr1121_modem_leave_network( context ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "Join manager: join procedure not cancelled\n" );
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    if( join_manager.nb_failures < UINT16_MAX )
+    {
+        join_manager.nb_failures++;
+    }
+    nb_failures = join_manager.nb_failures;
+    CRITICAL_SECTION_END( );
+
+    const uint32_t window_ms = join_manager_get_backoff_window_ms( nb_failures );
+    const uint32_t delay_ms  = ( uint32_t ) randr( 0, ( int32_t ) window_ms );
+
+    join_manager_schedule( delay_ms );
+    HAL_DBG_TRACE_INFO( "Join manager: join failure %u, next join request in %lu ms\n", nb_failures, delay_ms );
+}
+
+void apps_join_manager_on_joined( void )
+{
+    const uint32_t now_ms  = hal_rtc_get_time_ms( );
+    bool           managed = false;
+    uint32_t       time_ms = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( join_manager.joining == true )
+    {
+        managed                    = true;
+        time_ms                    = now_ms - join_manager.start_ms;
+        join_manager.joining       = false;
+        join_manager.scheduled     = false;
+        join_manager.last_attempts = join_manager.nb_failures + 1;
+        join_manager.last_time_ms  = time_ms;
+        if( ( join_manager.nb_joins == 0 ) || ( time_ms < join_manager.min_time_ms ) )
+        {
+            join_manager.min_time_ms = time_ms;
+        }
+        if( time_ms > join_manager.max_time_ms )
+        {
+            join_manager.max_time_ms = time_ms;
+        }
+        join_manager.total_time_ms += time_ms;
+        join_manager.nb_joins++;
+    }
+    CRITICAL_SECTION_END( );
+
+    if( managed == true )
+    {
+        HAL_DBG_TRACE_INFO( "Join manager: joined in %lu ms, %u join requests\n", time_ms, join_manager.last_attempts );
+    }
+}
+
+uint32_t apps_join_manager_process( const void* context )
+{
+    const uint32_t               now_ms = hal_rtc_get_time_ms( );
+    uint8_t                      distribution[LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH];
+    bool                         scheduled;
+    uint32_t                     due_ms;
+    uint16_t                     nb_failures;
+    lr1121_modem_response_code_t rc = LR1121_MODEM_RESPONSE_CODE_OK;
+
+    CRITICAL_SECTION_BEGIN( );
+    scheduled   = join_manager.scheduled;
+    due_ms      = join_manager.due_ms;
+    nb_failures = join_manager.nb_failures;
+    if( ( scheduled == true ) && ( ( int32_t ) ( now_ms - due_ms ) >= 0 ) )
+    {
+        join_manager.scheduled = false;
+    }
+    CRITICAL_SECTION_END( );
+
+    if( scheduled == false )
+    {
+        return APPS_JOIN_MANAGER_IDLE;
+    }
+    if( ( int32_t ) ( now_ms - due_ms ) < 0 )
+    {
+        return due_ms - now_ms;
+    }
+
+    const bool distribution_built = join_manager_build_distribution( nb_failures, distribution );
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    if( distribution_built == true )
+    {
+        rc = lr1121_modem_set_join_data_rate_distribution( context, distribution );
+    }
+    if( rc == LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        rc = lr1121_modem_join( context );
+    }
+    hal_gpio_irq_enable( );
+
+    if( rc != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "Join manager: join request refused, rc %d\n", rc );
+        join_manager_schedule( APPS_JOIN_MANAGER_BACKOFF_BASE_MS );
+        return APPS_JOIN_MANAGER_BACKOFF_BASE_MS;
+    }
+
+    if( distribution_built == true )
+    {
+        memcpy( join_manager.distribution, distribution, sizeof( distribution ) );
+        HAL_DBG_TRACE_ARRAY( "Join manager: join data rate distribution", distribution, sizeof( distribution ) );
+    }
+    HAL_DBG_TRACE_INFO( "###### ===== JOINING ==== ######\n\n\n" );
+    return APPS_JOIN_MANAGER_IDLE;
+}
+
+void apps_join_manager_get_stats( apps_join_manager_stats_t* stats )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+
+    CRITICAL_SECTION_BEGIN( );
+    stats->joining       = join_manager.joining;
+    stats->nb_failures   = ( join_manager.joining == true ) ? join_manager.nb_failures : 0;
+    stats->next_join_ms  = 0;
+    stats->nb_joins      = join_manager.nb_joins;
+    stats->last_attempts = join_manager.last_attempts;
+    stats->last_time_ms  = join_manager.last_time_ms;
+    stats->min_time_ms   = join_manager.min_time_ms;
+    stats->max_time_ms   = join_manager.max_time_ms;
+    stats->avg_time_ms   = ( join_manager.nb_joins == 0 ) ? 0 : join_manager.total_time_ms / join_manager.nb_joins;
+    if( ( join_manager.scheduled == true ) && ( ( int32_t ) ( join_manager.due_ms - now_ms ) > 0 ) )
+    {
+        stats->next_join_ms = join_manager.due_ms - now_ms;
+    }
+    memcpy( stats->distribution, join_manager.distribution, sizeof( stats->distribution ) );
+    CRITICAL_SECTION_END( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void join_manager_schedule( uint32_t delay_ms )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+
+    CRITICAL_SECTION_BEGIN( );
+    if( join_manager.joining == true )
+    {
+        join_manager.scheduled = true;
+        join_manager.due_ms    = now_ms + delay_ms;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+static uint32_t join_manager_get_backoff_window_ms( uint16_t nb_failures )
+{
+    uint32_t window_ms = APPS_JOIN_MANAGER_BACKOFF_BASE_MS;
+
+    while( ( nb_failures > 1 ) && ( window_ms < APPS_JOIN_MANAGER_BACKOFF_MAX_MS ) )
+    {
+        window_ms *= 2;
+        nb_failures--;
+    }
+    if( window_ms > APPS_JOIN_MANAGER_BACKOFF_MAX_MS )
+    {
+        window_ms = APPS_JOIN_MANAGER_BACKOFF_MAX_MS;
+    }
+    return window_ms;
+}
+
+static bool join_manager_build_distribution( uint16_t nb_failures,
+                                             uint8_t  distribution[LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH] )
+{
+    lr1121_modem_radio_mod_params_lora_t mod_params;
+    uint32_t                             weight[LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH] = { 0 };
+    uint32_t                             weight_sum                                        = 0;
+    uint8_t                              nb_rates                                          = 0;
+    uint8_t                              nb_entries                                        = 0;
+    uint8_t                              nb_dropped;
+    uint8_t                              fastest                                           = 0;
+
+    // Each data rate weighs the inverse of the time on air of a join request
+    for( uint8_t data_rate = 0; data_rate < LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH; data_rate++ )
+    {
+        if( ( apps_airtime_get_lora_params( data_rate, &mod_params ) == true ) &&
+            ( mod_params.bw == LR1121_MODEM_RADIO_LORA_BW_125 ) )
+        {
+            const uint32_t time_on_air_ms = apps_airtime_get_time_on_air_ms(
+                data_rate, JOIN_MANAGER_JOIN_REQUEST_SIZE - APPS_AIRTIME_MAC_OVERHEAD );
+
+            weight[data_rate] = JOIN_MANAGER_WEIGHT_SCALE / ( ( time_on_air_ms == 0 ) ? 1 : time_on_air_ms );
+            nb_rates++;
+        }
+    }
+    if( nb_rates == 0 )
+    {
+        return false;
+    }
+
+    // Drop the fastest data rates, out of reach if the join requests were not answered
+    nb_dropped = ( nb_failures / APPS_JOIN_MANAGER_FAILURES_PER_STEP ) % nb_rates;
+    while( nb_dropped-- > 0 )
+    {
+        uint8_t data_rate_max = 0;
+
+        for( uint8_t data_rate = 1; data_rate < LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH; data_rate++ )
+        {
+            if( weight[data_rate] > weight[data_rate_max] )
+            {
+                data_rate_max = data_rate;
+            }
+        }
+        weight[data_rate_max] = 0;
+    }
+
+    for( uint8_t data_rate = 0; data_rate < LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH; data_rate++ )
+    {
+        weight_sum += weight[data_rate];
+        if( weight[data_rate] > weight[fastest] )
+        {
+            fastest = data_rate;
+        }
+    }
+
+    // Spread the entries of the distribution by weight, each data rate kept having one at least
+    for( uint8_t data_rate = 0; data_rate < LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH; data_rate++ )
+    {
+        distribution[data_rate] = 0;
+        if( weight[data_rate] != 0 )
+        {
+            distribution[data_rate] =
+                ( uint8_t ) ( weight[data_rate] * LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH / weight_sum );
+            if( distribution[data_rate] == 0 )
+            {
+                distribution[data_rate] = 1;
+            }
+            nb_entries += distribution[data_rate];
+        }
+    }
+    // The rounding goes to the fastest data rate
+    if( nb_entries < LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH )
+    {
+        distribution[fastest] += LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH - nb_entries;
+    }
+    else if( ( nb_entries - LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH ) < distribution[fastest] )
+    {
+        distribution[fastest] -= nb_entries - LR1121_MODEM_DATARATE_DISTRIBUTION_LENGTH;
+    }
+    return true;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,568 @@
+/*!
+ * @file      apps_kv_store.c
+ *
+ * @brief     Wear-leveled key-value store in the user flash area
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "apps_kv_store.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_flash.h"
+#include "smtc_utilities.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/**
+ * @brief Size of a record holding a value of @p length bytes, rounded up to a flash double word
+ */
+#define APPS_KV_STORE_RECORD_SIZE( length ) \
+    ( ( sizeof( apps_kv_store_record_header_t ) + ( length ) + 7 ) & ~( ( uint32_t ) 7 ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Magic word of the header of a page in use
+ */
+#define APPS_KV_STORE_PAGE_MAGIC 0x3153564B  // "KVS1"
+
+/**
+ * @brief Value of an erased record header
+ */
+#define APPS_KV_STORE_RECORD_EMPTY 0xFFFFFFFF
+
+/**
+ * @brief Compact in background only when at most this number of pages are free...
+ */
+#define APPS_KV_STORE_GC_NB_FREE_PAGES 2
+
+/**
+ * @brief ...and when the oldest page holds less live data than this number of bytes, so that a store filled with
+ * live data is not compacted over and over
+ */
+#define APPS_KV_STORE_GC_MAX_LIVE_SIZE ( ADDR_FLASH_PAGE_SIZE / 2 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Header of a page in use, written in the first double word of the page
+ */
+typedef struct apps_kv_store_page_header_s
+{
+    uint32_t magic;     //!< APPS_KV_STORE_PAGE_MAGIC
+    uint32_t sequence;  //!< Incremented each time a page is opened, the highest one is the head of the ring
+} apps_kv_store_page_header_t;
+
+/**
+ * @brief Header of a record, followed by the value and padded to a flash double word
+ */
+typedef struct apps_kv_store_record_header_s
+{
+    uint8_t  key;
+    uint8_t  length;  //!< Length of the value, 0 for a deleted value
+    uint16_t crc;     //!< CRC16-CCITT of key, length and value
+} apps_kv_store_record_header_t;
+
+/**
+ * @brief Key-value store state
+ */
+typedef struct apps_kv_store_s
+{
+    bool     mounted;
+    uint32_t first_page;
+    uint8_t  nb_pages;
+    uint8_t  nb_free_pages;
+    uint8_t  head;           //!< Index of the page being filled
+    uint8_t  tail;           //!< Index of the oldest page in use
+    uint32_t head_sequence;  //!< Sequence number of the head page
+    uint32_t write_addr;     //!< Address of the next record in the head page
+    uint32_t index[APPS_KV_STORE_MAX_KEYS];  //!< Address of the last record of each key, 0 if none
+} apps_kv_store_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static apps_kv_store_t kv_store = { 0 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Get the address of a page of the store
+ */
+static uint32_t kv_store_page_addr( uint8_t page );
+
+/**
+ * @brief Get the index of the page following @p page in the ring
+ */
+static uint8_t kv_store_next_page( uint8_t page );
+
+/**
+ * @brief Compute the CRC of a record
+ */
+static uint16_t kv_store_crc( uint8_t key, uint8_t length, const uint8_t* value );
+
+/**
+ * @brief Check the record located at @p addr
+ *
+ * @param [in] addr Record address
+ * @param [in] page_end End address of the page holding the record
+ * @param [out] header Record header
+ *
+ * @returns true if the record is complete and its CRC is valid
+ */
+static bool kv_store_record_is_valid( uint32_t addr, uint32_t page_end, apps_kv_store_record_header_t* header );
+
+/**
+ * @brief Index the records of a page
+ *
+ * @returns Address following the last record of the page
+ */
+static uint32_t kv_store_scan_page( uint8_t page );
+
+/**
+ * @brief Check that a page is erased
+ */
+static bool kv_store_page_is_erased( uint8_t page );
+
+/**
+ * @brief Open the next page of the ring as head page
+ */
+static bool kv_store_open_next_page( void );
+
+/**
+ * @brief Append a record at the head of the ring
+ *
+ * @param [in] key Key of the value
+ * @param [in] value Value, can be located in flash
+ * @param [in] length Length of @p value, 0 for a deletion
+ * @param [in] use_spare_page Allow the last free page to be opened (compaction only)
+ */
+static bool kv_store_append( uint8_t key, const uint8_t* value, uint8_t length, bool use_spare_page );
+
+/**
+ * @brief Get the number of bytes of the tail page still used by live records
+ */
+static uint32_t kv_store_tail_live_size( void );
+
+/**
+ * @brief Copy the live records of the tail page to the head and erase it
+ */
+static bool kv_store_compact_tail( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool apps_kv_store_init( uint32_t first_page, uint8_t nb_pages )
+{
+    bool     head_found    = false;
+    uint32_t tail_sequence = 0;
+
+    memset( &kv_store, 0, sizeof( kv_store ) );
+
+    if( ( nb_pages < APPS_KV_STORE_MIN_NB_PAGES ) || ( first_page < FLASH_USER_START_PAGE ) ||
+        ( ( first_page + nb_pages - 1 ) > FLASH_USER_END_PAGE ) )
+    {
+        HAL_DBG_TRACE_ERROR( "KV store: invalid page range\n" );
+        return false;
+    }
+    kv_store.first_page = first_page;
+    kv_store.nb_pages   = nb_pages;
+
+    // Only the page headers are read to locate the head and the tail of the ring
+    for( uint8_t page = 0; page < nb_pages; page++ )
+    {
+        const apps_kv_store_page_header_t* header =
+            ( const apps_kv_store_page_header_t* ) kv_store_page_addr( page );
+
+        if( header->magic == APPS_KV_STORE_PAGE_MAGIC )
+        {
+            if( ( head_found == false ) || ( header->sequence > kv_store.head_sequence ) )
+            {
+                kv_store.head          = page;
+                kv_store.head_sequence = header->sequence;
+            }
+            if( ( head_found == false ) || ( header->sequence < tail_sequence ) )
+            {
+                kv_store.tail = page;
+                tail_sequence = header->sequence;
+            }
+            head_found = true;
+        }
+    }
+
+    if( head_found == false )
+    {
+        // Blank store: open the first page
+        kv_store.nb_free_pages = nb_pages;
+        kv_store.head          = nb_pages - 1;
+        kv_store.tail          = 0;
+        kv_store.head_sequence = 0;
+        if( kv_store_open_next_page( ) == false )
+        {
+            return false;
+        }
+    }
+    else
+    {
+        uint8_t page = kv_store.tail;
+
+        // Replay the pages from the oldest one, so that the last record of a key wins
+        kv_store.nb_free_pages = nb_pages;
+        while( true )
+        {
+            kv_store.write_addr = kv_store_scan_page( page );
+            kv_store.nb_free_pages--;
+            if( page == kv_store.head )
+            {
+                break;
+            }
+            page = kv_store_next_page( page );
+        }
+    }
+
+    kv_store.mounted = true;
+    HAL_DBG_TRACE_INFO( "KV store: %u pages from page %lu, %u free\n", nb_pages, first_page,
+                        kv_store.nb_free_pages );
+    return true;
+}
+
+bool apps_kv_store_read( uint8_t key, void* value, uint8_t size, uint8_t* length )
+{
+    if( ( kv_store.mounted == false ) || ( key >= APPS_KV_STORE_MAX_KEYS ) || ( kv_store.index[key] == 0 ) )
+    {
+        return false;
+    }
+
+    const apps_kv_store_record_header_t* header = ( const apps_kv_store_record_header_t* ) kv_store.index[key];
+
+    if( length != NULL )
+    {
+        *length = header->length;
+    }
+    if( header->length > size )
+    {
+        return false;
+    }
+    memcpy( value, ( const uint8_t* ) ( header + 1 ), header->length );
+    return true;
+}
+
+bool apps_kv_store_write( uint8_t key, const void* value, uint8_t length )
+{
+    if( ( kv_store.mounted == false ) || ( key >= APPS_KV_STORE_MAX_KEYS ) || ( length == 0 ) ||
+        ( length > APPS_KV_STORE_MAX_VALUE_SIZE ) )
+    {
+        return false;
+    }
+
+    // Do not wear the flash with an unchanged value
+    if( kv_store.index[key] != 0 )
+    {
+        const apps_kv_store_record_header_t* header =
+            ( const apps_kv_store_record_header_t* ) kv_store.index[key];
+
+        if( ( header->length == length ) && ( memcmp( header + 1, value, length ) == 0 ) )
+        {
+            return true;
+        }
+    }
+
+    return kv_store_append( key, ( const uint8_t* ) value, length, false );
+}
+
+bool apps_kv_store_delete( uint8_t key )
+{
+    if( ( kv_store.mounted == false ) || ( key >= APPS_KV_STORE_MAX_KEYS ) )
+    {
+        return false;
+    }
+    if( kv_store.index[key] == 0 )
+    {
+        return true;
+    }
+    return kv_store_append( key, NULL, 0, false );
+}
+
+void apps_kv_store_process( void )
+{
+    if( ( kv_store.mounted == true ) && ( kv_store.nb_free_pages <= APPS_KV_STORE_GC_NB_FREE_PAGES ) &&
+        ( kv_store.tail != kv_store.head ) && ( kv_store_tail_live_size( ) <= APPS_KV_STORE_GC_MAX_LIVE_SIZE ) )
+    {
+        kv_store_compact_tail( );
+    }
+}
+
+uint8_t apps_kv_store_get_nb_free_pages( void ) { return kv_store.nb_free_pages; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint32_t kv_store_page_addr( uint8_t page ) { return ADDR_FLASH_PAGE( kv_store.first_page + page ); }
+
+static uint8_t kv_store_next_page( uint8_t page ) { return ( page + 1 ) % kv_store.nb_pages; }
+
+static uint16_t kv_store_crc( uint8_t key, uint8_t length, const uint8_t* value )
+{
+    uint16_t crc = 0xFFFF;
+
+    for( int16_t i = -2; i < length; i++ )
+    {
+        const uint8_t byte = ( i == -2 ) ? key : ( ( i == -1 ) ? length : value[i] );
+
+        crc ^= ( uint16_t ) byte << 8;
+        for( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc & 0x8000 ) ? ( ( crc << 1 ) ^ 0x1021 ) : ( crc << 1 );
+        }
+    }
+    return crc;
+}
+
+static bool kv_store_record_is_valid( uint32_t addr, uint32_t page_end, apps_kv_store_record_header_t* header )
+{
+    memcpy( header, ( const void* ) addr, sizeof( apps_kv_store_record_header_t ) );
+
+    return ( header->length <= APPS_KV_STORE_MAX_VALUE_SIZE ) &&
+           ( ( addr + APPS_KV_STORE_RECORD_SIZE( header->length ) ) <= page_end ) &&
+           ( header->crc ==
+             kv_store_crc( header->key, header->length,
+                           ( const uint8_t* ) ( addr + sizeof( apps_kv_store_record_header_t ) ) ) );
+}
+
+static uint32_t kv_store_scan_page( uint8_t page )
+{
+    const uint32_t page_end = kv_store_page_addr( page ) + ADDR_FLASH_PAGE_SIZE;
+    uint32_t       addr     = kv_store_page_addr( page ) + sizeof( apps_kv_store_page_header_t );
+
+    if( ( ( const apps_kv_store_page_header_t* ) kv_store_page_addr( page ) )->magic != APPS_KV_STORE_PAGE_MAGIC )
+    {
+        return page_end;
+    }
+
+    while( ( addr < page_end ) && ( *( const uint32_t* ) addr != APPS_KV_STORE_RECORD_EMPTY ) )
+    {
+        apps_kv_store_record_header_t header;
+
+        if( kv_store_record_is_valid( addr, page_end, &header ) == true )
+        {
+            if( header.key < APPS_KV_STORE_MAX_KEYS )
+            {
+                kv_store.index[header.key] = ( header.length != 0 ) ? addr : 0;
+            }
+        }
+        else if( ( header.length > APPS_KV_STORE_MAX_VALUE_SIZE ) ||
+                 ( ( addr + APPS_KV_STORE_RECORD_SIZE( header.length ) ) > page_end ) )
+        {
+            // Corrupted length: the following records cannot be located, the rest of the page is not used anymore
+            HAL_DBG_TRACE_WARNING( "KV store: corrupted record at 0x%08lX\n", addr );
+            return page_end;
+        }
+        // A record interrupted by a reset is skipped
+        addr += APPS_KV_STORE_RECORD_SIZE( header.length );
+    }
+    return addr;
+}
+
+static bool kv_store_page_is_erased( uint8_t page )
+{
+    const uint64_t* word     = ( const uint64_t* ) kv_store_page_addr( page );
+    const uint64_t* page_end = word + ( ADDR_FLASH_PAGE_SIZE / sizeof( uint64_t ) );
+
+    while( word < page_end )
+    {
+        if( *word++ != FLASH_PAGE_EMPTY_CONTENT )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool kv_store_open_next_page( void )
+{
+    const uint8_t               page   = kv_store_next_page( kv_store.head );
+    apps_kv_store_page_header_t header = {
+        .magic    = APPS_KV_STORE_PAGE_MAGIC,
+        .sequence = kv_store.head_sequence + 1,
+    };
+
+    if( kv_store.nb_free_pages == 0 )
+    {
+        return false;
+    }
+
+    // A free page may have been left partially erased or written by a reset
+    if( ( kv_store_page_is_erased( page ) == false ) &&
+        ( flash_erase_page( kv_store_page_addr( page ), 1 ) != SMTC_SUCCESS ) )
+    {
+        return false;
+    }
+    if( flash_write_buffer( kv_store_page_addr( page ), ( uint8_t* ) &header, sizeof( header ) ) != sizeof( header ) )
+    {
+        return false;
+    }
+
+    kv_store.head          = page;
+    kv_store.head_sequence = header.sequence;
+    kv_store.write_addr    = kv_store_page_addr( page ) + sizeof( header );
+    kv_store.nb_free_pages--;
+    return true;
+}
+
+static bool kv_store_append( uint8_t key, const uint8_t* value, uint8_t length, bool use_spare_page )
+{
+    const uint32_t                 size = APPS_KV_STORE_RECORD_SIZE( length );
+    apps_kv_store_record_header_t* header;
+    uint64_t record[APPS_KV_STORE_RECORD_SIZE( APPS_KV_STORE_MAX_VALUE_SIZE ) / sizeof( uint64_t )];
+
+    if( ( kv_store.write_addr + size ) > ( kv_store_page_addr( kv_store.head ) + ADDR_FLASH_PAGE_SIZE ) )
+    {
+        // The spare page is kept for the compaction: make room by compacting the oldest pages
+        for( uint8_t i = 0; ( i < kv_store.nb_pages ) && ( use_spare_page == false ) &&
+                            ( kv_store.nb_free_pages <= 1 ) && ( kv_store.tail != kv_store.head );
+             i++ )
+        {
+            if( kv_store_compact_tail( ) == false )
+            {
+                return false;
+            }
+        }
+        // The compaction may have left room in the head page
+        if( ( kv_store.write_addr + size ) > ( kv_store_page_addr( kv_store.head ) + ADDR_FLASH_PAGE_SIZE ) )
+        {
+            if( ( use_spare_page == false ) && ( kv_store.nb_free_pages <= 1 ) )
+            {
+                HAL_DBG_TRACE_ERROR( "KV store: full\n" );
+                return false;
+            }
+            if( kv_store_open_next_page( ) == false )
+            {
+                return false;
+            }
+        }
+    }
+
+    memset( record, 0xFF, size );
+    header         = ( apps_kv_store_record_header_t* ) record;
+    header->key    = key;
+    header->length = length;
+    header->crc    = kv_store_crc( key, length, value );
+    if( length != 0 )
+    {
+        memcpy( header + 1, value, length );
+    }
+
+    if( flash_write_buffer( kv_store.write_addr, ( uint8_t* ) record, size ) != size )
+    {
+        // The record may be partially programmed and is followed by erased words ending the scan at boot: the rest of
+        // the page is not used anymore
+        kv_store.write_addr = kv_store_page_addr( kv_store.head ) + ADDR_FLASH_PAGE_SIZE;
+        return false;
+    }
+
+    kv_store.index[key] = ( length != 0 ) ? kv_store.write_addr : 0;
+    kv_store.write_addr += size;
+    return true;
+}
+
+static uint32_t kv_store_tail_live_size( void )
+{
+    const uint32_t page_end  = kv_store_page_addr( kv_store.tail ) + ADDR_FLASH_PAGE_SIZE;
+    uint32_t       live_size = 0;
+
+    for( uint8_t key = 0; key < APPS_KV_STORE_MAX_KEYS; key++ )
+    {
+        const uint32_t addr = kv_store.index[key];
+
+        if( ( addr >= kv_store_page_addr( kv_store.tail ) ) && ( addr < page_end ) )
+        {
+            live_size += APPS_KV_STORE_RECORD_SIZE( ( ( const apps_kv_store_record_header_t* ) addr )->length );
+        }
+    }
+    return live_size;
+}
+
+static bool kv_store_compact_tail( void )
+{
+    const uint32_t page_addr = kv_store_page_addr( kv_store.tail );
+
+    // Move the live records: the index points to the last record of each key
+    for( uint8_t key = 0; key < APPS_KV_STORE_MAX_KEYS; key++ )
+    {
+        const uint32_t addr = kv_store.index[key];
+
+        if( ( addr >= page_addr ) && ( addr < ( page_addr + ADDR_FLASH_PAGE_SIZE ) ) )
+        {
+            const apps_kv_store_record_header_t* header = ( const apps_kv_store_record_header_t* ) addr;
+
+            if( kv_store_append( key, ( const uint8_t* ) ( header + 1 ), header->length, true ) == false )
+            {
+                return false;
+            }
+        }
+    }
+
+    // The copies are written before the erase: after a reset in between, the newest copy wins
+    if( flash_erase_page( page_addr, 1 ) != SMTC_SUCCESS )
+    {
+        return false;
+    }
+    kv_store.tail = kv_store_next_page( kv_store.tail );
+    kv_store.nb_free_pages++;
+    return true;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,505 @@
+/*!
+ * @file      apps_link_quality.c
+ *
+ * @brief     Link quality monitor: downlink RSSI/SNR statistics, link checks and link health score
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include "apps_link_quality.h"
+#include "apps_airtime.h"
+#include "lr1121_modem_helper.h"
+#include "lr1121_modem_lorawan.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/**
+ * @brief Round a value in 1/16 units to the nearest integer
+ */
+#define LINK_QUALITY_Q4_ROUND( x ) ( ( int16_t ) ( ( ( x ) + ( ( ( x ) >= 0 ) ? 8 : -8 ) ) / 16 ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Demodulation floor of the SF7 downlinks in 0.25 dB, the floor being 2.5 dB lower at each higher SF
+ */
+#define LINK_QUALITY_SF7_FLOOR_QDB ( -30 )
+#define LINK_QUALITY_SF_STEP_QDB ( -10 )
+
+/**
+ * @brief Score added when several gateways answered the last link check
+ */
+#define LINK_QUALITY_MULTI_GATEWAY_BONUS 10
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Exponentially weighted statistics, in 1/16 units
+ */
+typedef struct link_quality_ewma_s
+{
+    uint32_t nb_downlinks;  //!< Downlinks added
+    int16_t  rssi_q4;       //!< RSSI in 1/16 dBm
+    int16_t  snr_q4;        //!< SNR in 1/64 dB
+} link_quality_ewma_t;
+
+/**
+ * @brief Downlink kept for the windowed statistics
+ */
+typedef struct link_quality_sample_s
+{
+    int16_t rssi_dbm;   //!< RSSI
+    int16_t snr_qdb;    //!< SNR in 0.25 dB
+    uint8_t window;     //!< lr1121_modem_downlink_window_t
+    uint8_t data_rate;  //!< Data rate
+} link_quality_sample_t;
+
+/**
+ * @brief Selection of the downlinks of a statistics request
+ */
+typedef enum link_quality_filter_e
+{
+    LINK_QUALITY_FILTER_ALL,
+    LINK_QUALITY_FILTER_WINDOW,
+    LINK_QUALITY_FILTER_DATA_RATE,
+} link_quality_filter_t;
+
+/**
+ * @brief Link quality context
+ */
+typedef struct link_quality_s
+{
+    link_quality_ewma_t   all;                                         //!< All the downlinks
+    link_quality_ewma_t   windows[APPS_LINK_QUALITY_NB_WINDOWS];       //!< Downlinks per window
+    link_quality_ewma_t   data_rates[APPS_LINK_QUALITY_NB_DATA_RATES];  //!< Downlinks per data rate
+    link_quality_sample_t samples[APPS_LINK_QUALITY_WINDOW_SIZE];      //!< Last downlinks, circular buffer
+    uint8_t               sample_index;                                //!< Index of the next sample
+    uint8_t               nb_samples;                                  //!< Samples in the buffer
+    uint32_t              nb_margins;             //!< Downlinks whose demodulation margin is known
+    int16_t               margin_q4;              //!< Exponentially weighted downlink margin in 1/64 dB
+    uint8_t               margin_data_rate;       //!< Data rate of the last downlink whose margin is known
+    bool                  link_check_valid;       //!< A link check answer was received
+    uint8_t               link_check_margin;      //!< Margin of the last link check answer
+    uint8_t               link_check_gateways;    //!< Gateways of the last link check answer
+    uint8_t               link_check_data_rate;   //!< Uplink data rate at the last link check answer
+    uint32_t              link_check_time_ms;     //!< Time of the last link check answer
+    bool                  link_check_requested;   //!< A link check was requested
+    uint32_t              link_check_request_ms;  //!< Time of the last link check request
+    uint16_t              nb_lost;                //!< Uplinks sent since the last downlink
+    uint32_t              lost_since_s;           //!< Time since the last downlink
+} link_quality_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static link_quality_t link_quality;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Add a downlink to exponentially weighted statistics
+ *
+ * @param [in] ewma Statistics
+ * @param [in] rssi_dbm RSSI
+ * @param [in] snr_qdb SNR in 0.25 dB
+ */
+static void link_quality_ewma_add( link_quality_ewma_t* ewma, int16_t rssi_dbm, int16_t snr_qdb );
+
+/**
+ * @brief Compute the link health from the link quality context
+ *
+ * @remark To be called in a critical section.
+ *
+ * @param [in] now_ms Current time
+ * @param [out] health Link health
+ */
+static void link_quality_compute_health( uint32_t now_ms, apps_link_quality_health_t* health );
+
+/**
+ * @brief Fill the statistics of a selection of downlinks
+ *
+ * @param [in] ewma Exponentially weighted statistics of the selection
+ * @param [in] filter Selection
+ * @param [in] key Window or data rate of the selection
+ * @param [out] stats Statistics
+ *
+ * @returns true if a downlink of the selection was received
+ */
+static bool link_quality_get_stats( const link_quality_ewma_t* ewma, link_quality_filter_t filter, uint8_t key,
+                                    apps_link_quality_stats_t* stats );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_link_quality_add_downlink( const lr1121_modem_downlink_metadata_t* metadata )
+{
+    lr1121_modem_radio_mod_params_lora_t mod_params;
+    const int16_t                        snr_qdb = ( int16_t ) metadata->snr_integer * 4 + metadata->snr_quarter;
+    const bool margin_known = apps_airtime_get_lora_params( metadata->datarate, &mod_params );
+    int16_t    margin_qdb   = 0;
+
+    if( margin_known == true )
+    {
+        const int16_t sf_steps = ( int16_t ) mod_params.sf - LR1121_MODEM_RADIO_LORA_SF7;
+
+        margin_qdb = snr_qdb - ( LINK_QUALITY_SF7_FLOOR_QDB + sf_steps * LINK_QUALITY_SF_STEP_QDB );
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    link_quality_ewma_add( &link_quality.all, metadata->rssi, snr_qdb );
+    if( metadata->window < APPS_LINK_QUALITY_NB_WINDOWS )
+    {
+        link_quality_ewma_add( &link_quality.windows[metadata->window], metadata->rssi, snr_qdb );
+    }
+    if( metadata->datarate < APPS_LINK_QUALITY_NB_DATA_RATES )
+    {
+        link_quality_ewma_add( &link_quality.data_rates[metadata->datarate], metadata->rssi, snr_qdb );
+    }
+
+    link_quality.samples[link_quality.sample_index] = ( link_quality_sample_t ){
+        .rssi_dbm  = metadata->rssi,
+        .snr_qdb   = snr_qdb,
+        .window    = ( uint8_t ) metadata->window,
+        .data_rate = metadata->datarate,
+    };
+    link_quality.sample_index = ( link_quality.sample_index + 1 ) % APPS_LINK_QUALITY_WINDOW_SIZE;
+    if( link_quality.nb_samples < APPS_LINK_QUALITY_WINDOW_SIZE )
+    {
+        link_quality.nb_samples++;
+    }
+
+    if( margin_known == true )
+    {
+        if( link_quality.nb_margins == 0 )
+        {
+            link_quality.margin_q4 = margin_qdb * 16;
+        }
+        else
+        {
+            link_quality.margin_q4 +=
+                ( margin_qdb * 16 - link_quality.margin_q4 ) / ( 1 << APPS_LINK_QUALITY_EWMA_SHIFT );
+        }
+        link_quality.margin_data_rate = metadata->datarate;
+        link_quality.nb_margins++;
+    }
+
+    // The modem resets its lost connection counter on the downlinks answering the uplinks
+    if( ( metadata->window == LR1121_MODEM_DOWNLINK_WINDOW_RX1 ) ||
+        ( metadata->window == LR1121_MODEM_DOWNLINK_WINDOW_RX2 ) )
+    {
+        link_quality.nb_lost      = 0;
+        link_quality.lost_since_s = 0;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void apps_link_quality_on_link_check( const void* context, uint8_t status )
+{
+    const uint8_t data_rate     = apps_airtime_get_data_rate( );
+    uint8_t       margin        = 0;
+    uint8_t       gateway_count = 0;
+
+    if( status != LR1121_MODEM_LINK_CHECK_RECEIVED )
+    {
+        HAL_DBG_TRACE_WARNING( "Link check not answered\n" );
+        return;
+    }
+    if( lr1121_modem_get_link_check_data( context, &margin, &gateway_count ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "Link check data read failed\n" );
+        return;
+    }
+    HAL_DBG_TRACE_INFO( "Link check: margin %u dB, %u gateway(s)\n", margin, gateway_count );
+
+    CRITICAL_SECTION_BEGIN( );
+    link_quality.link_check_valid     = true;
+    link_quality.link_check_margin    = margin;
+    link_quality.link_check_gateways  = gateway_count;
+    link_quality.link_check_data_rate = data_rate;
+    link_quality.link_check_time_ms   = hal_rtc_get_time_ms( );
+    CRITICAL_SECTION_END( );
+}
+
+void apps_link_quality_read_lost_connection( const void* context )
+{
+    uint16_t nb_lost      = 0;
+    uint32_t lost_since_s = 0;
+
+    if( lr1121_modem_get_lost_connection_counter( context, &nb_lost, &lost_since_s ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    link_quality.nb_lost      = nb_lost;
+    link_quality.lost_since_s = lost_since_s;
+    CRITICAL_SECTION_END( );
+}
+
+void apps_link_quality_get_health( apps_link_quality_health_t* health )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+
+    CRITICAL_SECTION_BEGIN( );
+    link_quality_compute_health( now_ms, health );
+    CRITICAL_SECTION_END( );
+}
+
+bool apps_link_quality_is_link_check_due( void )
+{
+    const uint32_t             now_ms = hal_rtc_get_time_ms( );
+    apps_link_quality_health_t health;
+    bool                       due = false;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( ( link_quality.link_check_requested == false ) ||
+        ( ( now_ms - link_quality.link_check_request_ms ) >= APPS_LINK_QUALITY_LINK_CHECK_MIN_INTERVAL_MS ) )
+    {
+        link_quality_compute_health( now_ms, &health );
+        due = ( link_quality.link_check_valid == false ) ||
+              ( ( now_ms - link_quality.link_check_time_ms ) >= APPS_LINK_QUALITY_LINK_CHECK_PERIOD_MS ) ||
+              ( health.level == APPS_LINK_QUALITY_LEVEL_POOR ) ||
+              ( link_quality.nb_lost >= APPS_LINK_QUALITY_LINK_CHECK_LOST );
+    }
+    CRITICAL_SECTION_END( );
+
+    return due;
+}
+
+void apps_link_quality_on_link_check_requested( void )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+
+    CRITICAL_SECTION_BEGIN( );
+    link_quality.link_check_requested  = true;
+    link_quality.link_check_request_ms = now_ms;
+    CRITICAL_SECTION_END( );
+}
+
+bool apps_link_quality_get_window_stats( lr1121_modem_downlink_window_t window, apps_link_quality_stats_t* stats )
+{
+    if( window >= APPS_LINK_QUALITY_NB_WINDOWS )
+    {
+        return false;
+    }
+    return link_quality_get_stats( &link_quality.windows[window], LINK_QUALITY_FILTER_WINDOW, ( uint8_t ) window,
+                                   stats );
+}
+
+bool apps_link_quality_get_data_rate_stats( uint8_t data_rate, apps_link_quality_stats_t* stats )
+{
+    if( data_rate >= APPS_LINK_QUALITY_NB_DATA_RATES )
+    {
+        return false;
+    }
+    return link_quality_get_stats( &link_quality.data_rates[data_rate], LINK_QUALITY_FILTER_DATA_RATE, data_rate,
+                                   stats );
+}
+
+bool apps_link_quality_get_stats( apps_link_quality_stats_t* stats )
+{
+    return link_quality_get_stats( &link_quality.all, LINK_QUALITY_FILTER_ALL, 0, stats );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void link_quality_ewma_add( link_quality_ewma_t* ewma, int16_t rssi_dbm, int16_t snr_qdb )
+{
+    if( ewma->nb_downlinks == 0 )
+    {
+        ewma->rssi_q4 = rssi_dbm * 16;
+        ewma->snr_q4  = snr_qdb * 16;
+    }
+    else
+    {
+        ewma->rssi_q4 += ( rssi_dbm * 16 - ewma->rssi_q4 ) / ( 1 << APPS_LINK_QUALITY_EWMA_SHIFT );
+        ewma->snr_q4 += ( snr_qdb * 16 - ewma->snr_q4 ) / ( 1 << APPS_LINK_QUALITY_EWMA_SHIFT );
+    }
+    ewma->nb_downlinks++;
+}
+
+static void link_quality_compute_health( uint32_t now_ms, apps_link_quality_health_t* health )
+{
+    const bool link_check_fresh =
+        ( link_quality.link_check_valid == true ) &&
+        ( ( now_ms - link_quality.link_check_time_ms ) < APPS_LINK_QUALITY_LINK_CHECK_PERIOD_MS );
+    int16_t  margin_db = 0;
+    uint16_t score     = APPS_LINK_QUALITY_UNKNOWN_SCORE;
+
+    health->gateway_count = ( link_quality.link_check_valid == true ) ? link_quality.link_check_gateways : 0;
+    health->nb_lost       = link_quality.nb_lost;
+    health->lost_since_s  = link_quality.lost_since_s;
+
+    if( link_check_fresh == true )
+    {
+        margin_db                = link_quality.link_check_margin;
+        health->margin_data_rate = link_quality.link_check_data_rate;
+        if( margin_db > INT8_MAX )
+        {
+            margin_db = INT8_MAX;
+        }
+    }
+    else if( link_quality.nb_margins > 0 )
+    {
+        margin_db                = LINK_QUALITY_Q4_ROUND( link_quality.margin_q4 ) / 4;
+        health->margin_data_rate = link_quality.margin_data_rate;
+    }
+    else
+    {
+        health->score     = APPS_LINK_QUALITY_UNKNOWN_SCORE;
+        health->level     = APPS_LINK_QUALITY_LEVEL_UNKNOWN;
+        health->margin_db        = 0;
+        health->margin_data_rate = APPS_AIRTIME_UNKNOWN_DATA_RATE;
+        return;
+    }
+
+    if( margin_db <= 0 )
+    {
+        score = 0;
+    }
+    else if( margin_db >= APPS_LINK_QUALITY_GOOD_MARGIN_DB )
+    {
+        score = 100;
+    }
+    else
+    {
+        score = ( uint16_t ) margin_db * 100 / APPS_LINK_QUALITY_GOOD_MARGIN_DB;
+    }
+    if( ( link_check_fresh == true ) && ( link_quality.link_check_gateways > 1 ) )
+    {
+        score += LINK_QUALITY_MULTI_GATEWAY_BONUS;
+        if( score > 100 )
+        {
+            score = 100;
+        }
+    }
+    score -= score *
+             ( ( link_quality.nb_lost < APPS_LINK_QUALITY_MAX_LOST ) ? link_quality.nb_lost
+                                                                     : APPS_LINK_QUALITY_MAX_LOST ) /
+             ( 2 * APPS_LINK_QUALITY_MAX_LOST );
+
+    health->score     = ( uint8_t ) score;
+    health->margin_db = ( int8_t ) margin_db;
+    if( score >= APPS_LINK_QUALITY_GOOD_SCORE )
+    {
+        health->level = APPS_LINK_QUALITY_LEVEL_GOOD;
+    }
+    else if( score >= APPS_LINK_QUALITY_FAIR_SCORE )
+    {
+        health->level = APPS_LINK_QUALITY_LEVEL_FAIR;
+    }
+    else
+    {
+        health->level = APPS_LINK_QUALITY_LEVEL_POOR;
+    }
+}
+
+static bool link_quality_get_stats( const link_quality_ewma_t* ewma, link_quality_filter_t filter, uint8_t key,
+                                    apps_link_quality_stats_t* stats )
+{
+    int32_t rssi_sum = 0;
+    int32_t snr_sum  = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    stats->nb_downlinks = ewma->nb_downlinks;
+    stats->rssi_dbm     = LINK_QUALITY_Q4_ROUND( ewma->rssi_q4 );
+    stats->snr_qdb      = LINK_QUALITY_Q4_ROUND( ewma->snr_q4 );
+    stats->nb_window    = 0;
+    stats->rssi_min_dbm = INT16_MAX;
+    stats->snr_min_qdb  = INT16_MAX;
+    for( uint8_t i = 0; i < link_quality.nb_samples; i++ )
+    {
+        const link_quality_sample_t* sample = &link_quality.samples[i];
+
+        if( ( ( filter == LINK_QUALITY_FILTER_WINDOW ) && ( sample->window != key ) ) ||
+            ( ( filter == LINK_QUALITY_FILTER_DATA_RATE ) && ( sample->data_rate != key ) ) )
+        {
+            continue;
+        }
+        stats->nb_window++;
+        rssi_sum += sample->rssi_dbm;
+        snr_sum += sample->snr_qdb;
+        if( sample->rssi_dbm < stats->rssi_min_dbm )
+        {
+            stats->rssi_min_dbm = sample->rssi_dbm;
+        }
+        if( sample->snr_qdb < stats->snr_min_qdb )
+        {
+            stats->snr_min_qdb = sample->snr_qdb;
+        }
+    }
+    CRITICAL_SECTION_END( );
+
+    if( stats->nb_window > 0 )
+    {
+        stats->rssi_avg_dbm = ( int16_t ) ( rssi_sum / stats->nb_window );
+        stats->snr_avg_qdb  = ( int16_t ) ( snr_sum / stats->nb_window );
+    }
+    else
+    {
+        stats->rssi_avg_dbm = 0;
+        stats->rssi_min_dbm = 0;
+        stats->snr_avg_qdb  = 0;
+        stats->snr_min_qdb  = 0;
+    }
+    return stats->nb_downlinks > 0;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
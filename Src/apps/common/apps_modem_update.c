@@ -0,0 +1,330 @@
+/*!
+ * @file      apps_modem_update.c
+ *
+ * @brief     LR1121 Modem-E firmware update from an image staged in the MCU flash
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "apps_modem_update.h"
+#include "apps_kv_store.h"
+#include "lr1121_bootloader.h"
+#include "lr1121_modem_hal.h"
+#include "lr1121_modem_modem.h"
+#include "smtc_hal_crc.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_watchdog.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+#define MODEM_UPDATE_MIN( a, b ) ( ( ( a ) < ( b ) ) ? ( a ) : ( b ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Number of words of a chunk written by the bootloader, the last one of the image being shorter
+ */
+#define MODEM_UPDATE_CHUNK_NB_WORDS 64
+
+/**
+ * @brief Delay between two version requests while the new firmware boots
+ */
+#define MODEM_UPDATE_BOOT_POLL_PERIOD_MS 100
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Update in progress, as stored in the key-value store
+ */
+typedef struct modem_update_record_s
+{
+    apps_modem_update_image_t image;     //!< Image being written
+    uint8_t                   attempts;  //!< Number of attempts started
+    uint8_t                   reserved[3];
+} modem_update_record_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint8_t modem_update_kv_key = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Read the update record from the key-value store
+ *
+ * @param [out] record Update record
+ *
+ * @returns true if an update is in progress
+ */
+static bool modem_update_load( modem_update_record_t* record );
+
+/**
+ * @brief Run one update attempt: enter the bootloader, erase, write the image, reboot and check the version
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] image Image staged in the MCU flash
+ * @param [out] info Information on the attempt
+ *
+ * @returns Update status
+ */
+static apps_modem_update_status_t modem_update_attempt( const void* context, const apps_modem_update_image_t* image,
+                                                        apps_modem_update_info_t* info );
+
+/**
+ * @brief Wait for the new firmware to answer and check its version
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] image Image staged in the MCU flash
+ * @param [out] info Information on the attempt
+ *
+ * @returns Update status
+ */
+static apps_modem_update_status_t modem_update_check_version( const void*                      context,
+                                                              const apps_modem_update_image_t* image,
+                                                              apps_modem_update_info_t*        info );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_modem_update_init( uint8_t kv_key ) { modem_update_kv_key = kv_key; }
+
+bool apps_modem_update_is_pending( apps_modem_update_image_t* image )
+{
+    modem_update_record_t record;
+
+    if( modem_update_load( &record ) == false )
+    {
+        return false;
+    }
+    *image = record.image;
+    return true;
+}
+
+apps_modem_update_status_t apps_modem_update_run( const void* context, const apps_modem_update_image_t* image,
+                                                  apps_modem_update_info_t* info )
+{
+    // Attempts interrupted by MCU resets count: the update is given up once they are exhausted
+    apps_modem_update_status_t status = APPS_MODEM_UPDATE_STATUS_WRITE_ERROR;
+    apps_modem_update_info_t   update_info;
+    modem_update_record_t      record;
+
+    memset( &update_info, 0, sizeof( update_info ) );
+
+    if( ( image->size == 0 ) || ( ( image->size % sizeof( uint32_t ) ) != 0 ) ||
+        ( ( image->address % sizeof( uint32_t ) ) != 0 ) )
+    {
+        return APPS_MODEM_UPDATE_STATUS_INVALID_PARAM;
+    }
+
+    // Never erase the modem for an image that cannot be written entirely
+    if( hal_crc32_update( HAL_CRC32_INIT_VALUE, ( const uint8_t* ) image->address, image->size ) != image->crc )
+    {
+        return APPS_MODEM_UPDATE_STATUS_CRC_ERROR;
+    }
+
+    if( ( modem_update_load( &record ) == false ) || ( memcmp( &record.image, image, sizeof( *image ) ) != 0 ) )
+    {
+        memset( &record, 0, sizeof( record ) );
+        record.image = *image;
+    }
+
+    // The modem events are processed once the new firmware runs, its reset event included
+    hal_gpio_irq_disable( );
+
+    while( record.attempts < APPS_MODEM_UPDATE_MAX_ATTEMPTS )
+    {
+        record.attempts++;
+        if( apps_kv_store_write( modem_update_kv_key, &record, sizeof( record ) ) == false )
+        {
+            status = APPS_MODEM_UPDATE_STATUS_FLASH_ERROR;
+            break;
+        }
+
+        update_info.attempt = record.attempts;
+        status              = modem_update_attempt( context, image, &update_info );
+        HAL_DBG_TRACE_INFO( "Modem update: attempt %u, erase %lu ms, write %lu ms (%lu B/s), total %lu ms, status %u\n",
+                            update_info.attempt, update_info.erase_ms, update_info.write_ms,
+                            update_info.throughput_bps, update_info.duration_ms, status );
+        if( status == APPS_MODEM_UPDATE_STATUS_OK )
+        {
+            break;
+        }
+    }
+
+    if( status != APPS_MODEM_UPDATE_STATUS_FLASH_ERROR )
+    {
+        apps_kv_store_delete( modem_update_kv_key );
+    }
+
+    hal_gpio_irq_enable( );
+
+    if( status == APPS_MODEM_UPDATE_STATUS_OK )
+    {
+        HAL_DBG_TRACE_INFO( "Modem update: Modem-E %u.%u.%u, LoRa Basics Modem %u.%u.%u\n",
+                            update_info.modem.modem_major, update_info.modem.modem_minor, update_info.modem.modem_patch,
+                            update_info.modem.lbm_major, update_info.modem.lbm_minor, update_info.modem.lbm_patch );
+    }
+
+    if( info != NULL )
+    {
+        *info = update_info;
+    }
+    return status;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool modem_update_load( modem_update_record_t* record )
+{
+    uint8_t length = 0;
+
+    return ( apps_kv_store_read( modem_update_kv_key, record, sizeof( *record ), &length ) == true ) &&
+           ( length == sizeof( *record ) );
+}
+
+static apps_modem_update_status_t modem_update_attempt( const void* context, const apps_modem_update_image_t* image,
+                                                        apps_modem_update_info_t* info )
+{
+    const uint32_t*              words    = ( const uint32_t* ) image->address;
+    const uint32_t               nb_words = image->size / sizeof( uint32_t );
+    const uint32_t               start_ms = hal_rtc_get_time_ms( );
+    uint32_t                     step_ms  = 0;
+    apps_modem_update_status_t   status;
+    lr1121_bootloader_stat1_t    stat1;
+    lr1121_bootloader_stat2_t    stat2;
+    lr1121_bootloader_irq_mask_t irq_status;
+
+    info->erase_ms       = 0;
+    info->write_ms       = 0;
+    info->throughput_bps = 0;
+
+    lr1121_modem_hal_enter_dfu( context );
+    if( ( lr1121_bootloader_get_status( context, &stat1, &stat2, &irq_status ) != LR1121_STATUS_OK ) ||
+        ( stat2.is_running_from_flash == true ) ||
+        ( lr1121_bootloader_get_version( context, &info->bootloader ) != LR1121_STATUS_OK ) ||
+        ( info->bootloader.type != APPS_MODEM_UPDATE_BOOTLOADER_TYPE ) )
+    {
+        info->duration_ms = hal_rtc_get_time_ms( ) - start_ms;
+        return APPS_MODEM_UPDATE_STATUS_BOOTLOADER_ERROR;
+    }
+
+    step_ms = hal_rtc_get_time_ms( );
+    if( lr1121_bootloader_erase_flash( context ) != LR1121_STATUS_OK )
+    {
+        info->duration_ms = hal_rtc_get_time_ms( ) - start_ms;
+        return APPS_MODEM_UPDATE_STATUS_ERASE_ERROR;
+    }
+    info->erase_ms = hal_rtc_get_time_ms( ) - step_ms;
+    hal_watchdog_reload( );
+
+    // The words are read in place from the MCU flash: each chunk is only swapped to big endian by the driver
+    step_ms = hal_rtc_get_time_ms( );
+    for( uint32_t index = 0; index < nb_words; index += MODEM_UPDATE_CHUNK_NB_WORDS )
+    {
+        const uint8_t length = ( uint8_t ) MODEM_UPDATE_MIN( nb_words - index, MODEM_UPDATE_CHUNK_NB_WORDS );
+
+        if( lr1121_bootloader_write_flash_encrypted( context, index * sizeof( uint32_t ), words + index, length ) !=
+            LR1121_STATUS_OK )
+        {
+            info->duration_ms = hal_rtc_get_time_ms( ) - start_ms;
+            return APPS_MODEM_UPDATE_STATUS_WRITE_ERROR;
+        }
+        hal_watchdog_reload( );
+    }
+    info->write_ms       = hal_rtc_get_time_ms( ) - step_ms;
+    if( info->write_ms > 0 )
+    {
+        info->throughput_bps = ( uint32_t ) ( ( ( uint64_t ) image->size * 1000 ) / info->write_ms );
+    }
+
+    // The chip answers the reboot command from the new firmware: its status is meaningless
+    lr1121_bootloader_reboot( context, false );
+
+    status            = modem_update_check_version( context, image, info );
+    info->duration_ms = hal_rtc_get_time_ms( ) - start_ms;
+    return status;
+}
+
+static apps_modem_update_status_t modem_update_check_version( const void*                      context,
+                                                              const apps_modem_update_image_t* image,
+                                                              apps_modem_update_info_t*        info )
+{
+    const uint32_t start_ms = hal_rtc_get_time_ms( );
+
+    while( lr1121_modem_get_modem_version( context, &info->modem ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        if( ( hal_rtc_get_time_ms( ) - start_ms ) > APPS_MODEM_UPDATE_BOOT_TIMEOUT_MS )
+        {
+            return APPS_MODEM_UPDATE_STATUS_VERSION_ERROR;
+        }
+        hal_mcu_wait_us( MODEM_UPDATE_BOOT_POLL_PERIOD_MS * 1000 );
+    }
+
+    if( ( image->version != 0 ) &&
+        ( APPS_MODEM_UPDATE_VERSION( info->modem.modem_major, info->modem.modem_minor, info->modem.modem_patch ) !=
+          image->version ) )
+    {
+        return APPS_MODEM_UPDATE_STATUS_VERSION_ERROR;
+    }
+    return APPS_MODEM_UPDATE_STATUS_OK;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,824 @@
+/*!
+ * @file      apps_multicast_session.c
+ *
+ * @brief     Multicast groups provisioned at runtime, with scheduled sessions
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "apps_multicast_session.h"
+#include "apps_kv_store.h"
+#include "lr1121_modem_lorawan.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Size of the parameters of the provisioning commands
+ */
+#define MULTICAST_SESSION_GROUP_SETUP_SIZE 37
+#define MULTICAST_SESSION_GROUP_DELETE_SIZE 1
+#define MULTICAST_SESSION_SESSION_SETUP_SIZE 16
+
+/**
+ * @brief Group of the modem not running any session
+ */
+#define MULTICAST_SESSION_NO_GROUP APPS_MULTICAST_SESSION_MAX_GROUPS
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Multicast group
+ */
+typedef struct multicast_session_entry_s
+{
+    apps_multicast_session_group_t config;   //!< Configuration and session
+    apps_multicast_session_state_t state;    //!< State
+    bool                           changed;  //!< Set up again or deleted while its session runs
+} multicast_session_entry_t;
+
+/**
+ * @brief Multicast session manager context
+ */
+typedef struct multicast_session_s
+{
+    uint8_t                   first_kv_key;                                          //!< Key of the first group
+    multicast_session_entry_t groups[APPS_MULTICAST_SESSION_MAX_GROUPS];             //!< Provisioned groups
+    uint8_t                   modem_groups[APPS_MULTICAST_SESSION_NB_MODEM_GROUPS];  //!< Group of each modem group
+    lr1121_modem_classes_t    device_class;                                          //!< Class set in the modem
+    volatile bool             joined;                                                //!< The device joined
+    volatile bool             modem_reset;                                           //!< Modem reset not handled yet
+    bool                      time_known;                                            //!< The network time is known
+    uint32_t                  time_s;                                                //!< Network time at time_ms
+    uint32_t                  time_ms;                                               //!< RTC time of the network time
+    bool                      time_requested;                                        //!< A network time was requested
+    uint32_t                  time_request_ms;                                       //!< Time of the last request
+} multicast_session_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static multicast_session_t multicast_session = {
+    .modem_groups = { MULTICAST_SESSION_NO_GROUP, MULTICAST_SESSION_NO_GROUP, MULTICAST_SESSION_NO_GROUP,
+                      MULTICAST_SESSION_NO_GROUP },
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Read a 32-bit little endian value
+ *
+ * @param [in] buffer Value
+ *
+ * @returns Value
+ */
+static uint32_t multicast_session_read_u32( const uint8_t* buffer );
+
+/**
+ * @brief Get the end of the window of a session
+ *
+ * @param [in] group Group whose session is set up
+ *
+ * @returns End time in GPS seconds, UINT32_MAX if the session has no end
+ */
+static uint32_t multicast_session_get_end_s( const apps_multicast_session_group_t* group );
+
+/**
+ * @brief Tell if a time falls in the window of a session
+ *
+ * @param [in] group Group whose session is set up
+ * @param [in] time_s Time in GPS seconds
+ *
+ * @returns true if @p time_s is in the window
+ */
+static bool multicast_session_is_in_window( const apps_multicast_session_group_t* group, uint32_t time_s );
+
+/**
+ * @brief Check that a session fits with the other sessions
+ *
+ * @param [in] group_id Group of the session
+ * @param [in] group Group whose session is set up
+ *
+ * @returns APPS_MULTICAST_SESSION_STATUS_OK if the session can be scheduled
+ */
+static apps_multicast_session_status_t multicast_session_check( uint8_t                               group_id,
+                                                                const apps_multicast_session_group_t* group );
+
+/**
+ * @brief Get the network time
+ *
+ * @param [out] time_s Network time in GPS seconds
+ * @param [out] elapsed_ms Time since the network time was received
+ *
+ * @returns true if the network time is known
+ */
+static bool multicast_session_get_time( uint32_t* time_s, uint32_t* elapsed_ms );
+
+/**
+ * @brief Forget the running sessions and the network time after a modem reset
+ */
+static void multicast_session_handle_modem_reset( void );
+
+/**
+ * @brief Request the network time if a session waits for it
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] now_ms RTC time
+ *
+ * @returns Time in ms before the next request
+ */
+static uint32_t multicast_session_request_time( const void* context, uint32_t now_ms );
+
+/**
+ * @brief Start the session of a group in a free group of the modem
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] group_id Group
+ *
+ * @returns true if the session is started
+ */
+static bool multicast_session_start( const void* context, uint8_t group_id );
+
+/**
+ * @brief Stop the session running in a group of the modem
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] modem_group Group of the modem
+ */
+static void multicast_session_stop( const void* context, uint8_t modem_group );
+
+/**
+ * @brief Switch the device class
+ *
+ * @param [in] context Chip implementation context
+ * @param [in] device_class Device class
+ *
+ * @returns true if the device class is set
+ */
+static bool multicast_session_set_class( const void* context, lr1121_modem_classes_t device_class );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+uint8_t apps_multicast_session_init( uint8_t first_kv_key )
+{
+    uint8_t nb_groups = 0;
+
+    multicast_session.first_kv_key = first_kv_key;
+    for( uint8_t group_id = 0; group_id < APPS_MULTICAST_SESSION_MAX_GROUPS; group_id++ )
+    {
+        multicast_session_entry_t* entry = &multicast_session.groups[group_id];
+        uint8_t                    length;
+
+        entry->state   = APPS_MULTICAST_SESSION_STATE_NONE;
+        entry->changed = false;
+        if( ( apps_kv_store_read( first_kv_key + group_id, &entry->config, sizeof( entry->config ), &length ) ==
+              true ) &&
+            ( length == sizeof( entry->config ) ) )
+        {
+            entry->state = ( entry->config.has_session == true ) ? APPS_MULTICAST_SESSION_STATE_SCHEDULED
+                                                                 : APPS_MULTICAST_SESSION_STATE_IDLE;
+            nb_groups++;
+        }
+    }
+    HAL_DBG_TRACE_INFO( "Multicast: %u groups provisioned\n", nb_groups );
+    return nb_groups;
+}
+
+apps_multicast_session_status_t apps_multicast_session_provision( uint8_t                               group_id,
+                                                                  const apps_multicast_session_group_t* group )
+{
+    multicast_session_entry_t*      entry;
+    apps_multicast_session_status_t status;
+
+    if( group_id >= APPS_MULTICAST_SESSION_MAX_GROUPS )
+    {
+        return APPS_MULTICAST_SESSION_STATUS_INVALID_PARAM;
+    }
+    if( group->has_session == true )
+    {
+        if( ( ( group->session_class != LR1121_LORAWAN_CLASS_B ) &&
+              ( group->session_class != LR1121_LORAWAN_CLASS_C ) ) ||
+            ( group->ping_slot > LR1121_MODEM_CLASS_B_PING_SLOT_128_S ) ||
+            ( ( group->start_s == APPS_MULTICAST_SESSION_START_NOW ) &&
+              ( group->duration_s != APPS_MULTICAST_SESSION_NO_END ) ) )
+        {
+            return APPS_MULTICAST_SESSION_STATUS_INVALID_PARAM;
+        }
+        status = multicast_session_check( group_id, group );
+        if( status != APPS_MULTICAST_SESSION_STATUS_OK )
+        {
+            return status;
+        }
+    }
+
+    if( apps_kv_store_write( multicast_session.first_kv_key + group_id, group, sizeof( *group ) ) == false )
+    {
+        return APPS_MULTICAST_SESSION_STATUS_FLASH_ERROR;
+    }
+
+    entry = &multicast_session.groups[group_id];
+    if( entry->state == APPS_MULTICAST_SESSION_STATE_RUNNING )
+    {
+        // Stopped by the next process, then started again with the new configuration
+        entry->changed = true;
+    }
+    entry->config = *group;
+    entry->state =
+        ( group->has_session == true ) ? APPS_MULTICAST_SESSION_STATE_SCHEDULED : APPS_MULTICAST_SESSION_STATE_IDLE;
+    return APPS_MULTICAST_SESSION_STATUS_OK;
+}
+
+uint8_t apps_multicast_session_on_downlink( const uint8_t* payload, uint8_t size, uint8_t* answer )
+{
+    uint8_t index       = 0;
+    uint8_t answer_size = 0;
+
+    while( ( index < size ) &&
+           ( answer_size < ( APPS_MULTICAST_SESSION_ANSWER_SIZE * APPS_MULTICAST_SESSION_MAX_COMMANDS ) ) )
+    {
+        const uint8_t                   command = payload[index++];
+        const uint8_t*                  params  = &payload[index];
+        apps_multicast_session_status_t status  = APPS_MULTICAST_SESSION_STATUS_UNKNOWN_COMMAND;
+        uint8_t                         length  = 0;
+
+        switch( command )
+        {
+        case APPS_MULTICAST_SESSION_CMD_GROUP_SETUP:
+            length = MULTICAST_SESSION_GROUP_SETUP_SIZE;
+            break;
+        case APPS_MULTICAST_SESSION_CMD_GROUP_DELETE:
+            length = MULTICAST_SESSION_GROUP_DELETE_SIZE;
+            break;
+        case APPS_MULTICAST_SESSION_CMD_SESSION_SETUP:
+            length = MULTICAST_SESSION_SESSION_SETUP_SIZE;
+            break;
+        default:
+            break;
+        }
+
+        answer[answer_size++] = command;
+        answer[answer_size++] = ( ( length != 0 ) && ( index < size ) ) ? params[0] : 0;
+        if( ( length == 0 ) || ( ( size - index ) < length ) )
+        {
+            answer[answer_size++] = APPS_MULTICAST_SESSION_STATUS_UNKNOWN_COMMAND;
+            break;
+        }
+        index += length;
+
+        const uint8_t              group_id = params[0];
+        multicast_session_entry_t* entry =
+            ( group_id < APPS_MULTICAST_SESSION_MAX_GROUPS ) ? &multicast_session.groups[group_id] : NULL;
+        apps_multicast_session_group_t group = { 0 };
+
+        if( entry == NULL )
+        {
+            status = APPS_MULTICAST_SESSION_STATUS_INVALID_PARAM;
+        }
+        else if( command == APPS_MULTICAST_SESSION_CMD_GROUP_SETUP )
+        {
+            // A group set up again loses its session, set up by a following command
+            group.address = multicast_session_read_u32( &params[1] );
+            memcpy( group.nwk_skey, &params[5], sizeof( group.nwk_skey ) );
+            memcpy( group.app_skey, &params[21], sizeof( group.app_skey ) );
+            status = apps_multicast_session_provision( group_id, &group );
+        }
+        else if( entry->state == APPS_MULTICAST_SESSION_STATE_NONE )
+        {
+            status = APPS_MULTICAST_SESSION_STATUS_UNKNOWN_GROUP;
+        }
+        else if( command == APPS_MULTICAST_SESSION_CMD_GROUP_DELETE )
+        {
+            status = APPS_MULTICAST_SESSION_STATUS_FLASH_ERROR;
+            if( apps_kv_store_delete( multicast_session.first_kv_key + group_id ) == true )
+            {
+                entry->changed = ( entry->state == APPS_MULTICAST_SESSION_STATE_RUNNING );
+                entry->state   = APPS_MULTICAST_SESSION_STATE_NONE;
+                status         = APPS_MULTICAST_SESSION_STATUS_OK;
+            }
+        }
+        else
+        {
+            group               = entry->config;
+            group.has_session   = true;
+            group.session_class = ( lr1121_modem_classes_t ) params[1];
+            group.frequency     = multicast_session_read_u32( &params[2] );
+            group.data_rate     = params[6];
+            group.ping_slot     = ( lr1121_modem_class_b_ping_slot_t ) params[7];
+            group.start_s       = multicast_session_read_u32( &params[8] );
+            group.duration_s    = multicast_session_read_u32( &params[12] );
+            status              = apps_multicast_session_provision( group_id, &group );
+        }
+
+        answer[answer_size++] = status;
+        HAL_DBG_TRACE_INFO( "Multicast: command 0x%02x on group %u, status %u\n", command, group_id, status );
+    }
+    return answer_size;
+}
+
+void apps_multicast_session_on_joined( void )
+{
+    multicast_session.joined = true;
+}
+
+void apps_multicast_session_on_modem_reset( void )
+{
+    multicast_session.joined      = false;
+    multicast_session.modem_reset = true;
+}
+
+void apps_multicast_session_on_mac_time( const void* context )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+    uint32_t       time_s;
+    uint32_t       fraction;
+
+    if( lr1121_modem_get_lorawan_mac_time( context, &time_s, &fraction ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    multicast_session.time_known = true;
+    multicast_session.time_s     = time_s;
+    multicast_session.time_ms    = now_ms;
+    CRITICAL_SECTION_END( );
+
+    HAL_DBG_TRACE_INFO( "Multicast: network time %lu s\n", time_s );
+}
+
+uint32_t apps_multicast_session_process( const void* context )
+{
+    const uint32_t now_ms   = hal_rtc_get_time_ms( );
+    uint32_t       sleep_ms = APPS_MULTICAST_SESSION_IDLE;
+    uint32_t       time_s   = 0;
+    uint32_t       elapsed_ms;
+    bool           time_known;
+    bool           running = false;
+
+    if( multicast_session.modem_reset == true )
+    {
+        multicast_session_handle_modem_reset( );
+    }
+    if( multicast_session.joined == false )
+    {
+        return APPS_MULTICAST_SESSION_IDLE;
+    }
+    sleep_ms   = multicast_session_request_time( context, now_ms );
+    time_known = multicast_session_get_time( &time_s, &elapsed_ms );
+
+    // Stop the sessions whose window closed, or whose group was set up again or deleted
+    for( uint8_t modem_group = 0; modem_group < APPS_MULTICAST_SESSION_NB_MODEM_GROUPS; modem_group++ )
+    {
+        const uint8_t group_id = multicast_session.modem_groups[modem_group];
+
+        if( group_id == MULTICAST_SESSION_NO_GROUP )
+        {
+            continue;
+        }
+
+        multicast_session_entry_t* entry = &multicast_session.groups[group_id];
+
+        if( ( entry->changed == true ) || ( entry->state != APPS_MULTICAST_SESSION_STATE_RUNNING ) )
+        {
+            entry->changed = false;
+            multicast_session_stop( context, modem_group );
+        }
+        else if( ( time_known == true ) && ( entry->config.start_s != APPS_MULTICAST_SESSION_START_NOW ) &&
+                 ( time_s >= multicast_session_get_end_s( &entry->config ) ) )
+        {
+            entry->state = APPS_MULTICAST_SESSION_STATE_ENDED;
+            multicast_session_stop( context, modem_group );
+        }
+        else
+        {
+            running = true;
+        }
+    }
+
+    // Start the sessions whose window opened, and find the next window to open or close
+    for( uint8_t group_id = 0; group_id < APPS_MULTICAST_SESSION_MAX_GROUPS; group_id++ )
+    {
+        multicast_session_entry_t*            entry = &multicast_session.groups[group_id];
+        const apps_multicast_session_group_t* group = &entry->config;
+        uint32_t                              next_s;
+
+        entry->changed = false;
+        if( entry->state == APPS_MULTICAST_SESSION_STATE_SCHEDULED )
+        {
+            if( ( group->start_s == APPS_MULTICAST_SESSION_START_NOW ) ||
+                ( ( time_known == true ) && ( multicast_session_is_in_window( group, time_s ) == true ) ) )
+            {
+                if( multicast_session_start( context, group_id ) == true )
+                {
+                    entry->state = APPS_MULTICAST_SESSION_STATE_RUNNING;
+                }
+            }
+            else if( ( time_known == true ) && ( time_s >= multicast_session_get_end_s( group ) ) )
+            {
+                entry->state = APPS_MULTICAST_SESSION_STATE_ENDED;
+            }
+        }
+
+        if( entry->state == APPS_MULTICAST_SESSION_STATE_RUNNING )
+        {
+            running = true;
+        }
+        if( ( time_known == false ) || ( group->start_s == APPS_MULTICAST_SESSION_START_NOW ) )
+        {
+            continue;
+        }
+        if( entry->state == APPS_MULTICAST_SESSION_STATE_SCHEDULED )
+        {
+            next_s = group->start_s;
+        }
+        else if( entry->state == APPS_MULTICAST_SESSION_STATE_RUNNING )
+        {
+            next_s = multicast_session_get_end_s( group );
+        }
+        else
+        {
+            continue;
+        }
+        if( ( next_s > time_s ) && ( ( next_s - time_s ) < ( sleep_ms / 1000 ) ) )
+        {
+            // The network time is counted from its last second, the window edges being rounded to the next one
+            sleep_ms = ( next_s - time_s ) * 1000 - ( elapsed_ms % 1000 );
+        }
+    }
+
+    // Back to class A once the windows closed
+    if( ( running == false ) && ( multicast_session.device_class != LR1121_LORAWAN_CLASS_A ) )
+    {
+        multicast_session_set_class( context, LR1121_LORAWAN_CLASS_A );
+    }
+    return sleep_ms;
+}
+
+apps_multicast_session_state_t apps_multicast_session_get_group( uint8_t                         group_id,
+                                                                 apps_multicast_session_group_t* group,
+                                                                 uint8_t*                        modem_group )
+{
+    if( group_id >= APPS_MULTICAST_SESSION_MAX_GROUPS )
+    {
+        return APPS_MULTICAST_SESSION_STATE_NONE;
+    }
+    if( group != NULL )
+    {
+        *group = multicast_session.groups[group_id].config;
+    }
+    if( modem_group != NULL )
+    {
+        *modem_group = APPS_MULTICAST_SESSION_NB_MODEM_GROUPS;
+        for( uint8_t i = 0; i < APPS_MULTICAST_SESSION_NB_MODEM_GROUPS; i++ )
+        {
+            if( multicast_session.modem_groups[i] == group_id )
+            {
+                *modem_group = i;
+            }
+        }
+    }
+    return multicast_session.groups[group_id].state;
+}
+
+uint8_t apps_multicast_session_get_group_id( uint8_t modem_group )
+{
+    uint8_t group_id = MULTICAST_SESSION_NO_GROUP;
+
+    if( modem_group < APPS_MULTICAST_SESSION_NB_MODEM_GROUPS )
+    {
+        CRITICAL_SECTION_BEGIN( );
+        group_id = multicast_session.modem_groups[modem_group];
+        CRITICAL_SECTION_END( );
+    }
+    return group_id;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint32_t multicast_session_read_u32( const uint8_t* buffer )
+{
+    return ( uint32_t ) buffer[0] | ( ( uint32_t ) buffer[1] << 8 ) | ( ( uint32_t ) buffer[2] << 16 ) |
+           ( ( uint32_t ) buffer[3] << 24 );
+}
+
+static uint32_t multicast_session_get_end_s( const apps_multicast_session_group_t* group )
+{
+    if( ( group->duration_s == APPS_MULTICAST_SESSION_NO_END ) ||
+        ( group->duration_s > ( UINT32_MAX - group->start_s ) ) )
+    {
+        return UINT32_MAX;
+    }
+    return group->start_s + group->duration_s;
+}
+
+static bool multicast_session_is_in_window( const apps_multicast_session_group_t* group, uint32_t time_s )
+{
+    return ( time_s >= group->start_s ) && ( time_s < multicast_session_get_end_s( group ) );
+}
+
+static apps_multicast_session_status_t multicast_session_check( uint8_t                               group_id,
+                                                                const apps_multicast_session_group_t* group )
+{
+    const uint32_t end_s = multicast_session_get_end_s( group );
+
+    // Sessions of another class, or class C sessions on another channel, cannot overlap
+    for( uint8_t other_id = 0; other_id < APPS_MULTICAST_SESSION_MAX_GROUPS; other_id++ )
+    {
+        const multicast_session_entry_t* other = &multicast_session.groups[other_id];
+
+        if( ( other_id == group_id ) || ( ( other->state != APPS_MULTICAST_SESSION_STATE_SCHEDULED ) &&
+                                          ( other->state != APPS_MULTICAST_SESSION_STATE_RUNNING ) ) )
+        {
+            continue;
+        }
+        if( ( other->config.start_s >= end_s ) || ( group->start_s >= multicast_session_get_end_s( &other->config ) ) )
+        {
+            continue;
+        }
+        if( ( other->config.session_class != group->session_class ) ||
+            ( ( group->session_class == LR1121_LORAWAN_CLASS_C ) &&
+              ( ( other->config.frequency != group->frequency ) || ( other->config.data_rate != group->data_rate ) ) ) )
+        {
+            return APPS_MULTICAST_SESSION_STATUS_CLASS_CONFLICT;
+        }
+    }
+
+    // The most sessions at once are found at the start of one of the windows overlapping the new one
+    for( uint8_t point_id = 0; point_id < APPS_MULTICAST_SESSION_MAX_GROUPS; point_id++ )
+    {
+        const multicast_session_entry_t* point_entry = &multicast_session.groups[point_id];
+        const uint32_t point_s     = ( point_id == group_id ) ? group->start_s : point_entry->config.start_s;
+        uint8_t        nb_sessions = 1;
+
+        if( ( point_id != group_id ) &&
+            ( ( ( point_entry->state != APPS_MULTICAST_SESSION_STATE_SCHEDULED ) &&
+                ( point_entry->state != APPS_MULTICAST_SESSION_STATE_RUNNING ) ) ||
+              ( multicast_session_is_in_window( group, point_s ) == false ) ) )
+        {
+            continue;
+        }
+        for( uint8_t other_id = 0; other_id < APPS_MULTICAST_SESSION_MAX_GROUPS; other_id++ )
+        {
+            const multicast_session_entry_t* other = &multicast_session.groups[other_id];
+
+            if( ( other_id != group_id ) &&
+                ( ( other->state == APPS_MULTICAST_SESSION_STATE_SCHEDULED ) ||
+                  ( other->state == APPS_MULTICAST_SESSION_STATE_RUNNING ) ) &&
+                ( multicast_session_is_in_window( &other->config, point_s ) == true ) )
+            {
+                nb_sessions++;
+            }
+        }
+        if( nb_sessions > APPS_MULTICAST_SESSION_NB_MODEM_GROUPS )
+        {
+            return APPS_MULTICAST_SESSION_STATUS_NO_MODEM_GROUP;
+        }
+    }
+    return APPS_MULTICAST_SESSION_STATUS_OK;
+}
+
+static bool multicast_session_get_time( uint32_t* time_s, uint32_t* elapsed_ms )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+    bool           time_known;
+
+    CRITICAL_SECTION_BEGIN( );
+    time_known  = multicast_session.time_known;
+    *elapsed_ms = now_ms - multicast_session.time_ms;
+    *time_s     = multicast_session.time_s + *elapsed_ms / 1000;
+    CRITICAL_SECTION_END( );
+    return time_known;
+}
+
+static void multicast_session_handle_modem_reset( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    multicast_session.modem_reset = false;
+    multicast_session.time_known  = false;
+    for( uint8_t modem_group = 0; modem_group < APPS_MULTICAST_SESSION_NB_MODEM_GROUPS; modem_group++ )
+    {
+        multicast_session.modem_groups[modem_group] = MULTICAST_SESSION_NO_GROUP;
+    }
+    CRITICAL_SECTION_END( );
+
+    multicast_session.device_class   = LR1121_LORAWAN_CLASS_A;
+    multicast_session.time_requested = false;
+    for( uint8_t group_id = 0; group_id < APPS_MULTICAST_SESSION_MAX_GROUPS; group_id++ )
+    {
+        multicast_session_entry_t* entry = &multicast_session.groups[group_id];
+
+        entry->changed = false;
+        if( entry->state == APPS_MULTICAST_SESSION_STATE_RUNNING )
+        {
+            entry->state = APPS_MULTICAST_SESSION_STATE_SCHEDULED;
+        }
+    }
+}
+
+static uint32_t multicast_session_request_time( const void* context, uint32_t now_ms )
+{
+    uint32_t                     time_s;
+    uint32_t                     elapsed_ms;
+    bool                         needed = false;
+    lr1121_modem_response_code_t rc;
+
+    if( ( multicast_session_get_time( &time_s, &elapsed_ms ) == true ) &&
+        ( elapsed_ms < APPS_MULTICAST_SESSION_TIME_SYNC_PERIOD_MS ) )
+    {
+        return APPS_MULTICAST_SESSION_IDLE;
+    }
+    for( uint8_t group_id = 0; group_id < APPS_MULTICAST_SESSION_MAX_GROUPS; group_id++ )
+    {
+        const multicast_session_entry_t* entry = &multicast_session.groups[group_id];
+
+        if( ( ( entry->state == APPS_MULTICAST_SESSION_STATE_SCHEDULED ) ||
+              ( entry->state == APPS_MULTICAST_SESSION_STATE_RUNNING ) ) &&
+            ( entry->config.start_s != APPS_MULTICAST_SESSION_START_NOW ) )
+        {
+            needed = true;
+        }
+    }
+    if( needed == false )
+    {
+        return APPS_MULTICAST_SESSION_IDLE;
+    }
+    if( ( multicast_session.time_requested == true ) &&
+        ( ( now_ms - multicast_session.time_request_ms ) < APPS_MULTICAST_SESSION_TIME_REQUEST_INTERVAL_MS ) )
+    {
+        return APPS_MULTICAST_SESSION_TIME_REQUEST_INTERVAL_MS - ( now_ms - multicast_session.time_request_ms );
+    }
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    rc = lr1121_modem_mac_request_tx( context, LR1121_MODEM_MAC_REQUEST_TIME );
+    hal_gpio_irq_enable( );
+
+    // A refused request is retried after the interval as well
+    multicast_session.time_requested  = true;
+    multicast_session.time_request_ms = now_ms;
+    if( rc == LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_INFO( "Multicast: network time requested\n" );
+    }
+    return APPS_MULTICAST_SESSION_TIME_REQUEST_INTERVAL_MS;
+}
+
+static bool multicast_session_start( const void* context, uint8_t group_id )
+{
+    const apps_multicast_session_group_t* group       = &multicast_session.groups[group_id].config;
+    uint8_t                               modem_group = 0;
+    lr1121_modem_response_code_t          rc;
+
+    while( ( modem_group < APPS_MULTICAST_SESSION_NB_MODEM_GROUPS ) &&
+           ( multicast_session.modem_groups[modem_group] != MULTICAST_SESSION_NO_GROUP ) )
+    {
+        modem_group++;
+    }
+    if( modem_group == APPS_MULTICAST_SESSION_NB_MODEM_GROUPS )
+    {
+        return false;
+    }
+    if( ( group->session_class != multicast_session.device_class ) &&
+        ( multicast_session_set_class( context, group->session_class ) == false ) )
+    {
+        return false;
+    }
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    rc = lr1121_modem_set_multicast_group_config( context, modem_group, group->address, group->nwk_skey,
+                                                  group->app_skey );
+    if( rc == LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        if( group->session_class == LR1121_LORAWAN_CLASS_B )
+        {
+            rc = lr1121_modem_start_session_multicast_class_b( context, modem_group, group->frequency,
+                                                               group->data_rate, group->ping_slot );
+        }
+        else
+        {
+            rc = lr1121_modem_start_session_multicast_class_c( context, modem_group, group->frequency,
+                                                               group->data_rate );
+        }
+    }
+    hal_gpio_irq_enable( );
+
+    if( rc != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "Multicast: session of group %u not started, rc %d\n", group_id, rc );
+        return false;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    multicast_session.modem_groups[modem_group] = group_id;
+    CRITICAL_SECTION_END( );
+
+    HAL_DBG_TRACE_INFO( "Multicast: class %c session of group %u started in modem group %u\n",
+                        ( group->session_class == LR1121_LORAWAN_CLASS_B ) ? 'B' : 'C', group_id, modem_group );
+    return true;
+}
+
+static void multicast_session_stop( const void* context, uint8_t modem_group )
+{
+    const uint8_t group_id = multicast_session.modem_groups[modem_group];
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    if( multicast_session.device_class == LR1121_LORAWAN_CLASS_B )
+    {
+        lr1121_modem_stop_session_multicast_class_b( context, modem_group );
+    }
+    else
+    {
+        lr1121_modem_stop_session_multicast_class_c( context, modem_group );
+    }
+    hal_gpio_irq_enable( );
+
+    CRITICAL_SECTION_BEGIN( );
+    multicast_session.modem_groups[modem_group] = MULTICAST_SESSION_NO_GROUP;
+    CRITICAL_SECTION_END( );
+
+    HAL_DBG_TRACE_INFO( "Multicast: session of group %u stopped\n", group_id );
+}
+
+static bool multicast_session_set_class( const void* context, lr1121_modem_classes_t device_class )
+{
+    lr1121_modem_response_code_t rc;
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    rc = lr1121_modem_set_class( context, device_class );
+    hal_gpio_irq_enable( );
+
+    if( rc != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "Multicast: class %u not set, rc %d\n", device_class, rc );
+        return false;
+    }
+    multicast_session.device_class = device_class;
+    HAL_DBG_TRACE_INFO( "Multicast: device switched to class %c\n", "ABC"[device_class] );
+    return true;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,451 @@
+/*!
+ * @file      apps_payload_codec.c
+ *
+ * @brief     Schema-driven compact payload codec: bit packing, zigzag varints, delta encoding
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "apps_payload_codec.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/**
+ * @brief Zigzag encoding of a signed value: 0, -1, 1, -2... are encoded as 0, 1, 2, 3...
+ */
+#define PAYLOAD_CODEC_ZIGZAG( value ) ( ( ( uint32_t ) ( value ) << 1 ) ^ ( uint32_t )( ( int32_t ) ( value ) >> 31 ) )
+
+/**
+ * @brief Zigzag decoding
+ */
+#define PAYLOAD_CODEC_UNZIGZAG( value ) ( ( int32_t )( ( ( value ) >> 1 ) ^ ( 0 - ( ( value ) & 1 ) ) ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Bits of the frame sequence numbers
+ */
+#define PAYLOAD_CODEC_SEQUENCE_BITS 4
+
+/**
+ * @brief Largest number of data bits per varint group
+ */
+#define PAYLOAD_CODEC_MAX_GROUP_BITS 8
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Bit stream, most significant bit first
+ */
+typedef struct payload_codec_bits_s
+{
+    uint8_t* buffer;    //!< Stream bytes
+    uint16_t nb_bits;   //!< Size of the stream in bits
+    uint16_t position;  //!< Position of the next bit
+} payload_codec_bits_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Write bits in a stream
+ *
+ * @param [in,out] bits Stream, its bytes being cleared beforehand
+ * @param [in] value Value, its unused bits being cleared
+ * @param [in] nb_bits Number of bits, in [1,32]
+ *
+ * @returns false if the stream is full
+ */
+static bool payload_codec_write( payload_codec_bits_t* bits, uint32_t value, uint8_t nb_bits );
+
+/**
+ * @brief Read bits from a stream
+ *
+ * @param [in,out] bits Stream
+ * @param [out] value Value
+ * @param [in] nb_bits Number of bits, in [1,32]
+ *
+ * @returns false if the stream ends before
+ */
+static bool payload_codec_read( payload_codec_bits_t* bits, uint32_t* value, uint8_t nb_bits );
+
+/**
+ * @brief Write a varint, least significant group first
+ *
+ * @param [in,out] bits Stream
+ * @param [in] value Value
+ * @param [in] group_bits Data bits per group
+ *
+ * @returns false if the stream is full
+ */
+static bool payload_codec_write_varint( payload_codec_bits_t* bits, uint32_t value, uint8_t group_bits );
+
+/**
+ * @brief Read a varint
+ *
+ * @param [in,out] bits Stream
+ * @param [out] value Value
+ * @param [in] group_bits Data bits per group
+ *
+ * @returns false if the stream ends before, or if the value exceeds 32 bits
+ */
+static bool payload_codec_read_varint( payload_codec_bits_t* bits, uint32_t* value, uint8_t group_bits );
+
+/**
+ * @brief Write a field
+ *
+ * @param [in,out] bits Stream
+ * @param [in] field Field
+ * @param [in] value Value
+ * @param [in] reference Value in the reference frame, NULL if the frame is not delta encoded
+ *
+ * @returns false if the value does not fit in the field or the stream is full
+ */
+static bool payload_codec_write_field( payload_codec_bits_t* bits, const apps_payload_codec_field_t* field,
+                                       int32_t value, const int32_t* reference );
+
+/**
+ * @brief Read a field
+ *
+ * @param [in,out] bits Stream
+ * @param [in] field Field
+ * @param [out] value Value
+ * @param [in] reference Value in the reference frame, NULL if the frame is not delta encoded
+ *
+ * @returns false if the stream ends before
+ */
+static bool payload_codec_read_field( payload_codec_bits_t* bits, const apps_payload_codec_field_t* field,
+                                      int32_t* value, const int32_t* reference );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool apps_payload_codec_init( apps_payload_codec_t* codec, const apps_payload_codec_field_t* fields,
+                              uint8_t nb_fields )
+{
+    if( ( nb_fields == 0 ) || ( nb_fields > APPS_PAYLOAD_CODEC_MAX_FIELDS ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < nb_fields; i++ )
+    {
+        const uint8_t max_bits = ( fields[i].type == APPS_PAYLOAD_CODEC_VARINT ) ? PAYLOAD_CODEC_MAX_GROUP_BITS : 32;
+
+        if( ( fields[i].type > APPS_PAYLOAD_CODEC_VARINT ) || ( fields[i].bits == 0 ) ||
+            ( fields[i].bits > max_bits ) || ( fields[i].delta_bits > PAYLOAD_CODEC_MAX_GROUP_BITS ) )
+        {
+            return false;
+        }
+    }
+
+    memset( codec, 0, sizeof( *codec ) );
+    codec->fields    = fields;
+    codec->nb_fields = nb_fields;
+    return true;
+}
+
+uint8_t apps_payload_codec_encode( apps_payload_codec_t* codec, const int32_t* values, uint8_t* buffer,
+                                   uint8_t max_size )
+{
+    payload_codec_bits_t bits = { .buffer = buffer, .nb_bits = ( uint16_t ) max_size * 8, .position = 0 };
+    bool                 ok;
+
+    // The sequence number of the reference frame must not be reused by the decoder
+    const bool delta = ( codec->has_reference == true ) &&
+                       ( ( codec->index - codec->reference_index ) < APPS_PAYLOAD_CODEC_NB_SEQUENCES );
+
+    memset( buffer, 0, max_size );
+    ok = payload_codec_write( &bits, ( delta == true ) ? 1 : 0, 1 ) &&
+         payload_codec_write( &bits, codec->index % APPS_PAYLOAD_CODEC_NB_SEQUENCES, PAYLOAD_CODEC_SEQUENCE_BITS );
+    if( delta == true )
+    {
+        ok = ok && payload_codec_write( &bits, codec->reference_index % APPS_PAYLOAD_CODEC_NB_SEQUENCES,
+                                        PAYLOAD_CODEC_SEQUENCE_BITS );
+    }
+    for( uint8_t i = 0; ( ok == true ) && ( i < codec->nb_fields ); i++ )
+    {
+        ok = payload_codec_write_field( &bits, &codec->fields[i], values[i],
+                                        ( delta == true ) ? &codec->reference[i] : NULL );
+    }
+    if( ok == false )
+    {
+        return 0;
+    }
+
+    // Keep the values until the frame is acknowledged
+    const uint8_t slot          = codec->index % APPS_PAYLOAD_CODEC_HISTORY_SIZE;
+    codec->history_index[slot] = codec->index;
+    memcpy( codec->history[slot], values, codec->nb_fields * sizeof( int32_t ) );
+    codec->index++;
+
+    return ( uint8_t )( ( bits.position + 7 ) / 8 );
+}
+
+bool apps_payload_codec_decode( const apps_payload_codec_t* codec, const uint8_t* buffer, uint8_t size,
+                                const int32_t* reference, int32_t* values )
+{
+    payload_codec_bits_t bits = { .buffer = ( uint8_t* ) buffer, .nb_bits = ( uint16_t ) size * 8, .position = 0 };
+    uint32_t             header;
+
+    if( payload_codec_read( &bits, &header, 1 + PAYLOAD_CODEC_SEQUENCE_BITS ) == false )
+    {
+        return false;
+    }
+    if( ( header >> PAYLOAD_CODEC_SEQUENCE_BITS ) != 0 )
+    {
+        if( ( reference == NULL ) || ( payload_codec_read( &bits, &header, PAYLOAD_CODEC_SEQUENCE_BITS ) == false ) )
+        {
+            return false;
+        }
+    }
+    else
+    {
+        reference = NULL;
+    }
+    for( uint8_t i = 0; i < codec->nb_fields; i++ )
+    {
+        if( payload_codec_read_field( &bits, &codec->fields[i], &values[i],
+                                      ( reference != NULL ) ? &reference[i] : NULL ) == false )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t apps_payload_codec_get_sequence( const uint8_t* buffer )
+{
+    return ( buffer[0] >> ( 7 - PAYLOAD_CODEC_SEQUENCE_BITS ) ) & ( APPS_PAYLOAD_CODEC_NB_SEQUENCES - 1 );
+}
+
+void apps_payload_codec_acknowledge( apps_payload_codec_t* codec, uint8_t sequence )
+{
+    for( uint8_t slot = 0; slot < APPS_PAYLOAD_CODEC_HISTORY_SIZE; slot++ )
+    {
+        const uint32_t index = codec->history_index[slot];
+
+        // Only the slots of the last encoded frames are valid
+        if( ( ( index % APPS_PAYLOAD_CODEC_HISTORY_SIZE ) != slot ) || ( index >= codec->index ) ||
+            ( ( codec->index - index ) > APPS_PAYLOAD_CODEC_HISTORY_SIZE ) ||
+            ( ( index % APPS_PAYLOAD_CODEC_NB_SEQUENCES ) != sequence ) )
+        {
+            continue;
+        }
+        if( ( codec->has_reference == false ) || ( index > codec->reference_index ) )
+        {
+            memcpy( codec->reference, codec->history[slot], codec->nb_fields * sizeof( int32_t ) );
+            codec->reference_index = index;
+            codec->has_reference   = true;
+        }
+        return;
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool payload_codec_write( payload_codec_bits_t* bits, uint32_t value, uint8_t nb_bits )
+{
+    if( ( bits->position + nb_bits ) > bits->nb_bits )
+    {
+        return false;
+    }
+    for( int8_t i = nb_bits - 1; i >= 0; i-- )
+    {
+        if( ( ( value >> i ) & 1 ) != 0 )
+        {
+            bits->buffer[bits->position / 8] |= 0x80 >> ( bits->position % 8 );
+        }
+        bits->position++;
+    }
+    return true;
+}
+
+static bool payload_codec_read( payload_codec_bits_t* bits, uint32_t* value, uint8_t nb_bits )
+{
+    if( ( bits->position + nb_bits ) > bits->nb_bits )
+    {
+        return false;
+    }
+    *value = 0;
+    for( uint8_t i = 0; i < nb_bits; i++ )
+    {
+        *value = ( *value << 1 ) | ( ( bits->buffer[bits->position / 8] >> ( 7 - ( bits->position % 8 ) ) ) & 1 );
+        bits->position++;
+    }
+    return true;
+}
+
+static bool payload_codec_write_varint( payload_codec_bits_t* bits, uint32_t value, uint8_t group_bits )
+{
+    do
+    {
+        const uint32_t data = value & ( ( 1UL << group_bits ) - 1 );
+
+        value >>= group_bits;
+        if( ( payload_codec_write( bits, data, group_bits ) == false ) ||
+            ( payload_codec_write( bits, ( value != 0 ) ? 1 : 0, 1 ) == false ) )
+        {
+            return false;
+        }
+    } while( value != 0 );
+    return true;
+}
+
+static bool payload_codec_read_varint( payload_codec_bits_t* bits, uint32_t* value, uint8_t group_bits )
+{
+    uint32_t more = 1;
+
+    *value = 0;
+    for( uint8_t shift = 0; more != 0; shift += group_bits )
+    {
+        uint32_t data;
+
+        if( ( shift >= 32 ) || ( payload_codec_read( bits, &data, group_bits ) == false ) ||
+            ( payload_codec_read( bits, &more, 1 ) == false ) )
+        {
+            return false;
+        }
+        *value |= data << shift;
+    }
+    return true;
+}
+
+static bool payload_codec_write_field( payload_codec_bits_t* bits, const apps_payload_codec_field_t* field,
+                                       int32_t value, const int32_t* reference )
+{
+    if( ( reference != NULL ) && ( field->delta_bits != 0 ) )
+    {
+        // Difference modulo 2^32, so that counters wrap around
+        const uint32_t delta = ( uint32_t ) value - ( uint32_t ) *reference;
+
+        return payload_codec_write_varint( bits, PAYLOAD_CODEC_ZIGZAG( delta ), field->delta_bits );
+    }
+
+    switch( field->type )
+    {
+    case APPS_PAYLOAD_CODEC_UNSIGNED:
+        if( ( field->bits < 32 ) && ( ( ( uint32_t ) value >> field->bits ) != 0 ) )
+        {
+            return false;
+        }
+        return payload_codec_write( bits, ( uint32_t ) value, field->bits );
+    case APPS_PAYLOAD_CODEC_SIGNED:
+        if( field->bits < 32 )
+        {
+            const int32_t max = ( int32_t )( ( 1UL << ( field->bits - 1 ) ) - 1 );
+
+            if( ( value > max ) || ( value < ( -max - 1 ) ) )
+            {
+                return false;
+            }
+            return payload_codec_write( bits, ( uint32_t ) value & ( ( 1UL << field->bits ) - 1 ), field->bits );
+        }
+        return payload_codec_write( bits, ( uint32_t ) value, field->bits );
+    default:
+        return payload_codec_write_varint( bits, PAYLOAD_CODEC_ZIGZAG( value ), field->bits );
+    }
+}
+
+static bool payload_codec_read_field( payload_codec_bits_t* bits, const apps_payload_codec_field_t* field,
+                                      int32_t* value, const int32_t* reference )
+{
+    uint32_t raw;
+
+    if( ( reference != NULL ) && ( field->delta_bits != 0 ) )
+    {
+        if( payload_codec_read_varint( bits, &raw, field->delta_bits ) == false )
+        {
+            return false;
+        }
+        *value = ( int32_t )( ( uint32_t ) *reference + ( uint32_t ) PAYLOAD_CODEC_UNZIGZAG( raw ) );
+        return true;
+    }
+
+    switch( field->type )
+    {
+    case APPS_PAYLOAD_CODEC_UNSIGNED:
+        if( payload_codec_read( bits, &raw, field->bits ) == false )
+        {
+            return false;
+        }
+        *value = ( int32_t ) raw;
+        return true;
+    case APPS_PAYLOAD_CODEC_SIGNED:
+        if( payload_codec_read( bits, &raw, field->bits ) == false )
+        {
+            return false;
+        }
+        if( ( field->bits < 32 ) && ( ( raw >> ( field->bits - 1 ) ) != 0 ) )
+        {
+            raw |= ~( ( 1UL << field->bits ) - 1 );  // Sign extension
+        }
+        *value = ( int32_t ) raw;
+        return true;
+    default:
+        if( payload_codec_read_varint( bits, &raw, field->bits ) == false )
+        {
+            return false;
+        }
+        *value = PAYLOAD_CODEC_UNZIGZAG( raw );
+        return true;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
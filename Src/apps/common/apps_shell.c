@@ -0,0 +1,356 @@
+/*!
+ * @file      apps_shell.c
+ *
+ * @brief     UART command shell implementation
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "apps_shell.h"
+#include "apps_utilities.h"
+#include "lr1121_modem_modem.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_uart.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const void*                 shell_context     = NULL;
+static const apps_shell_command_t* shell_commands    = NULL;
+static uint8_t                     shell_nb_commands = 0;
+
+static uint8_t       shell_rx_buffer[APPS_SHELL_RX_BUFFER_SIZE];
+static volatile bool shell_rx_event = false;  // Set under interrupt when bytes are received
+
+static char     shell_line[APPS_SHELL_LINE_MAX_SIZE + 1];
+static uint8_t  shell_line_size        = 0;
+static bool     shell_line_overflow    = false;
+static bool     shell_session_active   = false;
+static uint32_t shell_last_activity_ms = 0;
+
+static const char* trace_module_names[HAL_DBG_TRACE_MODULE_NB] = {
+    [HAL_DBG_TRACE_MODULE_APP]   = "app",
+    [HAL_DBG_TRACE_MODULE_HAL]   = "hal",
+    [HAL_DBG_TRACE_MODULE_BOARD] = "board",
+};
+
+static const char* trace_level_names[] = { "none", "error", "warning", "info", "debug" };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief UART reception callback, called under interrupt
+ */
+static void apps_shell_on_rx( void );
+
+/**
+ * @brief Add a received byte to the command line, and run it when complete
+ *
+ * @param [in] c Received byte
+ */
+static void apps_shell_on_byte( char c );
+
+/**
+ * @brief Split the command line in words and run the matching command
+ */
+static void apps_shell_run_line( void );
+
+/**
+ * @brief Find the index of a name in a table, or parse it as a number
+ *
+ * @param [in] word Word to be parsed
+ * @param [in] names Table of names
+ * @param [in] nb_names Number of names
+ *
+ * @returns Index of the name, or the number value, -1 if invalid
+ */
+static int32_t apps_shell_parse_name( const char* word, const char* const* names, uint8_t nb_names );
+
+static void apps_shell_cmd_help( uint8_t argc, char* argv[] );
+static void apps_shell_cmd_status( uint8_t argc, char* argv[] );
+static void apps_shell_cmd_log( uint8_t argc, char* argv[] );
+
+static const apps_shell_command_t shell_builtin_commands[] = {
+    { "help", "list the commands", apps_shell_cmd_help },
+    { "status", "print the modem status", apps_shell_cmd_status },
+    { "log", "log [<module|all> <level>]: print or set the runtime trace levels", apps_shell_cmd_log },
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC VARIABLES --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_shell_init( const void* context, const apps_shell_command_t* commands, uint8_t nb_commands )
+{
+    shell_context     = context;
+    shell_commands    = commands;
+    shell_nb_commands = ( commands != NULL ) ? nb_commands : 0;
+
+#if( HAL_USE_PRINTF_UART == HAL_FEATURE_ON )
+    hal_uart_rx_dma_start( HAL_PRINTF_UART_ID, shell_rx_buffer, sizeof( shell_rx_buffer ), apps_shell_on_rx );
+#endif
+}
+
+void apps_shell_process( void )
+{
+    uint8_t  bytes[16];
+    uint16_t nb_bytes;
+
+    if( shell_rx_event == true )
+    {
+        shell_rx_event = false;
+
+        // Keep the UART running until the end of the session
+        shell_session_active   = true;
+        shell_last_activity_ms = hal_rtc_get_time_ms( );
+        hal_mcu_stop_mode_enable( false );
+    }
+
+#if( HAL_USE_PRINTF_UART == HAL_FEATURE_ON )
+    while( ( nb_bytes = hal_uart_rx_read( HAL_PRINTF_UART_ID, bytes, sizeof( bytes ) ) ) > 0 )
+    {
+#if( HAL_DBG_TRACE_BINARY == HAL_FEATURE_OFF )
+        hal_uart_tx( HAL_PRINTF_UART_ID, bytes, nb_bytes );
+#endif
+        for( uint16_t i = 0; i < nb_bytes; i++ )
+        {
+            apps_shell_on_byte( ( char ) bytes[i] );
+        }
+    }
+#else
+    ( void ) bytes;
+    ( void ) nb_bytes;
+#endif
+
+    if( ( shell_session_active == true ) &&
+        ( ( hal_rtc_get_time_ms( ) - shell_last_activity_ms ) > APPS_SHELL_SESSION_TIMEOUT_MS ) )
+    {
+        shell_session_active = false;
+        hal_mcu_stop_mode_enable( true );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void apps_shell_on_rx( void ) { shell_rx_event = true; }
+
+static void apps_shell_on_byte( char c )
+{
+    if( ( c == '\r' ) || ( c == '\n' ) )
+    {
+        if( shell_line_overflow == true )
+        {
+            APPS_SHELL_PRINTF( "\nCommand line too long\n" );
+        }
+        else if( shell_line_size > 0 )
+        {
+            shell_line[shell_line_size] = '\0';
+            apps_shell_run_line( );
+        }
+        shell_line_size     = 0;
+        shell_line_overflow = false;
+    }
+    else if( ( c == '\b' ) || ( c == 0x7F ) )
+    {
+        if( shell_line_size > 0 )
+        {
+            shell_line_size--;
+        }
+    }
+    else if( ( c >= ' ' ) && ( c <= '~' ) )
+    {
+        if( shell_line_size < APPS_SHELL_LINE_MAX_SIZE )
+        {
+            shell_line[shell_line_size++] = c;
+        }
+        else
+        {
+            shell_line_overflow = true;
+        }
+    }
+}
+
+static void apps_shell_run_line( void )
+{
+    char*   argv[APPS_SHELL_MAX_ARGS];
+    uint8_t argc = 0;
+    char*   word = strtok( shell_line, " " );
+
+    while( ( word != NULL ) && ( argc < APPS_SHELL_MAX_ARGS ) )
+    {
+        argv[argc++] = word;
+        word         = strtok( NULL, " " );
+    }
+
+    if( argc == 0 )
+    {
+        return;
+    }
+
+    APPS_SHELL_PRINTF( "\n" );
+
+    for( uint8_t i = 0; i < ( sizeof( shell_builtin_commands ) / sizeof( shell_builtin_commands[0] ) ); i++ )
+    {
+        if( strcmp( argv[0], shell_builtin_commands[i].name ) == 0 )
+        {
+            shell_builtin_commands[i].handler( argc, argv );
+            return;
+        }
+    }
+    for( uint8_t i = 0; i < shell_nb_commands; i++ )
+    {
+        if( strcmp( argv[0], shell_commands[i].name ) == 0 )
+        {
+            shell_commands[i].handler( argc, argv );
+            return;
+        }
+    }
+
+    APPS_SHELL_PRINTF( "Unknown command, type help\n" );
+}
+
+static int32_t apps_shell_parse_name( const char* word, const char* const* names, uint8_t nb_names )
+{
+    char* end = NULL;
+
+    for( uint8_t i = 0; i < nb_names; i++ )
+    {
+        if( strcmp( word, names[i] ) == 0 )
+        {
+            return i;
+        }
+    }
+
+    const unsigned long value = strtoul( word, &end, 0 );
+    if( ( end == word ) || ( *end != '\0' ) || ( value > INT32_MAX ) )
+    {
+        return -1;
+    }
+    return ( int32_t ) value;
+}
+
+static void apps_shell_cmd_help( uint8_t argc, char* argv[] )
+{
+    for( uint8_t i = 0; i < ( sizeof( shell_builtin_commands ) / sizeof( shell_builtin_commands[0] ) ); i++ )
+    {
+        APPS_SHELL_PRINTF( "%-10s %s\n", shell_builtin_commands[i].name, shell_builtin_commands[i].help );
+    }
+    for( uint8_t i = 0; i < shell_nb_commands; i++ )
+    {
+        APPS_SHELL_PRINTF( "%-10s %s\n", shell_commands[i].name, shell_commands[i].help );
+    }
+}
+
+static void apps_shell_cmd_status( uint8_t argc, char* argv[] )
+{
+    lr1121_modem_lorawan_status_bitmask_t modem_status;
+
+    if( lr1121_modem_get_status( shell_context, &modem_status ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        APPS_SHELL_PRINTF( "Failed to get the modem status\n" );
+        return;
+    }
+    APPS_SHELL_PRINTF( "Modem status: 0x%02X%s%s%s%s\n", modem_status,
+                       ( ( modem_status & LR1121_LORAWAN_CRASH ) != 0 ) ? " CRASH" : "",
+                       ( ( modem_status & LR1121_LORAWAN_JOINED ) != 0 ) ? " JOINED" : "",
+                       ( ( modem_status & LR1121_LORAWAN_SUSPEND ) != 0 ) ? " SUSPEND" : "",
+                       ( ( modem_status & LR1121_LORAWAN_JOINING ) != 0 ) ? " JOINING" : "" );
+}
+
+static void apps_shell_cmd_log( uint8_t argc, char* argv[] )
+{
+    const uint8_t nb_levels = sizeof( trace_level_names ) / sizeof( trace_level_names[0] );
+
+    if( argc == 3 )
+    {
+        const int32_t module = ( strcmp( argv[1], "all" ) == 0 )
+                                   ? HAL_DBG_TRACE_MODULE_NB
+                                   : apps_shell_parse_name( argv[1], trace_module_names, HAL_DBG_TRACE_MODULE_NB );
+        const int32_t level = apps_shell_parse_name( argv[2], trace_level_names, nb_levels );
+
+        if( ( module < 0 ) || ( level < 0 ) ||
+            ( hal_dbg_trace_set_level( ( hal_dbg_trace_module_t ) module, ( uint8_t ) level ) == false ) )
+        {
+            APPS_SHELL_PRINTF( "Invalid module or level\n" );
+            return;
+        }
+    }
+    else if( argc != 1 )
+    {
+        APPS_SHELL_PRINTF( "Usage: log [<module|all> <level>]\n" );
+        return;
+    }
+
+    for( uint8_t i = 0; i < HAL_DBG_TRACE_MODULE_NB; i++ )
+    {
+        APPS_SHELL_PRINTF( "%-6s %s\n", trace_module_names[i], trace_level_names[hal_dbg_trace_get_level( i )] );
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,431 @@
+/*!
+ * @file      apps_telemetry_log.c
+ *
+ * @brief     Persistent telemetry log in flash
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "apps_telemetry_log.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_flash.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Magic word of the header of a page in use
+ */
+#define APPS_TELEMETRY_LOG_PAGE_MAGIC 0x31474C54  // "TLG1"
+
+/**
+ * @brief Number of record slots of a page, after the page header
+ */
+#define APPS_TELEMETRY_LOG_RECORDS_PER_PAGE \
+    ( ( ADDR_FLASH_PAGE_SIZE - sizeof( apps_telemetry_log_page_header_t ) ) / sizeof( apps_telemetry_log_slot_t ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Header of a page in use, written in the first double word of the page
+ */
+typedef struct apps_telemetry_log_page_header_s
+{
+    uint32_t magic;     //!< APPS_TELEMETRY_LOG_PAGE_MAGIC
+    uint32_t sequence;  //!< Incremented each time a page is opened, the highest one is the head of the ring
+} apps_telemetry_log_page_header_t;
+
+/**
+ * @brief Record as stored in flash: two double words. Its sequence number is given by its position.
+ */
+typedef struct apps_telemetry_log_slot_s
+{
+    uint32_t timestamp_s;
+    uint32_t charge;
+    int16_t  rssi_dbm;
+    uint16_t info;
+    uint8_t  event_type;
+    uint8_t  modem_rc;
+    int8_t   snr_db;
+    uint8_t  crc;  //!< CRC8 of the previous bytes
+} apps_telemetry_log_slot_t;
+
+/**
+ * @brief Compile-time check: a slot is made of whole flash double words
+ */
+typedef char apps_telemetry_log_slot_size_check[( sizeof( apps_telemetry_log_slot_t ) == 16 ) ? 1 : -1];
+
+/**
+ * @brief Telemetry log state
+ */
+typedef struct apps_telemetry_log_s
+{
+    bool     mounted;
+    uint32_t first_page;
+    uint8_t  nb_pages;
+    uint8_t  nb_used_pages;  //!< Number of pages holding records, head page included
+    uint8_t  head;           //!< Index of the page being filled
+    uint32_t head_sequence;  //!< Sequence number of the head page, 0 if no page is used yet
+    uint32_t head_slot;      //!< Next free slot of the head page
+
+    // Queue of the records appended by the application, emptied by apps_telemetry_log_process
+    apps_telemetry_log_slot_t queue[APPS_TELEMETRY_LOG_QUEUE_SIZE];
+    volatile uint32_t         queue_head;
+    volatile uint32_t         queue_tail;
+    volatile uint32_t         nb_dropped;
+} apps_telemetry_log_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static apps_telemetry_log_t telemetry_log = { 0 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Get the address of a page of the log
+ */
+static uint32_t telemetry_log_page_addr( uint8_t page );
+
+/**
+ * @brief Get a record slot of a page
+ */
+static const apps_telemetry_log_slot_t* telemetry_log_slot( uint8_t page, uint32_t slot );
+
+/**
+ * @brief Check that a slot has never been written
+ */
+static bool telemetry_log_slot_is_erased( const apps_telemetry_log_slot_t* slot );
+
+/**
+ * @brief Compute the CRC of a record slot
+ */
+static uint8_t telemetry_log_crc( const apps_telemetry_log_slot_t* slot );
+
+/**
+ * @brief Erase the page following the head page and open it
+ */
+static bool telemetry_log_open_next_page( void );
+
+/**
+ * @brief Write a slot at the head of the log
+ */
+static bool telemetry_log_write( const apps_telemetry_log_slot_t* slot );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool apps_telemetry_log_init( uint32_t first_page, uint8_t nb_pages )
+{
+    uint32_t low  = 0;
+    uint32_t high = APPS_TELEMETRY_LOG_RECORDS_PER_PAGE;
+
+    memset( &telemetry_log, 0, sizeof( telemetry_log ) );
+
+    if( ( nb_pages < APPS_TELEMETRY_LOG_MIN_NB_PAGES ) || ( first_page < FLASH_USER_START_PAGE ) ||
+        ( ( first_page + nb_pages - 1 ) > FLASH_USER_END_PAGE ) )
+    {
+        HAL_DBG_TRACE_ERROR( "Telemetry log: invalid page range\n" );
+        return false;
+    }
+    telemetry_log.first_page = first_page;
+    telemetry_log.nb_pages   = nb_pages;
+
+    // Head search: only the page headers are read
+    for( uint8_t page = 0; page < nb_pages; page++ )
+    {
+        const apps_telemetry_log_page_header_t* header =
+            ( const apps_telemetry_log_page_header_t* ) telemetry_log_page_addr( page );
+
+        if( ( header->magic == APPS_TELEMETRY_LOG_PAGE_MAGIC ) && ( header->sequence > telemetry_log.head_sequence ) )
+        {
+            telemetry_log.head          = page;
+            telemetry_log.head_sequence = header->sequence;
+        }
+    }
+
+    if( telemetry_log.head_sequence == 0 )
+    {
+        // Blank log: the first append opens the first page
+        telemetry_log.head      = nb_pages - 1;
+        telemetry_log.head_slot = APPS_TELEMETRY_LOG_RECORDS_PER_PAGE;
+    }
+    else
+    {
+        // The pages preceding the head in the ring hold the previous sequence numbers until the oldest one
+        telemetry_log.nb_used_pages = 1;
+        while( telemetry_log.nb_used_pages < nb_pages )
+        {
+            const uint8_t page = ( telemetry_log.head + nb_pages - telemetry_log.nb_used_pages ) % nb_pages;
+            const apps_telemetry_log_page_header_t* header =
+                ( const apps_telemetry_log_page_header_t* ) telemetry_log_page_addr( page );
+
+            if( ( header->magic != APPS_TELEMETRY_LOG_PAGE_MAGIC ) ||
+                ( header->sequence != ( telemetry_log.head_sequence - telemetry_log.nb_used_pages ) ) )
+            {
+                break;
+            }
+            telemetry_log.nb_used_pages++;
+        }
+
+        // The slots are written in order: binary search of the first erased slot of the head page
+        while( low < high )
+        {
+            const uint32_t middle = low + ( ( high - low ) / 2 );
+
+            if( telemetry_log_slot_is_erased( telemetry_log_slot( telemetry_log.head, middle ) ) == true )
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        telemetry_log.head_slot = low;
+    }
+
+    telemetry_log.mounted = true;
+    HAL_DBG_TRACE_INFO( "Telemetry log: %lu records retained\n", apps_telemetry_log_get_nb_records( ) );
+    return true;
+}
+
+bool apps_telemetry_log_append( const apps_telemetry_log_record_t* record )
+{
+    apps_telemetry_log_slot_t slot = {
+        .timestamp_s = hal_rtc_get_time_s( ),
+        .charge      = record->charge,
+        .rssi_dbm    = record->rssi_dbm,
+        .info        = record->info,
+        .event_type  = record->event_type,
+        .modem_rc    = record->modem_rc,
+        .snr_db      = record->snr_db,
+    };
+    bool queued = false;
+
+    slot.crc = telemetry_log_crc( &slot );
+
+    CRITICAL_SECTION_BEGIN( );
+    if( ( telemetry_log.queue_head - telemetry_log.queue_tail ) < APPS_TELEMETRY_LOG_QUEUE_SIZE )
+    {
+        telemetry_log.queue[telemetry_log.queue_head % APPS_TELEMETRY_LOG_QUEUE_SIZE] = slot;
+        telemetry_log.queue_head++;
+        queued = true;
+    }
+    else
+    {
+        telemetry_log.nb_dropped++;
+    }
+    CRITICAL_SECTION_END( );
+
+    return queued;
+}
+
+void apps_telemetry_log_process( void )
+{
+    if( telemetry_log.mounted == false )
+    {
+        return;
+    }
+
+    while( telemetry_log.queue_tail != telemetry_log.queue_head )
+    {
+        if( telemetry_log_write( &telemetry_log.queue[telemetry_log.queue_tail % APPS_TELEMETRY_LOG_QUEUE_SIZE] ) ==
+            false )
+        {
+            telemetry_log.nb_dropped++;
+        }
+        telemetry_log.queue_tail++;
+    }
+}
+
+uint32_t apps_telemetry_log_get_nb_records( void )
+{
+    if( telemetry_log.nb_used_pages == 0 )
+    {
+        return 0;
+    }
+    return ( ( telemetry_log.nb_used_pages - 1 ) * APPS_TELEMETRY_LOG_RECORDS_PER_PAGE ) + telemetry_log.head_slot;
+}
+
+bool apps_telemetry_log_read( uint32_t index, apps_telemetry_log_record_t* record )
+{
+    if( ( telemetry_log.mounted == false ) || ( index >= apps_telemetry_log_get_nb_records( ) ) )
+    {
+        return false;
+    }
+
+    // Position of the record, counted backwards from the last written slot of the head page
+    const uint32_t back  = index + ( APPS_TELEMETRY_LOG_RECORDS_PER_PAGE - telemetry_log.head_slot );
+    const uint32_t pages = back / APPS_TELEMETRY_LOG_RECORDS_PER_PAGE;
+    const uint8_t  page  = ( telemetry_log.head + telemetry_log.nb_pages - pages ) % telemetry_log.nb_pages;
+    const uint32_t slot_index = APPS_TELEMETRY_LOG_RECORDS_PER_PAGE - 1 - ( back % APPS_TELEMETRY_LOG_RECORDS_PER_PAGE );
+    const apps_telemetry_log_slot_t* slot = telemetry_log_slot( page, slot_index );
+
+    if( slot->crc != telemetry_log_crc( slot ) )
+    {
+        // Record interrupted by a reset
+        return false;
+    }
+
+    record->sequence    = ( ( telemetry_log.head_sequence - pages ) * APPS_TELEMETRY_LOG_RECORDS_PER_PAGE ) + slot_index;
+    record->timestamp_s = slot->timestamp_s;
+    record->charge      = slot->charge;
+    record->rssi_dbm    = slot->rssi_dbm;
+    record->snr_db      = slot->snr_db;
+    record->event_type  = slot->event_type;
+    record->modem_rc    = slot->modem_rc;
+    record->info        = slot->info;
+    return true;
+}
+
+uint32_t apps_telemetry_log_get_nb_dropped( void ) { return telemetry_log.nb_dropped; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint32_t telemetry_log_page_addr( uint8_t page )
+{
+    return ADDR_FLASH_PAGE( telemetry_log.first_page + page );
+}
+
+static const apps_telemetry_log_slot_t* telemetry_log_slot( uint8_t page, uint32_t slot )
+{
+    return ( const apps_telemetry_log_slot_t* ) ( telemetry_log_page_addr( page ) +
+                                                  sizeof( apps_telemetry_log_page_header_t ) +
+                                                  ( slot * sizeof( apps_telemetry_log_slot_t ) ) );
+}
+
+static bool telemetry_log_slot_is_erased( const apps_telemetry_log_slot_t* slot )
+{
+    const uint64_t* words = ( const uint64_t* ) slot;
+
+    return ( words[0] == FLASH_PAGE_EMPTY_CONTENT ) && ( words[1] == FLASH_PAGE_EMPTY_CONTENT );
+}
+
+static uint8_t telemetry_log_crc( const apps_telemetry_log_slot_t* slot )
+{
+    const uint8_t* data = ( const uint8_t* ) slot;
+    uint8_t        crc  = 0xFF;
+
+    for( uint8_t i = 0; i < offsetof( apps_telemetry_log_slot_t, crc ); i++ )
+    {
+        crc ^= data[i];
+        for( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc & 0x80 ) ? ( uint8_t ) ( ( crc << 1 ) ^ 0x07 ) : ( uint8_t ) ( crc << 1 );
+        }
+    }
+    return crc;
+}
+
+static bool telemetry_log_open_next_page( void )
+{
+    const uint8_t                    page   = ( telemetry_log.head + 1 ) % telemetry_log.nb_pages;
+    apps_telemetry_log_page_header_t header = {
+        .magic    = APPS_TELEMETRY_LOG_PAGE_MAGIC,
+        .sequence = telemetry_log.head_sequence + 1,
+    };
+
+    // The oldest page is erased once the ring is full
+    if( flash_bulk_erase( telemetry_log_page_addr( page ), 1 ) != FLASH_STATUS_OK )
+    {
+        return false;
+    }
+    if( telemetry_log.nb_used_pages == telemetry_log.nb_pages )
+    {
+        telemetry_log.nb_used_pages--;
+    }
+
+    if( flash_write_double_words( telemetry_log_page_addr( page ), ( const uint8_t* ) &header, sizeof( header ) ) !=
+        FLASH_STATUS_OK )
+    {
+        return false;
+    }
+
+    telemetry_log.head          = page;
+    telemetry_log.head_sequence = header.sequence;
+    telemetry_log.head_slot     = 0;
+    telemetry_log.nb_used_pages++;
+    return true;
+}
+
+static bool telemetry_log_write( const apps_telemetry_log_slot_t* slot )
+{
+    if( ( telemetry_log.head_slot >= APPS_TELEMETRY_LOG_RECORDS_PER_PAGE ) &&
+        ( telemetry_log_open_next_page( ) == false ) )
+    {
+        return false;
+    }
+
+    const uint32_t addr = ( uint32_t ) telemetry_log_slot( telemetry_log.head, telemetry_log.head_slot );
+
+    if( flash_write_double_words( addr, ( const uint8_t* ) slot, sizeof( *slot ) ) != FLASH_STATUS_OK )
+    {
+        // The slot may be partially written: leave the rest of the page erased, so that the slots stay in order for
+        // the binary search at mount, and skip it
+        telemetry_log.head_slot = APPS_TELEMETRY_LOG_RECORDS_PER_PAGE;
+        return false;
+    }
+    telemetry_log.head_slot++;
+    return true;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,458 @@
+/*!
+ * @file      apps_uplink_aggregator.c
+ *
+ * @brief     Aggregation of application records in LoRaWAN uplinks
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "apps_uplink_aggregator.h"
+#include "apps_airtime.h"
+#include "lr1121_modem_lorawan.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Bytes stored in front of a record in the buffer: 4-byte timestamp and priority, before the header byte
+ */
+#define UPLINK_AGGREGATOR_RECORD_INFO_SIZE 5
+
+/**
+ * @brief Delay before the maximal payload size is read again after a modem error
+ */
+#define UPLINK_AGGREGATOR_RETRY_DELAY_MS 5000
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Uplink aggregator context
+ *
+ * The records are stored in order in the buffer, each one as its timestamp, its priority, its header byte and its
+ * content.
+ */
+typedef struct uplink_aggregator_s
+{
+    uint8_t                        buffer[APPS_UPLINK_AGGREGATOR_BUFFER_SIZE];
+    uint16_t                       size;             //!< Bytes used in the buffer
+    uint16_t                       reserved;         //!< Bytes kept free to put back the records of the queued uplink
+    uint8_t                        port;             //!< LoRaWAN port of the aggregated uplinks
+    uint8_t                        uplink_type;      //!< lr1121_modem_uplink_type_t
+    uint8_t                        max_payload;      //!< Maximal payload size last read from the modem
+    uint8_t                        queued_priority;  //!< Priority of the queued uplink
+    uint32_t                       max_age_ms;       //!< Time after which a record is sent
+    uint32_t                       retry_ms;         //!< RTC time before which the modem is not requested again
+    apps_uplink_aggregator_stats_t stats;            //!< Statistics, except nb_pending
+} uplink_aggregator_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uplink_aggregator_t uplink_aggregator = {
+    .port        = 1,
+    .uplink_type = LR1121_MODEM_UPLINK_UNCONFIRMED,
+    .max_payload = APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE,
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Read the duty-cycle status and the maximal payload size of the next transmission
+ *
+ * @param [in] context Chip implementation context
+ * @param [out] duty_cycle_ms Duty-cycle status: time before the next transmission is allowed if negative
+ *
+ * @returns true if the modem answered
+ */
+static bool uplink_aggregator_read_modem( const void* context, int32_t* duty_cycle_ms );
+
+/**
+ * @brief Scan the records waiting in the buffer
+ *
+ * @param [out] oldest_ms Timestamp of the oldest record
+ * @param [out] high true if a record has a high priority
+ *
+ * @returns Size of an uplink holding all the records, 0 if the buffer is empty
+ */
+static uint16_t uplink_aggregator_scan( uint32_t* oldest_ms, bool* high );
+
+/**
+ * @brief Choose the number of records of the next uplink so that the waiting records take the least time on air
+ *
+ * @param [out] time_on_air_ms Planned time on air of all the waiting records, 0 if the data rate is not known
+ *
+ * @returns Number of records of the next uplink, at least one if the buffer is not empty
+ */
+static uint8_t uplink_aggregator_plan( uint32_t* time_on_air_ms );
+
+/**
+ * @brief Pack the oldest records, at least one and up to @p nb_planned, within the maximal payload size
+ *
+ * @param [in] nb_planned Number of records to pack
+ * @param [out] payload Uplink payload
+ * @param [out] size Payload size
+ * @param [out] priority Highest priority of the packed records
+ * @param [out] nb_records Number of packed records
+ *
+ * @returns Bytes of the buffer used by the packed records
+ */
+static uint16_t uplink_aggregator_pack( uint8_t nb_planned, uint8_t* payload, uint8_t* size, uint8_t* priority,
+                                        uint8_t* nb_records );
+
+/**
+ * @brief Remove the packed records from the buffer, keeping their room to put them back
+ *
+ * @param [in] used Bytes of the buffer used by the packed records
+ */
+static void uplink_aggregator_release( uint16_t used );
+
+/**
+ * @brief Put the records of an uplink taken back from the queue in front of the buffer
+ *
+ * The records are stamped as old enough to be sent at once.
+ *
+ * @param [in] payload Payload of the uplink
+ * @param [in] size Payload size
+ * @param [in] now_ms RTC time
+ */
+static void uplink_aggregator_put_back( const uint8_t* payload, uint8_t size, uint32_t now_ms );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_uplink_aggregator_init( uint8_t port, lr1121_modem_uplink_type_t uplink_type, uint32_t max_age_ms )
+{
+    uplink_aggregator.port        = port;
+    uplink_aggregator.uplink_type = ( uint8_t ) uplink_type;
+    uplink_aggregator.max_age_ms  = max_age_ms;
+}
+
+bool apps_uplink_aggregator_add( uint8_t type, apps_uplink_queue_priority_t priority, const uint8_t* record,
+                                 uint8_t size )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+    const uint16_t needed = UPLINK_AGGREGATOR_RECORD_INFO_SIZE + 1 + size;
+    bool           added  = false;
+
+    if( ( type > APPS_UPLINK_AGGREGATOR_MAX_RECORD_TYPE ) || ( size == 0 ) ||
+        ( size > APPS_UPLINK_AGGREGATOR_MAX_RECORD_SIZE ) )
+    {
+        return false;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    if( ( uplink_aggregator.size + uplink_aggregator.reserved + needed ) <= APPS_UPLINK_AGGREGATOR_BUFFER_SIZE )
+    {
+        uint8_t* slot = &uplink_aggregator.buffer[uplink_aggregator.size];
+
+        memcpy( slot, &now_ms, sizeof( now_ms ) );
+        slot[4] = ( uint8_t ) priority;
+        slot[5] = APPS_UPLINK_AGGREGATOR_RECORD_HEADER( type, size );
+        memcpy( &slot[6], record, size );
+        uplink_aggregator.size += needed;
+        uplink_aggregator.stats.nb_records++;
+        added = true;
+    }
+    else
+    {
+        uplink_aggregator.stats.nb_dropped++;
+    }
+    CRITICAL_SECTION_END( );
+
+    return added;
+}
+
+uint32_t apps_uplink_aggregator_process( const void* context )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+    uint8_t        payload[APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE];
+    uint8_t        nb_queued = apps_uplink_queue_get_nb_entries( uplink_aggregator.port );
+    int32_t        duty_cycle_ms;
+    uint32_t       oldest_ms = 0;
+    bool           high      = false;
+    uint8_t        priority;
+    uint8_t        nb_records;
+    uint8_t        uplink_size;
+    uint16_t       used;
+    uint32_t       time_on_air_ms;
+
+    if( ( ( nb_queued != 0 ) || ( uplink_aggregator.size != 0 ) ) &&
+        ( ( int32_t )( uplink_aggregator.retry_ms - now_ms ) > 0 ) )
+    {
+        return uplink_aggregator.retry_ms - now_ms;
+    }
+
+    if( nb_queued != 0 )
+    {
+        // The queued uplink is split again if the data rate changed since it was built
+        if( uplink_aggregator_read_modem( context, &duty_cycle_ms ) == false )
+        {
+            return UPLINK_AGGREGATOR_RETRY_DELAY_MS;
+        }
+        const uint8_t size =
+            apps_uplink_queue_take_oversized( uplink_aggregator.port, uplink_aggregator.max_payload, payload );
+        if( size == 0 )
+        {
+            return APPS_UPLINK_QUEUE_IDLE;
+        }
+        HAL_DBG_TRACE_WARNING( "Uplink aggregator: %u bytes > %u bytes available, splitting the uplink\n", size,
+                               uplink_aggregator.max_payload );
+        uplink_aggregator_put_back( payload, size, now_ms );
+        uplink_aggregator.stats.nb_resplits++;
+    }
+    uplink_aggregator.reserved = 0;
+
+    const uint16_t payload_size = uplink_aggregator_scan( &oldest_ms, &high );
+    if( payload_size == 0 )
+    {
+        return APPS_UPLINK_QUEUE_IDLE;
+    }
+
+    const uint32_t age_ms = now_ms - oldest_ms;
+    if( ( high == false ) && ( age_ms < uplink_aggregator.max_age_ms ) &&
+        ( payload_size < uplink_aggregator.max_payload ) )
+    {
+        return uplink_aggregator.max_age_ms - age_ms;
+    }
+
+    // The uplink is built at the last moment, with the records added while the duty cycle did not allow it
+    if( uplink_aggregator_read_modem( context, &duty_cycle_ms ) == false )
+    {
+        return UPLINK_AGGREGATOR_RETRY_DELAY_MS;
+    }
+    if( duty_cycle_ms < 0 )
+    {
+        return ( uint32_t )( -duty_cycle_ms );
+    }
+    if( ( high == false ) && ( age_ms < uplink_aggregator.max_age_ms ) &&
+        ( payload_size < uplink_aggregator.max_payload ) )
+    {
+        return uplink_aggregator.max_age_ms - age_ms;
+    }
+
+    // The split is planned out of the critical sections, the records being only appended meanwhile
+    const uint8_t nb_planned = uplink_aggregator_plan( &time_on_air_ms );
+    used = uplink_aggregator_pack( nb_planned, payload, &uplink_size, &priority, &nb_records );
+    if( apps_uplink_queue_push( uplink_aggregator.port, ( lr1121_modem_uplink_type_t ) uplink_aggregator.uplink_type,
+                                ( apps_uplink_queue_priority_t ) priority, APPS_UPLINK_QUEUE_NO_EXPIRY, payload,
+                                uplink_size ) == false )
+    {
+        // The queue is full of uplinks of higher priority, the records wait for the next call
+        uplink_aggregator.retry_ms = now_ms + UPLINK_AGGREGATOR_RETRY_DELAY_MS;
+        return UPLINK_AGGREGATOR_RETRY_DELAY_MS;
+    }
+
+    uplink_aggregator_release( used );
+    uplink_aggregator.queued_priority = priority;
+    uplink_aggregator.stats.nb_uplinks++;
+
+    HAL_DBG_TRACE_INFO( "Uplink aggregator: %u records packed in %u bytes, %lu ms on air planned at DR%u\n",
+                        nb_records, uplink_size, time_on_air_ms, apps_airtime_get_data_rate( ) );
+    return APPS_UPLINK_QUEUE_IDLE;
+}
+
+void apps_uplink_aggregator_get_stats( apps_uplink_aggregator_stats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    *stats            = uplink_aggregator.stats;
+    stats->nb_pending = 0;
+    for( uint16_t offset = 0; offset < uplink_aggregator.size; stats->nb_pending++ )
+    {
+        offset += UPLINK_AGGREGATOR_RECORD_INFO_SIZE + 1 +
+                  APPS_UPLINK_AGGREGATOR_RECORD_SIZE( uplink_aggregator.buffer[offset + 5] );
+    }
+    CRITICAL_SECTION_END( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool uplink_aggregator_read_modem( const void* context, int32_t* duty_cycle_ms )
+{
+    uint8_t max_payload = 0;
+    bool    ok;
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    ok = ( lr1121_modem_get_duty_cycle_status( context, duty_cycle_ms ) == LR1121_MODEM_RESPONSE_CODE_OK ) &&
+         ( lr1121_modem_get_next_tx_max_payload( context, &max_payload ) == LR1121_MODEM_RESPONSE_CODE_OK );
+    hal_gpio_irq_enable( );
+
+    if( ok == false )
+    {
+        HAL_DBG_TRACE_ERROR( "Uplink aggregator: modem status read failed\n" );
+        uplink_aggregator.retry_ms = hal_rtc_get_time_ms( ) + UPLINK_AGGREGATOR_RETRY_DELAY_MS;
+        return false;
+    }
+    uplink_aggregator.max_payload = max_payload;
+    apps_airtime_update_data_rate( max_payload );
+    return true;
+}
+
+static uint16_t uplink_aggregator_scan( uint32_t* oldest_ms, bool* high )
+{
+    uint16_t payload_size = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint16_t offset = 0; offset < uplink_aggregator.size; )
+    {
+        const uint8_t* slot = &uplink_aggregator.buffer[offset];
+
+        if( offset == 0 )
+        {
+            memcpy( oldest_ms, slot, sizeof( *oldest_ms ) );
+        }
+        *high |= ( slot[4] == APPS_UPLINK_QUEUE_PRIORITY_HIGH );
+        payload_size += 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( slot[5] );
+        offset += UPLINK_AGGREGATOR_RECORD_INFO_SIZE + 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( slot[5] );
+    }
+    CRITICAL_SECTION_END( );
+
+    return payload_size;
+}
+
+static uint8_t uplink_aggregator_plan( uint32_t* time_on_air_ms )
+{
+    uint8_t sizes[APPS_AIRTIME_PLAN_MAX_ITEMS];
+    uint8_t nb_items = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint16_t offset = 0; ( offset < uplink_aggregator.size ) && ( nb_items < APPS_AIRTIME_PLAN_MAX_ITEMS ); )
+    {
+        sizes[nb_items] = 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( uplink_aggregator.buffer[offset + 5] );
+        offset += UPLINK_AGGREGATOR_RECORD_INFO_SIZE + sizes[nb_items];
+        nb_items++;
+    }
+    CRITICAL_SECTION_END( );
+
+    // Beyond APPS_AIRTIME_PLAN_MAX_ITEMS records, the first uplinks are packed at best for the oldest ones
+    return apps_airtime_plan( sizes, nb_items, uplink_aggregator.max_payload, time_on_air_ms );
+}
+
+static uint16_t uplink_aggregator_pack( uint8_t nb_planned, uint8_t* payload, uint8_t* size, uint8_t* priority,
+                                        uint8_t* nb_records )
+{
+    uint16_t offset = 0;
+
+    *size       = 0;
+    *priority   = APPS_UPLINK_QUEUE_PRIORITY_LOW;
+    *nb_records = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    while( ( offset < uplink_aggregator.size ) && ( *nb_records < nb_planned ) )
+    {
+        const uint8_t* slot        = &uplink_aggregator.buffer[offset];
+        const uint8_t  record_size = 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( slot[5] );
+
+        if( ( *nb_records != 0 ) && ( ( *size + record_size ) > uplink_aggregator.max_payload ) )
+        {
+            break;
+        }
+        memcpy( &payload[*size], &slot[5], record_size );
+        *size += record_size;
+        *priority = ( slot[4] > *priority ) ? slot[4] : *priority;
+        offset += UPLINK_AGGREGATOR_RECORD_INFO_SIZE + record_size;
+        ( *nb_records )++;
+    }
+    CRITICAL_SECTION_END( );
+
+    return offset;
+}
+
+static void uplink_aggregator_release( uint16_t used )
+{
+    // Records are only appended meanwhile: the packed ones are still in front of the buffer
+    CRITICAL_SECTION_BEGIN( );
+    memmove( uplink_aggregator.buffer, &uplink_aggregator.buffer[used], uplink_aggregator.size - used );
+    uplink_aggregator.size -= used;
+    uplink_aggregator.reserved = used;
+    CRITICAL_SECTION_END( );
+}
+
+static void uplink_aggregator_put_back( const uint8_t* payload, uint8_t size, uint32_t now_ms )
+{
+    const uint32_t timestamp_ms = now_ms - uplink_aggregator.max_age_ms;
+    uint16_t       needed       = 0;
+
+    for( uint8_t i = 0; i < size; i += 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( payload[i] ) )
+    {
+        needed += UPLINK_AGGREGATOR_RECORD_INFO_SIZE + 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( payload[i] );
+    }
+
+    // The room was reserved when the uplink was queued
+    CRITICAL_SECTION_BEGIN( );
+    memmove( &uplink_aggregator.buffer[needed], uplink_aggregator.buffer, uplink_aggregator.size );
+    uplink_aggregator.size += needed;
+    uint8_t* slot = uplink_aggregator.buffer;
+    for( uint8_t i = 0; i < size; )
+    {
+        const uint8_t record_size = 1 + APPS_UPLINK_AGGREGATOR_RECORD_SIZE( payload[i] );
+
+        memcpy( slot, &timestamp_ms, sizeof( timestamp_ms ) );
+        slot[4] = uplink_aggregator.queued_priority;
+        memcpy( &slot[5], &payload[i], record_size );
+        i += record_size;
+        slot += UPLINK_AGGREGATOR_RECORD_INFO_SIZE + record_size;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,254 @@
+/*!
+ * @file      apps_uplink_policy.c
+ *
+ * @brief     Uplink policy: confirmation and number of transmissions meeting a delivery target
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include "apps_uplink_policy.h"
+#include "apps_link_quality.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_mcu.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Success rates in per mille predicted for the lowest and the highest link health scores
+ */
+#define UPLINK_POLICY_PRIOR_MIN 500
+#define UPLINK_POLICY_PRIOR_MAX 990
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Uplink policy context
+ */
+typedef struct uplink_policy_s
+{
+    uint16_t                   target;           //!< Delivery target in per mille
+    uint16_t                   window;           //!< Outcomes of the last probes, the last one in bit 0, set if acked
+    uint8_t                    nb_window;        //!< Probes in the window
+    uint8_t                    probe_countdown;  //!< Confirmed uplinks before the next probe
+    apps_uplink_policy_stats_t stats;            //!< Counters of the statistics
+} uplink_policy_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uplink_policy_t uplink_policy;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Estimate the success rate of a transmission, and the number of transmissions meeting the delivery target
+ *
+ * @remark To be called in a critical section.
+ *
+ * @param [in] score Link health score
+ * @param [out] success Success rate of a transmission in per mille
+ * @param [out] nb_trans Fewest transmissions meeting the target, APPS_UPLINK_POLICY_MAX_NB_TRANS if none
+ * @param [out] delivery Delivery of an uplink sent @p nb_trans times in per mille
+ */
+static void uplink_policy_estimate( uint8_t score, uint16_t* success, uint8_t* nb_trans, uint16_t* delivery );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_uplink_policy_init( uint16_t target )
+{
+    CRITICAL_SECTION_BEGIN( );
+    uplink_policy.target = ( target > 1000 ) ? 1000 : target;
+    CRITICAL_SECTION_END( );
+}
+
+apps_uplink_policy_decision_t apps_uplink_policy_decide( lr1121_modem_uplink_type_t uplink_type )
+{
+    apps_uplink_policy_decision_t decision = { .uplink_type = uplink_type, .nb_trans = 0, .probe = false };
+    apps_link_quality_health_t    health;
+    uint16_t                      success;
+    uint16_t                      delivery;
+    uint8_t                       nb_trans;
+
+    if( uplink_policy.target == APPS_UPLINK_POLICY_DISABLED )
+    {
+        return decision;
+    }
+    apps_link_quality_get_health( &health );
+
+    CRITICAL_SECTION_BEGIN( );
+    uplink_policy_estimate( health.score, &success, &nb_trans, &delivery );
+    if( uplink_type == LR1121_MODEM_UPLINK_CONFIRMED )
+    {
+        if( ( uplink_policy.nb_window < APPS_UPLINK_POLICY_MIN_PROBES ) || ( uplink_policy.probe_countdown == 0 ) )
+        {
+            decision.probe                = true;
+            uplink_policy.probe_countdown = APPS_UPLINK_POLICY_PROBE_PERIOD;
+        }
+        else
+        {
+            uplink_policy.probe_countdown--;
+        }
+    }
+    CRITICAL_SECTION_END( );
+
+    if( decision.probe == true )
+    {
+        decision.nb_trans = 1;
+    }
+    else if( ( uplink_type == LR1121_MODEM_UPLINK_CONFIRMED ) && ( delivery < uplink_policy.target ) )
+    {
+        // Out of reach without feedback: the acknowledgement stops the retransmissions as soon as one gets through
+        decision.nb_trans = APPS_UPLINK_POLICY_MAX_NB_TRANS;
+    }
+    else
+    {
+        decision.uplink_type = LR1121_MODEM_UPLINK_UNCONFIRMED;
+        decision.nb_trans    = nb_trans;
+    }
+
+    HAL_DBG_TRACE_INFO( "Uplink policy: %s x%u, success %u/1000, delivery %u/1000\n",
+                        ( decision.uplink_type == LR1121_MODEM_UPLINK_CONFIRMED ) ? "confirmed" : "unconfirmed",
+                        decision.nb_trans, success, delivery );
+    return decision;
+}
+
+void apps_uplink_policy_on_tx_done( const apps_uplink_policy_decision_t* decision,
+                                    lr1121_modem_tx_done_event_t         tx_done_status )
+{
+    if( tx_done_status == LR1121_MODEM_TX_NOT_SENT )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    if( decision->uplink_type == LR1121_MODEM_UPLINK_CONFIRMED )
+    {
+        uplink_policy.stats.nb_confirmed++;
+    }
+    else
+    {
+        uplink_policy.stats.nb_unconfirmed++;
+    }
+    uplink_policy.stats.nb_transmissions += ( decision->nb_trans == 0 ) ? 1 : decision->nb_trans;
+    if( decision->probe == true )
+    {
+        uplink_policy.window = ( uint16_t ) ( uplink_policy.window << 1 ) |
+                               ( ( tx_done_status == LR1121_MODEM_CONFIRMED_TX ) ? 1 : 0 );
+        if( uplink_policy.nb_window < APPS_UPLINK_POLICY_WINDOW_SIZE )
+        {
+            uplink_policy.nb_window++;
+        }
+        uplink_policy.stats.nb_probes++;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void apps_uplink_policy_get_stats( apps_uplink_policy_stats_t* stats )
+{
+    apps_link_quality_health_t health;
+
+    apps_link_quality_get_health( &health );
+
+    CRITICAL_SECTION_BEGIN( );
+    *stats                 = uplink_policy.stats;
+    stats->target          = uplink_policy.target;
+    stats->nb_window       = uplink_policy.nb_window;
+    stats->nb_window_acked = 0;
+    for( uint8_t i = 0; i < uplink_policy.nb_window; i++ )
+    {
+        stats->nb_window_acked += ( uplink_policy.window >> i ) & 1;
+    }
+    uplink_policy_estimate( health.score, &stats->success, &stats->nb_trans, &stats->delivery );
+    CRITICAL_SECTION_END( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void uplink_policy_estimate( uint8_t score, uint16_t* success, uint8_t* nb_trans, uint16_t* delivery )
+{
+    uint32_t prior    = UPLINK_POLICY_PRIOR_MIN;
+    uint32_t nb_acked = 0;
+    uint32_t missed;
+    uint32_t residual;
+    uint8_t  n = 1;
+
+    if( score != APPS_LINK_QUALITY_UNKNOWN_SCORE )
+    {
+        prior += ( uint32_t ) score * ( UPLINK_POLICY_PRIOR_MAX - UPLINK_POLICY_PRIOR_MIN ) / 100;
+    }
+    for( uint8_t i = 0; i < uplink_policy.nb_window; i++ )
+    {
+        nb_acked += ( uplink_policy.window >> i ) & 1;
+    }
+    *success = ( uint16_t ) ( ( nb_acked * 1000 + prior * APPS_UPLINK_POLICY_PRIOR_WEIGHT ) /
+                              ( uplink_policy.nb_window + APPS_UPLINK_POLICY_PRIOR_WEIGHT ) );
+
+    // An uplink sent n times is lost if all its transmissions are
+    missed   = 1000 - *success;
+    residual = missed;
+    while( ( ( 1000 - residual ) < uplink_policy.target ) && ( n < APPS_UPLINK_POLICY_MAX_NB_TRANS ) )
+    {
+        residual = residual * missed / 1000;
+        n++;
+    }
+    *nb_trans = n;
+    *delivery = ( uint16_t ) ( 1000 - residual );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,469 @@
+/*!
+ * @file      apps_uplink_queue.c
+ *
+ * @brief     Duty-cycle aware queue of the application uplinks
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "apps_uplink_queue.h"
+#include "apps_adr_optimizer.h"
+#include "apps_airtime.h"
+#include "apps_uplink_policy.h"
+#include "lr1121_modem_lorawan.h"
+#include "smtc_hal_dbg_trace.h"
+#include "smtc_hal_gpio.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Index of the transmitted uplink when no uplink or an empty one is transmitted
+ */
+#define UPLINK_QUEUE_NO_ENTRY 0xFF
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Queued uplink
+ */
+typedef struct uplink_queue_entry_s
+{
+    uint32_t sequence;     //!< Queuing order, identifies the entry
+    uint32_t expiry_ms;    //!< RTC time after which the uplink is dropped, if expires is true
+    bool     used;         //!< true if the entry holds an uplink
+    bool     expires;      //!< true if the uplink has a lifetime
+    uint8_t  port;         //!< LoRaWAN port
+    uint8_t  uplink_type;  //!< lr1121_modem_uplink_type_t
+    uint8_t  priority;     //!< apps_uplink_queue_priority_t
+    uint8_t  size;         //!< Payload size
+    uint8_t  payload[APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE];
+} uplink_queue_entry_t;
+
+/**
+ * @brief Uplink queue context
+ */
+typedef struct uplink_queue_s
+{
+    uplink_queue_entry_t              entries[APPS_UPLINK_QUEUE_SIZE];
+    uint32_t                          next_sequence;    //!< Sequence of the next queued uplink
+    volatile bool                     tx_pending;       //!< A transmission waits for its TX_DONE event
+    uint8_t                           tx_index;         //!< Entry being transmitted, UPLINK_QUEUE_NO_ENTRY if empty
+    uint32_t                          tx_sequence;      //!< Sequence of the entry being transmitted
+    uint32_t                          tx_start_ms;      //!< RTC time of the transmission request
+    apps_uplink_policy_decision_t     tx_decision;      //!< How the entry being transmitted is sent
+    uint8_t                           tx_data_rate;     //!< Data rate of the entry being transmitted
+    uint32_t                          next_attempt_ms;  //!< RTC time before which no transmission is requested
+    apps_uplink_queue_stats_t         stats;            //!< Statistics, except nb_entries and tx_pending
+    apps_uplink_queue_sent_callback_t sent_callback;    //!< Callback of the sent uplinks
+} uplink_queue_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uplink_queue_t uplink_queue = { 0 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Find the next uplink to send: highest priority first, then the oldest one
+ *
+ * @remark To be called in a critical section.
+ *
+ * @param [in] skip_index Entry not to be selected, UPLINK_QUEUE_NO_ENTRY to consider all of them
+ * @param [in] lowest true to find the oldest uplink of the lowest priority instead, the next one to be evicted
+ *
+ * @returns Index of the entry, UPLINK_QUEUE_NO_ENTRY if the queue is empty
+ */
+static uint8_t uplink_queue_select( uint8_t skip_index, bool lowest );
+
+/**
+ * @brief Drop the uplinks whose lifetime elapsed, except the one being transmitted
+ *
+ * @remark To be called in a critical section.
+ *
+ * @param [in] now_ms RTC time
+ */
+static void uplink_queue_expire( uint32_t now_ms );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void apps_uplink_queue_set_sent_callback( apps_uplink_queue_sent_callback_t callback )
+{
+    uplink_queue.sent_callback = callback;
+}
+
+bool apps_uplink_queue_push( uint8_t port, lr1121_modem_uplink_type_t uplink_type,
+                             apps_uplink_queue_priority_t priority, uint32_t lifetime_ms, const uint8_t* payload,
+                             uint8_t size )
+{
+    const uint32_t now_ms = hal_rtc_get_time_ms( );
+    uint8_t        index  = UPLINK_QUEUE_NO_ENTRY;
+
+    if( size > APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE )
+    {
+        return false;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < APPS_UPLINK_QUEUE_SIZE; i++ )
+    {
+        if( uplink_queue.entries[i].used == false )
+        {
+            index = i;
+            break;
+        }
+    }
+
+    if( index == UPLINK_QUEUE_NO_ENTRY )
+    {
+        // The uplink being transmitted is never evicted: its TX_DONE event would remove another one
+        const uint8_t skip_index = ( uplink_queue.tx_pending == true ) ? uplink_queue.tx_index : UPLINK_QUEUE_NO_ENTRY;
+
+        index = uplink_queue_select( skip_index, true );
+        if( ( index != UPLINK_QUEUE_NO_ENTRY ) && ( uplink_queue.entries[index].priority >= priority ) )
+        {
+            index = UPLINK_QUEUE_NO_ENTRY;
+        }
+        uplink_queue.stats.nb_dropped++;
+    }
+
+    if( index != UPLINK_QUEUE_NO_ENTRY )
+    {
+        uplink_queue_entry_t* entry = &uplink_queue.entries[index];
+
+        entry->sequence    = uplink_queue.next_sequence++;
+        entry->expiry_ms   = now_ms + lifetime_ms;
+        entry->used        = true;
+        entry->expires     = ( lifetime_ms != APPS_UPLINK_QUEUE_NO_EXPIRY );
+        entry->port        = port;
+        entry->uplink_type = ( uint8_t ) uplink_type;
+        entry->priority    = ( uint8_t ) priority;
+        entry->size        = size;
+        memcpy( entry->payload, payload, size );
+        uplink_queue.stats.nb_queued++;
+    }
+    CRITICAL_SECTION_END( );
+
+    return index != UPLINK_QUEUE_NO_ENTRY;
+}
+
+void apps_uplink_queue_on_tx_done( lr1121_modem_tx_done_event_t tx_done_status )
+{
+    apps_uplink_policy_decision_t decision;
+    uint8_t                       data_rate = APPS_AIRTIME_UNKNOWN_DATA_RATE;
+    bool                          sent      = false;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( uplink_queue.tx_pending == true )
+    {
+        if( uplink_queue.tx_index == UPLINK_QUEUE_NO_ENTRY )
+        {
+            // The empty uplink flushed the MAC commands: the queued one is sent next
+        }
+        else if( tx_done_status == LR1121_MODEM_TX_NOT_SENT )
+        {
+            uplink_queue.stats.nb_not_sent++;
+        }
+        else if( uplink_queue.entries[uplink_queue.tx_index].sequence == uplink_queue.tx_sequence )
+        {
+            const uplink_queue_entry_t* entry = &uplink_queue.entries[uplink_queue.tx_index];
+
+            if( uplink_queue.sent_callback != NULL )
+            {
+                uplink_queue.sent_callback( entry->port, entry->payload, entry->size, tx_done_status );
+            }
+            uplink_queue.entries[uplink_queue.tx_index].used = false;
+            uplink_queue.stats.nb_sent++;
+            decision  = uplink_queue.tx_decision;
+            data_rate = uplink_queue.tx_data_rate;
+            sent      = true;
+        }
+        uplink_queue.tx_pending = false;
+    }
+    CRITICAL_SECTION_END( );
+
+    if( sent == true )
+    {
+        apps_uplink_policy_on_tx_done( &decision, tx_done_status );
+        apps_adr_optimizer_on_tx_done( data_rate, decision.uplink_type, tx_done_status );
+    }
+}
+
+uint32_t apps_uplink_queue_process( const void* context )
+{
+    const uint32_t               now_ms = hal_rtc_get_time_ms( );
+    lr1121_modem_response_code_t rc     = LR1121_MODEM_RESPONSE_CODE_OK;
+    int32_t                      duty_cycle_ms;
+    uint8_t                      tx_max_payload;
+    uint8_t                      index;
+    uplink_queue_entry_t         entry;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( ( uplink_queue.tx_pending == true ) &&
+        ( ( int32_t )( now_ms - uplink_queue.tx_start_ms ) >= APPS_UPLINK_QUEUE_TX_TIMEOUT_MS ) )
+    {
+        // No TX_DONE event, the modem may have been reset: the uplink is sent again
+        HAL_DBG_TRACE_WARNING( "Uplink queue: no TX_DONE event, transmission dropped\n" );
+        uplink_queue.tx_pending = false;
+    }
+    uplink_queue_expire( now_ms );
+    index = uplink_queue_select( UPLINK_QUEUE_NO_ENTRY, false );
+    if( index != UPLINK_QUEUE_NO_ENTRY )
+    {
+        entry = uplink_queue.entries[index];
+    }
+    CRITICAL_SECTION_END( );
+
+    if( uplink_queue.tx_pending == true )
+    {
+        return APPS_UPLINK_QUEUE_TX_TIMEOUT_MS - ( now_ms - uplink_queue.tx_start_ms );
+    }
+    if( index == UPLINK_QUEUE_NO_ENTRY )
+    {
+        return APPS_UPLINK_QUEUE_IDLE;
+    }
+    if( ( int32_t )( uplink_queue.next_attempt_ms - now_ms ) > 0 )
+    {
+        return uplink_queue.next_attempt_ms - now_ms;
+    }
+
+    // Mask the modem events, whose handler talks to the modem as well and reports the TX_DONE event
+    hal_gpio_irq_disable( );
+
+    if( ( lr1121_modem_get_duty_cycle_status( context, &duty_cycle_ms ) == LR1121_MODEM_RESPONSE_CODE_OK ) &&
+        ( duty_cycle_ms < 0 ) )
+    {
+        hal_gpio_irq_enable( );
+        uplink_queue.next_attempt_ms = now_ms - duty_cycle_ms;
+        return ( uint32_t )( -duty_cycle_ms );
+    }
+
+    uplink_queue.tx_data_rate = APPS_AIRTIME_UNKNOWN_DATA_RATE;
+    if( lr1121_modem_get_next_tx_max_payload( context, &tx_max_payload ) != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        tx_max_payload = APPS_UPLINK_QUEUE_MAX_PAYLOAD_SIZE;
+    }
+    else if( apps_airtime_update_data_rate( tx_max_payload ) == true )
+    {
+        uplink_queue.tx_data_rate = apps_airtime_get_data_rate( );
+    }
+
+    if( entry.size > tx_max_payload )
+    {
+        // Send an empty uplink to flush the MAC commands, the uplink stays in the queue
+        HAL_DBG_TRACE_WARNING( "Uplink queue: %u bytes > %u bytes available, sending an empty uplink\n", entry.size,
+                               tx_max_payload );
+        rc    = lr1121_modem_request_tx( context, entry.port, LR1121_MODEM_UPLINK_UNCONFIRMED, NULL, 0 );
+        index = UPLINK_QUEUE_NO_ENTRY;
+        if( rc == LR1121_MODEM_RESPONSE_CODE_OK )
+        {
+            uplink_queue.stats.nb_flushes++;
+        }
+    }
+    else
+    {
+        uplink_queue.tx_decision = apps_uplink_policy_decide( ( lr1121_modem_uplink_type_t ) entry.uplink_type );
+        if( uplink_queue.tx_decision.nb_trans != 0 )
+        {
+            rc = lr1121_modem_set_nb_trans( context, uplink_queue.tx_decision.nb_trans );
+        }
+        if( rc == LR1121_MODEM_RESPONSE_CODE_OK )
+        {
+            rc = lr1121_modem_request_tx( context, entry.port, uplink_queue.tx_decision.uplink_type, entry.payload,
+                                          entry.size );
+        }
+    }
+
+    if( rc == LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        uplink_queue.tx_pending  = true;
+        uplink_queue.tx_index    = index;
+        uplink_queue.tx_sequence = entry.sequence;
+        uplink_queue.tx_start_ms = now_ms;
+    }
+    hal_gpio_irq_enable( );
+
+    if( rc != LR1121_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "Uplink queue: transmission request failed, rc %d\n", rc );
+        uplink_queue.next_attempt_ms = now_ms + APPS_UPLINK_QUEUE_RETRY_DELAY_MS;
+        return APPS_UPLINK_QUEUE_RETRY_DELAY_MS;
+    }
+
+    HAL_DBG_TRACE_INFO( "Uplink queue: %u bytes requested on port %u\n",
+                        ( index == UPLINK_QUEUE_NO_ENTRY ) ? 0 : entry.size, entry.port );
+    return APPS_UPLINK_QUEUE_TX_TIMEOUT_MS;
+}
+
+uint8_t apps_uplink_queue_get_nb_entries( uint8_t port )
+{
+    uint8_t nb_entries = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < APPS_UPLINK_QUEUE_SIZE; i++ )
+    {
+        if( ( uplink_queue.entries[i].used == true ) && ( uplink_queue.entries[i].port == port ) )
+        {
+            nb_entries++;
+        }
+    }
+    CRITICAL_SECTION_END( );
+
+    return nb_entries;
+}
+
+uint8_t apps_uplink_queue_take_oversized( uint8_t port, uint8_t max_size, uint8_t* payload )
+{
+    uint8_t index = UPLINK_QUEUE_NO_ENTRY;
+    uint8_t size  = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < APPS_UPLINK_QUEUE_SIZE; i++ )
+    {
+        const uplink_queue_entry_t* entry = &uplink_queue.entries[i];
+
+        if( ( entry->used == true ) && ( entry->port == port ) && ( entry->size > max_size ) &&
+            ( ( uplink_queue.tx_pending == false ) || ( i != uplink_queue.tx_index ) ) &&
+            ( ( index == UPLINK_QUEUE_NO_ENTRY ) ||
+              ( ( int32_t )( entry->sequence - uplink_queue.entries[index].sequence ) < 0 ) ) )
+        {
+            index = i;
+        }
+    }
+    if( index != UPLINK_QUEUE_NO_ENTRY )
+    {
+        size = uplink_queue.entries[index].size;
+        memcpy( payload, uplink_queue.entries[index].payload, size );
+        uplink_queue.entries[index].used = false;
+    }
+    CRITICAL_SECTION_END( );
+
+    return size;
+}
+
+void apps_uplink_queue_get_stats( apps_uplink_queue_stats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    *stats            = uplink_queue.stats;
+    stats->nb_entries = 0;
+    for( uint8_t i = 0; i < APPS_UPLINK_QUEUE_SIZE; i++ )
+    {
+        if( uplink_queue.entries[i].used == true )
+        {
+            stats->nb_entries++;
+        }
+    }
+    stats->tx_pending = uplink_queue.tx_pending;
+    CRITICAL_SECTION_END( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint8_t uplink_queue_select( uint8_t skip_index, bool lowest )
+{
+    uint8_t selected = UPLINK_QUEUE_NO_ENTRY;
+
+    for( uint8_t i = 0; i < APPS_UPLINK_QUEUE_SIZE; i++ )
+    {
+        const uplink_queue_entry_t* entry = &uplink_queue.entries[i];
+
+        if( ( entry->used == false ) || ( i == skip_index ) )
+        {
+            continue;
+        }
+        if( selected == UPLINK_QUEUE_NO_ENTRY )
+        {
+            selected = i;
+        }
+        else if( entry->priority != uplink_queue.entries[selected].priority )
+        {
+            if( ( entry->priority < uplink_queue.entries[selected].priority ) == lowest )
+            {
+                selected = i;
+            }
+        }
+        else if( ( int32_t )( entry->sequence - uplink_queue.entries[selected].sequence ) < 0 )
+        {
+            selected = i;
+        }
+    }
+    return selected;
+}
+
+static void uplink_queue_expire( uint32_t now_ms )
+{
+    for( uint8_t i = 0; i < APPS_UPLINK_QUEUE_SIZE; i++ )
+    {
+        uplink_queue_entry_t* entry = &uplink_queue.entries[i];
+
+        if( ( entry->used == true ) && ( entry->expires == true ) &&
+            ( ( uplink_queue.tx_pending == false ) || ( i != uplink_queue.tx_index ) ) &&
+            ( ( int32_t )( now_ms - entry->expiry_ms ) >= 0 ) )
+        {
+            entry->used = false;
+            uplink_queue.stats.nb_expired++;
+        }
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -86,6 +86,11 @@ void print_hex_buffer( const uint8_t* buffer, uint8_t size )
 {
     uint8_t newline = 0;
 
+    if( !HAL_DBG_TRACE_IS_ENABLED( HAL_DBG_TRACE_LEVEL_DEBUG ) )
+    {
+        return;
+    }
+
     for( uint8_t i = 0; i < size; i++ )
     {
         if( newline != 0 )
@@ -104,6 +109,23 @@ void print_hex_buffer( const uint8_t* buffer, uint8_t size )
     HAL_DBG_TRACE_PRINTF( "\n\n" );
 }
 
+bool set_trace_levels_from_downlink( uint8_t port, const uint8_t* payload, uint8_t size )
+{
+    if( ( port != TRACE_LEVEL_DOWNLINK_PORT ) || ( size == 0 ) || ( ( size % 2 ) != 0 ) )
+    {
+        return false;
+    }
+
+    for( uint8_t i = 0; i < size; i += 2 )
+    {
+        if( hal_dbg_trace_set_level( ( hal_dbg_trace_module_t ) payload[i], payload[i + 1] ) == false )
+        {
+            HAL_DBG_TRACE_WARNING( "Invalid trace level %u for module %u\n", payload[i + 1], payload[i] );
+        }
+    }
+    return true;
+}
+
 void print_version( lr1121_modem_version_t modem_version )
 {
     HAL_DBG_TRACE_INFO( "###### ===== lr1121 MODEM-E VERSION ==== ######\n\n\n" );
@@ -52,8 +52,16 @@
 #include "lorawan_commissioning.h"
 #include "lr1121_modem_board.h"
 #include "apps_utilities.h"
+#include "apps_airtime.h"
+#include "apps_downlink_rx.h"
 #include "lr1121_modem_helper.h"
 #include "lr1121_modem_system_types.h"
+#include "apps_fuota_file.h"
+#include "apps_fuota_image.h"
+#include "apps_join_manager.h"
+#include "apps_kv_store.h"
+#include "apps_modem_update.h"
+#include "smtc_hal_flash.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -115,6 +123,12 @@
  */
 #define WATCHDOG_RELOAD_PERIOD_MS 20000
 
+/**
+ * @brief Largest random delay before the first join request after reset, spreading the joins of the devices powered up
+ * together
+ */
+#define JOIN_START_JITTER_MS 30000
+
 /**
  * @brief Periodical uplink alarm delay in seconds
  */
@@ -122,11 +136,6 @@
 
 #define EXTI_BUTTON PC_13
 
-/*!
- * @brief User application data buffer size
- */
-#define LORAWAN_APP_DATA_MAX_SIZE 242
-
 /*!
  * @brief LoRaWAN regulatory region.
  * One of:
@@ -165,6 +174,15 @@ static const uint8_t user_app_key[16] = LORAWAN_APP_KEY;
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/**
+ * @brief Keys of the values saved in the key-value store, the LoRaWAN example uses 0 and 1
+ */
+typedef enum
+{
+    KV_STORE_KEY_FUOTA_IMAGE  = 2,
+    KV_STORE_KEY_MODEM_UPDATE = 3,
+} kv_store_key_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -173,6 +191,8 @@ static const uint8_t user_app_key[16] = LORAWAN_APP_KEY;
 extern lr1121_t lr1121;
 
 static volatile bool user_button_is_press = false;  // Flag for button status
+static volatile bool fuota_file_available = false;  // Flag set when the modem holds a complete FUOTA file
+static volatile bool network_joined       = false;  // Flag set when the new image reached the network
 
 /**
  * @brief Internal credentials
@@ -198,6 +218,11 @@ static void user_button_callback( void* context );
  */
 static lr1121_modem_response_code_t send_empty_uplink( const lr1121_modem_uplink_type_t tx_confirmed );
 
+/**
+ * @brief Extract the FUOTA file held by the modem, then activate the MCU image or write the modem firmware it carries
+ */
+static void fuota_file_process( void );
+
 /**
  * @brief Process received events
  *
@@ -236,6 +261,22 @@ int main( void )
     HAL_DBG_TRACE_INFO( "###### ===== FUOTA example is starting (with uplink every %d sec) ==== ######\r\n\r\n",
                         PERIODICAL_UPLINK_DELAY_S );
 
+    // Count the boots of a new image, which rolls it back if it was never confirmed
+    const apps_fuota_image_config_t fuota_image_config = {
+        .image_first_page      = FLASH_USER_FUOTA_IMAGE_START_PAGE,
+        .image_nb_pages        = FLASH_USER_FUOTA_IMAGE_NB_PAGES,
+        .persistent_first_page = FLASH_USER_PERSISTENT_START_PAGE,
+        .persistent_nb_pages   = FLASH_USER_PERSISTENT_NB_PAGES,
+        .kv_key                = KV_STORE_KEY_FUOTA_IMAGE,
+        .max_boot_attempts     = APPS_FUOTA_IMAGE_MAX_BOOT_ATTEMPTS,
+    };
+    if( apps_kv_store_init( FLASH_USER_KV_STORE_START_PAGE, FLASH_USER_KV_STORE_NB_PAGES ) == false )
+    {
+        HAL_DBG_TRACE_ERROR( "Key-value store mount failed\n" );
+    }
+    apps_fuota_image_init( &fuota_image_config );
+    apps_modem_update_init( KV_STORE_KEY_MODEM_UPDATE );
+
     // Disable IRQ to avoid unwanted behavior during init
     hal_mcu_disable_irq( );
 
@@ -255,6 +296,17 @@ int main( void )
     };
     hal_gpio_init_in( lr1121.event.pin, HAL_GPIO_PULL_MODE_NONE, HAL_GPIO_IRQ_MODE_RISING, &event_callback );
 
+    // Flash areas receiving the FUOTA files
+    const apps_fuota_file_config_t fuota_file_config = {
+        .file_first_page    = FLASH_USER_FUOTA_FILE_START_PAGE,
+        .file_nb_pages      = FLASH_USER_FUOTA_FILE_NB_PAGES,
+        .image_first_page   = FLASH_USER_FUOTA_IMAGE_START_PAGE,
+        .image_nb_pages     = FLASH_USER_FUOTA_IMAGE_NB_PAGES,
+        .journal_first_page = FLASH_USER_FUOTA_JOURNAL_START_PAGE,
+        .journal_nb_pages   = FLASH_USER_FUOTA_JOURNAL_NB_PAGES,
+    };
+    apps_fuota_file_init( &fuota_file_config );
+
     // Flush events before enabling irq
     lr1121_modem_board_event_flush( &lr1121 );
 
@@ -265,6 +317,14 @@ int main( void )
     leds_blink( LED_TX_MASK, 100, 20, true );
     HAL_DBG_TRACE_MSG( "Initialization done\r\n" );
 
+    // A modem firmware update interrupted by a MCU reset left the modem in its bootloader
+    apps_modem_update_image_t modem_image;
+    if( apps_modem_update_is_pending( &modem_image ) == true )
+    {
+        HAL_DBG_TRACE_WARNING( "Resuming the modem firmware update\n" );
+        apps_modem_update_run( &lr1121, &modem_image, NULL );
+    }
+
     lr1121_modem_system_reboot( &lr1121, false );
 
     while( 1 )
@@ -285,11 +345,37 @@ int main( void )
             }
         }
 
+        // Copy the received file in the staging area, out of the modem event interrupt
+        if( fuota_file_available == true )
+        {
+            fuota_file_available = false;
+            fuota_file_process( );
+        }
+
+        // The new image reached the network: cancel its rollback
+        if( network_joined == true )
+        {
+            network_joined = false;
+            if( apps_fuota_image_confirm( ) == APPS_FUOTA_IMAGE_STATUS_OK )
+            {
+                HAL_DBG_TRACE_INFO( "Running image confirmed\n" );
+            }
+        }
+
+        apps_kv_store_process( );
+
+        // Send the join request scheduled after reset or after a join failure
+        uint32_t sleep_ms = apps_join_manager_process( &lr1121 );
+        if( sleep_ms > WATCHDOG_RELOAD_PERIOD_MS )
+        {
+            sleep_ms = WATCHDOG_RELOAD_PERIOD_MS;
+        }
+
         hal_mcu_disable_irq( );
-        if( ( user_button_is_press == false ) )
+        if( ( user_button_is_press == false ) && ( fuota_file_available == false ) && ( network_joined == false ) )
         {
             hal_watchdog_reload( );
-            hal_mcu_set_sleep_for_ms( WATCHDOG_RELOAD_PERIOD_MS );
+            hal_mcu_set_sleep_for_ms( ( int32_t ) sleep_ms );
         }
         hal_watchdog_reload( );
         hal_mcu_enable_irq( );
@@ -321,6 +407,13 @@ static void event_process( void* context )
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_system_cfg_lfclk( context, LR1121_MODEM_SYSTEM_LFCLK_XTAL, true ) );
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_crystal_error( context, 50 ) );
                 get_and_print_crashlog( context );
+
+                // An extraction interrupted by a MCU reset resumes if the modem still holds the file
+                if( apps_fuota_file_is_pending( ) == true )
+                {
+                    fuota_file_available = true;
+                }
+
 #if( !USE_LR11XX_CREDENTIALS )
                 // Set user credentials
                 HAL_DBG_TRACE_INFO( "###### ===== LR1121 SET EUI and KEYS ==== ######\r\n" );
@@ -354,9 +447,13 @@ static void event_process( void* context )
                         lr1121_modem_set_certification_mode( context, LR1121_MODEM_CERTIFICATION_MODE_ENABLE ) );
                 }
 
-                // Schedule a Join LoRaWAN network
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_join( context ) );
-                HAL_DBG_TRACE_INFO( "###### ===== JOINING ==== ######\r\n\r\n" );
+                // Data rates of the region, the join data rate distribution is built from
+                if( apps_airtime_init( LORAWAN_REGION_USED ) == false )
+                {
+                    HAL_DBG_TRACE_WARNING( "No data rate table for this region, default join distribution\r\n" );
+                }
+                // Schedule a LoRaWAN network JoinRequest after a random delay, sent from the main loop
+                apps_join_manager_start( context, JOIN_START_JITTER_MS );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_ALARM:
@@ -370,6 +467,8 @@ static void event_process( void* context )
             case LR1121_MODEM_LORAWAN_EVENT_JOINED:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINED\n", HAL_DBG_TRACE_COLOR_BLUE );
                 HAL_DBG_TRACE_INFO( "Modem is now joined \r\n" );
+                apps_join_manager_on_joined( );
+                network_joined = true;
 
                 uint8_t adr_custom_list[16] = { 0 };
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_adr_profile(
@@ -422,23 +521,25 @@ static void event_process( void* context )
 
             case LR1121_MODEM_LORAWAN_EVENT_DOWN_DATA:
             {
-                uint8_t rx_payload[LORAWAN_APP_DATA_MAX_SIZE] = { 0 };  // Buffer for rx payload
-                uint8_t rx_payload_size                       = 0;      // Size of the payload in the rx_payload buffer
-                lr1121_modem_downlink_metadata_t rx_metadata  = { 0 };  // Metadata of downlink
-                uint8_t                          rx_remaining = 0;      // Remaining downlink payload in modem
+                const apps_downlink_rx_frame_t* downlink;
 
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: DOWNDATA\r\n", HAL_DBG_TRACE_COLOR_BLUE );
-                // Get downlink data
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data_size( context, &rx_payload_size, &rx_remaining ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data( context, rx_payload, rx_payload_size ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_metadata( context, &rx_metadata ) );
-                HAL_DBG_TRACE_PRINTF( "Data received on port %u\n", rx_metadata.fport );
-                HAL_DBG_TRACE_ARRAY( "Received payload", rx_payload, rx_payload_size );
+                // Get all the downlinks waiting in the modem, then handle them in order
+                apps_downlink_rx_drain( context );
+                while( ( downlink = apps_downlink_rx_take( ) ) != NULL )
+                {
+                    HAL_DBG_TRACE_PRINTF( "Data received on port %u\n", downlink->metadata.fport );
+                    HAL_DBG_TRACE_ARRAY( "Received payload", downlink->payload, downlink->size );
+                    set_trace_levels_from_downlink( downlink->metadata.fport, downlink->payload, downlink->size );
+                    apps_downlink_rx_release( downlink );
+                }
             }
             break;
 
             case LR1121_MODEM_LORAWAN_EVENT_JOIN_FAIL:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINFAIL\r\n", HAL_DBG_TRACE_COLOR_BLUE );
+                // Retry after a random backoff instead of the automatic retry of the modem
+                apps_join_manager_on_join_fail( context );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_LINK_CHECK:
@@ -487,6 +588,10 @@ static void event_process( void* context )
             {
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: FUOTA DONE\r\n", HAL_DBG_TRACE_COLOR_BLUE );
                 HAL_DBG_TRACE_PRINTF( "  --> FUOTA status %02x\n", ( uint8_t )( current_event.data >> 8 ) );
+                if( ( uint8_t )( current_event.data >> 8 ) == LR1121_MODEM_FUOTA_STATUS_TERMINATED_SUCCESSFULLY )
+                {
+                    fuota_file_available = true;
+                }
                 break;
             }
             case LR1121_MODEM_LORAWAN_EVENT_REGIONAL_DUTY_CYCLE:
@@ -544,6 +649,58 @@ static lr1121_modem_response_code_t send_empty_uplink( const lr1121_modem_uplink
     return modem_response_code;
 }
 
+static void fuota_file_process( void )
+{
+    apps_fuota_image_info_t image_info;
+    apps_fuota_file_info_t  file_info;
+
+    // The staging bank holds the image to roll back to until the running one is confirmed
+    apps_fuota_image_get_info( &image_info );
+    if( image_info.state == APPS_FUOTA_IMAGE_STATE_TRIAL )
+    {
+        HAL_DBG_TRACE_WARNING( "FUOTA file ignored: running image not confirmed yet\n" );
+        return;
+    }
+
+    if( ( apps_fuota_file_extract( &lr1121, &file_info ) != APPS_FUOTA_FILE_STATUS_OK ) ||
+        ( file_info.is_image == false ) )
+    {
+        return;
+    }
+
+    if( ( file_info.header.flags & APPS_FUOTA_FILE_FLAG_MODEM ) != 0 )
+    {
+        const apps_modem_update_image_t modem_image = {
+            .address = ADDR_FLASH_PAGE( FLASH_USER_FUOTA_IMAGE_START_PAGE ),
+            .size    = file_info.header.image_size,
+            .crc     = file_info.header.image_crc,
+            .version = file_info.header.version,
+        };
+        if( apps_modem_update_run( &lr1121, &modem_image, NULL ) != APPS_MODEM_UPDATE_STATUS_OK )
+        {
+            HAL_DBG_TRACE_ERROR( "Modem firmware update failed\n" );
+        }
+        return;
+    }
+
+    const apps_fuota_image_header_t header = {
+        .version = file_info.header.version,
+        .size    = file_info.header.image_size,
+        .crc     = file_info.header.image_crc,
+    };
+    if( apps_fuota_image_stage( &header ) != APPS_FUOTA_IMAGE_STATUS_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "FUOTA image staging failed\n" );
+        return;
+    }
+
+    HAL_DBG_TRACE_INFO( "Activating FUOTA image version %lu\n", header.version );
+    if( apps_fuota_image_activate( ) != APPS_FUOTA_IMAGE_STATUS_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "FUOTA image activation failed\n" );
+    }
+}
+
 void get_and_print_multicast_class_b_group_information( void* context, uint8_t group_id )
 {
     lr1121_modem_multicast_class_b_status_t mc_b_status = { 0 };
@@ -49,12 +49,19 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include "lorawan_commissioning.h"
 #include "lr1121_modem_board.h"
 #include "smtc_utilities.h"
 #include "apps_utilities.h"
+#include "apps_airtime.h"
+#include "apps_downlink_rx.h"
+#include "apps_join_manager.h"
+#include "apps_kv_store.h"
+#include "apps_multicast_session.h"
 #include "lr1121_modem_system_types.h"
 #include "lr1121_modem_helper.h"
+#include "smtc_hal_flash.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -123,14 +130,15 @@
 #define WATCHDOG_RELOAD_PERIOD_MS 20000
 
 /**
- * @brief Pin of the nucleo button
+ * @brief Largest random delay before the first join request after reset, spreading the joins of the devices powered up
+ * together
  */
-#define EXTI_BUTTON PC_13
+#define JOIN_START_JITTER_MS 30000
 
-/*!
- * @brief User application data buffer size
+/**
+ * @brief Pin of the nucleo button
  */
-#define LORAWAN_APP_DATA_MAX_SIZE 242
+#define EXTI_BUTTON PC_13
 
 /*!
  * @brief LoRaWAN regulatory region.
@@ -158,10 +166,20 @@
 #define MULTICAST_SESSION_CLASS LORAWAN_CLASS_B
 
 /*!
- * @brief Number of multicast session (1 or 2).
+ * @brief Number of multicast session (1 or 2), provisioned at first boot with sessions running from the join.
  */
 #define NUMBER_MULTICAST_SESSION 2
 
+/*!
+ * @brief Port of the multicast provisioning downlinks and of their answers
+ */
+#define MULTICAST_PROVISIONING_PORT 199
+
+/*!
+ * @brief Number of provisioning downlinks waiting to be applied, the following ones are dropped without answer
+ */
+#define MULTICAST_PROVISIONING_QUEUE_SIZE 2
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
@@ -258,14 +276,25 @@ static const uint8_t MULTICAST_DATARATE = DEFAULT_MULTICAST_DR[LORAWAN_REGION_US
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/**
+ * @brief Keys of the values saved in the key-value store, the LoRaWAN example uses 0 and 1, the FUOTA example 2 and 3
+ */
+typedef enum
+{
+    KV_STORE_KEY_MULTICAST_GROUPS = 4,  //!< First of the APPS_MULTICAST_SESSION_MAX_GROUPS keys of the groups
+} kv_store_key_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
-extern lr1121_t      lr1121;
-static volatile bool user_button_is_press = false;  // Flag for button status
-static volatile bool unicast_ready        = false;  // Flag for class applied
-static volatile bool multicast_started    = false;  // Flag for multicast started
+extern lr1121_t         lr1121;
+static volatile bool    user_button_is_press    = false;  // Flag for button status
+static volatile uint8_t provisioning_nb_pending = 0;      // Number of provisioning downlinks received
+static uint8_t          provisioning_first      = 0;      // Queue index of the oldest provisioning downlink
+static uint32_t         provisioning_nb_dropped = 0;      // Provisioning downlinks dropped, the queue being full
+static uint8_t provisioning_payloads[MULTICAST_PROVISIONING_QUEUE_SIZE][APPS_DOWNLINK_RX_MAX_PAYLOAD_SIZE];
+static uint8_t provisioning_sizes[MULTICAST_PROVISIONING_QUEUE_SIZE];  // Provisioning downlink sizes
 /**
  * @brief Internal credentials
  */
@@ -286,12 +315,22 @@ static uint8_t chip_pin[4] = { 0 };
 static void user_button_callback( void* context );
 
 /**
- * @brief Enable or disable certification mode
+ * @brief Print the multicast groups and the state of their session
  *
  * @param context Define by the user at the init
  */
 static void main_handle_button_pushed( void* context );
 
+/**
+ * @brief Provision the compile-time multicast groups, at first boot
+ */
+static void provision_default_groups( void );
+
+/**
+ * @brief Apply the oldest queued provisioning downlink and send its answer
+ */
+static void provisioning_process( void );
+
 /**
  * @brief Send tx_frame_buffer on choosen port
  *
@@ -326,6 +365,16 @@ int main( void )
     HAL_DBG_TRACE_MSG( "\n\n" );
     HAL_DBG_TRACE_INFO( "###### ===== Multicast example is starting ==== ######\n\n\n" );
 
+    // Load the multicast groups provisioned by downlink, or the compile-time ones at first boot
+    if( apps_kv_store_init( FLASH_USER_KV_STORE_START_PAGE, FLASH_USER_KV_STORE_NB_PAGES ) == false )
+    {
+        HAL_DBG_TRACE_ERROR( "Key-value store mount failed\n" );
+    }
+    if( apps_multicast_session_init( KV_STORE_KEY_MULTICAST_GROUPS ) == 0 )
+    {
+        provision_default_groups( );
+    }
+
     // Disable IRQ to avoid unwanted behavior during init
     hal_mcu_disable_irq( );
 
@@ -364,25 +413,33 @@ int main( void )
             main_handle_button_pushed( &lr1121 );
         }
 
-        if( MULTICAST_SESSION_CLASS == LR1121_LORAWAN_CLASS_B )
+        // Apply the provisioning commands, out of the modem event interrupt
+        if( provisioning_nb_pending > 0 )
         {
-            lr1121_modem_multicast_class_b_status_t multicast_status;
-            ASSERT_SMTC_MODEM_RC( lr1121_modem_get_multicast_class_b_session_status( &lr1121, 0, &multicast_status ) );
+            provisioning_process( );
+        }
 
-            if( ( multicast_status.is_session_waiting_for_beacon == 0 ) &&
-                ( multicast_status.is_session_started == 1 ) )
-            {
-                multicast_started = true;
-                HAL_DBG_TRACE_INFO( "###### ===== BEACON RECEIVED ==== ######\n\n\n" );
-                HAL_DBG_TRACE_PRINTF( "You can now send multicast downlinks\n\n" );
-            }
+        apps_kv_store_process( );
+
+        // Send the join request scheduled after reset or after a join failure
+        uint32_t sleep_ms = apps_join_manager_process( &lr1121 );
+
+        // Start and stop the multicast sessions as their windows open and close
+        const uint32_t multicast_sleep_ms = apps_multicast_session_process( &lr1121 );
+        if( multicast_sleep_ms < sleep_ms )
+        {
+            sleep_ms = multicast_sleep_ms;
+        }
+        if( sleep_ms > WATCHDOG_RELOAD_PERIOD_MS )
+        {
+            sleep_ms = WATCHDOG_RELOAD_PERIOD_MS;
         }
 
         hal_mcu_disable_irq( );
-        if( ( user_button_is_press == false ) )
+        if( ( user_button_is_press == false ) && ( provisioning_nb_pending == 0 ) )
         {
             hal_watchdog_reload( );
-            hal_mcu_set_sleep_for_ms( WATCHDOG_RELOAD_PERIOD_MS );
+            hal_mcu_set_sleep_for_ms( ( int32_t ) sleep_ms );
         }
         hal_watchdog_reload( );
         hal_mcu_enable_irq( );
@@ -413,8 +470,8 @@ static void event_process( void* context )
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_system_cfg_lfclk( context, LR1121_MODEM_SYSTEM_LFCLK_XTAL, true ) );
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_crystal_error( context, 50 ) );
                 get_and_print_crashlog( context );
-                unicast_ready     = false;
-                multicast_started = false;
+                // The sessions running in the modem are lost, they start again once joined
+                apps_multicast_session_on_modem_reset( );
 #if( !USE_LR11XX_CREDENTIALS )
                 // Set user credentials
                 HAL_DBG_TRACE_INFO( "###### ===== LR1121 SET EUI and KEYS ==== ######\n\n" );
@@ -437,9 +494,13 @@ static void event_process( void* context )
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_region( context, LORAWAN_REGION_USED ) );
                 print_lorawan_region( LORAWAN_REGION_USED );
 
-                // Schedule a LoRaWAN network JoinRequest.
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_join( context ) );
-                HAL_DBG_TRACE_INFO( "###### ===== JOINING ==== ######\n\n\n" );
+                // Data rates of the region, the join data rate distribution is built from
+                if( apps_airtime_init( LORAWAN_REGION_USED ) == false )
+                {
+                    HAL_DBG_TRACE_WARNING( "No data rate table for this region, default join distribution\n" );
+                }
+                // Schedule a LoRaWAN network JoinRequest after a random delay, sent from the main loop
+                apps_join_manager_start( context, JOIN_START_JITTER_MS );
 
                 break;
 
@@ -450,26 +511,14 @@ static void event_process( void* context )
             case LR1121_MODEM_LORAWAN_EVENT_JOINED:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINED\n", HAL_DBG_TRACE_COLOR_BLUE );
                 HAL_DBG_TRACE_INFO( "Modem is now joined \n\n" );
+                apps_join_manager_on_joined( );
 
                 uint8_t adr_custom_list[16] = { 0 };
                 ASSERT_SMTC_MODEM_RC( lr1121_modem_set_adr_profile(
                     context, LR1121_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED, adr_custom_list ) );
 
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_set_class( context, MULTICAST_SESSION_CLASS ) );
-                for( uint8_t i = 0; i < NUMBER_MULTICAST_SESSION; i++ )
-                {
-                    uint32_t grp_addr = ( MULTICAST_KEYS[i][0][0] << 24 ) | ( MULTICAST_KEYS[i][0][1] << 16 ) |
-                                        ( MULTICAST_KEYS[i][0][2] << 8 ) | MULTICAST_KEYS[i][0][3];
-                    ASSERT_SMTC_MODEM_RC( lr1121_modem_set_multicast_group_config(
-                        context, i, grp_addr, MULTICAST_KEYS[i][1], MULTICAST_KEYS[i][2] ) );
-                }
-                if( MULTICAST_SESSION_CLASS == LR1121_LORAWAN_CLASS_C )
-                {
-                    unicast_ready = true;
-                    // Send an uplink to enable the unicast class C session on NS
-                    uint8_t buff[8] = { 0 };
-                    ASSERT_SMTC_MODEM_RC( send_frame( buff, 8, 10, LR1121_MODEM_UNCONFIRMED_TX ) );
-                }
+                // The device class and the multicast groups are set from the main loop, as the sessions start
+                apps_multicast_session_on_joined( );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_TX_DONE:
@@ -505,32 +554,70 @@ static void event_process( void* context )
                 HAL_DBG_TRACE_MSG( "\n\n" );
 
                 HAL_DBG_TRACE_INFO( "Transmission done \n" );
-                if( unicast_ready )
-                {
-                    HAL_DBG_TRACE_INFO(
-                        "Device unicast session setup - You can push the blue button to start the multicast "
-                        "session\n\n\n" );
-                }
-
                 break;
             }
 
             case LR1121_MODEM_LORAWAN_EVENT_DOWN_DATA:
+            {
+                const apps_downlink_rx_frame_t* downlink;
+
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: DOWNDATA\n\n", HAL_DBG_TRACE_COLOR_BLUE );
-                // Get downlink data
-                uint8_t rx_payload[LORAWAN_APP_DATA_MAX_SIZE] = { 0 };  // Buffer for rx payload
-                uint8_t rx_payload_size                       = 0;      // Size of the payload in the rx_payload buffer
-                lr1121_modem_downlink_metadata_t rx_metadata  = { 0 };  // Metadata of downlink
-                uint8_t                          rx_remaining = 0;      // Remaining downlink payload in modem
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data_size( context, &rx_payload_size, &rx_remaining ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_data( context, rx_payload, rx_payload_size ) );
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_get_downlink_metadata( context, &rx_metadata ) );
-                HAL_DBG_TRACE_PRINTF( "Data received on windows %s\n", get_downlink_window_name( rx_metadata.window ) );
-                HAL_DBG_TRACE_ARRAY( "Received payload", rx_payload, rx_payload_size );
+                // Get all the downlinks waiting in the modem, then handle them in order
+                apps_downlink_rx_drain( context );
+                while( ( downlink = apps_downlink_rx_take( ) ) != NULL )
+                {
+                    HAL_DBG_TRACE_PRINTF( "Data received on windows %s\n",
+                                          get_downlink_window_name( downlink->metadata.window ) );
+                    if( ( downlink->metadata.window >= LR1121_MODEM_DOWNLINK_WINDOW_RXC_MULTICAST_GROUP0 ) &&
+                        ( downlink->metadata.window <= LR1121_MODEM_DOWNLINK_WINDOW_RXC_MULTICAST_GROUP3 ) )
+                    {
+                        HAL_DBG_TRACE_PRINTF( "Multicast group %u\n",
+                                              apps_multicast_session_get_group_id(
+                                                  downlink->metadata.window -
+                                                  LR1121_MODEM_DOWNLINK_WINDOW_RXC_MULTICAST_GROUP0 ) );
+                    }
+                    else if( ( downlink->metadata.window >= LR1121_MODEM_DOWNLINK_WINDOW_RXB_MULTICAST_GROUP0 ) &&
+                             ( downlink->metadata.window <= LR1121_MODEM_DOWNLINK_WINDOW_RXB_MULTICAST_GROUP3 ) )
+                    {
+                        HAL_DBG_TRACE_PRINTF( "Multicast group %u\n",
+                                              apps_multicast_session_get_group_id(
+                                                  downlink->metadata.window -
+                                                  LR1121_MODEM_DOWNLINK_WINDOW_RXB_MULTICAST_GROUP0 ) );
+                    }
+                    HAL_DBG_TRACE_ARRAY( "Received payload", downlink->payload, downlink->size );
+                    set_trace_levels_from_downlink( downlink->metadata.fport, downlink->payload, downlink->size );
+
+                    // Provisioning commands, applied from the main loop, a unicast downlink only. A dropped downlink
+                    // gets no answer, for the network server to send it again.
+                    if( ( downlink->metadata.fport == MULTICAST_PROVISIONING_PORT ) &&
+                        ( ( downlink->metadata.window <= LR1121_MODEM_DOWNLINK_WINDOW_RXC ) ||
+                          ( downlink->metadata.window == LR1121_MODEM_DOWNLINK_WINDOW_RXB ) ) )
+                    {
+                        if( provisioning_nb_pending < MULTICAST_PROVISIONING_QUEUE_SIZE )
+                        {
+                            const uint8_t index =
+                                ( provisioning_first + provisioning_nb_pending ) % MULTICAST_PROVISIONING_QUEUE_SIZE;
+
+                            memcpy( provisioning_payloads[index], downlink->payload, downlink->size );
+                            provisioning_sizes[index] = downlink->size;
+                            provisioning_nb_pending++;
+                        }
+                        else
+                        {
+                            provisioning_nb_dropped++;
+                            HAL_DBG_TRACE_ERROR( "Provisioning downlink dropped, %lu since reset\n",
+                                                 provisioning_nb_dropped );
+                        }
+                    }
+                    apps_downlink_rx_release( downlink );
+                }
                 break;
+            }
 
             case LR1121_MODEM_LORAWAN_EVENT_JOIN_FAIL:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: JOINFAIL\n\n", HAL_DBG_TRACE_COLOR_BLUE );
+                // Retry after a random backoff instead of the automatic retry of the modem
+                apps_join_manager_on_join_fail( context );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_LINK_CHECK:
@@ -543,17 +630,18 @@ static void event_process( void* context )
 
             case LR1121_MODEM_LORAWAN_EVENT_CLASS_B_STATUS:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: CLASS_B_STATUS\n\n", HAL_DBG_TRACE_COLOR_BLUE );
-                if( ( current_event.data ) && ( MULTICAST_SESSION_CLASS == LR1121_LORAWAN_CLASS_B ) )
+                if( current_event.data )
                 {
-                    unicast_ready = true;
-                    // Send an uplink to enable the unicast class C session on NS
+                    // Send an uplink to enable the unicast class B session on NS
                     uint8_t buff[8] = { 0 };
-                    ASSERT_SMTC_MODEM_RC( send_frame( buff, 8, 10, LR1121_MODEM_UNCONFIRMED_TX ) );
+                    ASSERT_SMTC_MODEM_RC( send_frame( buff, 8, 10, LR1121_MODEM_UPLINK_UNCONFIRMED ) );
                 }
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_LORAWAN_MAC_TIME:
                 HAL_DBG_TRACE_MSG_COLOR( "Event received: LORAWAN MAC TIME\n\n", HAL_DBG_TRACE_COLOR_BLUE );
+                // Network time the session windows are scheduled on
+                apps_multicast_session_on_mac_time( context );
                 break;
 
             case LR1121_MODEM_LORAWAN_EVENT_NEW_MULTICAST_SESSION_CLASS_C:
@@ -597,54 +685,84 @@ static void user_button_callback( void* context )
 
 static void main_handle_button_pushed( void* context )
 {
-    if( unicast_ready )
+    static const char* state_names[] = { "none", "idle", "scheduled", "running", "ended" };
+
+    ( void ) context;
+
+    for( uint8_t group_id = 0; group_id < APPS_MULTICAST_SESSION_MAX_GROUPS; group_id++ )
     {
-        // The device class is setup, we can start or stop the multicast session
-        if( multicast_started )
+        apps_multicast_session_group_t       group;
+        uint8_t                              modem_group;
+        const apps_multicast_session_state_t state =
+            apps_multicast_session_get_group( group_id, &group, &modem_group );
+
+        if( state == APPS_MULTICAST_SESSION_STATE_NONE )
         {
-            // The multicast session is started, the action is to stop the session
-            if( MULTICAST_SESSION_CLASS == LR1121_LORAWAN_CLASS_B )
-            {
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_stop_all_session_multicast_class_b( context ) );
-            }
-            else
-            {
-                ASSERT_SMTC_MODEM_RC( lr1121_modem_stop_all_session_multicast_class_c( context ) );
-            }
-            multicast_started = false;
-            HAL_DBG_TRACE_INFO( "###### ===== STOP MULTICAST SESSION(S) ==== ######\n\n\n" );
+            continue;
         }
-        else
+        HAL_DBG_TRACE_PRINTF( "Multicast group %u: address 0x%08lx, %s", group_id, group.address,
+                              state_names[state] );
+        if( group.has_session == true )
         {
-            // The multicast session is not started, the action is to start the session
-            for( uint8_t i = 0; i < NUMBER_MULTICAST_SESSION; i++ )
-            {
-                if( MULTICAST_SESSION_CLASS == LR1121_LORAWAN_CLASS_B )
-                {
-                    ASSERT_SMTC_MODEM_RC( lr1121_modem_start_session_multicast_class_b(
-                        context, i, MULTICAST_FREQUENCY, MULTICAST_DATARATE, MULTICAST_PING_SLOT_PERIODICITY[i] ) );
-                    HAL_DBG_TRACE_INFO( "###### ===== START MULTICAST SESSION n°%d ==== ######\n\n\n", i + 1 );
-                    HAL_DBG_TRACE_PRINTF( "Wait for beacon reception...\n\n" );
-                }
-                else
-                {
-                    ASSERT_SMTC_MODEM_RC( lr1121_modem_start_session_multicast_class_c( context, i, MULTICAST_FREQUENCY,
-                                                                                        MULTICAST_DATARATE ) );
-
-                    HAL_DBG_TRACE_INFO( "###### ===== START MULTICAST SESSION n°%d ==== ######\n\n\n", i + 1 );
-                    HAL_DBG_TRACE_PRINTF( "You can now send multicast downlinks\n\n" );
-                }
-            }
-            multicast_started = true;
+            HAL_DBG_TRACE_PRINTF( ", class %c, %lu Hz, DR%u, start %lu s, duration %lu s",
+                                  ( group.session_class == LR1121_LORAWAN_CLASS_B ) ? 'B' : 'C', group.frequency,
+                                  group.data_rate, group.start_s, group.duration_s );
+        }
+        if( modem_group < APPS_MULTICAST_SESSION_NB_MODEM_GROUPS )
+        {
+            HAL_DBG_TRACE_PRINTF( ", modem group %u", modem_group );
         }
+        HAL_DBG_TRACE_PRINTF( "\n" );
     }
-    else
+    HAL_DBG_TRACE_PRINTF( "Provisioning downlinks dropped: %lu\n", provisioning_nb_dropped );
+}
+
+static void provision_default_groups( void )
+{
+    for( uint8_t i = 0; i < NUMBER_MULTICAST_SESSION; i++ )
     {
-        multicast_started = false;
-        HAL_DBG_TRACE_PRINTF( "UNICAST SESSION NOT READY\n\n" );
+        const uint32_t grp_addr = ( ( uint32_t ) MULTICAST_KEYS[i][0][0] << 24 ) | ( MULTICAST_KEYS[i][0][1] << 16 ) |
+                                  ( MULTICAST_KEYS[i][0][2] << 8 ) | MULTICAST_KEYS[i][0][3];
+        apps_multicast_session_group_t group = {
+            .address       = grp_addr,
+            .has_session   = true,
+            .data_rate     = MULTICAST_DATARATE,
+            .session_class = ( lr1121_modem_classes_t ) MULTICAST_SESSION_CLASS,
+            .ping_slot     = ( lr1121_modem_class_b_ping_slot_t ) MULTICAST_PING_SLOT_PERIODICITY[i],
+            .frequency     = MULTICAST_FREQUENCY,
+            .start_s       = APPS_MULTICAST_SESSION_START_NOW,
+            .duration_s    = APPS_MULTICAST_SESSION_NO_END,
+        };
+        memcpy( group.nwk_skey, MULTICAST_KEYS[i][1], sizeof( group.nwk_skey ) );
+        memcpy( group.app_skey, MULTICAST_KEYS[i][2], sizeof( group.app_skey ) );
+
+        if( apps_multicast_session_provision( i, &group ) != APPS_MULTICAST_SESSION_STATUS_OK )
+        {
+            HAL_DBG_TRACE_ERROR( "Multicast group %u not provisioned\n", i );
+        }
     }
 }
 
+static void provisioning_process( void )
+{
+    uint8_t answer[APPS_MULTICAST_SESSION_ANSWER_SIZE * APPS_MULTICAST_SESSION_MAX_COMMANDS];
+    uint8_t answer_size;
+
+    // The event handler only writes the free slots of the queue: the oldest one is released once applied
+    answer_size = apps_multicast_session_on_downlink( provisioning_payloads[provisioning_first],
+                                                      provisioning_sizes[provisioning_first], answer );
+    hal_mcu_disable_irq( );
+    provisioning_first = ( provisioning_first + 1 ) % MULTICAST_PROVISIONING_QUEUE_SIZE;
+    provisioning_nb_pending--;
+    hal_mcu_enable_irq( );
+
+    // Mask the modem events, whose handler talks to the modem as well
+    hal_gpio_irq_disable( );
+    ASSERT_SMTC_MODEM_RC(
+        send_frame( answer, answer_size, MULTICAST_PROVISIONING_PORT, LR1121_MODEM_UPLINK_UNCONFIRMED ) );
+    hal_gpio_irq_enable( );
+}
+
 static lr1121_modem_response_code_t send_frame( const uint8_t* tx_frame_buffer, const uint8_t tx_frame_buffer_size,
                                                 uint8_t port, const lr1121_modem_uplink_type_t tx_confirmed )
 {
@@ -37,6 +37,8 @@
  * --- DEPENDENCIES ------------------------------------------------------------
  */
 
+#define HAL_DBG_TRACE_MODULE HAL_DBG_TRACE_MODULE_BOARD
+
 #include <stdlib.h>
 #include "lr1121_hal.h"
 #include "lr1121_modem_hal.h"
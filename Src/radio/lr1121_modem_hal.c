@@ -37,6 +37,8 @@
  * --- DEPENDENCIES ------------------------------------------------------------
  */
 
+#define HAL_DBG_TRACE_MODULE HAL_DBG_TRACE_MODULE_BOARD
+
 #include <stdlib.h>
 #include <stdint.h>
 #include "lr1121_hal.h"
@@ -56,6 +58,16 @@
 
 #define LR1121_MODEM_RESET_TIMEOUT 3000
 
+/*!
+ * @brief Time the busy line is held low after the reset, for the chip to sample it and stay in the bootloader
+ */
+#define LR1121_MODEM_DFU_BUSY_HOLD_MS 250
+
+/*!
+ * @brief Maximal time for the bootloader to release the busy line once started
+ */
+#define LR1121_MODEM_DFU_READY_TIMEOUT_MS 250
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -338,6 +350,11 @@ lr1121_modem_hal_status_t lr1121_modem_hal_reset( const void* context )
     return LR1121_MODEM_HAL_STATUS_OK;
 }
 
+/*
+ * The busy line is held low LR1121_MODEM_DFU_BUSY_HOLD_MS after the reset, then the function returns once the
+ * bootloader released it or LR1121_MODEM_DFU_READY_TIMEOUT_MS elapsed. A timeout is traced: the caller checks with
+ * lr1121_bootloader_get_status that the bootloader runs.
+ */
 void lr1121_modem_hal_enter_dfu( const void* context )
 {
     /* Force dio0 to 0 */
@@ -348,11 +365,15 @@ void lr1121_modem_hal_enter_dfu( const void* context )
     HAL_Delay( 1 );
     hal_gpio_set_value( ( ( lr1121_t* ) context )->reset.pin, 1 );
 
-    /* wait 250ms */
-    HAL_Delay( 250 );
+    /* hold dio0 low until the bootloader sampled it */
+    HAL_Delay( LR1121_MODEM_DFU_BUSY_HOLD_MS );
 
-    /* reinit dio0 */
+    /* reinit dio0, then wait for the bootloader to be ready */
     hal_gpio_init_in( ( ( lr1121_t* ) context )->busy.pin, HAL_GPIO_PULL_MODE_NONE, HAL_GPIO_IRQ_MODE_OFF, NULL );
+    if( lr1121_hal_wait_on_busy( context, LR1121_MODEM_DFU_READY_TIMEOUT_MS ) != LR1121_HAL_STATUS_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "Bootloader not ready %d ms after the DFU reset\n", LR1121_MODEM_DFU_READY_TIMEOUT_MS );
+    }
 }
 
 lr1121_modem_hal_status_t lr1121_modem_hal_wakeup( const void* context )
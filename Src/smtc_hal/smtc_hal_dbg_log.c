@@ -0,0 +1,306 @@
+/**
+ * @file      smtc_hal_dbg_log.c
+ *
+ * @brief     Binary (tokenized) debug log implementation.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdarg.h>
+
+#include "smtc_hal_options.h"
+#include "smtc_hal_dbg_log.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_uart.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Size of the frame header (sync, id and info bytes)
+ */
+#define HAL_DBG_LOG_FRAME_HEADER_SIZE 4
+
+/**
+ * @brief Mask applied to the free-running buffer indexes
+ */
+#define HAL_DBG_LOG_BUFFER_MASK ( HAL_DBG_LOG_BUFFER_SIZE - 1 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Compile-time check: the buffer indexes are wrapped with a mask
+ */
+typedef char hal_dbg_log_buffer_size_is_power_of_2[( ( HAL_DBG_LOG_BUFFER_SIZE & HAL_DBG_LOG_BUFFER_MASK ) == 0 ) ? 1
+                                                                                                                  : -1];
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/**
+ * @brief RAM log buffer
+ */
+static uint8_t hal_dbg_log_buffer[HAL_DBG_LOG_BUFFER_SIZE];
+
+/**
+ * @brief Free-running write index, only updated by the writers in critical section
+ */
+static volatile uint32_t hal_dbg_log_head = 0;
+
+/**
+ * @brief Free-running read index, only updated by @ref hal_dbg_log_flush
+ */
+static volatile uint32_t hal_dbg_log_tail = 0;
+
+static volatile uint32_t hal_dbg_log_nb_dropped          = 0;
+static volatile uint32_t hal_dbg_log_nb_dropped_reported = 0;
+static volatile bool     hal_dbg_log_flush_on_going      = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Copy a frame in the log buffer if it fits
+ *
+ * @param [in] header Frame header and arguments
+ * @param [in] header_len Length of @p header
+ * @param [in] payload Optional payload following the header (can be NULL)
+ * @param [in] payload_len Length of @p payload
+ *
+ * @returns true if the frame was copied, false if there was not enough room left
+ */
+static bool hal_dbg_log_push( const uint8_t* header, uint8_t header_len, const uint8_t* payload,
+                              uint16_t payload_len );
+
+/**
+ * @brief Push a frame, flushing the buffer first when it is full
+ *
+ * @remark The frame is dropped if the buffer is full while a flush is already on-going (log from an interrupt)
+ */
+static void hal_dbg_log_push_or_flush( const uint8_t* header, uint8_t header_len, const uint8_t* payload,
+                                       uint16_t payload_len );
+
+/**
+ * @brief Fill a frame header
+ */
+static void hal_dbg_log_set_header( uint8_t* frame, uint16_t id, uint8_t info );
+
+/**
+ * @brief Serialize a 32-bit word in little endian
+ */
+static void hal_dbg_log_set_word( uint8_t* buffer, uint32_t word );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_dbg_log_write( uint16_t id, uint8_t nb_args, ... )
+{
+    uint8_t frame[HAL_DBG_LOG_FRAME_HEADER_SIZE + ( 4 * HAL_DBG_LOG_MAX_ARGS )];
+    va_list argp;
+
+    if( nb_args > HAL_DBG_LOG_MAX_ARGS )
+    {
+        nb_args = HAL_DBG_LOG_MAX_ARGS;
+    }
+
+    hal_dbg_log_set_header( frame, id, nb_args );
+
+    va_start( argp, nb_args );
+    for( uint8_t i = 0; i < nb_args; i++ )
+    {
+        hal_dbg_log_set_word( &frame[HAL_DBG_LOG_FRAME_HEADER_SIZE + ( 4 * i )], va_arg( argp, uint32_t ) );
+    }
+    va_end( argp );
+
+    hal_dbg_log_push_or_flush( frame, HAL_DBG_LOG_FRAME_HEADER_SIZE + ( 4 * nb_args ), NULL, 0 );
+}
+
+void hal_dbg_log_write_array( uint16_t id, uint8_t info, const uint8_t* array, uint32_t len )
+{
+    uint8_t frame[HAL_DBG_LOG_FRAME_HEADER_SIZE + 1];
+
+    hal_dbg_log_set_header( frame, id, info );
+
+    do
+    {
+        const uint8_t chunk_len = ( len > 255 ) ? 255 : ( uint8_t ) len;
+
+        frame[HAL_DBG_LOG_FRAME_HEADER_SIZE] = chunk_len;
+        hal_dbg_log_push_or_flush( frame, sizeof( frame ), array, chunk_len );
+
+        array += chunk_len;
+        len -= chunk_len;
+    } while( len > 0 );
+}
+
+void hal_dbg_log_flush( void )
+{
+#if( HAL_USE_PRINTF_UART == HAL_FEATURE_ON )
+    {
+        CRITICAL_SECTION_BEGIN( );
+        if( hal_dbg_log_flush_on_going == true )
+        {
+            CRITICAL_SECTION_END( );
+            return;
+        }
+        hal_dbg_log_flush_on_going = true;
+        CRITICAL_SECTION_END( );
+    }
+
+    // Report the frames dropped since the last flush, there is room for it once the buffer has been sent
+    bool drop_to_report = ( hal_dbg_log_nb_dropped != hal_dbg_log_nb_dropped_reported );
+
+    do
+    {
+        // Frames written by interrupts during the transmission are sent by the next loop iteration
+        while( hal_dbg_log_tail != hal_dbg_log_head )
+        {
+            const uint32_t tail   = hal_dbg_log_tail;
+            const uint32_t offset = tail & HAL_DBG_LOG_BUFFER_MASK;
+            uint32_t       chunk  = hal_dbg_log_head - tail;
+
+            if( chunk > ( HAL_DBG_LOG_BUFFER_SIZE - offset ) )
+            {
+                chunk = HAL_DBG_LOG_BUFFER_SIZE - offset;
+            }
+            hal_uart_tx( HAL_PRINTF_UART_ID, &hal_dbg_log_buffer[offset], ( uint16_t ) chunk );
+            hal_dbg_log_tail = tail + chunk;
+        }
+
+        if( drop_to_report == true )
+        {
+            uint8_t        frame[HAL_DBG_LOG_FRAME_HEADER_SIZE + 4];
+            const uint32_t nb_dropped = hal_dbg_log_nb_dropped;
+
+            hal_dbg_log_set_header( frame, HAL_DBG_LOG_ID_DROPPED, 1 );
+            hal_dbg_log_set_word( &frame[HAL_DBG_LOG_FRAME_HEADER_SIZE], nb_dropped - hal_dbg_log_nb_dropped_reported );
+            if( hal_dbg_log_push( frame, sizeof( frame ), NULL, 0 ) == true )
+            {
+                hal_dbg_log_nb_dropped_reported = nb_dropped;
+            }
+            drop_to_report = false;
+        }
+    } while( hal_dbg_log_tail != hal_dbg_log_head );
+
+    hal_dbg_log_flush_on_going = false;
+#endif
+}
+
+uint32_t hal_dbg_log_get_nb_dropped( void ) { return hal_dbg_log_nb_dropped; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool hal_dbg_log_push( const uint8_t* header, uint8_t header_len, const uint8_t* payload,
+                              uint16_t payload_len )
+{
+    bool pushed = false;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    uint32_t head = hal_dbg_log_head;
+
+    if( ( HAL_DBG_LOG_BUFFER_SIZE - ( head - hal_dbg_log_tail ) ) >= ( uint32_t ) ( header_len + payload_len ) )
+    {
+        for( uint8_t i = 0; i < header_len; i++ )
+        {
+            hal_dbg_log_buffer[head++ & HAL_DBG_LOG_BUFFER_MASK] = header[i];
+        }
+        for( uint16_t i = 0; i < payload_len; i++ )
+        {
+            hal_dbg_log_buffer[head++ & HAL_DBG_LOG_BUFFER_MASK] = payload[i];
+        }
+        hal_dbg_log_head = head;
+        pushed           = true;
+    }
+
+    CRITICAL_SECTION_END( );
+
+    return pushed;
+}
+
+static void hal_dbg_log_push_or_flush( const uint8_t* header, uint8_t header_len, const uint8_t* payload,
+                                       uint16_t payload_len )
+{
+    if( hal_dbg_log_push( header, header_len, payload, payload_len ) == true )
+    {
+        return;
+    }
+
+    if( hal_dbg_log_flush_on_going == false )
+    {
+        hal_dbg_log_flush( );
+        if( hal_dbg_log_push( header, header_len, payload, payload_len ) == true )
+        {
+            return;
+        }
+    }
+
+    hal_dbg_log_nb_dropped++;
+}
+
+static void hal_dbg_log_set_header( uint8_t* frame, uint16_t id, uint8_t info )
+{
+    frame[0] = HAL_DBG_LOG_FRAME_SYNC;
+    frame[1] = ( uint8_t ) id;
+    frame[2] = ( uint8_t ) ( id >> 8 );
+    frame[3] = info;
+}
+
+static void hal_dbg_log_set_word( uint8_t* buffer, uint32_t word )
+{
+    buffer[0] = ( uint8_t ) word;
+    buffer[1] = ( uint8_t ) ( word >> 8 );
+    buffer[2] = ( uint8_t ) ( word >> 16 );
+    buffer[3] = ( uint8_t ) ( word >> 24 );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
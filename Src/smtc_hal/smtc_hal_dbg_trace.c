@@ -0,0 +1,113 @@
+/**
+ * @file      smtc_hal_dbg_trace.c
+ *
+ * @brief     Board specific package debug trace level implementation.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+volatile uint8_t hal_dbg_trace_levels[HAL_DBG_TRACE_MODULE_NB] = {
+    [HAL_DBG_TRACE_MODULE_APP]   = HAL_DBG_TRACE_LEVEL_DEBUG,
+    [HAL_DBG_TRACE_MODULE_HAL]   = HAL_DBG_TRACE_LEVEL_DEBUG,
+    [HAL_DBG_TRACE_MODULE_BOARD] = HAL_DBG_TRACE_LEVEL_DEBUG,
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool hal_dbg_trace_set_level( hal_dbg_trace_module_t module, uint8_t level )
+{
+    if( ( module > HAL_DBG_TRACE_MODULE_NB ) || ( level > HAL_DBG_TRACE_LEVEL_DEBUG ) )
+    {
+        return false;
+    }
+
+    if( module == HAL_DBG_TRACE_MODULE_NB )
+    {
+        for( uint8_t i = 0; i < HAL_DBG_TRACE_MODULE_NB; i++ )
+        {
+            hal_dbg_trace_levels[i] = level;
+        }
+    }
+    else
+    {
+        hal_dbg_trace_levels[module] = level;
+    }
+    return true;
+}
+
+uint8_t hal_dbg_trace_get_level( hal_dbg_trace_module_t module )
+{
+    if( module >= HAL_DBG_TRACE_MODULE_NB )
+    {
+        return HAL_DBG_TRACE_LEVEL_NONE;
+    }
+    return hal_dbg_trace_levels[module];
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/* --- EOF ------------------------------------------------------------------ */
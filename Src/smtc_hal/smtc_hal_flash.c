@@ -37,6 +37,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "stm32l4xx_hal.h"
 #include "smtc_hal_flash.h"
 #include "smtc_utilities.h"
@@ -51,6 +52,11 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * @brief Last address which can be erased or written: end of the last (tracker context) page
+ */
+#define FLASH_USER_LAST_ADDR FLASH_USER_TRACKER_CTX_END_ADDR
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -61,6 +67,13 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+/*!
+ * @brief Linker symbols locating the end of the firmware image (initialized data copied after the code)
+ */
+extern uint32_t _sidata;
+extern uint32_t _sdata;
+extern uint32_t _edata;
+
 /*!
  * @brief Initializes the FlashUserStartAddr to FLASH_USER_END_ADDR to avoid erase a occupied memory .
  */
@@ -73,6 +86,37 @@ uint32_t flash_user_start_addr = FLASH_USER_END_ADDR;
  */
 static uint32_t get_page( uint32_t address );
 
+/**
+ * @brief Check if a flash page is erased
+ *
+ * @remark The page is compared in place, 64 bits at a time, and the comparison stops on the first programmed word
+ *
+ * @param [in] page Page number
+ *
+ * @returns true if the whole page is erased
+ */
+static bool flash_is_page_empty( uint32_t page );
+
+/**
+ * @brief Erase pages, with a single erase request per bank
+ *
+ * @param [in] first_page First page to erase, numbered from the start of the flash
+ * @param [in] nb_pages Number of pages to erase
+ *
+ * @returns FLASH_STATUS_OK or FLASH_STATUS_ERASE_ERROR
+ */
+static flash_status_t flash_erase( uint32_t first_page, uint32_t nb_pages );
+
+/**
+ * @brief Program a double word, with retries
+ *
+ * @param [in] addr Address to program
+ * @param [in] data Double word
+ *
+ * @returns FLASH_STATUS_OK or FLASH_STATUS_PROGRAM_ERROR
+ */
+static flash_status_t flash_program( uint32_t addr, uint64_t data );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -86,127 +130,118 @@ static uint32_t get_page( uint32_t address );
 /*!
  * @brief Initializes the FLASH module and find the first empty page.
  *
+ * The user pages are filled sequentially from the end of the firmware image, so the written/erased boundary is found
+ * with a binary search: the number of pages read does not depend on the amount of data written in flash. The
+ * reserved pages (end of the first bank, receiving the persistent data before a bank swap, and second bank, used for
+ * FUOTA staging, key-value store and telemetry log) are excluded from the search.
+ *
  * @returns User flash start address
  */
 uint32_t flash_init( void )
 {
-    uint8_t  status = SMTC_SUCCESS;
-    uint8_t  buffer[ADDR_FLASH_PAGE_SIZE / 0x10]; 
-    uint32_t  index_page = FLASH_USER_START_PAGE;
-    uint64_t nb_empty_bytes = 0;
+    uint8_t  status     = SMTC_SUCCESS;
+    uint32_t first_page = get_page( ( uint32_t ) &_sidata + ( ( uint32_t ) &_edata - ( uint32_t ) &_sdata ) - 1 ) + 1;
+    uint32_t last_page  = FLASH_USER_RESERVED_START_PAGE;
 
-    while( ( nb_empty_bytes != ADDR_FLASH_PAGE_SIZE ) && ( index_page < FLASH_USER_END_PAGE ) )
+    // Never look for the boundary inside the firmware image, an erased area of the image is not a free page
+    if( first_page < FLASH_USER_START_PAGE )
     {
-        nb_empty_bytes = 0;
+        first_page = FLASH_USER_START_PAGE;
+    }
 
-        for( uint32_t j = 0; j < 0x10; j++ )
-        {
-            flash_read_buffer( ADDR_FLASH_PAGE_0 + ( index_page * ADDR_FLASH_PAGE_SIZE ) + ( j * sizeof( buffer ) ), buffer,
-                               sizeof( buffer ) );
+    // Pages below first_page are written, pages from last_page are empty (or out of the user area)
+    while( first_page < last_page )
+    {
+        const uint32_t middle_page = first_page + ( ( last_page - first_page ) / 2 );
 
-            for( uint32_t i = 0; i < sizeof( buffer ); i++ )
-            {
-                if( buffer[i] == 0xFF )
-                {
-                    nb_empty_bytes++;
-                }
-            }
+        if( flash_is_page_empty( middle_page ) == true )
+        {
+            last_page = middle_page;
+        }
+        else
+        {
+            first_page = middle_page + 1;
         }
-        index_page++;  // Check next page
     }
-    flash_user_start_addr = ADDR_FLASH_PAGE_0 + ( ( index_page - 1 ) * ADDR_FLASH_PAGE_SIZE );
+
+    // No empty page: keep the last page before the reserved pages, not filled sequentially
+    if( first_page >= FLASH_USER_RESERVED_START_PAGE )
+    {
+        first_page = FLASH_USER_RESERVED_START_PAGE - 1;
+    }
+    flash_user_start_addr = ADDR_FLASH_PAGE( first_page );
 
     return status;
 }
 
 uint8_t flash_erase_page( uint32_t addr, uint8_t nb_page )
 {
-    uint8_t  status          = SMTC_SUCCESS;
-    uint8_t  hal_status      = SMTC_SUCCESS;
-    uint32_t first_user_page = 0, nb_of_pages_max = 0;
-    uint32_t page_error            = 0;
-    uint8_t  flash_operation_retry = 0;
+    /* Get the number of pages available */
+    const uint32_t nb_of_pages_max = get_page( FLASH_USER_END_ADDR ) - get_page( flash_user_start_addr ) + 1;
 
-    FLASH_EraseInitTypeDef EraseInitStruct;
+    if( ( flash_user_start_addr > addr ) || ( nb_page > nb_of_pages_max ) )
+    {
+        return SMTC_FAIL;
+    }
 
-    /* Unlock the Flash to enable the flash control register access *************/
-    HAL_FLASH_Unlock( );
+    return ( flash_erase( get_page( addr ), nb_page ) == FLASH_STATUS_OK ) ? SMTC_SUCCESS : SMTC_FAIL;
+}
 
-    /* Clear OPTVERR bit set on virgin samples */
-    __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_OPTVERR );
+uint8_t flash_force_erase_page( uint32_t addr, uint8_t nb_page )
+{
+    return ( flash_erase( get_page( addr ), nb_page ) == FLASH_STATUS_OK ) ? SMTC_SUCCESS : SMTC_FAIL;
+}
 
-    /* Erase the user Flash area
-    (area defined by FlashUserStartAddr and FLASH_USER_END_ADDR) ***********/
+flash_status_t flash_bulk_erase( uint32_t addr, uint16_t nb_pages )
+{
+    if( ( ( addr % ADDR_FLASH_PAGE_SIZE ) != 0 ) || ( addr < flash_user_start_addr ) || ( nb_pages == 0 ) ||
+        ( ( addr + ( ( uint32_t ) nb_pages * ADDR_FLASH_PAGE_SIZE ) - 1 ) > FLASH_USER_LAST_ADDR ) )
+    {
+        return FLASH_STATUS_INVALID_PARAM;
+    }
 
-    /* Get the 1st page to erase */
-    first_user_page = get_page( addr );
+    return flash_erase( get_page( addr ), nb_pages );
+}
 
-    /* Get the number of pages to erase from 1st page */
-    nb_of_pages_max = get_page( FLASH_USER_END_ADDR ) - get_page( flash_user_start_addr ) + 1;
+uint32_t flash_write_buffer( uint32_t addr, uint8_t* buffer, uint32_t size )
+{
+    uint32_t real_size = 0;
 
-    if( ( flash_user_start_addr > addr ) || ( nb_page > nb_of_pages_max ) )
+    // Nothing written, as before the status codes: 0 bytes
+    if( size == 0 )
     {
-        status = SMTC_FAIL;
-        return status;
+        return 0;
     }
 
-    /* Fill EraseInit structure*/
-    EraseInitStruct.TypeErase = FLASH_TYPEERASE_PAGES;
-    EraseInitStruct.Page      = first_user_page;
-    EraseInitStruct.NbPages   = nb_page;
-    if( first_user_page < 256 )
+    /* Complete size for FLASH_TYPEPROGRAM_DOUBLEWORD operation*/
+    if( ( size % 8 ) != 0 )
     {
-        EraseInitStruct.Banks     = FLASH_BANK_1;
+        real_size = size + ( 8 - ( size % 8 ) );
     }
     else
     {
-        EraseInitStruct.Banks     = FLASH_BANK_2;
+        real_size = size;
     }
 
-    /* Note: If an erase operation in Flash memory also concerns data in the data or instruction cache,
-     you have to make sure that these data are rewritten before they are accessed during code
-     execution. If this cannot be done safely, it is recommended to flush the caches by setting the
-     DCRST and ICRST bits in the FLASH_CR register. */
-    do
-    {
-        hal_status = HAL_FLASHEx_Erase( &EraseInitStruct, &page_error );
-        flash_operation_retry++;
-    } while( ( hal_status != HAL_OK ) && ( flash_operation_retry < FLASH_OPERATION_MAX_RETRY ) );
-
-    if( flash_operation_retry >= FLASH_OPERATION_MAX_RETRY )
-    {
-        /*
-          Error occurred while  erase.
-          User can add here some code to deal with this error.
-          PageError will contain the faulty  and then to know the code error on this ,
-          user can call function 'HAL_FLASH_GetError()'
-        */
-        /* Infinite loop */
-        while( 1 )
-        {
-        }
-    }
-    else
+    if( flash_write_double_words( addr, buffer, size ) != FLASH_STATUS_OK )
     {
-        flash_operation_retry = 0;
+        return SMTC_FAIL;
     }
 
-    /* Lock the Flash to disable the flash control register access (recommended
-    to protect the FLASH memory against possible unwanted operation) *********/
-    HAL_FLASH_Lock( );
-
-    return status;
+    return real_size;
 }
 
-uint8_t flash_force_erase_page( uint32_t addr, uint8_t nb_page )
+flash_status_t flash_write_double_words( uint32_t addr, const uint8_t* buffer, uint32_t size )
 {
-    uint8_t  status                = SMTC_SUCCESS;
-    uint8_t  hal_status            = SMTC_SUCCESS;
-    uint32_t first_user_page       = 0;
-    uint32_t page_error            = 0;
-    uint8_t  flash_operation_retry = 0;
+    flash_status_t status    = FLASH_STATUS_OK;
+    const uint32_t real_size = ( size + 7 ) & ~( ( uint32_t ) 7 );
+    uint32_t       offset    = 0;
 
-    FLASH_EraseInitTypeDef EraseInitStruct;
+    if( ( ( addr % 8 ) != 0 ) || ( addr < flash_user_start_addr ) || ( size == 0 ) ||
+        ( ( addr + real_size - 1 ) > FLASH_USER_LAST_ADDR ) )
+    {
+        return FLASH_STATUS_INVALID_PARAM;
+    }
 
     /* Unlock the Flash to enable the flash control register access *************/
     HAL_FLASH_Unlock( );
@@ -214,43 +249,15 @@ uint8_t flash_force_erase_page( uint32_t addr, uint8_t nb_page )
     /* Clear OPTVERR bit set on virgin samples */
     __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_OPTVERR );
 
-    /* Erase the user Flash area
-    (area defined by FlashUserStartAddr and FLASH_USER_END_ADDR) ***********/
-
-    /* Get the 1st page to erase */
-    first_user_page = get_page( addr );
-
-    /* Fill EraseInit structure*/
-    EraseInitStruct.TypeErase = FLASH_TYPEERASE_PAGES;
-    EraseInitStruct.Page      = first_user_page;
-    EraseInitStruct.NbPages   = nb_page;
-
-    /* Note: If an erase operation in Flash memory also concerns data in the data or instruction cache,
-     you have to make sure that these data are rewritten before they are accessed during code
-     execution. If this cannot be done safely, it is recommended to flush the caches by setting the
-     DCRST and ICRST bits in the FLASH_CR register. */
-    do
+    while( ( offset < size ) && ( status == FLASH_STATUS_OK ) )
     {
-        hal_status = HAL_FLASHEx_Erase( &EraseInitStruct, &page_error );
-        flash_operation_retry++;
-    } while( ( hal_status != HAL_OK ) && ( flash_operation_retry < FLASH_OPERATION_MAX_RETRY ) );
+        const uint32_t remaining = size - offset;
+        uint64_t       data64    = FLASH_PAGE_EMPTY_CONTENT;
 
-    if( flash_operation_retry >= FLASH_OPERATION_MAX_RETRY )
-    {
-        /*
-          Error occurred while  erase.
-          User can add here some code to deal with this error.
-          PageError will contain the faulty  and then to know the code error on this ,
-          user can call function 'HAL_FLASH_GetError()'
-        */
-        /* Infinite loop */
-        while( 1 )
-        {
-        }
-    }
-    else
-    {
-        flash_operation_retry = 0;
+        // Double words copied from any alignment, the last one is padded with the erased value
+        memcpy( &data64, &buffer[offset], ( remaining < 8 ) ? remaining : 8 );
+        status = flash_program( addr + offset, data64 );
+        offset += 8;
     }
 
     /* Lock the Flash to disable the flash control register access (recommended
@@ -260,73 +267,117 @@ uint8_t flash_force_erase_page( uint32_t addr, uint8_t nb_page )
     return status;
 }
 
-uint32_t flash_write_buffer( uint32_t addr, uint8_t* buffer, uint32_t size )
+void flash_read_buffer( uint32_t addr, uint8_t* buffer, uint32_t size )
 {
-    uint8_t  status       = SMTC_SUCCESS;
-    uint8_t  hal_status   = SMTC_SUCCESS;
-    uint32_t buffer_index = 0, nb_of_pages_max = 0, real_size = 0, addr_end = 0;
-    uint64_t data64                = 0;
-    uint8_t  flash_operation_retry = 0;
+    uint32_t flash_index = 0;
+    __IO uint8_t data8   = 0;
 
-    /* Complete size for FLASH_TYPEPROGRAM_DOUBLEWORD operation*/
-    if( ( size % 8 ) != 0 )
-    {
-        real_size = size + ( 8 - ( size % 8 ) );
-    }
-    else
+    while( flash_index < size )
     {
-        real_size = size;
+        data8 = *( __IO uint32_t* ) ( addr + flash_index );
+
+        buffer[flash_index] = data8;
+
+        flash_index++;
     }
+}
+
+uint32_t flash_get_user_start_addr( void ) { return flash_user_start_addr; }
 
-    addr_end = addr + real_size;
+void flash_set_user_start_addr( uint32_t addr ) { flash_user_start_addr = addr; }
+
+bool flash_is_bank_swapped( void )
+{
+    __HAL_RCC_SYSCFG_CLK_ENABLE( );
+    return READ_BIT( SYSCFG->MEMRMP, SYSCFG_MEMRMP_FB_MODE ) != 0;
+}
+
+flash_status_t flash_swap_banks( void )
+{
+    FLASH_OBProgramInitTypeDef option_bytes = { 0 };
+
+    option_bytes.OptionType = OPTIONBYTE_USER;
+    option_bytes.USERType   = OB_USER_BFB2;
+    option_bytes.USERConfig = ( flash_is_bank_swapped( ) == true ) ? OB_BFB2_DISABLE : OB_BFB2_ENABLE;
 
-    /* Unlock the Flash to enable the flash control register access *************/
     HAL_FLASH_Unlock( );
+    HAL_FLASH_OB_Unlock( );
 
     /* Clear OPTVERR bit set on virgin samples */
     __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_OPTVERR );
 
-    /* Get the number of pages available */
-    nb_of_pages_max = get_page( FLASH_USER_END_ADDR ) - get_page( flash_user_start_addr ) + 1;
-
-    if( ( flash_user_start_addr > addr ) || ( ( real_size / ADDR_FLASH_PAGE_SIZE ) > nb_of_pages_max ) )
+    if( HAL_FLASHEx_OBProgram( &option_bytes ) == HAL_OK )
     {
-        status = SMTC_FAIL;
-        return status;
+        // Generates a reset
+        HAL_FLASH_OB_Launch( );
     }
 
-    /* Program the user Flash area word by word
-    (area defined by FlashUserStartAddr and FLASH_USER_END_ADDR) ***********/
+    HAL_FLASH_OB_Lock( );
+    HAL_FLASH_Lock( );
+
+    return FLASH_STATUS_PROGRAM_ERROR;
+}
+
+static uint32_t get_page( uint32_t addr ) { return ( addr - FLASH_BASE ) / FLASH_PAGE_SIZE; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static flash_status_t flash_erase( uint32_t first_page, uint32_t nb_pages )
+{
+    flash_status_t status = FLASH_STATUS_OK;
+
+    /* Unlock the Flash to enable the flash control register access *************/
+    HAL_FLASH_Unlock( );
+
+    /* Clear OPTVERR bit set on virgin samples */
+    __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_OPTVERR );
 
-    while( addr < addr_end )
+    /* Note: If an erase operation in Flash memory also concerns data in the data or instruction cache,
+     you have to make sure that these data are rewritten before they are accessed during code
+     execution. If this cannot be done safely, it is recommended to flush the caches by setting the
+     DCRST and ICRST bits in the FLASH_CR register. */
+    while( ( nb_pages > 0 ) && ( status == FLASH_STATUS_OK ) )
     {
-        data64 = 0;
-        for( uint8_t i = 0; i < 8; i++ )
+        FLASH_EraseInitTypeDef erase_init;
+        HAL_StatusTypeDef      hal_status            = HAL_OK;
+        uint32_t               page_error            = 0xFFFFFFFF;
+        uint8_t                flash_operation_retry = 0;
+
+        // A single erase request per bank: its pages are numbered from the start of the bank. The erase targets a
+        // physical bank, the second one being mapped first when the banks are swapped.
+        erase_init.TypeErase = FLASH_TYPEERASE_PAGES;
+        erase_init.Banks =
+            ( ( first_page < FLASH_NB_PAGES_PER_BANK ) != flash_is_bank_swapped( ) ) ? FLASH_BANK_1 : FLASH_BANK_2;
+        erase_init.Page      = first_page % FLASH_NB_PAGES_PER_BANK;
+        erase_init.NbPages   = FLASH_NB_PAGES_PER_BANK - erase_init.Page;
+        if( erase_init.NbPages > nb_pages )
         {
-            data64 += ( ( ( uint64_t ) buffer[buffer_index + i] ) << ( i * 8 ) );
+            erase_init.NbPages = nb_pages;
         }
+        first_page += erase_init.NbPages;
+        nb_pages -= erase_init.NbPages;
 
         do
         {
-            hal_status = HAL_FLASH_Program( FLASH_TYPEPROGRAM_DOUBLEWORD, addr, data64 );
+            // page_error is left untouched when the erase fails before its page loop (busy Flash, timeout)
+            page_error = 0xFFFFFFFF;
+            hal_status = HAL_FLASHEx_Erase( &erase_init, &page_error );
+            if( ( hal_status != HAL_OK ) && ( page_error >= erase_init.Page ) &&
+                ( page_error < ( erase_init.Page + erase_init.NbPages ) ) )
+            {
+                // Retry from the faulty page, the previous ones are erased. Otherwise retry the same range.
+                erase_init.NbPages -= page_error - erase_init.Page;
+                erase_init.Page = page_error;
+            }
             flash_operation_retry++;
         } while( ( hal_status != HAL_OK ) && ( flash_operation_retry < FLASH_OPERATION_MAX_RETRY ) );
 
-        if( flash_operation_retry >= FLASH_OPERATION_MAX_RETRY )
+        if( hal_status != HAL_OK )
         {
-            /* Error occurred while writing data in Flash memory.
-            User can add here some code to deal with this error */
-            /* Infinite loop */
-            while( 1 )
-            {
-            }
-        }
-        else
-        {
-            flash_operation_retry = 0;
-            /* increment to next double word*/
-            addr         = addr + 8;
-            buffer_index = buffer_index + 8;
+            status = FLASH_STATUS_ERASE_ERROR;
         }
     }
 
@@ -334,33 +385,36 @@ uint32_t flash_write_buffer( uint32_t addr, uint8_t* buffer, uint32_t size )
     to protect the FLASH memory against possible unwanted operation) *********/
     HAL_FLASH_Lock( );
 
-    return real_size;
+    return status;
 }
 
-void flash_read_buffer( uint32_t addr, uint8_t* buffer, uint32_t size )
+static flash_status_t flash_program( uint32_t addr, uint64_t data )
 {
-    uint32_t flash_index = 0;
-    __IO uint8_t data8   = 0;
+    HAL_StatusTypeDef hal_status            = HAL_OK;
+    uint8_t           flash_operation_retry = 0;
 
-    while( flash_index < size )
+    do
     {
-        data8 = *( __IO uint32_t* ) ( addr + flash_index );
-
-        buffer[flash_index] = data8;
+        hal_status = HAL_FLASH_Program( FLASH_TYPEPROGRAM_DOUBLEWORD, addr, data );
+        flash_operation_retry++;
+    } while( ( hal_status != HAL_OK ) && ( flash_operation_retry < FLASH_OPERATION_MAX_RETRY ) );
 
-        flash_index++;
-    }
+    return ( hal_status == HAL_OK ) ? FLASH_STATUS_OK : FLASH_STATUS_PROGRAM_ERROR;
 }
 
-uint32_t flash_get_user_start_addr( void ) { return flash_user_start_addr; }
-
-void flash_set_user_start_addr( uint32_t addr ) { flash_user_start_addr = addr; }
-
-static uint32_t get_page( uint32_t addr ) { return ( addr - FLASH_BASE ) / FLASH_PAGE_SIZE; }
+static bool flash_is_page_empty( uint32_t page )
+{
+    const uint64_t* word     = ( const uint64_t* ) ADDR_FLASH_PAGE( page );
+    const uint64_t* page_end = word + ( ADDR_FLASH_PAGE_SIZE / sizeof( uint64_t ) );
 
-/*
- * -----------------------------------------------------------------------------
- * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
- */
+    while( word < page_end )
+    {
+        if( *word++ != FLASH_PAGE_EMPTY_CONTENT )
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -34,6 +34,8 @@
  * --- DEPENDENCIES ------------------------------------------------------------
  */
 
+#define HAL_DBG_TRACE_MODULE HAL_DBG_TRACE_MODULE_HAL
+
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
 
@@ -91,6 +93,7 @@ typedef enum low_power_mode_e
 static volatile bool             hal_exit_wait        = false;
 static volatile low_power_mode_t hal_lp_current_mode  = LOW_POWER_ENABLE;
 static bool                      partial_sleep_enable = false;
+static volatile bool             stop_mode_enable     = true;
 
 /*!
  * @brief Timer to handle the software watchdog
@@ -264,6 +267,9 @@ void hal_mcu_panic( void )
 
     HAL_DBG_TRACE_ERROR( "%s\n", __func__ );
     HAL_DBG_TRACE_ERROR( "PANIC" );
+#if( HAL_DBG_TRACE_BINARY == HAL_FEATURE_ON )
+    hal_dbg_log_flush( );
+#endif
 
     /* reset the board */
     hal_mcu_reset( );
@@ -372,6 +378,8 @@ void assert_failed( uint8_t* file, uint32_t line )
 
 void hal_mcu_partial_sleep_enable( bool enable ) { partial_sleep_enable = enable; }
 
+void hal_mcu_stop_mode_enable( bool enable ) { stop_mode_enable = enable; }
+
 void hal_mcu_set_sleep_for_ms( const int32_t milliseconds )
 {
     if( milliseconds <= 0 )
@@ -580,6 +588,10 @@ static void hal_mcu_lpm_exit_stop_mode( void )
  */
 void hal_mcu_low_power_handler( void )
 {
+#if( HAL_DBG_TRACE_BINARY == HAL_FEATURE_ON )
+    /* Send the pending binary traces while the UART is still initialized */
+    hal_dbg_log_flush( );
+#endif
 #if( HAL_LOW_POWER_MODE == HAL_FEATURE_ON )
     __disable_irq( );
     /*!
@@ -587,8 +599,18 @@ void hal_mcu_low_power_handler( void )
      * and cortex will not enter low power anyway
      */
 
-    hal_mcu_lpm_enter_stop_mode( );
-    hal_mcu_lpm_exit_stop_mode( );
+    if( stop_mode_enable == true )
+    {
+        hal_mcu_lpm_enter_stop_mode( );
+        hal_mcu_lpm_exit_stop_mode( );
+    }
+    else
+    {
+        /* Sleep mode: the peripherals keep running, the SysTick is suspended to not wake up every millisecond */
+        HAL_SuspendTick( );
+        HAL_PWR_EnterSLEEPMode( PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI );
+        HAL_ResumeTick( );
+    }
 
     __enable_irq( );
 #endif
@@ -721,6 +743,9 @@ static void on_soft_watchdog_event( void* context )
 void HardFault_Handler( void )
 {
     HAL_DBG_TRACE_ERROR( "HardFault_Handler\n\r" );
+#if( HAL_DBG_TRACE_BINARY == HAL_FEATURE_ON )
+    hal_dbg_log_flush( );
+#endif
 
     /* reset the board*/
     hal_mcu_reset( );
@@ -39,6 +39,7 @@
 
 #include "stm32l4xx_hal.h"
 #include "smtc_hal_gpio_pin_names.h"
+#include "smtc_hal_gpio.h"
 #include "smtc_hal_uart.h"
 #include "smtc_hal_mcu.h"
 
@@ -69,6 +70,17 @@ typedef struct hal_uart_s
         hal_gpio_pin_names_t tx;
         hal_gpio_pin_names_t rx;
     } pins;
+    struct
+    {
+        DMA_Channel_TypeDef* channel;     //!< DMA channel mapped on the UART RX request
+        IRQn_Type            irq;         //!< Interrupt of the DMA channel
+        DMA_HandleTypeDef    dma;         //!< DMA handle
+        uint8_t*             buffer;      //!< Circular reception buffer, NULL when the DMA reception is not started
+        uint16_t             size;        //!< Size of the circular reception buffer
+        uint16_t             read_index;  //!< Index of the next byte to be read in the circular reception buffer
+        void ( *callback )( void );       //!< Called under interrupt when new bytes are received
+        hal_gpio_irq_t       wakeup_irq;  //!< RX pin interrupt waking up the MCU from stop mode
+    } rx;
 } hal_uart_t;
 
 static hal_uart_t hal_uart[] = {
@@ -81,6 +93,12 @@ static hal_uart_t hal_uart[] = {
                     .tx = NC,
                     .rx = NC,
                 },
+            .rx =
+                {
+                    .channel = DMA1_Channel5,
+                    .irq     = DMA1_Channel5_IRQn,
+                    .buffer  = NULL,
+                },
         },
     [1] =
         {
@@ -91,6 +109,12 @@ static hal_uart_t hal_uart[] = {
                     .tx = NC,
                     .rx = NC,
                 },
+            .rx =
+                {
+                    .channel = DMA1_Channel6,
+                    .irq     = DMA1_Channel6_IRQn,
+                    .buffer  = NULL,
+                },
         },
     [2] =
         {
@@ -101,6 +125,12 @@ static hal_uart_t hal_uart[] = {
                     .tx = NC,
                     .rx = NC,
                 },
+            .rx =
+                {
+                    .channel = DMA1_Channel3,
+                    .irq     = DMA1_Channel3_IRQn,
+                    .buffer  = NULL,
+                },
         },
 };
 
@@ -109,7 +139,7 @@ static hal_uart_t hal_uart[] = {
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
-uint8_t uart_rx_done = false;
+static volatile bool uart_rx_done = false;
 
 /*
  * -----------------------------------------------------------------------------
@@ -119,6 +149,39 @@ uint8_t uart_rx_done = false;
 void USART1_IRQHandler(void);
 void USART2_IRQHandler(void);
 void USART3_IRQHandler(void);
+void DMA1_Channel5_IRQHandler( void );
+void DMA1_Channel6_IRQHandler( void );
+void DMA1_Channel3_IRQHandler( void );
+
+/**
+ * @brief Handle the idle line interrupt and the other UART interrupts
+ *
+ * @param [in] local_id UART index in hal_uart array
+ */
+static void hal_uart_irq_handler( const uint32_t local_id );
+
+/**
+ * @brief Configure the DMA channel and (re)start the circular reception
+ *
+ * @param [in] local_id UART index in hal_uart array
+ */
+static void hal_uart_rx_dma_restart( const uint32_t local_id );
+
+/**
+ * @brief Get the UART index in hal_uart array from the HAL handle
+ *
+ * @param [in] handle UART HAL handle
+ *
+ * @returns UART index in hal_uart array
+ */
+static uint32_t hal_uart_get_local_id( const UART_HandleTypeDef* handle );
+
+/**
+ * @brief Call the reception callback of the UART, if any
+ *
+ * @param [in] context UART index in hal_uart array
+ */
+static void hal_uart_rx_notify( void* context );
 
 /*
  * -----------------------------------------------------------------------------
@@ -144,11 +207,31 @@ void hal_uart_init( const uint32_t id, const hal_gpio_pin_names_t uart_tx, const
     hal_uart[local_id].pins.tx = uart_tx;
     hal_uart[local_id].pins.rx = uart_rx;
 
+    if( hal_uart[local_id].rx.buffer != NULL )
+    {
+        /* Back from stop mode: release the RX pin wake-up interrupt, still pending if it woke up the MCU as the
+         * interrupts are disabled during the low power handler */
+        const uint16_t rx_pin_mask = ( 1 << ( uart_rx & 0x0F ) );
+
+        hal_gpio_irq_deatach( &hal_uart[local_id].rx.wakeup_irq );
+        HAL_GPIO_DeInit( ( GPIO_TypeDef* ) ( AHB2PERIPH_BASE + ( ( uart_rx & 0xF0 ) << 6 ) ), rx_pin_mask );
+        if( __HAL_GPIO_EXTI_GET_IT( rx_pin_mask ) != RESET )
+        {
+            __HAL_GPIO_EXTI_CLEAR_IT( rx_pin_mask );
+            hal_uart_rx_notify( ( void* ) local_id );
+        }
+    }
+
     if( HAL_UART_Init( &hal_uart[local_id].handle ) != HAL_OK )
     {
         hal_mcu_panic( );
     }
     __HAL_UART_ENABLE( &hal_uart[local_id].handle );
+
+    if( hal_uart[local_id].rx.buffer != NULL )
+    {
+        hal_uart_rx_dma_restart( local_id );
+    }
 }
 
 void hal_uart_deinit( const uint32_t id )
@@ -156,7 +239,23 @@ void hal_uart_deinit( const uint32_t id )
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
     uint32_t local_id = id - 1;
 
+    if( hal_uart[local_id].rx.buffer != NULL )
+    {
+        HAL_UART_AbortReceive( &hal_uart[local_id].handle );
+        HAL_NVIC_DisableIRQ( hal_uart[local_id].rx.irq );
+    }
+
     HAL_UART_DeInit( &hal_uart[local_id].handle );
+
+    if( hal_uart[local_id].rx.buffer != NULL )
+    {
+        /* The UART is not clocked in stop mode: the start bit of the next received byte wakes up the MCU, this byte
+         * is lost */
+        hal_uart[local_id].rx.wakeup_irq.context  = ( void* ) local_id;
+        hal_uart[local_id].rx.wakeup_irq.callback = hal_uart_rx_notify;
+        hal_gpio_init_in( hal_uart[local_id].pins.rx, HAL_GPIO_PULL_MODE_UP, HAL_GPIO_IRQ_MODE_FALLING,
+                          &hal_uart[local_id].rx.wakeup_irq );
+    }
 }
 
 void hal_uart_tx( const uint32_t id, uint8_t* buff, uint16_t len )
@@ -172,6 +271,18 @@ void hal_uart_rx( const uint32_t id, uint8_t* rx_buffer, uint8_t len )
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
     uint32_t local_id = id - 1;
 
+    if( hal_uart[local_id].rx.buffer != NULL )
+    {
+        /* The DMA reception owns the UART: read from its buffer */
+        uint8_t nb_read = 0;
+
+        while( nb_read < len )
+        {
+            nb_read += hal_uart_rx_read( id, &rx_buffer[nb_read], len - nb_read );
+        }
+        return;
+    }
+
     HAL_UART_Receive_IT( &hal_uart[local_id].handle, rx_buffer, len );
 
     while( uart_rx_done != true )
@@ -180,6 +291,49 @@ void hal_uart_rx( const uint32_t id, uint8_t* rx_buffer, uint8_t len )
     uart_rx_done = false;
 }
 
+void hal_uart_rx_dma_start( const uint32_t id, uint8_t* buffer, uint16_t size, void ( *callback )( void ) )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+    uint32_t local_id = id - 1;
+
+    hal_uart[local_id].rx.buffer   = buffer;
+    hal_uart[local_id].rx.size     = size;
+    hal_uart[local_id].rx.callback = callback;
+
+    hal_uart_rx_dma_restart( local_id );
+}
+
+uint16_t hal_uart_rx_read( const uint32_t id, uint8_t* buffer, uint16_t max_len )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+    uint32_t    local_id = id - 1;
+    hal_uart_t* uart     = &hal_uart[local_id];
+    uint16_t    len      = 0;
+
+    if( uart->rx.buffer == NULL )
+    {
+        return 0;
+    }
+
+    /* The DMA counter holds the number of bytes left before the end of the circular buffer */
+    uint16_t write_index = uart->rx.size - ( uint16_t ) __HAL_DMA_GET_COUNTER( &uart->rx.dma );
+    if( write_index >= uart->rx.size )
+    {
+        write_index = 0;
+    }
+
+    while( ( uart->rx.read_index != write_index ) && ( len < max_len ) )
+    {
+        buffer[len++] = uart->rx.buffer[uart->rx.read_index++];
+        if( uart->rx.read_index >= uart->rx.size )
+        {
+            uart->rx.read_index = 0;
+        }
+    }
+
+    return len;
+}
+
 void HAL_UART_MspInit( UART_HandleTypeDef* huart )
 {
     if( huart->Instance == hal_uart[0].interface )
@@ -283,14 +437,14 @@ void HAL_UART_MspDeInit( UART_HandleTypeDef* huart )
 /**
  * @brief  This function handles USART1 interrupt request.
  */
-void USART1_IRQHandler( void ) { HAL_UART_IRQHandler( &hal_uart[0].handle ); }
+void USART1_IRQHandler( void ) { hal_uart_irq_handler( 0 ); }
 
 /**
   * @brief  This function handles USART2 interrupt request.
   */
 void USART2_IRQHandler(void)
 {
-  HAL_UART_IRQHandler(&hal_uart[1].handle);
+  hal_uart_irq_handler( 1 );
 }
 
 /**
@@ -298,16 +452,141 @@ void USART2_IRQHandler(void)
   */
 void USART3_IRQHandler(void)
 {
-  HAL_UART_IRQHandler(&hal_uart[2].handle);
+  hal_uart_irq_handler( 2 );
 }
 
+/**
+ * @brief  This function handles DMA1 channel 5 interrupt request (USART1 RX).
+ */
+void DMA1_Channel5_IRQHandler( void ) { HAL_DMA_IRQHandler( &hal_uart[0].rx.dma ); }
+
+/**
+ * @brief  This function handles DMA1 channel 6 interrupt request (USART2 RX).
+ */
+void DMA1_Channel6_IRQHandler( void ) { HAL_DMA_IRQHandler( &hal_uart[1].rx.dma ); }
+
+/**
+ * @brief  This function handles DMA1 channel 3 interrupt request (USART3 RX).
+ */
+void DMA1_Channel3_IRQHandler( void ) { HAL_DMA_IRQHandler( &hal_uart[2].rx.dma ); }
+
 /**
  * @brief  Rx Transfer completed callback
  * @param  UartHandle: UART handle
- * @note   This example shows a simple way to report end of DMA Rx transfer, and
- *         you can add your own implementation.
+ * @note   In DMA circular mode, it is called each time the end of the reception buffer is reached
+ * @retval None
+ */
+void HAL_UART_RxCpltCallback( UART_HandleTypeDef* UartHandle )
+{
+    const uint32_t local_id = hal_uart_get_local_id( UartHandle );
+
+    if( hal_uart[local_id].rx.buffer != NULL )
+    {
+        hal_uart_rx_notify( ( void* ) local_id );
+    }
+    else
+    {
+        uart_rx_done = true;
+    }
+}
+
+/**
+ * @brief  Rx Half Transfer completed callback
+ * @param  UartHandle: UART handle
  * @retval None
  */
-void HAL_UART_RxCpltCallback( UART_HandleTypeDef* UartHandle ) { uart_rx_done = true; }
+void HAL_UART_RxHalfCpltCallback( UART_HandleTypeDef* UartHandle )
+{
+    hal_uart_rx_notify( ( void* ) hal_uart_get_local_id( UartHandle ) );
+}
+
+/**
+ * @brief  UART error callback
+ * @param  UartHandle: UART handle
+ * @note   The HAL aborts the DMA reception on error (overrun, framing, noise): restart it
+ * @retval None
+ */
+void HAL_UART_ErrorCallback( UART_HandleTypeDef* UartHandle )
+{
+    const uint32_t local_id = hal_uart_get_local_id( UartHandle );
+
+    if( ( hal_uart[local_id].rx.buffer != NULL ) && ( UartHandle->RxState == HAL_UART_STATE_READY ) )
+    {
+        hal_uart_rx_dma_restart( local_id );
+    }
+}
+
+static void hal_uart_irq_handler( const uint32_t local_id )
+{
+    UART_HandleTypeDef* handle = &hal_uart[local_id].handle;
+
+    if( ( __HAL_UART_GET_FLAG( handle, UART_FLAG_IDLE ) != RESET ) &&
+        ( __HAL_UART_GET_IT_SOURCE( handle, UART_IT_IDLE ) != RESET ) )
+    {
+        /* End of a burst of bytes: report them without waiting for the half or full buffer DMA interrupts */
+        __HAL_UART_CLEAR_IDLEFLAG( handle );
+        hal_uart_rx_notify( ( void* ) local_id );
+    }
+
+    HAL_UART_IRQHandler( handle );
+}
+
+static void hal_uart_rx_dma_restart( const uint32_t local_id )
+{
+    hal_uart_t* uart = &hal_uart[local_id];
+
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+
+    uart->rx.dma.Instance                 = uart->rx.channel;
+    uart->rx.dma.Init.Request             = DMA_REQUEST_2;
+    uart->rx.dma.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    uart->rx.dma.Init.PeriphInc           = DMA_PINC_DISABLE;
+    uart->rx.dma.Init.MemInc              = DMA_MINC_ENABLE;
+    uart->rx.dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    uart->rx.dma.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    uart->rx.dma.Init.Mode                = DMA_CIRCULAR;
+    uart->rx.dma.Init.Priority            = DMA_PRIORITY_LOW;
+
+    if( HAL_DMA_Init( &uart->rx.dma ) != HAL_OK )
+    {
+        hal_mcu_panic( );
+    }
+    __HAL_LINKDMA( &uart->handle, hdmarx, uart->rx.dma );
+
+    HAL_NVIC_SetPriority( uart->rx.irq, 0, 1 );
+    HAL_NVIC_EnableIRQ( uart->rx.irq );
+
+    uart->rx.read_index = 0;
+    if( HAL_UART_Receive_DMA( &uart->handle, uart->rx.buffer, uart->rx.size ) != HAL_OK )
+    {
+        hal_mcu_panic( );
+    }
+
+    __HAL_UART_CLEAR_IDLEFLAG( &uart->handle );
+    __HAL_UART_ENABLE_IT( &uart->handle, UART_IT_IDLE );
+}
+
+static uint32_t hal_uart_get_local_id( const UART_HandleTypeDef* handle )
+{
+    for( uint32_t i = 0; i < ( sizeof( hal_uart ) / sizeof( hal_uart[0] ) ); i++ )
+    {
+        if( handle->Instance == hal_uart[i].interface )
+        {
+            return i;
+        }
+    }
+    hal_mcu_panic( );
+    return 0;
+}
+
+static void hal_uart_rx_notify( void* context )
+{
+    const uint32_t local_id = ( uint32_t ) context;
+
+    if( hal_uart[local_id].rx.callback != NULL )
+    {
+        hal_uart[local_id].rx.callback( );
+    }
+}
 
 /* --- EOF ------------------------------------------------------------------ */
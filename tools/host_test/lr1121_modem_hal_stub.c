@@ -0,0 +1,89 @@
+/*!
+ * @file      lr1121_modem_hal_stub.c
+ *
+ * @brief     Host stub of the LR1121 Modem-E HAL, the tests build the driver without a chip
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include "lr1121_modem_hal.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+lr1121_modem_hal_status_t lr1121_modem_hal_write( const void* context, const uint8_t* command,
+                                                  const uint16_t command_length, const uint8_t* data,
+                                                  const uint16_t data_length )
+{
+    return LR1121_MODEM_HAL_STATUS_ERROR;
+}
+
+lr1121_modem_hal_status_t lr1121_modem_hal_read( const void* context, const uint8_t* command,
+                                                 const uint16_t command_length, uint8_t* data,
+                                                 const uint16_t data_length )
+{
+    return LR1121_MODEM_HAL_STATUS_ERROR;
+}
+
+lr1121_modem_hal_status_t lr1121_modem_hal_write_read( const void* context, const uint8_t* command, uint8_t* data,
+                                                       const uint16_t data_length )
+{
+    return LR1121_MODEM_HAL_STATUS_ERROR;
+}
+
+lr1121_modem_hal_status_t lr1121_modem_hal_direct_read( const void* context, uint8_t* data,
+                                                        const uint16_t data_length )
+{
+    return LR1121_MODEM_HAL_STATUS_ERROR;
+}
+
+lr1121_modem_hal_status_t lr1121_modem_hal_write_without_rc( const void* context, const uint8_t* command,
+                                                             const uint16_t command_length, const uint8_t* data,
+                                                             const uint16_t data_length )
+{
+    return LR1121_MODEM_HAL_STATUS_ERROR;
+}
+
+lr1121_modem_hal_status_t lr1121_modem_hal_reset( const void* context ) { return LR1121_MODEM_HAL_STATUS_ERROR; }
+
+void lr1121_modem_hal_enter_dfu( const void* context ) {}
+
+lr1121_modem_hal_status_t lr1121_modem_hal_wakeup( const void* context ) { return LR1121_MODEM_HAL_STATUS_ERROR; }
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,85 @@
+/*!
+ * @file      smtc_airtime_table_test.c
+ *
+ * @brief     Host test of the time-on-air tables against the radio driver function
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "lr1121_modem_radio.h"
+#include "apps_airtime_table.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+int main( void )
+{
+    uint32_t nb_errors = 0;
+
+    for( uint8_t row = 0; row < APPS_AIRTIME_TABLE_NB_ROWS; row++ )
+    {
+        for( uint16_t length = 0; length < APPS_AIRTIME_TABLE_NB_LENGTHS; length++ )
+        {
+            const lr1121_modem_radio_pkt_params_lora_t pkt_params = {
+                .preamble_len_in_symb = APPS_AIRTIME_TABLE_PREAMBLE_LEN,
+                .header_type          = LR1121_MODEM_RADIO_LORA_PKT_EXPLICIT,
+                .pld_len_in_bytes     = ( uint8_t ) length,
+                .crc                  = LR1121_MODEM_RADIO_LORA_CRC_ON,
+                .iq                   = LR1121_MODEM_RADIO_LORA_IQ_STANDARD,
+            };
+            const uint32_t expected_ms =
+                lr1121_modem_radio_get_lora_time_on_air_in_ms( &pkt_params, &apps_airtime_table_mod_params[row] );
+
+            if( apps_airtime_table_ms[row][length] != expected_ms )
+            {
+                printf( "row %u length %u: %u ms, expected %u ms\n", row, length, apps_airtime_table_ms[row][length],
+                        expected_ms );
+                nb_errors++;
+            }
+        }
+    }
+
+    printf( "Airtime tables: %s (%u rows of %u lengths, %u errors)\n", ( nb_errors == 0 ) ? "PASS" : "FAIL",
+            APPS_AIRTIME_TABLE_NB_ROWS, APPS_AIRTIME_TABLE_NB_LENGTHS, nb_errors );
+    return ( nb_errors == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,211 @@
+/*!
+ * @file      smtc_crc32_test.c
+ *
+ * @brief     Host test and benchmark of the HAL CRC32 against the modem driver FUOTA CRC32
+ *
+ * @copyright
+ * @parblock
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * @endparblock
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "smtc_hal_crc.h"
+
+// The reference function is private to the driver: build the driver in this file
+#include "lr1121_modem_lorawan.c"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/**
+ * @brief Size of the random test buffer, the split tests use its prefixes
+ */
+#define CRC32_TEST_BUFFER_SIZE 4096
+
+/**
+ * @brief Number of random split tests
+ */
+#define CRC32_TEST_NB_SPLITS 20000
+
+/**
+ * @brief Size of the benchmark buffer and number of passes over it
+ */
+#define CRC32_BENCH_BUFFER_SIZE ( 64 * 1024 )
+#define CRC32_BENCH_NB_PASSES 512
+
+/**
+ * @brief CRC-32 check value, CRC of "123456789"
+ */
+#define CRC32_CHECK_VALUE 0xCBF43926
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint8_t test_buffer[CRC32_TEST_BUFFER_SIZE + 8];
+
+static uint8_t bench_buffer[CRC32_BENCH_BUFFER_SIZE];
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/**
+ * @brief CRC32 of a buffer with the driver function
+ */
+static uint32_t reference_crc32( uint32_t crc, const uint8_t* buffer, uint32_t size )
+{
+    lr1121_modem_fuota_crc32( &crc, buffer, size );
+    return crc;
+}
+
+/**
+ * @brief Time the throughput of a CRC32 function in MB/s
+ */
+static double bench( uint32_t ( *crc32 )( uint32_t, const uint8_t*, uint32_t ), uint32_t* crc )
+{
+    const clock_t start = clock( );
+
+    *crc = HAL_CRC32_INIT_VALUE;
+    for( int pass = 0; pass < CRC32_BENCH_NB_PASSES; pass++ )
+    {
+        *crc = crc32( *crc, bench_buffer, sizeof( bench_buffer ) );
+    }
+    return ( ( double ) CRC32_BENCH_BUFFER_SIZE * CRC32_BENCH_NB_PASSES / ( 1024 * 1024 ) ) /
+           ( ( double ) ( clock( ) - start ) / CLOCKS_PER_SEC );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+int main( void )
+{
+    const uint8_t check[] = "123456789";
+    uint32_t      nb_errors = 0;
+    uint32_t      crc_hal;
+    uint32_t      crc_ref;
+
+    srand( 1 );
+    for( uint32_t i = 0; i < sizeof( test_buffer ); i++ )
+    {
+        test_buffer[i] = ( uint8_t ) rand( );
+    }
+    for( uint32_t i = 0; i < sizeof( bench_buffer ); i++ )
+    {
+        bench_buffer[i] = ( uint8_t ) rand( );
+    }
+
+    // Test vectors
+    crc_hal = hal_crc32_update( HAL_CRC32_INIT_VALUE, check, 9 );
+    crc_ref = reference_crc32( 0, check, 9 );
+    if( ( crc_hal != CRC32_CHECK_VALUE ) || ( crc_ref != CRC32_CHECK_VALUE ) )
+    {
+        printf( "check value: 0x%08X / 0x%08X, expected 0x%08X\n", crc_hal, crc_ref, CRC32_CHECK_VALUE );
+        nb_errors++;
+    }
+    if( hal_crc32_update( HAL_CRC32_INIT_VALUE, check, 0 ) != 0 )
+    {
+        printf( "empty buffer: 0x%08X, expected 0\n", hal_crc32_update( HAL_CRC32_INIT_VALUE, check, 0 ) );
+        nb_errors++;
+    }
+
+    // Every size and alignment of a single call
+    for( uint32_t offset = 0; offset < 8; offset++ )
+    {
+        for( uint32_t size = 0; size <= 256; size++ )
+        {
+            crc_hal = hal_crc32_update( HAL_CRC32_INIT_VALUE, &test_buffer[offset], size );
+            crc_ref = reference_crc32( 0, &test_buffer[offset], size );
+            if( crc_hal != crc_ref )
+            {
+                printf( "offset %u size %u: 0x%08X, expected 0x%08X\n", offset, size, crc_hal, crc_ref );
+                nb_errors++;
+            }
+        }
+    }
+
+    // Chained calls: a random prefix split in random chunks, at random alignments
+    for( uint32_t test = 0; test < CRC32_TEST_NB_SPLITS; test++ )
+    {
+        const uint32_t offset = rand( ) % 8;
+        const uint32_t size   = rand( ) % ( CRC32_TEST_BUFFER_SIZE + 1 );
+        uint32_t       done   = 0;
+
+        crc_hal = HAL_CRC32_INIT_VALUE;
+        while( done < size )
+        {
+            uint32_t chunk = 1 + rand( ) % 300;
+
+            if( chunk > ( size - done ) )
+            {
+                chunk = size - done;
+            }
+            crc_hal = hal_crc32_update( crc_hal, &test_buffer[offset + done], chunk );
+            done += chunk;
+        }
+        crc_ref = reference_crc32( 0, &test_buffer[offset], size );
+        if( crc_hal != crc_ref )
+        {
+            printf( "split test %u (offset %u size %u): 0x%08X, expected 0x%08X\n", test, offset, size, crc_hal,
+                    crc_ref );
+            nb_errors++;
+        }
+    }
+
+    // Benchmark
+    const double hal_mb_per_s = bench( hal_crc32_update, &crc_hal );
+    const double ref_mb_per_s = bench( reference_crc32, &crc_ref );
+    printf( "hal_crc32_update: %.1f MB/s, lr1121_modem_fuota_crc32: %.1f MB/s (x%.1f)\n", hal_mb_per_s,
+            ref_mb_per_s, hal_mb_per_s / ref_mb_per_s );
+    if( crc_hal != crc_ref )
+    {
+        printf( "benchmark: 0x%08X, expected 0x%08X\n", crc_hal, crc_ref );
+        nb_errors++;
+    }
+
+    printf( "CRC32: %s (%u errors)\n", ( nb_errors == 0 ) ? "PASS" : "FAIL", nb_errors );
+    return ( nb_errors == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,10 @@
+/* Host stub of smtc_hal_options.h: the table-driven CRC32 is built in place of the CRC peripheral */
+#ifndef SMTC_HAL_OPTIONS_H
+#define SMTC_HAL_OPTIONS_H
+
+#define HAL_FEATURE_OFF 0
+#define HAL_FEATURE_ON !HAL_FEATURE_OFF
+
+#define HAL_USE_CRC32_HW HAL_FEATURE_OFF
+
+#endif  // SMTC_HAL_OPTIONS_H
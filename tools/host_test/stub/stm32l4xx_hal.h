@@ -0,0 +1 @@
+/* Host stub: the CRC peripheral is not built on host, HAL_USE_CRC32_HW is off (see smtc_hal_options.h) */
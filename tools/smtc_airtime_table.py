@@ -0,0 +1,223 @@
+##
+## @file  smtc_airtime_table.py
+##
+## @brief Host generator of the LoRa time-on-air tables of the LoRaWAN uplinks
+##
+## The Clear BSD License
+## Copyright Semtech Corporation 2024. All rights reserved.
+##
+## Redistribution and use in source and binary forms, with or without
+## modification, are permitted (subject to the limitations in the disclaimer
+## below) provided that the following conditions are met:
+##     * Redistributions of source code must retain the above copyright
+##       notice, this list of conditions and the following disclaimer.
+##     * Redistributions in binary form must reproduce the above copyright
+##       notice, this list of conditions and the following disclaimer in the
+##       documentation and/or other materials provided with the distribution.
+##     * Neither the name of the Semtech corporation nor the
+##       names of its contributors may be used to endorse or promote products
+##       derived from this software without specific prior written permission.
+##
+## NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+## THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+## CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+## NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+## PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+## LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+## CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+## SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+## INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+## CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+## ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+## POSSIBILITY OF SUCH DAMAGE.
+##
+
+
+##
+## Usage:
+##   python smtc_airtime_table.py header <out.h>
+##   python smtc_airtime_table.py print <row> <size>...
+##
+## The header command generates the time-on-air tables compiled in the application (see Inc/apps/apps_airtime.h):
+## one row per LoRa modulation of the data rates of the supported regions, giving the time on air in ms of a LoRaWAN
+## uplink (APPS_AIRTIME_TABLE_PREAMBLE_LEN preamble symbols, explicit header, CRC, coding rate 4/5) for each PHY
+## payload length from 0 to 255 bytes. The values are computed the way lr1121_modem_radio_get_lora_time_on_air_in_ms
+## does, with the same integer arithmetic, so that the lookup returns exactly what the function returns. The print
+## command prints the time on air of the given PHY payload lengths for a row, named as in the generated header, e.g.
+## SF12_BW125.
+##
+## A generated header is checked against lr1121_modem_radio_get_lora_time_on_air_in_ms itself by the host test:
+##   make -C tools/host_test AIRTIME_TABLE_DIR=<directory of the header>
+##
+
+import argparse
+import os
+import sys
+
+PREAMBLE_LEN = 8
+
+# LoRa coding rate 4/5, short interleaver, as lr1121_modem_radio_lora_cr_t
+CR_4_5 = 1
+
+# Bandwidths as lr1121_modem_radio_lora_bw_t, with their value in Hz
+BANDWIDTHS = {125: (0x04, 125000), 250: (0x05, 250000), 500: (0x06, 500000)}
+
+# Modulations of the LoRa data rates of the sub-GHz regions, as spreading factor and bandwidth in kHz
+ROWS = [(12, 125), (11, 125), (10, 125), (9, 125), (8, 125), (7, 125), (7, 250), (8, 500)]
+
+MAX_PHY_PAYLOAD_SIZE = 255
+
+
+def row_name(sf, bw):
+    return "SF%u_BW%u" % (sf, bw)
+
+
+def ldro(sf, bw):
+    # Low data rate optimization for the symbols of 16 ms or more
+    return 1 if ((1000000 << sf) // BANDWIDTHS[bw][1]) >= 16000 else 0
+
+
+def time_on_air_ms(sf, bw, cr, pld_len_in_bytes, preamble_len=PREAMBLE_LEN, implicit=False, crc=True):
+    fine_synch = 1 if sf <= 6 else 0
+    long_interleaving = cr > 4
+    total_bytes_nb = pld_len_in_bytes + (2 if crc else 0)
+    tx_bits_symbol = sf - 2 * ldro(sf, bw)
+
+    if long_interleaving:
+        fec_rate_numerator = 4
+        fec_rate_denominator = cr + (1 if cr == 7 else 0)
+        if implicit:
+            tx_bits_symbol_start = sf - 2 + 2 * fine_synch
+            if 8 * total_bytes_nb * fec_rate_denominator <= 7 * fec_rate_numerator * tx_bits_symbol_start:
+                ceil_numerator = 8 * total_bytes_nb * fec_rate_denominator
+                ceil_denominator = fec_rate_numerator * tx_bits_symbol_start
+            else:
+                tx_codedbits_header = tx_bits_symbol_start * 8
+                ceil_numerator = (
+                    8 * fec_rate_numerator * tx_bits_symbol
+                    + 8 * total_bytes_nb * fec_rate_denominator
+                    - fec_rate_numerator * tx_codedbits_header
+                )
+                ceil_denominator = fec_rate_numerator * tx_bits_symbol
+        else:
+            tx_infobits_header = (sf * 4 + fine_synch * 8 - 28) & ~0x07
+            if tx_infobits_header < 8 * total_bytes_nb and tx_infobits_header > 8 * pld_len_in_bytes:
+                tx_infobits_header = 8 * pld_len_in_bytes
+            tx_infobits_payload = max(8 * total_bytes_nb - tx_infobits_header, 0)
+            ceil_numerator = tx_infobits_payload * fec_rate_denominator + 8 * fec_rate_numerator * tx_bits_symbol
+            ceil_denominator = fec_rate_numerator * tx_bits_symbol
+    else:
+        tx_infobits_header = sf * 4 + fine_synch * 8 - 8
+        if not implicit:
+            tx_infobits_header -= 20
+        tx_infobits_payload = max(8 * total_bytes_nb - tx_infobits_header, 0)
+        ceil_numerator = tx_infobits_payload
+        ceil_denominator = 4 * tx_bits_symbol
+
+    symbols_nb_data = (ceil_numerator + ceil_denominator - 1) // ceil_denominator
+    if not long_interleaving:
+        symbols_nb_data = symbols_nb_data * (cr + 4) + 8
+    intermed = preamble_len + 4 + 2 * fine_synch + symbols_nb_data
+    numerator = 1000 * (((4 * intermed + 1) * (1 << (sf - 2))) - 1)
+    denominator = BANDWIDTHS[bw][1]
+    return (numerator + denominator - 1) // denominator
+
+
+def license_header(path, brief):
+    lines = [line[3:] if len(line) > 2 else "" for line in LICENSE.splitlines()]
+    text = "/**\n * @file      %s\n *\n * @brief     %s\n *\n * @copyright\n * @parblock\n" % (path, brief)
+    text += "".join((" * " + line).rstrip() + "\n" for line in lines)
+    return text + " * @endparblock\n */\n"
+
+
+def generate_header(path):
+    guard = os.path.basename(path).upper().replace(".", "_")
+    text = license_header(os.path.basename(path), "LoRa time-on-air tables of the LoRaWAN uplinks")
+    text += "\n// Generated by tools/smtc_airtime_table.py, do not edit\n\n"
+    text += "#ifndef %s\n#define %s\n\n" % (guard, guard)
+    text += "#include <stdint.h>\n#include \"lr1121_modem_radio_types.h\"\n\n"
+    text += "/**\n * @brief Preamble length of the packets of the tables, in symbols\n */\n"
+    text += "#define APPS_AIRTIME_TABLE_PREAMBLE_LEN %u\n\n" % PREAMBLE_LEN
+    text += "/**\n * @brief Number of PHY payload lengths of a table row, from 0 byte\n */\n"
+    text += "#define APPS_AIRTIME_TABLE_NB_LENGTHS %u\n\n" % (MAX_PHY_PAYLOAD_SIZE + 1)
+    text += "/**\n * @brief Rows of the time-on-air tables\n */\nenum\n{\n"
+    for sf, bw in ROWS:
+        text += "    APPS_AIRTIME_TABLE_%s,\n" % row_name(sf, bw)
+    text += "    APPS_AIRTIME_TABLE_NB_ROWS,\n};\n\n"
+    text += "/**\n * @brief LoRa modulation of the rows, with coding rate 4/5\n */\n"
+    text += "static const lr1121_modem_radio_mod_params_lora_t "
+    text += "apps_airtime_table_mod_params[APPS_AIRTIME_TABLE_NB_ROWS] = {\n"
+    for sf, bw in ROWS:
+        entry = "    [APPS_AIRTIME_TABLE_%s] = { " % row_name(sf, bw)
+        text += "%sLR1121_MODEM_RADIO_LORA_SF%u, LR1121_MODEM_RADIO_LORA_BW_%u,\n" % (entry, sf, bw)
+        text += "%sLR1121_MODEM_RADIO_LORA_CR_4_5, %u },\n" % (" " * len(entry), ldro(sf, bw))
+    text += "};\n\n"
+    text += "/**\n * @brief Time on air in ms of the LoRaWAN uplinks, per row and PHY payload length\n */\n"
+    text += "static const uint16_t "
+    text += "apps_airtime_table_ms[APPS_AIRTIME_TABLE_NB_ROWS][APPS_AIRTIME_TABLE_NB_LENGTHS] = {\n"
+    for sf, bw in ROWS:
+        text += "    [APPS_AIRTIME_TABLE_%s] = {\n" % row_name(sf, bw)
+        values = [time_on_air_ms(sf, bw, CR_4_5, length) for length in range(MAX_PHY_PAYLOAD_SIZE + 1)]
+        for i in range(0, len(values), 16):
+            text += "        %s,\n" % ", ".join("%u" % value for value in values[i : i + 16])
+        text += "    },\n"
+    text += "};\n\n#endif  // %s\n\n/* --- EOF %s */\n" % (guard, "-" * 66)
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the LoRa time-on-air tables")
+    commands = parser.add_subparsers(dest="command", required=True)
+    header = commands.add_parser("header", help="C tables compiled in the application")
+    header.add_argument("output", help="C header")
+    show = commands.add_parser("print", help="print the time on air of PHY payload lengths")
+    show.add_argument("row", help="row name, e.g. SF12_BW125")
+    show.add_argument("sizes", nargs="+", type=int, help="PHY payload length")
+    options = parser.parse_args()
+
+    if options.command == "header":
+        with open(options.output, "w") as f:
+            f.write(generate_header(options.output))
+    else:
+        rows = {row_name(sf, bw): (sf, bw) for sf, bw in ROWS}
+        if options.row.upper() not in rows:
+            sys.exit("%s: unknown row, one of %s" % (options.row, " ".join(rows)))
+        sf, bw = rows[options.row.upper()]
+        for size in options.sizes:
+            if not 0 <= size <= MAX_PHY_PAYLOAD_SIZE:
+                sys.exit("%u: PHY payload length out of [0,%u]" % (size, MAX_PHY_PAYLOAD_SIZE))
+            print("%s %3u bytes: %u ms" % (row_name(sf, bw), size, time_on_air_ms(sf, bw, CR_4_5, size)))
+
+
+LICENSE = """\
+## The Clear BSD License
+## Copyright Semtech Corporation 2024. All rights reserved.
+##
+## Redistribution and use in source and binary forms, with or without
+## modification, are permitted (subject to the limitations in the disclaimer
+## below) provided that the following conditions are met:
+##     * Redistributions of source code must retain the above copyright
+##       notice, this list of conditions and the following disclaimer.
+##     * Redistributions in binary form must reproduce the above copyright
+##       notice, this list of conditions and the following disclaimer in the
+##       documentation and/or other materials provided with the distribution.
+##     * Neither the name of the Semtech corporation nor the
+##       names of its contributors may be used to endorse or promote products
+##       derived from this software without specific prior written permission.
+##
+## NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+## THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+## CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+## NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+## PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+## LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+## CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+## SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+## INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+## CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+## ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+## POSSIBILITY OF SUCH DAMAGE.
+"""
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,260 @@
+##
+## @file  smtc_dbg_log_decoder.py
+##
+## @brief Host decoder of the binary (tokenized) debug traces
+##
+## The Clear BSD License
+## Copyright Semtech Corporation 2024. All rights reserved.
+##
+## Redistribution and use in source and binary forms, with or without
+## modification, are permitted (subject to the limitations in the disclaimer
+## below) provided that the following conditions are met:
+##     * Redistributions of source code must retain the above copyright
+##       notice, this list of conditions and the following disclaimer.
+##     * Redistributions in binary form must reproduce the above copyright
+##       notice, this list of conditions and the following disclaimer in the
+##       documentation and/or other materials provided with the distribution.
+##     * Neither the name of the Semtech corporation nor the
+##       names of its contributors may be used to endorse or promote products
+##       derived from this software without specific prior written permission.
+##
+## NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+## THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+## CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+## NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+## PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+## LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+## CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+## SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+## INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+## CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+## ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+## POSSIBILITY OF SUCH DAMAGE.
+##
+
+##
+## Usage:
+##   python smtc_dbg_log_decoder.py <firmware.elf> --port /dev/ttyACM0 [--baudrate 921600]
+##   python smtc_dbg_log_decoder.py <firmware.elf> --file capture.bin
+##   cat capture.bin | python smtc_dbg_log_decoder.py <firmware.elf>
+##
+## The firmware must be built with HAL_DBG_TRACE_BINARY set to HAL_FEATURE_ON (see smtc_hal_options.h). The .elf
+## file must be the one of the running firmware: the log identifiers are offsets in its .smtc_log_fmt section.
+## Reading from a serial port requires pyserial, reading from a file or stdin has no dependency.
+##
+
+import argparse
+import re
+import struct
+import sys
+
+FRAME_SYNC = 0xA5
+FRAME_ARRAY_FLAG = 0x80
+FRAME_PACKED_FLAG = 0x40
+ID_DROPPED = 0xFFFF
+FMT_SECTION = ".smtc_log_fmt"
+
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+
+COLOR_DEFAULT = "\x1B[0m"
+COLORS = {"INFO : ": "\x1B[0;32m", "WARN : ": "\x1B[0;33m", "ERROR: ": "\x1B[0;31m"}
+
+# C printf conversion specification: flags, width, precision, length modifier and conversion
+PRINTF_SPEC = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+class Elf32:
+    """Minimal little endian ELF32 reader: only the section headers are parsed"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[0:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError("%s is not a little endian ELF32 file" % path)
+
+        e_shoff, = struct.unpack_from("<I", self.data, 0x20)
+        e_shentsize, e_shnum, e_shstrndx = struct.unpack_from("<HHH", self.data, 0x2E)
+
+        headers = []
+        for i in range(e_shnum):
+            headers.append(struct.unpack_from("<IIIIIIIIII", self.data, e_shoff + i * e_shentsize))
+
+        strtab_offset = headers[e_shstrndx][4]
+        self.sections = []
+        for name, sh_type, flags, addr, offset, size, _, _, _, _ in headers:
+            self.sections.append(
+                {
+                    "name": self._cstring(strtab_offset + name),
+                    "type": sh_type,
+                    "flags": flags,
+                    "addr": addr,
+                    "offset": offset,
+                    "size": size,
+                }
+            )
+
+    def _cstring(self, offset):
+        end = self.data.index(b"\x00", offset)
+        return self.data[offset:end].decode("utf-8", errors="replace")
+
+    def section(self, name):
+        for section in self.sections:
+            if section["name"] == name:
+                return section
+        return None
+
+    def string_at_offset(self, section, offset):
+        if offset >= section["size"]:
+            return None
+        return self._cstring(section["offset"] + offset)
+
+    def string_at_address(self, address):
+        """Read a constant string from the sections loaded in the MCU memory"""
+        for section in self.sections:
+            if (section["flags"] & SHF_ALLOC) == 0 or section["type"] == SHT_NOBITS:
+                continue
+            if section["addr"] <= address < section["addr"] + section["size"]:
+                return self._cstring(section["offset"] + address - section["addr"])
+        return None
+
+
+class Decoder:
+    def __init__(self, elf, color=True):
+        self.elf = elf
+        self.color = color
+        self.fmt_section = elf.section(FMT_SECTION)
+        if self.fmt_section is None:
+            raise ValueError("no %s section: was the firmware built with HAL_DBG_TRACE_BINARY?" % FMT_SECTION)
+        self.buffer = bytearray()
+
+    def feed(self, data):
+        """Append received bytes and return the decoded traces"""
+        self.buffer += data
+        out = []
+        while True:
+            # Resynchronize on the next sync byte
+            start = self.buffer.find(bytes([FRAME_SYNC]))
+            if start < 0:
+                self.buffer.clear()
+                break
+            del self.buffer[:start]
+            if len(self.buffer) < 4:
+                break
+
+            log_id, info = struct.unpack_from("<HB", self.buffer, 1)
+            if info & FRAME_ARRAY_FLAG:
+                if len(self.buffer) < 5:
+                    break
+                frame_len = 5 + self.buffer[4]
+            else:
+                frame_len = 4 + 4 * info
+            if len(self.buffer) < frame_len:
+                break
+
+            frame = bytes(self.buffer[:frame_len])
+            text = self._decode_frame(log_id, info, frame)
+            if text is None:
+                # Not a valid frame: skip this sync byte
+                del self.buffer[:1]
+                continue
+            del self.buffer[:frame_len]
+            out.append(text)
+        return "".join(out)
+
+    def _decode_frame(self, log_id, info, frame):
+        if log_id == ID_DROPPED:
+            if info != 1:
+                return None
+            nb_dropped, = struct.unpack_from("<I", frame, 4)
+            return self._colorize("ERROR: ", "ERROR: %u trace(s) dropped, log buffer full\n" % nb_dropped)
+
+        fmt = self.elf.string_at_offset(self.fmt_section, log_id)
+        if fmt is None:
+            return None
+
+        if info & FRAME_ARRAY_FLAG:
+            data = frame[5:]
+            if info & FRAME_PACKED_FLAG:
+                # HAL_DBG_TRACE_PACKARRAY
+                return "".join("%02X" % b for b in data)
+            lines = []
+            for i in range(0, len(data), 16):
+                lines.append("".join(" %02X" % b for b in data[i : i + 16]))
+            return "%s - (%u bytes):\n%s\n" % (fmt, len(data), "\n".join(lines))
+
+        args = list(struct.unpack_from("<%dI" % info, frame, 4))
+        return self._colorize(fmt, self._format(fmt, args))
+
+    def _format(self, fmt, args):
+        def convert(match):
+            flags, width, precision, _, conversion = match.groups()
+            if conversion == "%":
+                return "%"
+            if not args:
+                return match.group(0)
+            word = args.pop(0)
+            if conversion in "di":
+                value = word - (1 << 32) if word & 0x80000000 else word
+                conversion = "d"
+            elif conversion == "u":
+                value, conversion = word, "d"
+            elif conversion == "c":
+                value = chr(word & 0xFF)
+            elif conversion == "p":
+                value, conversion, flags = word, "x", flags + "#"
+            elif conversion == "s":
+                value = self.elf.string_at_address(word)
+                if value is None:
+                    value = "<0x%08X>" % word
+            else:
+                value = word
+            spec = "%" + flags + width + ("." + precision if precision else "") + conversion
+            return spec % value
+
+        return PRINTF_SPEC.sub(convert, fmt)
+
+    def _colorize(self, fmt, text):
+        if self.color:
+            for prefix, color in COLORS.items():
+                if fmt.startswith(prefix):
+                    return color + text + COLOR_DEFAULT
+        return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the binary debug traces of the LR1121 modem application")
+    parser.add_argument("elf", help="ELF file of the running firmware")
+    source = parser.add_mutually_exclusive_group()
+    source.add_argument("--port", help="serial port of the trace UART")
+    source.add_argument("--file", help="raw capture of the trace UART")
+    parser.add_argument("--baudrate", type=int, default=921600, help="trace UART baudrate (default: 921600)")
+    parser.add_argument("--no-color", action="store_true", help="do not color the traces")
+    options = parser.parse_args()
+
+    decoder = Decoder(Elf32(options.elf), color=not options.no_color)
+
+    if options.port:
+        import serial
+
+        stream = serial.Serial(options.port, options.baudrate, timeout=0.1)
+        read = lambda: stream.read(256)
+    else:
+        stream = open(options.file, "rb") if options.file else sys.stdin.buffer
+        read = lambda: stream.read1(256) if hasattr(stream, "read1") else stream.read(256)
+
+    try:
+        while True:
+            data = read()
+            if not data and not options.port:
+                break
+            text = decoder.feed(data)
+            if text:
+                sys.stdout.write(text)
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
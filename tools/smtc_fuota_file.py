@@ -0,0 +1,398 @@
+##
+## @file  smtc_fuota_file.py
+##
+## @brief Host generator of the FUOTA image files and delta patches
+##
+## The Clear BSD License
+## Copyright Semtech Corporation 2024. All rights reserved.
+##
+## Redistribution and use in source and binary forms, with or without
+## modification, are permitted (subject to the limitations in the disclaimer
+## below) provided that the following conditions are met:
+##     * Redistributions of source code must retain the above copyright
+##       notice, this list of conditions and the following disclaimer.
+##     * Redistributions in binary form must reproduce the above copyright
+##       notice, this list of conditions and the following disclaimer in the
+##       documentation and/or other materials provided with the distribution.
+##     * Neither the name of the Semtech corporation nor the
+##       names of its contributors may be used to endorse or promote products
+##       derived from this software without specific prior written permission.
+##
+## NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+## THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+## CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+## NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+## PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+## LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+## CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+## SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+## INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+## CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+## ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+## POSSIBILITY OF SUCH DAMAGE.
+##
+
+
+##
+## Usage:
+##   python smtc_fuota_file.py image [--compress] [--modem] [--image-version N] <new.bin> <out.fuota>
+##   python smtc_fuota_file.py delta [--compress] [--image-version N] <old.bin> <new.bin> <out.fuota>
+##   python smtc_fuota_file.py apply <old.bin> <file.fuota> <new.bin>
+##
+## The files are sent to the device through FUOTA. Once received by the modem, the device extracts them in its image
+## staging area (see Inc/apps/apps_fuota_file.h). <old.bin> must be the binary of the firmware running on the device:
+## a delta patch is rejected by a device running another firmware. With --compress, the payload (image or delta patch)
+## is LZSS compressed; the device decompresses it on the fly with a RAM window of 2^window_bits bytes. The apply command
+## decodes a file the way the device does, to check it on the host. The image version is reported by the device when
+## the image is staged and activated (see Inc/apps/apps_fuota_image.h).
+##
+## With --modem, <new.bin> is an encrypted LR1121 Modem-E firmware, either binary or the C header it is released
+## as, that the device writes in the modem (see Inc/apps/apps_modem_update.h). Its version is then given as
+## major.minor.patch and checked by the device once the new firmware runs.
+##
+
+import argparse
+import re
+import struct
+import sys
+import zlib
+
+HEADER_MAGIC = 0x31554653  # "SFU1"
+HEADER_FORMAT = "<IBBBxIIIII"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+FLAG_DELTA = 0x01
+FLAG_COMPRESSED = 0x02
+FLAG_MODEM = 0x04
+
+MAX_FILE_SIZE = 32768  # Largest FUOTA file the modem can store
+
+OP_INSERT = 0
+OP_COPY = 1
+
+BLOCK_SIZE = 8  # Size of the blocks of the old image indexed to find the copies
+MAX_CANDIDATES = 16  # Positions of the old image kept per block
+MIN_COPY = 12  # Shortest copy from an arbitrary position of the old image
+MIN_COPY_CONTINUED = 4  # Shortest copy continuing the previous one, its offset fits in a byte
+
+LZSS_MIN_LENGTH = 3
+LZSS_WINDOW_BITS = 11  # APPS_FUOTA_FILE_WINDOW_BITS_MAX: 2 KB of device RAM
+LZSS_LENGTH_BITS = (3, 4, 5, 6)  # Tried in turn, the smallest output is kept
+LZSS_MAX_CANDIDATES = 64  # Previous positions tried per match
+
+
+def crc32(data):
+    return zlib.crc32(data) & 0xFFFFFFFF
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def match_length(a, a_pos, b, b_pos):
+    """Number of identical bytes of a and b from a_pos and b_pos"""
+    length = 0
+    limit = min(len(a) - a_pos, len(b) - b_pos)
+    step = 64
+    while length < limit:
+        n = min(step, limit - length)
+        if a[a_pos + length : a_pos + length + n] == b[b_pos + length : b_pos + length + n]:
+            length += n
+            continue
+        if n == 1:
+            break
+        step = max(1, n // 8)
+    return length
+
+
+def delta_encode(old, new):
+    """Greedy copy/insert encoding of new against old"""
+    index = {}
+    for pos in range(len(old) - BLOCK_SIZE + 1):
+        positions = index.setdefault(old[pos : pos + BLOCK_SIZE], [])
+        if len(positions) < MAX_CANDIDATES:
+            positions.append(pos)
+
+    out = bytearray()
+    source_pos = 0  # End of the previous copy in old
+    literal_start = 0
+    pos = 0
+
+    def emit_insert(end):
+        if end > literal_start:
+            out.extend(varint(((end - literal_start) << 1) | OP_INSERT))
+            out.extend(new[literal_start:end])
+
+    while pos < len(new):
+        # Continuation of the previous copy, past the bytes replaced by the pending literals
+        expected = source_pos + (pos - literal_start)
+        best_pos, best_len = expected, 0
+        if expected < len(old):
+            best_len = match_length(new, pos, old, expected)
+        if best_len < MIN_COPY_CONTINUED:
+            best_len = 0
+            for candidate in index.get(new[pos : pos + BLOCK_SIZE], []):
+                length = match_length(new, pos, old, candidate)
+                if length > best_len:
+                    best_pos, best_len = candidate, length
+            if best_len < MIN_COPY:
+                pos += 1
+                continue
+
+        # Extend the copy backwards over the pending literals
+        while pos > literal_start and best_pos > 0 and new[pos - 1] == old[best_pos - 1]:
+            pos -= 1
+            best_pos -= 1
+            best_len += 1
+
+        emit_insert(pos)
+        out.extend(varint((best_len << 1) | OP_COPY))
+        out.extend(varint(zigzag(best_pos - source_pos)))
+        source_pos = best_pos + best_len
+        pos += best_len
+        literal_start = pos
+
+    emit_insert(len(new))
+    return bytes(out)
+
+
+def delta_decode(old, patch, image_size):
+    out = bytearray()
+    source_pos = 0
+    pos = 0
+
+    def read_varint():
+        nonlocal pos
+        value, shift = 0, 0
+        while True:
+            byte = patch[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    while pos < len(patch):
+        header = read_varint()
+        length = header >> 1
+        if length == 0:
+            raise ValueError("invalid delta operation at %u" % pos)
+        if header & 1 == OP_INSERT:
+            out.extend(patch[pos : pos + length])
+            pos += length
+        else:
+            offset = read_varint()
+            source_pos += (offset >> 1) ^ -(offset & 1)
+            if source_pos < 0 or source_pos + length > len(old):
+                raise ValueError("copy out of the old image at %u" % pos)
+            out.extend(old[source_pos : source_pos + length])
+            source_pos += length
+    if len(out) != image_size:
+        raise ValueError("image size %u, expected %u" % (len(out), image_size))
+    return bytes(out)
+
+
+def lzss_compress(data, window_bits, length_bits):
+    """Greedy LZSS: literal is 1 + byte, match is 0 + (distance - 1) + (length - LZSS_MIN_LENGTH), MSB first"""
+    window = 1 << window_bits
+    max_length = LZSS_MIN_LENGTH + (1 << length_bits) - 1
+    heads = {}
+    out = bytearray()
+    acc, acc_bits = 0, 0
+
+    def put(value, nbits):
+        nonlocal acc, acc_bits
+        acc = (acc << nbits) | value
+        acc_bits += nbits
+        while acc_bits >= 8:
+            acc_bits -= 8
+            out.append((acc >> acc_bits) & 0xFF)
+        acc &= (1 << acc_bits) - 1
+
+    def insert(pos):
+        positions = heads.setdefault(data[pos : pos + LZSS_MIN_LENGTH], [])
+        positions.append(pos)
+        if len(positions) > 2 * LZSS_MAX_CANDIDATES:
+            del positions[:LZSS_MAX_CANDIDATES]
+
+    pos = 0
+    while pos < len(data):
+        best_length, best_distance = 0, 0
+        for candidate in reversed(heads.get(data[pos : pos + LZSS_MIN_LENGTH], [])[-LZSS_MAX_CANDIDATES:]):
+            if pos - candidate > window:
+                break
+            length = min(match_length(data, pos, data, candidate), max_length)
+            if length > best_length:
+                best_length, best_distance = length, pos - candidate
+                if length == max_length:
+                    break
+        if best_length >= LZSS_MIN_LENGTH:
+            put(0, 1)
+            put(best_distance - 1, window_bits)
+            put(best_length - LZSS_MIN_LENGTH, length_bits)
+        else:
+            best_length = 1
+            put(0x100 | data[pos], 9)
+        for p in range(pos, pos + best_length):
+            insert(p)
+        pos += best_length
+
+    if acc_bits:
+        put(0, 8 - acc_bits)
+    return bytes(out)
+
+
+def lzss_decompress(data, window_bits, length_bits):
+    out = bytearray()
+    acc, acc_bits = 0, 0
+    for byte in data:
+        acc = ((acc << 8) | byte) & 0xFFFFFFFF
+        acc_bits += 8
+        while acc_bits > 0:
+            literal = (acc >> (acc_bits - 1)) & 1
+            nbits = 9 if literal else 1 + window_bits + length_bits
+            if acc_bits < nbits:
+                break
+            acc_bits -= nbits
+            token = (acc >> acc_bits) & ((1 << nbits) - 1)
+            if literal:
+                out.append(token & 0xFF)
+                continue
+            distance = ((token >> length_bits) & ((1 << window_bits) - 1)) + 1
+            length = (token & ((1 << length_bits) - 1)) + LZSS_MIN_LENGTH
+            if distance > len(out):
+                raise ValueError("LZSS distance out of the window")
+            for _ in range(length):
+                out.append(out[-distance])
+    if acc_bits >= 8:
+        raise ValueError("truncated LZSS stream")
+    return bytes(out)
+
+
+def compress(payload):
+    """Compress with the best length size, return (window_bits, length_bits, compressed payload)"""
+    results = [(LZSS_WINDOW_BITS, bits, lzss_compress(payload, LZSS_WINDOW_BITS, bits)) for bits in LZSS_LENGTH_BITS]
+    return min(results, key=lambda result: len(result[2]))
+
+
+def build_file(flags, image, payload, version, source=b"", compressed=False):
+    window_bits, length_bits = 0, 0
+    if compressed:
+        window_bits, length_bits, payload = compress(payload)
+        flags |= FLAG_COMPRESSED
+    header = struct.pack(
+        HEADER_FORMAT,
+        HEADER_MAGIC,
+        flags,
+        window_bits,
+        length_bits,
+        len(image),
+        crc32(image),
+        len(source),
+        crc32(source) if source else 0,
+        version,
+    )
+    return header + payload
+
+
+def write_file(path, data, image_size):
+    with open(path, "wb") as f:
+        f.write(data)
+    print("%s: %u bytes for a %u bytes image (ratio %.1f)" % (path, len(data), image_size, image_size / len(data)))
+    if len(data) > MAX_FILE_SIZE:
+        print("warning: larger than the %u bytes the modem can receive" % MAX_FILE_SIZE, file=sys.stderr)
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def read_modem_firmware(path):
+    """Return the words of an encrypted modem firmware, little endian as the device stores them"""
+    data = read(path)
+    if path.endswith(".h"):
+        words = [int(word, 16) for word in re.findall(rb"0x([0-9a-fA-F]{8})", data.split(b"{", 1)[-1])]
+        return struct.pack("<%uI" % len(words), *words)
+    if len(data) % 4 != 0:
+        sys.exit("%s: size not a multiple of 4 bytes" % path)
+    return data
+
+
+def version(text):
+    """Parse an image version, major.minor.patch being packed as the device reports the modem version"""
+    if "." in text:
+        major, minor, patch = (int(field) for field in text.split("."))
+        return (major << 16) | (minor << 8) | patch
+    return int(text, 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the FUOTA files of the LR1121 modem applications")
+    commands = parser.add_subparsers(dest="command", required=True)
+    image = commands.add_parser("image", help="full image file")
+    image.add_argument("--compress", action="store_true", help="LZSS compress the image")
+    image.add_argument("--modem", action="store_true", help="encrypted LR1121 Modem-E firmware (.bin or .h)")
+    image.add_argument("--image-version", type=version, default=0, help="version of the new firmware (default: 0)")
+    image.add_argument("new", help="binary of the new firmware")
+    image.add_argument("output", help="FUOTA file")
+    delta = commands.add_parser("delta", help="delta patch against the running firmware")
+    delta.add_argument("--compress", action="store_true", help="LZSS compress the delta patch")
+    delta.add_argument("--image-version", type=version, default=0, help="version of the new firmware (default: 0)")
+    delta.add_argument("old", help="binary of the firmware running on the device")
+    delta.add_argument("new", help="binary of the new firmware")
+    delta.add_argument("output", help="FUOTA file")
+    apply = commands.add_parser("apply", help="decode a FUOTA file as the device does")
+    apply.add_argument("old", help="binary of the firmware running on the device")
+    apply.add_argument("file", help="FUOTA file")
+    apply.add_argument("output", help="decoded image")
+    options = parser.parse_args()
+
+    if options.command == "image":
+        new = read_modem_firmware(options.new) if options.modem else read(options.new)
+        flags = FLAG_MODEM if options.modem else 0
+        fuota_file = build_file(flags, new, new, options.image_version, compressed=options.compress)
+        write_file(options.output, fuota_file, len(new))
+    elif options.command == "delta":
+        old, new = read(options.old), read(options.new)
+        patch = delta_encode(old, new)
+        fuota_file = build_file(FLAG_DELTA, new, patch, options.image_version, old, options.compress)
+        write_file(options.output, fuota_file, len(new))
+    else:
+        old, data = read(options.old), read(options.file)
+        fields = struct.unpack_from(HEADER_FORMAT, data)
+        magic, flags, window_bits, length_bits, image_size, image_crc, source_size, source_crc, image_version = fields
+        if magic != HEADER_MAGIC:
+            sys.exit("%s: no image header, raw file" % options.file)
+        payload = data[HEADER_SIZE:]
+        if flags & FLAG_COMPRESSED:
+            payload = lzss_decompress(payload, window_bits, length_bits)
+        if flags & FLAG_DELTA:
+            if source_size != len(old) or source_crc != crc32(old):
+                sys.exit("%s: generated against another firmware" % options.file)
+            payload = delta_decode(old, payload, image_size)
+        if crc32(payload) != image_crc:
+            sys.exit("%s: image CRC mismatch" % options.file)
+        with open(options.output, "wb") as f:
+            f.write(payload)
+        if flags & FLAG_MODEM:
+            major, minor, patch = image_version >> 16, (image_version >> 8) & 0xFF, image_version & 0xFF
+            print("%s: %u bytes modem firmware, version %u.%u.%u" % (options.output, len(payload), major, minor, patch))
+        else:
+            print("%s: %u bytes image, version %u" % (options.output, len(payload), image_version))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,313 @@
+##
+## @file  smtc_payload_codec.py
+##
+## @brief Host generator of the payload codec schemas and decoders
+##
+## The Clear BSD License
+## Copyright Semtech Corporation 2024. All rights reserved.
+##
+## Redistribution and use in source and binary forms, with or without
+## modification, are permitted (subject to the limitations in the disclaimer
+## below) provided that the following conditions are met:
+##     * Redistributions of source code must retain the above copyright
+##       notice, this list of conditions and the following disclaimer.
+##     * Redistributions in binary form must reproduce the above copyright
+##       notice, this list of conditions and the following disclaimer in the
+##       documentation and/or other materials provided with the distribution.
+##     * Neither the name of the Semtech corporation nor the
+##       names of its contributors may be used to endorse or promote products
+##       derived from this software without specific prior written permission.
+##
+## NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+## THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+## CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+## NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+## PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+## LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+## CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+## SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+## INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+## CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+## ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+## POSSIBILITY OF SUCH DAMAGE.
+##
+
+
+##
+## Usage:
+##   python smtc_payload_codec.py header <schema.json> <out.h>
+##   python smtc_payload_codec.py decoder <schema.json> <out.py>
+##   python smtc_payload_codec.py encode <schema.json> <values>... [--ack]
+##   python smtc_payload_codec.py decode <schema.json> <frame>...
+##
+## A schema lists the fields of the frames encoded by the device (see Inc/apps/apps_payload_codec.h):
+##   { "name": "counters", "fields": [ { "name": "uplinks", "type": "varint", "bits": 7, "delta_bits": 3 }, ... ] }
+## with type "unsigned" or "signed" (bits: width) or "varint" (bits: data bits per group), and delta_bits the data
+## bits per group of the difference with the reference frame, 0 or absent if the field is not delta encoded.
+##
+## The header command generates the C schema compiled in the application. The decoder command generates a standalone
+## Python decoder for the application server: it keeps the last frame decoded for each sequence number, so that the
+## delta frames are decoded against their reference frame. The encode and decode commands run the codec on the host:
+## encode takes one frame per argument, as comma-separated values, and with --ack acknowledges each frame the way the
+## device does on a confirmed uplink; decode takes the frames as hexadecimal strings.
+##
+
+import argparse
+import inspect
+import json
+import os
+import sys
+
+SEQUENCE_BITS = 4
+NB_SEQUENCES = 1 << SEQUENCE_BITS
+HISTORY_SIZE = 4
+MAX_FIELDS = 8
+FIELD_TYPES = ("unsigned", "signed", "varint")
+
+
+class Decoder:
+    """Stateful decoder of the frames of a schema"""
+
+    def __init__(self, schema):
+        self.fields = schema["fields"]
+        self.frames = {}
+
+    @staticmethod
+    def _read(frame, position, nb_bits):
+        if position + nb_bits > 8 * len(frame):
+            raise ValueError("frame too short")
+        value = 0
+        for i in range(position, position + nb_bits):
+            value = (value << 1) | ((frame[i // 8] >> (7 - i % 8)) & 1)
+        return value, position + nb_bits
+
+    @classmethod
+    def _read_varint(cls, frame, position, group_bits):
+        value, shift, more = 0, 0, 1
+        while more:
+            if shift >= 32:
+                raise ValueError("varint too long")
+            data, position = cls._read(frame, position, group_bits)
+            more, position = cls._read(frame, position, 1)
+            value |= data << shift
+            shift += group_bits
+        return (value >> 1) ^ -(value & 1), position
+
+    def decode(self, frame):
+        """Decode a frame, returns (sequence number, {field name: value})"""
+        delta, position = self._read(frame, 0, 1)
+        sequence, position = self._read(frame, position, SEQUENCE_BITS)
+        reference = None
+        if delta:
+            reference_sequence, position = self._read(frame, position, SEQUENCE_BITS)
+            if reference_sequence not in self.frames:
+                raise ValueError("reference frame %u not received" % reference_sequence)
+            reference = self.frames[reference_sequence]
+        values = {}
+        for field in self.fields:
+            name, bits = field["name"], field["bits"]
+            if reference is not None and field.get("delta_bits", 0):
+                difference, position = self._read_varint(frame, position, field["delta_bits"])
+                value = (reference[name] + difference) & 0xFFFFFFFF
+                if field["type"] != "unsigned":
+                    value = value - (1 << 32) if value & 0x80000000 else value
+            elif field["type"] == "varint":
+                value, position = self._read_varint(frame, position, bits)
+            else:
+                value, position = self._read(frame, position, bits)
+                if field["type"] == "signed" and value & (1 << (bits - 1)):
+                    value -= 1 << bits
+            values[name] = value
+        self.frames[sequence] = values
+        return sequence, values
+
+
+class Encoder:
+    """Encoder of the frames of a schema, as on the device"""
+
+    def __init__(self, schema):
+        self.fields = schema["fields"]
+        self.index = 0
+        self.reference = None
+        self.reference_index = 0
+        self.history = {}
+
+    def encode(self, values):
+        bits = []
+
+        def put(value, nb_bits):
+            bits.extend((value >> i) & 1 for i in range(nb_bits - 1, -1, -1))
+
+        def put_varint(value, group_bits):
+            value = ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+            while True:
+                data, value = value & ((1 << group_bits) - 1), value >> group_bits
+                put(data, group_bits)
+                put(1 if value else 0, 1)
+                if not value:
+                    break
+
+        delta = self.reference is not None and self.index - self.reference_index < NB_SEQUENCES
+        put(1 if delta else 0, 1)
+        put(self.index % NB_SEQUENCES, SEQUENCE_BITS)
+        if delta:
+            put(self.reference_index % NB_SEQUENCES, SEQUENCE_BITS)
+        for field, value in zip(self.fields, values):
+            bits_ = field["bits"]
+            if delta and field.get("delta_bits", 0):
+                difference = (value - self.reference[field["name"]]) & 0xFFFFFFFF
+                put_varint(difference - (1 << 32) if difference & 0x80000000 else difference, field["delta_bits"])
+            elif field["type"] == "varint":
+                put_varint(value - (1 << 32) if value >= 0x80000000 else value, bits_)
+            elif field["type"] == "signed":
+                if not -(1 << (bits_ - 1)) <= value < (1 << (bits_ - 1)):
+                    raise ValueError("%s: %d out of range" % (field["name"], value))
+                put(value & ((1 << bits_) - 1), bits_)
+            else:
+                if not 0 <= value < (1 << bits_):
+                    raise ValueError("%s: %d out of range" % (field["name"], value))
+                put(value, bits_)
+        bits.extend([0] * (-len(bits) % 8))
+        frame = bytes(int("".join(map(str, bits[i : i + 8])), 2) for i in range(0, len(bits), 8))
+        self.history[self.index] = {field["name"]: value for field, value in zip(self.fields, values)}
+        self.history.pop(self.index - HISTORY_SIZE, None)
+        self.index += 1
+        return frame
+
+    def acknowledge(self, sequence):
+        for index, values in self.history.items():
+            if index % NB_SEQUENCES == sequence and (self.reference is None or index > self.reference_index):
+                self.reference, self.reference_index = values, index
+
+
+def load_schema(path):
+    with open(path) as f:
+        schema = json.load(f)
+    fields = schema.get("fields", [])
+    if not schema.get("name") or not 0 < len(fields) <= MAX_FIELDS:
+        sys.exit("%s: a schema has a name and 1 to %u fields" % (path, MAX_FIELDS))
+    for field in fields:
+        max_bits = 8 if field.get("type") == "varint" else 32
+        if field.get("type") not in FIELD_TYPES or not 1 <= field.get("bits", 0) <= max_bits:
+            sys.exit("%s: invalid field %s" % (path, field))
+        if not 0 <= field.get("delta_bits", 0) <= 8:
+            sys.exit("%s: invalid delta_bits of field %s" % (path, field["name"]))
+    return schema
+
+
+def license_header(path, brief, comment):
+    lines = [line[3:] if len(line) > 2 else "" for line in LICENSE.splitlines()]
+    if comment == "c":
+        text = "/**\n * @file      %s\n *\n * @brief     %s\n *\n * @copyright\n * @parblock\n" % (path, brief)
+        text += "".join((" * " + line).rstrip() + "\n" for line in lines)
+        return text + " * @endparblock\n */\n"
+    text = "##\n## @file  %s\n##\n## @brief %s\n##\n" % (path, brief)
+    return text + "".join(("## " + line).rstrip() + "\n" for line in lines) + "##\n"
+
+
+def generate_header(schema, source, path):
+    name = schema["name"]
+    guard = os.path.basename(path).upper().replace(".", "_")
+    text = license_header(os.path.basename(path), "Payload codec schema \"%s\"" % name, "c")
+    text += "\n// Generated by tools/smtc_payload_codec.py from %s, do not edit\n\n" % os.path.basename(source)
+    text += "#ifndef %s\n#define %s\n\n#include \"apps_payload_codec.h\"\n\n" % (guard, guard)
+    text += "/**\n * @brief Fields of the \"%s\" frames\n */\nenum\n{\n" % name
+    for field in schema["fields"]:
+        text += "    %s_FIELD_%s,\n" % (name.upper(), field["name"].upper())
+    text += "    %s_NB_FIELDS,\n};\n\n" % name.upper()
+    text += "/**\n * @brief Schema of the \"%s\" frames\n */\n" % name
+    text += "static const apps_payload_codec_field_t %s_fields[%s_NB_FIELDS] = {\n" % (name, name.upper())
+    for field in schema["fields"]:
+        text += "    [%s_FIELD_%s] = { APPS_PAYLOAD_CODEC_%s, %u, %u },\n" % (
+            name.upper(),
+            field["name"].upper(),
+            field["type"].upper(),
+            field["bits"],
+            field.get("delta_bits", 0),
+        )
+    text += "};\n\n#endif  // %s\n\n/* --- EOF %s */\n" % (guard, "-" * 66)
+    return text
+
+
+def generate_decoder(schema, source, path):
+    text = license_header(os.path.basename(path), "Decoder of the \"%s\" payloads" % schema["name"], "python")
+    text += "\n##\n## Generated by tools/smtc_payload_codec.py from %s, do not edit\n" % os.path.basename(source)
+    text += "##\n## Usage:\n##   python %s <frame>...\n##\n\n" % os.path.basename(path)
+    text += "import sys\n\nSEQUENCE_BITS = %u\n\nSCHEMA = %s\n\n\n" % (SEQUENCE_BITS, json.dumps(schema, indent=4))
+    text += inspect.getsource(Decoder)
+    text += "\n\nif __name__ == \"__main__\":\n    decoder = Decoder(SCHEMA)\n    for frame in sys.argv[1:]:\n"
+    text += "        print(\"#%u %s\" % decoder.decode(bytes.fromhex(frame)))\n"
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the payload codec schemas and decoders")
+    commands = parser.add_subparsers(dest="command", required=True)
+    header = commands.add_parser("header", help="C schema compiled in the application")
+    header.add_argument("schema", help="JSON schema")
+    header.add_argument("output", help="C header")
+    decoder = commands.add_parser("decoder", help="standalone Python decoder")
+    decoder.add_argument("schema", help="JSON schema")
+    decoder.add_argument("output", help="Python decoder")
+    encode = commands.add_parser("encode", help="encode frames as the device does")
+    encode.add_argument("--ack", action="store_true", help="acknowledge each frame")
+    encode.add_argument("schema", help="JSON schema")
+    encode.add_argument("values", nargs="+", help="comma-separated values of a frame")
+    decode = commands.add_parser("decode", help="decode frames")
+    decode.add_argument("schema", help="JSON schema")
+    decode.add_argument("frames", nargs="+", help="hexadecimal frame")
+    options = parser.parse_args()
+
+    schema = load_schema(options.schema)
+    if options.command in ("header", "decoder"):
+        generate = generate_header if options.command == "header" else generate_decoder
+        with open(options.output, "w") as f:
+            f.write(generate(schema, options.schema, options.output))
+    elif options.command == "encode":
+        encoder = Encoder(schema)
+        for frame_values in options.values:
+            values = [int(value, 0) for value in frame_values.split(",")]
+            if len(values) != len(schema["fields"]):
+                sys.exit("%s: %u values expected" % (frame_values, len(schema["fields"])))
+            frame = encoder.encode(values)
+            print(frame.hex())
+            if options.ack:
+                encoder.acknowledge((frame[0] >> 3) & (NB_SEQUENCES - 1))
+    else:
+        decoder = Decoder(schema)
+        for frame in options.frames:
+            print("#%u %s" % decoder.decode(bytes.fromhex(frame)))
+
+
+LICENSE = """\
+## The Clear BSD License
+## Copyright Semtech Corporation 2024. All rights reserved.
+##
+## Redistribution and use in source and binary forms, with or without
+## modification, are permitted (subject to the limitations in the disclaimer
+## below) provided that the following conditions are met:
+##     * Redistributions of source code must retain the above copyright
+##       notice, this list of conditions and the following disclaimer.
+##     * Redistributions in binary form must reproduce the above copyright
+##       notice, this list of conditions and the following disclaimer in the
+##       documentation and/or other materials provided with the distribution.
+##     * Neither the name of the Semtech corporation nor the
+##       names of its contributors may be used to endorse or promote products
+##       derived from this software without specific prior written permission.
+##
+## NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+## THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+## CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+## NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+## PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+## LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+## CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+## SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+## INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+## CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+## ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+## POSSIBILITY OF SUCH DAMAGE.
+"""
+
+if __name__ == "__main__":
+    main()